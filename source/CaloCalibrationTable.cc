@@ -0,0 +1,150 @@
+#include "CaloCalibrationTable.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>  // for operator<<, endl, basic_ost...
+#include <limits>
+#include <sstream>
+
+//____________________________________________________________________________..
+int CaloCalibrationTable::Set(const std::string &name, const double weight, const std::vector<double> &limits, const std::vector<double> &factors)
+{
+  if (name.empty() || factors.empty() || limits.size() != factors.size() + 1 || !std::is_sorted(limits.begin(), limits.end()))
+  {
+    std::cout << "CaloCalibrationTable::Set - " << name << ": " << factors.size() << " factors need "
+              << factors.size() + 1 << " increasing limits, got " << limits.size() << std::endl;
+    return -1;
+  }
+  Entry &entry = m_Entries[name];
+  entry.weight = weight;
+  entry.limits = limits;
+  entry.factors = factors;
+  return 0;
+}
+
+//____________________________________________________________________________..
+const CaloCalibrationTable::Entry *CaloCalibrationTable::Get(const std::string &name) const
+{
+  auto iter = m_Entries.find(name);
+  return (iter != m_Entries.end()) ? &iter->second : nullptr;
+}
+
+//____________________________________________________________________________..
+int CaloCalibrationTable::Write(const std::string &file) const
+{
+  const std::string tmpfile = file + ".tmp";
+  {
+    std::ofstream out(tmpfile);
+    if (!out)
+    {
+      std::cout << "CaloCalibrationTable::Write - cannot open " << tmpfile << std::endl;
+      return -1;
+    }
+    // enough digits to read back the same doubles
+    out << std::setprecision(std::numeric_limits<double>::max_digits10);
+    out << "# name weight nslices limits[nslices + 1] factors[nslices]" << std::endl;
+    for (const auto &iter : m_Entries)
+    {
+      const Entry &entry = iter.second;
+      out << iter.first << " " << entry.weight << " " << entry.factors.size();
+      for (double limit : entry.limits)
+      {
+        out << " " << limit;
+      }
+      for (double factor : entry.factors)
+      {
+        out << " " << factor;
+      }
+      out << std::endl;
+    }
+    out.close();
+    if (!out)
+    {
+      std::cout << "CaloCalibrationTable::Write - error writing " << tmpfile << std::endl;
+      return -1;
+    }
+  }
+  if (std::rename(tmpfile.c_str(), file.c_str()))
+  {
+    std::cout << "CaloCalibrationTable::Write - cannot rename " << tmpfile << " to " << file << std::endl;
+    return -1;
+  }
+  return 0;
+}
+
+//____________________________________________________________________________..
+int CaloCalibrationTable::Read(const std::string &file)
+{
+  std::ifstream in(file);
+  if (!in)
+  {
+    std::cout << "CaloCalibrationTable::Read - cannot open " << file << std::endl;
+    return -1;
+  }
+  int nentries = 0;
+  std::string line;
+  for (int iline = 1; std::getline(in, line); iline++)
+  {
+    const size_t first = line.find_first_not_of(" \t");
+    if (first == std::string::npos || line[first] == '#')
+    {
+      continue;
+    }
+    std::istringstream is(line);
+    std::string name;
+    double weight = 0;
+    int nslices = 0;
+    if (!(is >> name >> weight >> nslices) || nslices <= 0)
+    {
+      std::cout << "CaloCalibrationTable::Read - " << file << ":" << iline << " is not a calibration entry: " << line << std::endl;
+      return -1;
+    }
+    std::vector<double> limits(nslices + 1);
+    std::vector<double> factors(nslices);
+    for (double &limit : limits)
+    {
+      is >> limit;
+    }
+    for (double &factor : factors)
+    {
+      is >> factor;
+    }
+    if (is.fail() || Set(name, weight, limits, factors))
+    {
+      std::cout << "CaloCalibrationTable::Read - " << file << ":" << iline << " is not a calibration entry: " << line << std::endl;
+      return -1;
+    }
+    nentries++;
+  }
+  return nentries;
+}
+
+//____________________________________________________________________________..
+int CaloCalibrationTable::Slice(const std::vector<double> &limits, const double e)
+{
+  // (limit[i], limit[i + 1]] as the ceil() of the analysis macros
+  const int slice = std::lower_bound(limits.begin(), limits.end(), e) - limits.begin() - 1;
+  return std::max(0, std::min(slice, static_cast<int>(limits.size()) - 2));
+}
+
+//____________________________________________________________________________..
+void CaloCalibrationTable::Print(const std::string &what) const
+{
+  std::cout << "CaloCalibrationTable: " << m_Entries.size() << " entries" << std::endl;
+  if (what != "ALL")
+  {
+    return;
+  }
+  for (const auto &iter : m_Entries)
+  {
+    const Entry &entry = iter.second;
+    std::cout << "  " << iter.first << ": weight " << entry.weight << std::endl;
+    for (size_t i = 0; i < entry.factors.size(); i++)
+    {
+      std::cout << "    " << std::setw(6) << entry.limits[i] << " -" << std::setw(6) << entry.limits[i + 1]
+                << " GeV: " << entry.factors[i] << std::endl;
+    }
+  }
+}
@@ -0,0 +1,59 @@
+// Tell emacs that this is a C++ source
+//  -*- C++ -*-.
+#ifndef CALOCALIBRATIONTABLE_H
+#define CALOCALIBRATIONTABLE_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+//! Per energy slice recalibration factors of the resolution analysis
+/*!
+ * LoopEvalFR.C/LoopEvalHR.C and CaloResolutionAnalysis normalise every
+ * detector by its mean response (weight) and its mean te/ge in the energy
+ * slice of the generated particle, the normalised sum is then divided by the
+ * mean of the sum in the slice. The table keeps one entry per detector and
+ * one for the sum (named after the analysis, e.g. FEMC_FHCAL, weight 1) so
+ * CaloRecalibrationReco can apply the same correction in the event loop.
+ * Text file, one entry per line:
+ *   name weight nslices limits[nslices + 1] factors[nslices]
+ * Energies are in GeV, a slice is (limit[i], limit[i + 1]].
+ */
+class CaloCalibrationTable
+{
+ public:
+  struct Entry
+  {
+    double weight = 1;  // mean te/ge of the detector
+    std::vector<double> limits;  // slice edges
+    std::vector<double> factors;  // mean te/ge per slice
+  };
+
+  CaloCalibrationTable() {}
+
+  virtual ~CaloCalibrationTable() {}
+
+  //! returns 0, -1 if limits and factors do not match
+  int Set(const std::string &name, const double weight, const std::vector<double> &limits, const std::vector<double> &factors);
+
+  //! nullptr if there is no entry name
+  const Entry *Get(const std::string &name) const;
+
+  size_t NEntries() const { return m_Entries.size(); }
+
+  //! writes <file>.tmp and renames it, returns 0 on success
+  int Write(const std::string &file) const;
+
+  //! adds the entries of file, returns the number of entries read, -1 on error
+  int Read(const std::string &file);
+
+  //! slice of energy e, energies outside the limits go to the first or last slice
+  static int Slice(const std::vector<double> &limits, const double e);
+
+  void Print(const std::string &what = "ALL") const;
+
+ private:
+  std::map<std::string, Entry> m_Entries;
+};
+
+#endif  // CALOCALIBRATIONTABLE_H
@@ -0,0 +1,881 @@
+#include "CaloCutExpression.h"
+
+#include "EvalRootTTree.h"
+#include "EvalTower.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>  // for operator<<, endl, basic_ost...
+
+namespace
+{
+  // variables of the expression, the event variables come first
+  enum Variable
+  {
+    kGe,
+    kGeta,
+    kGphi,
+    kGtheta,
+    kGpx,
+    kGpy,
+    kGpz,
+    kGvx,
+    kGvy,
+    kGvz,
+    kGpid,
+    kNtowers,
+    kTesum,
+    kTe,  // first tower variable
+    kTeta,
+    kTphi,
+    kTtheta,
+    kTt,
+    kTx,
+    kTy,
+    kTz,
+    kNVariables
+  };
+
+  const char *VariableNames[kNVariables] = {"ge", "geta", "gphi", "gtheta", "gpx", "gpy", "gpz",
+                                            "gvx", "gvy", "gvz", "gpid", "ntowers", "tesum",
+                                            "te", "teta", "tphi", "ttheta", "tt", "tx", "ty", "tz"};
+
+  double EventVariable(const EvalRootTTree *eval, const int var)
+  {
+    switch (var)
+    {
+    case kGe:
+      return eval->get_ge();
+    case kGeta:
+      return eval->get_geta();
+    case kGphi:
+      return eval->get_gphi();
+    case kGtheta:
+      return eval->get_gtheta();
+    case kGpx:
+      return eval->get_gpx();
+    case kGpy:
+      return eval->get_gpy();
+    case kGpz:
+      return eval->get_gpz();
+    case kGvx:
+      return eval->get_gvx();
+    case kGvy:
+      return eval->get_gvy();
+    case kGvz:
+      return eval->get_gvz();
+    case kGpid:
+      return eval->get_gpid();
+    case kNtowers:
+      return eval->get_ntowers();
+    case kTesum:
+      return eval->get_tesum();
+    }
+    return NAN;
+  }
+
+  const std::vector<double> &TowerVariable(const CaloTowerColumns &towers, const int var)
+  {
+    switch (var)
+    {
+    case kTeta:
+      return towers.teta;
+    case kTphi:
+      return towers.tphi;
+    case kTtheta:
+      return towers.ttheta;
+    case kTt:
+      return towers.tt;
+    case kTx:
+      return towers.tx;
+    case kTy:
+      return towers.ty;
+    case kTz:
+      return towers.tz;
+    }
+    return towers.te;
+  }
+
+  // operand of a bulk operation, either a column or an event value
+  struct Column
+  {
+    const double *p;
+    double operator[](const size_t i) const { return p[i]; }
+  };
+
+  struct Scalar
+  {
+    double v;
+    double operator[](const size_t) const { return v; }
+  };
+
+  template <typename A, typename B, typename F>
+  void Loop(double *out, const size_t n, const A a, const B b, F f)
+  {
+    for (size_t i = 0; i < n; i++)
+    {
+      out[i] = f(a[i], b[i]);
+    }
+  }
+}  // namespace
+
+//____________________________________________________________________________..
+void CaloTowerColumns::Fill(const EvalRootTTree *eval)
+{
+  std::vector<double> *columns[] = {&te, &teta, &tphi, &ttheta, &tt, &tx, &ty, &tz};
+  index.clear();
+  for (auto col : columns)
+  {
+    col->clear();
+  }
+  for (int j = 0; j < eval->get_ntowers(); j++)
+  {
+    const EvalTower *twr = eval->get_tower(j);
+    if (!twr)
+    {
+      continue;
+    }
+    index.push_back(j);
+    te.push_back(twr->get_te());
+    teta.push_back(twr->get_teta());
+    tphi.push_back(twr->get_tphi());
+    ttheta.push_back(twr->get_ttheta());
+    tt.push_back(twr->get_tt());
+    tx.push_back(twr->get_tx());
+    ty.push_back(twr->get_ty());
+    tz.push_back(twr->get_tz());
+  }
+}
+
+//____________________________________________________________________________..
+CaloCutExpression::CaloCutExpression(const std::string &expr)
+{
+  Compile(expr);
+}
+
+//____________________________________________________________________________..
+int CaloCutExpression::Compile(const std::string &expr)
+{
+  m_Expression = expr;
+  m_Error.clear();
+  m_Nodes.clear();
+  m_EventProgram.clear();
+  m_TowerProgram.clear();
+  m_Columns.clear();
+  m_Root = -1;
+  m_Pos = 0;
+  if (!Tokenize(expr))
+  {
+    return -1;
+  }
+  int root = ParseOr();
+  if (root >= 0 && Peek().type != Token::kEnd)
+  {
+    root = Fail("unexpected " + Peek().text);
+  }
+  m_Tokens.clear();
+  if (root < 0)
+  {
+    m_Nodes.clear();
+    return -1;
+  }
+
+  // event terms are scheduled once per event, tower terms once per column
+  m_ColumnOf.assign(m_Nodes.size(), -1);
+  std::vector<char> done(m_Nodes.size(), 0);
+  Schedule(root, done);
+  m_Scalars.assign(m_Nodes.size(), 0);
+  for (size_t i = 0; i < m_Nodes.size(); i++)
+  {
+    if (m_Nodes[i].op == kConst)
+    {
+      m_Scalars[i] = m_Nodes[i].value;
+    }
+  }
+  m_Columns.resize(m_TowerProgram.size());
+  m_Root = root;
+  return 0;
+}
+
+//____________________________________________________________________________..
+CaloCutExpression::Level CaloCutExpression::GetLevel() const
+{
+  return IsValid() ? m_Nodes[m_Root].level : kConstant;
+}
+
+//____________________________________________________________________________..
+void CaloCutExpression::SetEvent(const EvalRootTTree *eval)
+{
+  for (const int i : m_EventProgram)
+  {
+    const Node &node = m_Nodes[i];
+    if (node.op == kVar)
+    {
+      m_Scalars[i] = EventVariable(eval, node.var);
+    }
+    else
+    {
+      const double a = m_Scalars[node.arg[0]];
+      const double b = node.arg[1] >= 0 ? m_Scalars[node.arg[1]] : 0;
+      m_Scalars[i] = Apply(node.op, a, b);
+    }
+  }
+}
+
+//____________________________________________________________________________..
+double CaloCutExpression::EvalEvent() const
+{
+  if (!IsValid() || m_Nodes[m_Root].level == kTower)
+  {
+    return NAN;
+  }
+  return m_Scalars[m_Root];
+}
+
+//____________________________________________________________________________..
+void CaloCutExpression::EvalTowers(const CaloTowerColumns &towers, std::vector<double> &values) const
+{
+  const size_t n = towers.size();
+  if (!IsValid() || m_Nodes[m_Root].level != kTower)
+  {
+    values.assign(n, EvalEvent());
+    return;
+  }
+  const double *result = RunTowers(towers);
+  values.assign(result, result + n);
+}
+
+//____________________________________________________________________________..
+void CaloCutExpression::SelectTowers(const CaloTowerColumns &towers, std::vector<char> &pass) const
+{
+  const size_t n = towers.size();
+  if (!IsValid())
+  {
+    pass.assign(n, 0);
+    return;
+  }
+  if (m_Nodes[m_Root].level != kTower)
+  {
+    pass.assign(n, m_Scalars[m_Root] != 0);
+    return;
+  }
+  const double *result = RunTowers(towers);
+  pass.resize(n);
+  for (size_t i = 0; i < n; i++)
+  {
+    pass[i] = result[i] != 0;
+  }
+}
+
+//____________________________________________________________________________..
+void CaloCutExpression::Print(const std::string & /*what*/) const
+{
+  std::cout << "CaloCutExpression: " << m_Expression << std::endl;
+  if (!IsValid())
+  {
+    std::cout << "  invalid: " << m_Error << std::endl;
+    return;
+  }
+  std::cout << "  per event:" << std::endl;
+  for (const int i : m_EventProgram)
+  {
+    if (m_Nodes[i].op != kVar)
+    {
+      std::cout << "    " << Describe(i) << std::endl;
+    }
+  }
+  std::cout << "  per tower:" << std::endl;
+  for (const int i : m_TowerProgram)
+  {
+    std::cout << "    " << Describe(i) << std::endl;
+  }
+  if (m_Nodes[m_Root].level == kConstant)
+  {
+    std::cout << "  constant: " << m_Nodes[m_Root].value << std::endl;
+  }
+}
+
+//____________________________________________________________________________..
+const double *CaloCutExpression::RunTowers(const CaloTowerColumns &towers) const
+{
+  const size_t n = towers.size();
+  // tower variables are read from the columns directly
+  auto column = [&](const int i) {
+    const Node &node = m_Nodes[i];
+    return Column{node.op == kVar ? TowerVariable(towers, node.var).data() : m_Columns[m_ColumnOf[i]].data()};
+  };
+  for (const int i : m_TowerProgram)
+  {
+    const Node &node = m_Nodes[i];
+    std::vector<double> &col = m_Columns[m_ColumnOf[i]];
+    col.resize(n);
+    // at least one argument is a column, the other one may be an event value
+    const int ia = node.arg[0];
+    const int ib = node.arg[1];
+    const bool acol = m_Nodes[ia].level == kTower;
+    const bool bcol = ib >= 0 && m_Nodes[ib].level == kTower;
+    const Op op = node.op;
+    auto run = [&](const auto a, const auto b) {
+      double *out = col.data();
+      switch (op)
+      {
+      case kAdd:
+        Loop(out, n, a, b, [](double x, double y) { return x + y; });
+        break;
+      case kSub:
+        Loop(out, n, a, b, [](double x, double y) { return x - y; });
+        break;
+      case kMul:
+        Loop(out, n, a, b, [](double x, double y) { return x * y; });
+        break;
+      case kDiv:
+        Loop(out, n, a, b, [](double x, double y) { return x / y; });
+        break;
+      case kLt:
+        Loop(out, n, a, b, [](double x, double y) { return double(x < y); });
+        break;
+      case kLe:
+        Loop(out, n, a, b, [](double x, double y) { return double(x <= y); });
+        break;
+      case kGt:
+        Loop(out, n, a, b, [](double x, double y) { return double(x > y); });
+        break;
+      case kGe:
+        Loop(out, n, a, b, [](double x, double y) { return double(x >= y); });
+        break;
+      case kAnd:
+        Loop(out, n, a, b, [](double x, double y) { return double(x != 0 && y != 0); });
+        break;
+      case kOr:
+        Loop(out, n, a, b, [](double x, double y) { return double(x != 0 || y != 0); });
+        break;
+      default:
+        Loop(out, n, a, b, [op](double x, double y) { return Apply(op, x, y); });
+        break;
+      }
+    };
+    if (acol && bcol)
+    {
+      run(column(ia), column(ib));
+    }
+    else if (acol)
+    {
+      run(column(ia), Scalar{ib >= 0 ? m_Scalars[ib] : 0});
+    }
+    else
+    {
+      run(Scalar{m_Scalars[ia]}, column(ib));
+    }
+  }
+  return column(m_Root).p;
+}
+
+//____________________________________________________________________________..
+int CaloCutExpression::ParseOr()
+{
+  int a = ParseAnd();
+  while (a >= 0 && Accept("||"))
+  {
+    const int b = ParseAnd();
+    a = b < 0 ? -1 : MakeNode(kOr, a, b);
+  }
+  return a;
+}
+
+//____________________________________________________________________________..
+int CaloCutExpression::ParseAnd()
+{
+  int a = ParseCompare();
+  while (a >= 0 && Accept("&&"))
+  {
+    const int b = ParseCompare();
+    a = b < 0 ? -1 : MakeNode(kAnd, a, b);
+  }
+  return a;
+}
+
+//____________________________________________________________________________..
+int CaloCutExpression::ParseCompare()
+{
+  static const std::pair<const char *, Op> ops[] = {{"<=", kLe}, {">=", kGe}, {"==", kEq}, {"!=", kNe}, {"<", kLt}, {">", kGt}};
+  int a = ParseSum();
+  while (a >= 0)
+  {
+    bool found = false;
+    for (const auto &op : ops)
+    {
+      if (Accept(op.first))
+      {
+        const int b = ParseSum();
+        a = b < 0 ? -1 : MakeNode(op.second, a, b);
+        found = true;
+        break;
+      }
+    }
+    if (!found)
+    {
+      break;
+    }
+  }
+  return a;
+}
+
+//____________________________________________________________________________..
+int CaloCutExpression::ParseSum()
+{
+  int a = ParseProduct();
+  while (a >= 0)
+  {
+    Op op;
+    if (Accept("+"))
+    {
+      op = kAdd;
+    }
+    else if (Accept("-"))
+    {
+      op = kSub;
+    }
+    else
+    {
+      break;
+    }
+    const int b = ParseProduct();
+    a = b < 0 ? -1 : MakeNode(op, a, b);
+  }
+  return a;
+}
+
+//____________________________________________________________________________..
+int CaloCutExpression::ParseProduct()
+{
+  int a = ParseUnary();
+  while (a >= 0)
+  {
+    Op op;
+    if (Accept("*"))
+    {
+      op = kMul;
+    }
+    else if (Accept("/"))
+    {
+      op = kDiv;
+    }
+    else
+    {
+      break;
+    }
+    const int b = ParseUnary();
+    a = b < 0 ? -1 : MakeNode(op, a, b);
+  }
+  return a;
+}
+
+//____________________________________________________________________________..
+int CaloCutExpression::ParseUnary()
+{
+  if (Accept("-"))
+  {
+    const int a = ParseUnary();
+    return a < 0 ? -1 : MakeNode(kNeg, a);
+  }
+  if (Accept("!"))
+  {
+    const int a = ParseUnary();
+    return a < 0 ? -1 : MakeNode(kNot, a);
+  }
+  if (Accept("+"))
+  {
+    return ParseUnary();
+  }
+  return ParsePower();
+}
+
+//____________________________________________________________________________..
+int CaloCutExpression::ParsePower()
+{
+  const int a = ParsePrimary();
+  if (a >= 0 && (Accept("^") || Accept("**")))
+  {
+    // right associative, 2^-1 is allowed
+    const int b = ParseUnary();
+    return b < 0 ? -1 : MakeNode(kPow, a, b);
+  }
+  return a;
+}
+
+//____________________________________________________________________________..
+int CaloCutExpression::ParsePrimary()
+{
+  const Token tok = Peek();
+  if (tok.type == Token::kNumber)
+  {
+    m_Pos++;
+    return MakeConstant(tok.value);
+  }
+  if (Accept("("))
+  {
+    const int a = ParseOr();
+    if (a < 0)
+    {
+      return -1;
+    }
+    if (!Accept(")"))
+    {
+      return Fail("missing )");
+    }
+    return a;
+  }
+  if (tok.type != Token::kName)
+  {
+    return Fail(tok.type == Token::kEnd ? "unexpected end of expression" : "unexpected " + tok.text);
+  }
+  m_Pos++;
+  if (!Accept("("))
+  {
+    return MakeVariable(tok.text);
+  }
+
+  static const std::map<std::string, Op> functions = {
+      {"sqrt", kSqrt}, {"abs", kAbs}, {"fabs", kAbs}, {"exp", kExp}, {"log", kLog}, {"sin", kSin}, {"cos", kCos}, {"tan", kTan}, {"atan2", kAtan2}, {"min", kMin}, {"max", kMax}, {"pow", kPow}};
+  auto iter = functions.find(tok.text);
+  if (iter == functions.end())
+  {
+    return Fail("unknown function " + tok.text);
+  }
+  const Op op = iter->second;
+  int args[2] = {-1, -1};
+  for (int i = 0; i < NArgs(op); i++)
+  {
+    if (i > 0 && !Accept(","))
+    {
+      return Fail(tok.text + " needs " + std::to_string(NArgs(op)) + " arguments");
+    }
+    args[i] = ParseOr();
+    if (args[i] < 0)
+    {
+      return -1;
+    }
+  }
+  if (!Accept(")"))
+  {
+    return Fail("missing ) after arguments of " + tok.text);
+  }
+  return MakeNode(op, args[0], args[1]);
+}
+
+//____________________________________________________________________________..
+bool CaloCutExpression::Tokenize(const std::string &expr)
+{
+  static const char *symbols[] = {"**", "<=", ">=", "==", "!=", "&&", "||",
+                                  "+", "-", "*", "/", "^", "<", ">", "!", "(", ")", ","};
+  m_Tokens.clear();
+  size_t i = 0;
+  while (i < expr.size())
+  {
+    const char c = expr[i];
+    if (std::isspace(static_cast<unsigned char>(c)))
+    {
+      i++;
+      continue;
+    }
+    Token tok;
+    if (std::isdigit(static_cast<unsigned char>(c)) || c == '.')
+    {
+      const char *begin = expr.c_str() + i;
+      char *end = nullptr;
+      tok.type = Token::kNumber;
+      tok.value = std::strtod(begin, &end);
+      if (end == begin)
+      {
+        Fail("bad number at " + expr.substr(i));
+        return false;
+      }
+      tok.text = expr.substr(i, end - begin);
+      i += end - begin;
+    }
+    else if (std::isalpha(static_cast<unsigned char>(c)) || c == '_')
+    {
+      size_t j = i;
+      while (j < expr.size() && (std::isalnum(static_cast<unsigned char>(expr[j])) || expr[j] == '_'))
+      {
+        j++;
+      }
+      tok.type = Token::kName;
+      tok.text = expr.substr(i, j - i);
+      i = j;
+    }
+    else
+    {
+      for (const char *sym : symbols)
+      {
+        if (expr.compare(i, std::string(sym).size(), sym) == 0)
+        {
+          tok.type = Token::kSymbol;
+          tok.text = sym;
+          break;
+        }
+      }
+      if (tok.type != Token::kSymbol)
+      {
+        Fail(std::string("unknown character ") + c);
+        return false;
+      }
+      i += tok.text.size();
+    }
+    m_Tokens.push_back(tok);
+  }
+  m_Tokens.push_back(Token());
+  return true;
+}
+
+//____________________________________________________________________________..
+bool CaloCutExpression::Accept(const std::string &symbol)
+{
+  if (Peek().type == Token::kSymbol && Peek().text == symbol)
+  {
+    m_Pos++;
+    return true;
+  }
+  return false;
+}
+
+//____________________________________________________________________________..
+int CaloCutExpression::Fail(const std::string &msg)
+{
+  if (m_Error.empty())
+  {
+    m_Error = msg;
+    std::cout << "CaloCutExpression::Compile - " << msg << " in \"" << m_Expression << "\"" << std::endl;
+  }
+  return -1;
+}
+
+//____________________________________________________________________________..
+int CaloCutExpression::MakeNode(const Op op, const int a, const int b)
+{
+  Node node;
+  node.op = op;
+  node.arg[0] = a;
+  node.arg[1] = b;
+  node.level = std::max(m_Nodes[a].level, b >= 0 ? m_Nodes[b].level : kConstant);
+  // the usual squares of the elliptical cuts are a multiplication
+  if (op == kPow && node.level != kConstant && m_Nodes[b].level == kConstant && m_Nodes[b].value == 2)
+  {
+    return MakeNode(kMul, a, a);
+  }
+  // terms of constants only are folded right away
+  if (node.level == kConstant)
+  {
+    return MakeConstant(Apply(op, m_Nodes[a].value, b >= 0 ? m_Nodes[b].value : 0));
+  }
+  m_Nodes.push_back(node);
+  return m_Nodes.size() - 1;
+}
+
+//____________________________________________________________________________..
+int CaloCutExpression::MakeConstant(const double value)
+{
+  Node node;
+  node.op = kConst;
+  node.value = value;
+  m_Nodes.push_back(node);
+  return m_Nodes.size() - 1;
+}
+
+//____________________________________________________________________________..
+int CaloCutExpression::MakeVariable(const std::string &name)
+{
+  auto iter = m_Constants.find(name);
+  if (iter != m_Constants.end())
+  {
+    return MakeConstant(iter->second);
+  }
+  if (name == "pi")
+  {
+    return MakeConstant(M_PI);
+  }
+  // distances to the generated particle
+  if (name == "dphi")
+  {
+    return MakeNode(kSub, MakeVariable("tphi"), MakeVariable("gphi"));
+  }
+  if (name == "dtheta")
+  {
+    return MakeNode(kSub, MakeVariable("ttheta"), MakeVariable("gtheta"));
+  }
+  if (name == "deta")
+  {
+    return MakeNode(kSub, MakeVariable("teta"), MakeVariable("geta"));
+  }
+  for (int i = 0; i < kNVariables; i++)
+  {
+    if (name == VariableNames[i])
+    {
+      Node node;
+      node.op = kVar;
+      node.var = i;
+      node.level = i >= kTe ? kTower : kEvent;
+      m_Nodes.push_back(node);
+      return m_Nodes.size() - 1;
+    }
+  }
+  return Fail("unknown variable " + name);
+}
+
+//____________________________________________________________________________..
+void CaloCutExpression::Schedule(const int node, std::vector<char> &done)
+{
+  if (done[node])
+  {
+    return;
+  }
+  done[node] = 1;
+  const Node &n = m_Nodes[node];
+  if (n.level == kConstant)
+  {
+    return;
+  }
+  for (const int arg : n.arg)
+  {
+    if (arg >= 0)
+    {
+      Schedule(arg, done);
+    }
+  }
+  if (n.level == kEvent)
+  {
+    m_EventProgram.push_back(node);
+  }
+  else if (n.op != kVar)
+  {
+    m_ColumnOf[node] = m_TowerProgram.size();
+    m_TowerProgram.push_back(node);
+  }
+}
+
+//____________________________________________________________________________..
+std::string CaloCutExpression::Describe(const int node) const
+{
+  static const char *names[] = {"", "", "-", "!", "+", "-", "*", "/", "pow", "<", "<=", ">", ">=", "==", "!=", "&&", "||",
+                                "sqrt", "abs", "exp", "log", "sin", "cos", "tan", "atan2", "min", "max"};
+  const Node &n = m_Nodes[node];
+  switch (n.op)
+  {
+  case kConst:
+    return std::to_string(n.value);
+  case kVar:
+    return VariableNames[n.var];
+  case kNeg:
+  case kNot:
+    return names[n.op] + Describe(n.arg[0]);
+  case kAdd:
+  case kSub:
+  case kMul:
+  case kDiv:
+  case kLt:
+  case kLe:
+  case kGt:
+  case kGe:
+  case kEq:
+  case kNe:
+  case kAnd:
+  case kOr:
+    return "(" + Describe(n.arg[0]) + " " + names[n.op] + " " + Describe(n.arg[1]) + ")";
+  default:
+    break;
+  }
+  std::string s = std::string(names[n.op]) + "(" + Describe(n.arg[0]);
+  if (n.arg[1] >= 0)
+  {
+    s += ", " + Describe(n.arg[1]);
+  }
+  return s + ")";
+}
+
+//____________________________________________________________________________..
+double CaloCutExpression::Apply(const Op op, const double a, const double b)
+{
+  switch (op)
+  {
+  case kConst:
+  case kVar:
+    break;
+  case kNeg:
+    return -a;
+  case kNot:
+    return a == 0;
+  case kAdd:
+    return a + b;
+  case kSub:
+    return a - b;
+  case kMul:
+    return a * b;
+  case kDiv:
+    return a / b;
+  case kPow:
+    return std::pow(a, b);
+  case kLt:
+    return a < b;
+  case kLe:
+    return a <= b;
+  case kGt:
+    return a > b;
+  case kGe:
+    return a >= b;
+  case kEq:
+    return a == b;
+  case kNe:
+    return a != b;
+  case kAnd:
+    return a != 0 && b != 0;
+  case kOr:
+    return a != 0 || b != 0;
+  case kSqrt:
+    return std::sqrt(a);
+  case kAbs:
+    return std::fabs(a);
+  case kExp:
+    return std::exp(a);
+  case kLog:
+    return std::log(a);
+  case kSin:
+    return std::sin(a);
+  case kCos:
+    return std::cos(a);
+  case kTan:
+    return std::tan(a);
+  case kAtan2:
+    return std::atan2(a, b);
+  case kMin:
+    return std::min(a, b);
+  case kMax:
+    return std::max(a, b);
+  }
+  return NAN;
+}
+
+//____________________________________________________________________________..
+int CaloCutExpression::NArgs(const Op op)
+{
+  switch (op)
+  {
+  case kConst:
+  case kVar:
+    return 0;
+  case kNeg:
+  case kNot:
+  case kSqrt:
+  case kAbs:
+  case kExp:
+  case kLog:
+  case kSin:
+  case kCos:
+  case kTan:
+    return 1;
+  default:
+    break;
+  }
+  return 2;
+}
@@ -0,0 +1,198 @@
+// Tell emacs that this is a C++ source
+//  -*- C++ -*-.
+#ifndef CALOCUTEXPRESSION_H
+#define CALOCUTEXPRESSION_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+class EvalRootTTree;
+
+//! Tower quantities of one detector and event as columns
+struct CaloTowerColumns
+{
+  //! copy the towers of eval, towers which cannot be read are left out
+  void Fill(const EvalRootTTree *eval);
+
+  size_t size() const { return te.size(); }
+
+  // position of the tower in EvalRootTTree::get_tower()
+  std::vector<int> index;
+  std::vector<double> te;
+  std::vector<double> teta;
+  std::vector<double> tphi;
+  std::vector<double> ttheta;
+  std::vector<double> tt;
+  std::vector<double> tx;
+  std::vector<double> ty;
+  std::vector<double> tz;
+};
+
+//! Cut expression on the Eval trees, compiled once and evaluated in bulk
+/*!
+ * An expression like "te > 0.01 + 0.02*gtheta && (dphi/0.45)^2 + (dtheta/0.15)^2 <= 1"
+ * is parsed once into an operation list. Every term only depending on the
+ * generated particle (ge, geta, gphi, gtheta, ...) and constants is computed
+ * once per event in SetEvent(), so it is never evaluated inside the tower
+ * loop. The remaining per tower operations run over the tower columns of a
+ * CaloTowerColumns, one operation at a time for all towers.
+ *
+ * event variables: ge geta gphi gtheta gpx gpy gpz gvx gvy gvz gpid ntowers tesum
+ * tower variables: te teta tphi ttheta tt tx ty tz, dphi = tphi - gphi,
+ *                  dtheta = ttheta - gtheta, deta = teta - geta
+ * operators: + - * / ^ ** < <= > >= == != && || ! and parentheses
+ * functions: sqrt abs exp log sin cos tan atan2 min max pow
+ * plus the named constants set with SetConstant() before Compile().
+ *
+ * SetEvent() and the bulk evaluation use scratch space of the object, use
+ * one copy per thread.
+ */
+class CaloCutExpression
+{
+ public:
+  enum Level
+  {
+    kConstant = 0,
+    kEvent = 1,
+    kTower = 2
+  };
+
+  CaloCutExpression() {}
+
+  //! compiles expr, check IsValid()/Error()
+  explicit CaloCutExpression(const std::string &expr);
+
+  virtual ~CaloCutExpression() {}
+
+  //! named constant, e.g. a cut value which is scanned; must be set before Compile()
+  void SetConstant(const std::string &name, const double value) { m_Constants[name] = value; }
+
+  //! parse expr, returns 0 on success
+  int Compile(const std::string &expr);
+
+  bool IsValid() const { return m_Root >= 0; }
+  const std::string &Error() const { return m_Error; }
+  const std::string &Expression() const { return m_Expression; }
+
+  //! highest level of the variables used in the expression
+  Level GetLevel() const;
+
+  //! evaluate all event terms for this event
+  void SetEvent(const EvalRootTTree *eval);
+
+  //! value of an expression without tower variables (after SetEvent())
+  double EvalEvent() const;
+
+  //! value for every tower of the columns (after SetEvent())
+  void EvalTowers(const CaloTowerColumns &towers, std::vector<double> &values) const;
+
+  //! 1 for every tower passing the cut, 0 otherwise (after SetEvent())
+  void SelectTowers(const CaloTowerColumns &towers, std::vector<char> &pass) const;
+
+  //! operations done per event and per tower
+  void Print(const std::string &what = "ALL") const;
+
+ private:
+  enum Op
+  {
+    kConst,
+    kVar,
+    kNeg,
+    kNot,
+    kAdd,
+    kSub,
+    kMul,
+    kDiv,
+    kPow,
+    kLt,
+    kLe,
+    kGt,
+    kGe,
+    kEq,
+    kNe,
+    kAnd,
+    kOr,
+    kSqrt,
+    kAbs,
+    kExp,
+    kLog,
+    kSin,
+    kCos,
+    kTan,
+    kAtan2,
+    kMin,
+    kMax
+  };
+
+  struct Node
+  {
+    Op op = kConst;
+    double value = 0;
+    int var = -1;
+    int arg[2] = {-1, -1};
+    Level level = kConstant;
+  };
+
+  struct Token
+  {
+    enum Type
+    {
+      kNumber,
+      kName,
+      kSymbol,
+      kEnd
+    };
+    Type type = kEnd;
+    std::string text;
+    double value = 0;
+  };
+
+  // recursive descent parser, every function returns a node index or -1
+  int ParseOr();
+  int ParseAnd();
+  int ParseCompare();
+  int ParseSum();
+  int ParseProduct();
+  int ParseUnary();
+  int ParsePower();
+  int ParsePrimary();
+
+  bool Tokenize(const std::string &expr);
+  const Token &Peek() const { return m_Tokens[m_Pos]; }
+  bool Accept(const std::string &symbol);
+  int Fail(const std::string &msg);
+
+  int MakeNode(const Op op, const int a = -1, const int b = -1);
+  int MakeConstant(const double value);
+  int MakeVariable(const std::string &name);
+  void Schedule(const int node, std::vector<char> &done);
+  std::string Describe(const int node) const;
+
+  //! runs the tower program, returns the column of the result
+  const double *RunTowers(const CaloTowerColumns &towers) const;
+
+  static double Apply(const Op op, const double a, const double b);
+  static int NArgs(const Op op);
+
+  std::string m_Expression;
+  std::string m_Error;
+  std::map<std::string, double> m_Constants;
+
+  std::vector<Token> m_Tokens;
+  size_t m_Pos = 0;
+
+  std::vector<Node> m_Nodes;
+  int m_Root = -1;
+
+  // nodes in evaluation order, event (and constant) nodes are scalars,
+  // tower nodes get a column each
+  std::vector<int> m_EventProgram;
+  std::vector<int> m_TowerProgram;
+  std::vector<int> m_ColumnOf;
+
+  std::vector<double> m_Scalars;
+  mutable std::vector<std::vector<double>> m_Columns;
+};
+
+#endif  // CALOCUTEXPRESSION_H
@@ -0,0 +1,653 @@
+#include "CaloCutScan.h"
+
+#include "EvalRootTTree.h"
+#include "EvalTower.h"
+#include "EvalTreeReader.h"
+#include "SliceFitter.h"
+
+#include <ROOT/TSeq.hxx>
+#include <ROOT/TThreadExecutor.hxx>
+
+#include <TF1.h>
+#include <TFile.h>
+#include <TGraphErrors.h>
+#include <TH1.h>
+#include <TH2.h>
+#include <TROOT.h>
+#include <TTree.h>
+
+#include <algorithm>
+#include <functional>
+#include <iomanip>
+#include <iostream>  // for operator<<, endl, basic_ost...
+
+//____________________________________________________________________________..
+CaloCutScan::CaloCutScan(const std::string &name)
+  : m_Name(name)
+{
+  SetEnergyBinning(m_LowEnergy, m_MaxEnergy, m_LowBins, m_HighBins);
+}
+
+//____________________________________________________________________________..
+CaloCutScan::~CaloCutScan()
+{
+}
+
+//____________________________________________________________________________..
+void CaloCutScan::AddDetector(const std::string &det, const bool emc, const std::string &file)
+{
+  DetectorConfig config;
+  config.name = det;
+  config.file = file.empty() ? "merged_Eval_" + det + ".root" : file;
+  config.emc = emc;
+  m_Detectors.push_back(config);
+}
+
+//____________________________________________________________________________..
+void CaloCutScan::SetEnergyBinning(const double lowEnergy, const double maxEnergy, const int lowBins, const int highBins)
+{
+  m_LowEnergy = lowEnergy;
+  m_MaxEnergy = maxEnergy;
+  m_LowBins = lowBins;
+  m_HighBins = highBins;
+  m_BinLimits.clear();
+  for (int i = 0; i <= m_LowBins + m_HighBins; i++)
+  {
+    if (i <= m_LowBins)
+    {
+      m_BinLimits.push_back(m_LowEnergy * i / m_LowBins);
+    }
+    else
+    {
+      m_BinLimits.push_back(m_LowEnergy + (m_MaxEnergy - m_LowEnergy) * (i - m_LowBins) / m_HighBins);
+    }
+  }
+}
+
+//____________________________________________________________________________..
+void CaloCutScan::SetResolutionAxis(const int nbins, const double ymin, const double ymax)
+{
+  m_ResolutionBins = nbins;
+  m_ResolutionMin = ymin;
+  m_ResolutionMax = ymax;
+}
+
+//____________________________________________________________________________..
+void CaloCutScan::ScanRadius(const std::string &det, const std::vector<double> &x_radius, const std::vector<double> &y_radius)
+{
+  for (auto &config : m_Detectors)
+  {
+    if (config.name == det)
+    {
+      config.x_radius = x_radius;
+      config.y_radius = y_radius;
+      return;
+    }
+  }
+  std::cout << "CaloCutScan::ScanRadius - detector " << det << " not added via AddDetector()" << std::endl;
+}
+
+//____________________________________________________________________________..
+int CaloCutScan::Run()
+{
+  if (BuildGrid())
+  {
+    return -1;
+  }
+  m_Reader.reset(new EvalTreeReader());
+  m_Reader->Verbosity(m_Verbosity);
+  for (const auto &det : m_Detectors)
+  {
+    m_Reader->AddDetector(det.name, det.file);
+  }
+  if (m_Reader->Open())
+  {
+    return -1;
+  }
+  const long long nentries = m_Reader->GetEntries();
+  if (nentries <= 0)
+  {
+    std::cout << "CaloCutScan::Run - no entries in the input trees" << std::endl;
+    return -1;
+  }
+  const long long nchunks = (nentries + m_ChunkSize - 1) / m_ChunkSize;
+  auto work = [&](const size_t ichunk) {
+    ChunkResult result;
+    long long first = ichunk * m_ChunkSize;
+    ProcessChunk(first, std::min(first + m_ChunkSize, nentries), result);
+    return result;
+  };
+  ROOT::EnableThreadSafety();
+  ROOT::TThreadExecutor pool(m_NThreads);
+  std::vector<ChunkResult> results = pool.Map(work, ROOT::TSeqUL(nchunks));
+
+  // add the chunks up in entry order, independent of the thread scheduling
+  ChunkResult total;
+  total.events.resize(m_Configs.size());
+  for (auto &result : results)
+  {
+    if (total.weight_sum.empty())
+    {
+      total.weight_sum.assign(result.weight_sum.size(), 0);
+      total.weight_n.assign(result.weight_n.size(), 0);
+      total.profile_sum.assign(result.profile_sum.size(), 0);
+      total.profile_n.assign(result.profile_n.size(), 0);
+    }
+    for (size_t i = 0; i < result.weight_sum.size(); i++)
+    {
+      total.weight_sum[i] += result.weight_sum[i];
+      total.weight_n[i] += result.weight_n[i];
+    }
+    for (size_t i = 0; i < result.profile_sum.size(); i++)
+    {
+      total.profile_sum[i] += result.profile_sum[i];
+      total.profile_n[i] += result.profile_n[i];
+    }
+    for (size_t iconf = 0; iconf < result.events.size(); iconf++)
+    {
+      total.events[iconf].insert(total.events[iconf].end(), result.events[iconf].begin(), result.events[iconf].end());
+      std::vector<double>().swap(result.events[iconf]);
+    }
+  }
+  if (total.weight_sum.empty())
+  {
+    std::cout << "CaloCutScan::Run - reading the trees failed" << std::endl;
+    return -1;
+  }
+
+  // the slices of every configuration are fitted in parallel by the SliceFitter
+  m_Results.clear();
+  for (size_t iconf = 0; iconf < m_Configs.size(); iconf++)
+  {
+    m_Results.push_back(Evaluate(iconf, total));
+  }
+  if (m_Verbosity > 0)
+  {
+    std::cout << "CaloCutScan::Run - " << nentries << " entries, " << m_Configs.size()
+              << " configurations, " << m_Reader->MissingEvents() << " events skipped" << std::endl;
+  }
+  return 0;
+}
+
+//____________________________________________________________________________..
+int CaloCutScan::Write(const std::string &fname) const
+{
+  std::string outname = fname.empty() ? "cut_scan_" + m_Name + ".root" : fname;
+  std::unique_ptr<TFile> f(TFile::Open(outname.c_str(), "RECREATE"));
+  if (!f || f->IsZombie())
+  {
+    std::cout << "CaloCutScan::Write - cannot open " << outname << std::endl;
+    return -1;
+  }
+  const size_t ndet = m_Detectors.size();
+  int config = 0;
+  int slice = 0;
+  Long64_t events = 0;
+  double tower_cut = 0;
+  double aggregate_cut = 0;
+  std::string mip_cut;
+  std::vector<double> x_radius(ndet, 0);
+  std::vector<double> y_radius(ndet, 0);
+  SliceResult sr;
+  double constant_term = 0;
+  double stochastic_term = 0;
+
+  TTree *t = new TTree("scan", ("cut scan " + m_Name).c_str());
+  t->Branch("config", &config, "config/I");
+  t->Branch("slice", &slice, "slice/I");
+  t->Branch("events", &events, "events/L");
+  t->Branch("tower_cut", &tower_cut, "tower_cut/D");
+  t->Branch("aggregate_cut", &aggregate_cut, "aggregate_cut/D");
+  t->Branch("mip_cut", &mip_cut);
+  for (size_t idet = 0; idet < ndet; idet++)
+  {
+    const std::string &det = m_Detectors[idet].name;
+    t->Branch(("x_radius_" + det).c_str(), &x_radius[idet], ("x_radius_" + det + "/D").c_str());
+    t->Branch(("y_radius_" + det).c_str(), &y_radius[idet], ("y_radius_" + det + "/D").c_str());
+  }
+  t->Branch("ge_low", &sr.ge_low, "ge_low/D");
+  t->Branch("ge_high", &sr.ge_high, "ge_high/D");
+  t->Branch("entries", &sr.entries, "entries/D");
+  t->Branch("mean", &sr.mean, "mean/D");
+  t->Branch("mean_error", &sr.mean_error, "mean_error/D");
+  t->Branch("sigma", &sr.sigma, "sigma/D");
+  t->Branch("sigma_error", &sr.sigma_error, "sigma_error/D");
+  t->Branch("chi2", &sr.chi2, "chi2/D");
+  t->Branch("constant_term", &constant_term, "constant_term/D");
+  t->Branch("stochastic_term", &stochastic_term, "stochastic_term/D");
+
+  for (size_t iconf = 0; iconf < m_Results.size(); iconf++)
+  {
+    const Result &res = m_Results[iconf];
+    config = iconf;
+    events = res.events;
+    tower_cut = res.config.tower_cut;
+    aggregate_cut = res.config.aggregate_cut;
+    mip_cut = res.config.mip_cut;
+    // the branches point into x_radius/y_radius, copy without reallocating
+    std::copy(res.config.x_radius.begin(), res.config.x_radius.end(), x_radius.begin());
+    std::copy(res.config.y_radius.begin(), res.config.y_radius.end(), y_radius.begin());
+    constant_term = res.constant_term;
+    stochastic_term = res.stochastic_term;
+    for (size_t islice = 0; islice < res.slices.size(); islice++)
+    {
+      slice = islice + 1;
+      sr = res.slices[islice];
+      t->Fill();
+    }
+  }
+  t->Write();
+  f->Close();
+  std::cout << "CaloCutScan::Write - " << m_Results.size() << " configurations written to " << outname << std::endl;
+  return 0;
+}
+
+//____________________________________________________________________________..
+void CaloCutScan::PrintTable() const
+{
+  for (size_t iconf = 0; iconf < m_Results.size(); iconf++)
+  {
+    const Result &res = m_Results[iconf];
+    std::cout << "config " << iconf << ":";
+    for (size_t idet = 0; idet < m_Detectors.size(); idet++)
+    {
+      std::cout << " " << m_Detectors[idet].name << " " << res.config.x_radius[idet] << " x " << res.config.y_radius[idet] << ",";
+    }
+    std::cout << " tower cut " << res.config.tower_cut << ", aggregate cut " << res.config.aggregate_cut
+              << ", MIP cut " << res.config.mip_cut << ", " << res.events << " events" << std::endl;
+    std::cout << "  sigma = " << res.constant_term << " + " << res.stochastic_term << "/sqrt(E)" << std::endl;
+    for (const auto &sr : res.slices)
+    {
+      std::cout << "  " << std::setw(6) << sr.ge_low << " - " << std::setw(6) << sr.ge_high
+                << " GeV: mean " << sr.mean << " +- " << sr.mean_error
+                << ", sigma " << sr.sigma << " +- " << sr.sigma_error
+                << ", chi2/ndf " << sr.chi2 << std::endl;
+    }
+  }
+}
+
+//____________________________________________________________________________..
+void CaloCutScan::Print(const std::string & /*what*/) const
+{
+  std::cout << "CaloCutScan " << m_Name << ": " << m_EtaMin << " < geta < " << m_EtaMax << std::endl;
+  for (const auto &det : m_Detectors)
+  {
+    std::cout << "  " << det.name << " from " << det.file << (det.emc ? " (EMC)" : "") << ", x radius:";
+    for (auto r : det.x_radius)
+    {
+      std::cout << " " << r;
+    }
+    std::cout << ", y radius:";
+    for (auto r : det.y_radius)
+    {
+      std::cout << " " << r;
+    }
+    std::cout << std::endl;
+  }
+  std::cout << "  tower cuts:";
+  for (auto cut : m_TowerCutAxis)
+  {
+    std::cout << " " << cut;
+  }
+  std::cout << ", aggregate cuts:";
+  for (auto cut : m_AggregateCutAxis)
+  {
+    std::cout << " " << cut;
+  }
+  std::cout << ", MIP cuts:";
+  for (const auto &cut : m_MIPCutAxis)
+  {
+    std::cout << " \"" << cut << "\"";
+  }
+  std::cout << std::endl;
+  if (!m_ExtraConfigs.empty())
+  {
+    std::cout << "  plus " << m_ExtraConfigs.size() << " single configurations" << std::endl;
+  }
+}
+
+//____________________________________________________________________________..
+int CaloCutScan::BuildGrid()
+{
+  if (m_Detectors.empty())
+  {
+    std::cout << "CaloCutScan::BuildGrid - no detector set via AddDetector()" << std::endl;
+    return -1;
+  }
+  const size_t ndet = m_Detectors.size();
+  m_Configs.clear();
+  bool grid = true;
+  for (const auto &det : m_Detectors)
+  {
+    if (det.x_radius.empty() || det.y_radius.empty())
+    {
+      grid = false;
+    }
+  }
+  if (grid)
+  {
+    // expand one axis after the other, the last axis changes fastest
+    m_Configs.resize(1);
+    m_Configs[0].x_radius.assign(ndet, 0);
+    m_Configs[0].y_radius.assign(ndet, 0);
+    auto expand = [this](const size_t n, const std::function<void(Configuration &, size_t)> &set) {
+      std::vector<Configuration> expanded;
+      for (const auto &config : m_Configs)
+      {
+        for (size_t i = 0; i < n; i++)
+        {
+          expanded.push_back(config);
+          set(expanded.back(), i);
+        }
+      }
+      m_Configs.swap(expanded);
+    };
+    for (size_t idet = 0; idet < ndet; idet++)
+    {
+      const DetectorConfig &det = m_Detectors[idet];
+      expand(det.x_radius.size(), [&](Configuration &c, size_t i) { c.x_radius[idet] = det.x_radius[i]; });
+      expand(det.y_radius.size(), [&](Configuration &c, size_t i) { c.y_radius[idet] = det.y_radius[i]; });
+    }
+    expand(m_TowerCutAxis.size(), [this](Configuration &c, size_t i) { c.tower_cut = m_TowerCutAxis[i]; });
+    expand(m_AggregateCutAxis.size(), [this](Configuration &c, size_t i) { c.aggregate_cut = m_AggregateCutAxis[i]; });
+    expand(m_MIPCutAxis.size(), [this](Configuration &c, size_t i) { c.mip_cut = m_MIPCutAxis[i]; });
+  }
+  for (const auto &config : m_ExtraConfigs)
+  {
+    if (config.x_radius.size() != ndet || config.y_radius.size() != ndet)
+    {
+      std::cout << "CaloCutScan::BuildGrid - configuration needs one x/y radius per detector" << std::endl;
+      return -1;
+    }
+    m_Configs.push_back(config);
+  }
+  if (m_Configs.empty())
+  {
+    std::cout << "CaloCutScan::BuildGrid - no configuration, use ScanRadius() for every detector or AddConfiguration()" << std::endl;
+    return -1;
+  }
+
+  // structure of arrays for the tower loop, every MIP formula is evaluated once per event
+  const size_t nconf = m_Configs.size();
+  m_XRadius.assign(ndet * nconf, 0);
+  m_YRadius.assign(ndet * nconf, 0);
+  m_TowerCut.assign(nconf, 0);
+  m_AggregateCut.assign(nconf, 0);
+  m_MIPIndex.assign(nconf, 0);
+  m_MIPCuts.clear();
+  std::vector<std::string> formulas;
+  for (size_t iconf = 0; iconf < nconf; iconf++)
+  {
+    const Configuration &config = m_Configs[iconf];
+    for (size_t idet = 0; idet < ndet; idet++)
+    {
+      m_XRadius[idet * nconf + iconf] = config.x_radius[idet];
+      m_YRadius[idet * nconf + iconf] = config.y_radius[idet];
+    }
+    m_TowerCut[iconf] = config.tower_cut;
+    m_AggregateCut[iconf] = config.aggregate_cut;
+    auto iter = std::find(formulas.begin(), formulas.end(), config.mip_cut);
+    m_MIPIndex[iconf] = iter - formulas.begin();
+    if (iter == formulas.end())
+    {
+      std::string fname = "mip_cut_scan_" + m_Name + "_" + std::to_string(formulas.size());
+      m_MIPCuts.emplace_back(new TF1(fname.c_str(), config.mip_cut.c_str()));
+      formulas.push_back(config.mip_cut);
+    }
+  }
+  if (m_Verbosity > 0)
+  {
+    std::cout << "CaloCutScan::BuildGrid - " << nconf << " configurations" << std::endl;
+  }
+  return 0;
+}
+
+//____________________________________________________________________________..
+void CaloCutScan::ProcessChunk(const long long first, const long long last, ChunkResult &result) const
+{
+  std::unique_ptr<EvalTreeReader> reader = m_Reader->Clone();
+  if (!reader)
+  {
+    return;
+  }
+  const size_t nconf = m_Configs.size();
+  const size_t ndet = m_Detectors.size();
+  const size_t nslices = m_BinLimits.size() - 1;
+  // TF1::Eval is not thread safe, every task uses its own copies
+  std::vector<std::unique_ptr<TF1>> mipcuts;
+  for (const auto &mipcut : m_MIPCuts)
+  {
+    mipcuts.emplace_back(static_cast<TF1 *>(mipcut->Clone()));
+  }
+  std::vector<double> mipvalues(mipcuts.size(), 0);
+
+  result.events.resize(nconf);
+  result.weight_sum.assign(nconf * ndet, 0);
+  result.weight_n.assign(nconf * ndet, 0);
+  result.profile_sum.assign(nconf * ndet * nslices, 0);
+  result.profile_n.assign(nconf * ndet * nslices, 0);
+
+  // [det * nconf + config]
+  std::vector<double> cut(ndet * nconf, 0);
+  std::vector<double> te_detector(ndet * nconf, 0);
+  std::vector<double> te_circular(nconf, 0);
+  for (long long i = first; i < last; i++)
+  {
+    if (!reader->GetEntry(i))
+    {
+      continue;
+    }
+    const EvalRootTTree *gen = reader->Get(0);
+    const double geta = gen->get_geta();
+    if (geta < m_EtaMin || geta > m_EtaMax)
+    {
+      continue;
+    }
+    const double ge = gen->get_ge();
+    const double gtheta = gen->get_gtheta();
+    const double gphi = gen->get_gphi();
+    for (size_t imip = 0; imip < mipcuts.size(); imip++)
+    {
+      mipvalues[imip] = mipcuts[imip]->Eval(gtheta);
+    }
+    for (size_t idet = 0; idet < ndet; idet++)
+    {
+      const bool emc = m_Detectors[idet].emc;
+      for (size_t iconf = 0; iconf < nconf; iconf++)
+      {
+        cut[idet * nconf + iconf] = m_TowerCut[iconf] + (emc ? mipvalues[m_MIPIndex[iconf]] : 0);
+      }
+    }
+    std::fill(te_detector.begin(), te_detector.end(), 0);
+    std::fill(te_circular.begin(), te_circular.end(), 0);
+
+    for (size_t idet = 0; idet < ndet; idet++)
+    {
+      const EvalRootTTree *eval = reader->Get(idet);
+      const double *dcut = &cut[idet * nconf];
+      const double *xr = &m_XRadius[idet * nconf];
+      const double *yr = &m_YRadius[idet * nconf];
+      double *dsum = &te_detector[idet * nconf];
+      double *asum = te_circular.data();
+      for (int j = 0; j < eval->get_ntowers(); j++)
+      {
+        EvalTower *twr = eval->get_tower(j);
+        if (!twr)
+        {
+          continue;
+        }
+        const double te = twr->get_te();
+        const double dphi = twr->get_tphi() - gphi;
+        const double dtheta = twr->get_ttheta() - gtheta;
+        // no branches in here, adding 0 leaves the sums unchanged
+        for (size_t iconf = 0; iconf < nconf; iconf++)
+        {
+          const double a = dphi / yr[iconf];
+          const double b = dtheta / xr[iconf];
+          const bool pass = (te > dcut[iconf]) & (a * a + b * b <= 1);
+          const double inside = pass ? te : 0;
+          dsum[iconf] += inside;
+          asum[iconf] += inside;
+        }
+      }
+    }
+
+    // the per detector response which normalises the detectors to each other
+    const int slice = Slice(ge);
+    for (size_t iconf = 0; iconf < nconf; iconf++)
+    {
+      if (te_circular[iconf] <= m_AggregateCut[iconf])
+      {
+        continue;
+      }
+      std::vector<double> &events = result.events[iconf];
+      events.push_back(ge);
+      events.push_back(te_circular[iconf]);
+      for (size_t idet = 0; idet < ndet; idet++)
+      {
+        const double ratio = te_detector[idet * nconf + iconf] / ge;
+        events.push_back(te_detector[idet * nconf + iconf]);
+        // axis ranges of te_by_ge_ge_EtaCut_CircularCut_<det> and mean_te_by_ge_ge_EtaCut_CircularCut_<det>
+        const size_t index = iconf * ndet + idet;
+        if (ge >= 0 && ge < 30 && ratio >= -1 && ratio < 2)
+        {
+          result.weight_sum[index] += ratio;
+          result.weight_n[index] += 1;
+        }
+        if (slice >= 0 && ratio >= -0.5 && ratio <= 35)
+        {
+          result.profile_sum[index * nslices + slice] += ratio;
+          result.profile_n[index * nslices + slice] += 1;
+        }
+      }
+    }
+  }
+  if (m_Verbosity > 1)
+  {
+    std::cout << "CaloCutScan::ProcessChunk - entries " << first << " - " << last << std::endl;
+  }
+}
+
+//____________________________________________________________________________..
+CaloCutScan::Result CaloCutScan::Evaluate(const size_t iconf, const ChunkResult &total) const
+{
+  const size_t ndet = m_Detectors.size();
+  const size_t nslices = m_BinLimits.size() - 1;
+  const size_t stride = 2 + ndet;
+  const std::vector<double> &events = total.events[iconf];
+
+  Result res;
+  res.config = m_Configs[iconf];
+  res.events = events.size() / stride;
+
+  std::vector<double> weights(ndet, 0);
+  std::vector<double> detector_recalibration(ndet * nslices, 0);
+  for (size_t idet = 0; idet < ndet; idet++)
+  {
+    const size_t index = iconf * ndet + idet;
+    weights[idet] = total.weight_n[index] > 0 ? total.weight_sum[index] / total.weight_n[index] : 0;
+    for (size_t islice = 0; islice < nslices; islice++)
+    {
+      const double n = total.profile_n[index * nslices + islice];
+      detector_recalibration[idet * nslices + islice] = n > 0 ? total.profile_sum[index * nslices + islice] / n : 0;
+    }
+  }
+  auto normalised = [&](const size_t i, const int bin) {
+    double te_normalised = 0;
+    for (size_t idet = 0; idet < ndet; idet++)
+    {
+      te_normalised += events[i + 2 + idet] * weights[idet] / detector_recalibration[idet * nslices + bin];
+    }
+    return te_normalised;
+  };
+
+  // pass 2: recalibration of the normalised sum per energy bin
+  std::vector<double> sum(nslices, 0);
+  std::vector<double> n(nslices, 0);
+  for (size_t i = 0; i < events.size(); i += stride)
+  {
+    const double ge = events[i];
+    const double ratio = normalised(i, RecalibrationBin(ge)) / ge;
+    const int slice = Slice(ge);
+    if (slice >= 0 && ratio >= -0.5 && ratio <= 35)
+    {
+      sum[slice] += ratio;
+      n[slice] += 1;
+    }
+  }
+  std::vector<double> recalibration(nslices, 0);
+  for (size_t islice = 0; islice < nslices; islice++)
+  {
+    recalibration[islice] = n[islice] > 0 ? sum[islice] / n[islice] : 0;
+  }
+
+  // pass 3: resolution, sliced and fitted as in CaloResolutionAnalysis
+  std::string hname = "cut_scan_" + m_Name + "_" + std::to_string(iconf);
+  TH2D hres(hname.c_str(), "", nslices, m_BinLimits.data(), m_ResolutionBins, m_ResolutionMin, m_ResolutionMax);
+  hres.SetDirectory(nullptr);
+  for (size_t i = 0; i < events.size(); i += stride)
+  {
+    const double ge = events[i];
+    const int bin = RecalibrationBin(ge);
+    hres.Fill(ge, ((normalised(i, bin) / recalibration[bin]) - ge) / ge);
+  }
+  SliceFitter fitter(hname);
+  fitter.SetMinEntries(0);
+  fitter.SetNThreads(m_NThreads);
+  const std::vector<SliceFitter::SliceFit> fits = fitter.Fit(&hres);
+  for (const auto &fit : fits)
+  {
+    SliceResult sr;
+    sr.ge_low = m_BinLimits[fit.bin - 1];
+    sr.ge_high = m_BinLimits[fit.bin];
+    sr.entries = fit.entries;
+    if (fit.fitted)
+    {
+      sr.mean = fit.mean;
+      sr.mean_error = fit.mean_error;
+      sr.sigma = fit.sigma;
+      sr.sigma_error = fit.sigma_error;
+      sr.chi2 = fit.chi2;
+    }
+    res.slices.push_back(sr);
+  }
+  std::unique_ptr<TGraphErrors> gsigma(SliceFitter::Graph(fits, SliceFitter::kSigma, hname + "_sigma"));
+  if (gsigma->GetN() > 2)
+  {
+    TF1 fres((hname + "_fit").c_str(), "[0] + [1]/sqrt(x)", m_BinLimits.front(), m_BinLimits.back());
+    if (gsigma->Fit(&fres, "QN0") == 0)
+    {
+      res.constant_term = fres.GetParameter(0);
+      res.stochastic_term = fres.GetParameter(1);
+    }
+  }
+  return res;
+}
+
+//____________________________________________________________________________..
+int CaloCutScan::Slice(const double ge) const
+{
+  // TProfile::FindBin on the energy binning, -1 for under/overflow
+  if (ge < m_BinLimits.front() || ge >= m_BinLimits.back())
+  {
+    return -1;
+  }
+  return std::upper_bound(m_BinLimits.begin(), m_BinLimits.end(), ge) - m_BinLimits.begin() - 1;
+}
+
+//____________________________________________________________________________..
+int CaloCutScan::RecalibrationBin(const double ge) const
+{
+  // same as CaloResolutionAnalysis::RecalibrationBin()
+  int bin = 0;
+  if (ge > m_LowEnergy)
+  {
+    double eRangeBin = (m_MaxEnergy - m_LowEnergy) / m_HighBins;
+    bin = m_LowBins + ceil((ge - m_LowEnergy) / eRangeBin) - 1;
+  }
+  else
+  {
+    bin = ceil((ge / m_LowEnergy) * m_LowBins) - 1;
+  }
+  return std::max(0, std::min(bin, static_cast<int>(m_BinLimits.size()) - 2));
+}
@@ -0,0 +1,185 @@
+// Tell emacs that this is a C++ source
+//  -*- C++ -*-.
+#ifndef CALOCUTSCAN_H
+#define CALOCUTSCAN_H
+
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
+
+class EvalTreeReader;
+class TF1;
+
+//! Scan of the CaloResolutionAnalysis cuts in a single pass over the trees
+/*!
+ * Evaluates a grid of cut configurations (ellipse half axes per detector,
+ * tower energy cut, aggregate energy cut, MIP cut) with the same event
+ * selection and recalibration as CaloResolutionAnalysis. The trees are read
+ * only once, in parallel chunks through an EvalTreeReader. The angles of a
+ * tower to the generated particle are computed once and the cuts of all
+ * configurations are applied in a branch free loop over per configuration cut
+ * arrays, which the compiler vectorizes. Per configuration only ge and the
+ * ellipse sums of the events passing its aggregate cut are kept, the
+ * recalibration passes and the slice fits run on this cache. The result is a
+ * table of linearity (mean) and resolution (sigma) per configuration and
+ * energy slice, plus the fitted sigma = p0 + p1/sqrt(E).
+ */
+class CaloCutScan
+{
+ public:
+  struct Configuration
+  {
+    // one entry per detector, in the order of AddDetector()
+    std::vector<double> x_radius;
+    std::vector<double> y_radius;
+    double tower_cut = 0;
+    double aggregate_cut = 0;
+    // TF1 formula in the generated theta, applied to the EMC towers only
+    std::string mip_cut = "0";
+  };
+
+  struct SliceResult
+  {
+    double ge_low = 0;
+    double ge_high = 0;
+    double entries = 0;
+    double mean = NAN;
+    double mean_error = NAN;
+    double sigma = NAN;
+    double sigma_error = NAN;
+    double chi2 = NAN;
+  };
+
+  struct Result
+  {
+    Configuration config;
+    long long events = 0;
+    std::vector<SliceResult> slices;
+    double constant_term = NAN;
+    double stochastic_term = NAN;
+  };
+
+  //! name is used for the output file cut_scan_<name>.root
+  CaloCutScan(const std::string &name = "FEMC_FHCAL");
+
+  virtual ~CaloCutScan();
+
+  //! read merged_Eval_<det>.root (or file), the generated particle is taken from the first detector
+  void AddDetector(const std::string &det, const bool emc = false, const std::string &file = "");
+
+  void SetEtaRange(const double etamin, const double etamax)
+  {
+    m_EtaMin = etamin;
+    m_EtaMax = etamax;
+  }
+
+  //! same as CaloResolutionAnalysis::SetEnergyBinning()
+  void SetEnergyBinning(const double lowEnergy, const double maxEnergy, const int lowBins, const int highBins);
+
+  //! y axis of the (te-ge)/ge histogram which is sliced for the resolution
+  void SetResolutionAxis(const int nbins, const double ymin, const double ymax);
+
+  //! grid axes, Run() evaluates every combination of them
+  //! every detector needs its radius axis, the other axes default to a single value
+  void ScanRadius(const std::string &det, const std::vector<double> &x_radius, const std::vector<double> &y_radius);
+  void ScanTowerEnergyCut(const std::vector<double> &cuts) { m_TowerCutAxis = cuts; }
+  void ScanAggregateEnergyCut(const std::vector<double> &cuts) { m_AggregateCutAxis = cuts; }
+  void ScanMIPCut(const std::vector<std::string> &formulas) { m_MIPCutAxis = formulas; }
+
+  //! single configuration evaluated in addition to the grid
+  void AddConfiguration(const Configuration &config) { m_ExtraConfigs.push_back(config); }
+
+  //! number of threads, 0 = number of cores
+  void SetNThreads(const unsigned int n) { m_NThreads = n; }
+
+  //! number of tree entries processed by one task
+  void SetChunkSize(const long long n) { m_ChunkSize = n; }
+
+  void Verbosity(const int i) { m_Verbosity = i; }
+
+  //! read the trees once and evaluate all configurations, returns 0 on success
+  int Run();
+
+  const std::vector<Result> &Results() const { return m_Results; }
+
+  //! tree "scan" with one entry per configuration and energy slice
+  //! empty file name = cut_scan_<name>.root
+  int Write(const std::string &fname = "") const;
+
+  //! resolution and linearity table of all configurations
+  void PrintTable() const;
+
+  void Print(const std::string &what = "ALL") const;
+
+ private:
+  struct DetectorConfig
+  {
+    std::string name;
+    std::string file;
+    bool emc = false;
+    std::vector<double> x_radius;
+    std::vector<double> y_radius;
+  };
+
+  struct ChunkResult
+  {
+    // per configuration: ge, summed ellipse energy and ellipse energy of
+    // every detector of the events passing its aggregate cut
+    std::vector<std::vector<double>> events;
+    // te/ge response per [config * ndet + det], as the mean of te_by_ge_ge_EtaCut_CircularCut_<det>
+    std::vector<double> weight_sum;
+    std::vector<double> weight_n;
+    // te/ge response per [(config * ndet + det) * nslices + slice], as mean_te_by_ge_ge_EtaCut_CircularCut_<det>
+    std::vector<double> profile_sum;
+    std::vector<double> profile_n;
+  };
+
+  int BuildGrid();
+  void ProcessChunk(const long long first, const long long last, ChunkResult &result) const;
+  Result Evaluate(const size_t iconf, const ChunkResult &total) const;
+
+  int Slice(const double ge) const;
+  int RecalibrationBin(const double ge) const;
+
+  int m_Verbosity = 0;
+  int m_LowBins = 2;
+  int m_HighBins = 9;
+  int m_ResolutionBins = 350;
+
+  unsigned int m_NThreads = 0;
+
+  long long m_ChunkSize = 20000;
+
+  double m_EtaMin = -5;
+  double m_EtaMax = 5;
+  double m_LowEnergy = 3;
+  double m_MaxEnergy = 30;
+  double m_ResolutionMin = -0.99;
+  double m_ResolutionMax = 1;
+
+  std::string m_Name;
+
+  std::vector<DetectorConfig> m_Detectors;
+  std::vector<double> m_BinLimits;
+
+  std::vector<double> m_TowerCutAxis = {0};
+  std::vector<double> m_AggregateCutAxis = {0};
+  std::vector<std::string> m_MIPCutAxis = {"0"};
+  std::vector<Configuration> m_ExtraConfigs;
+
+  // grid of Run(), structure of arrays over the configurations for the tower loop
+  std::vector<Configuration> m_Configs;
+  std::vector<double> m_XRadius;  // [det * nconfig + config]
+  std::vector<double> m_YRadius;
+  std::vector<double> m_TowerCut;
+  std::vector<double> m_AggregateCut;
+  std::vector<int> m_MIPIndex;
+  std::vector<std::unique_ptr<TF1>> m_MIPCuts;
+
+  std::unique_ptr<EvalTreeReader> m_Reader;
+
+  std::vector<Result> m_Results;
+};
+
+#endif  // CALOCUTSCAN_H
@@ -0,0 +1,314 @@
+#include "CaloFastShowerReco.h"
+
+#include "CaloShowerParametrization.h"
+#include "CaloTowerLocator.h"
+#include "QAInstrumentation.h"
+
+#include <g4main/PHG4Particle.h>
+#include <g4main/PHG4TruthInfoContainer.h>
+#include <g4main/PHG4VtxPoint.h>
+
+#include <calobase/RawTower.h>
+#include <calobase/RawTowerContainer.h>
+#include <calobase/RawTowerGeomContainer.h>
+#include <calobase/RawTowerv1.h>
+
+#include <fun4all/Fun4AllReturnCodes.h>
+
+#include <phool/PHCompositeNode.h>
+#include <phool/getClass.h>
+
+#include <TRandom3.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>  // for operator<<, endl, basic_ost...
+
+namespace
+{
+  //! gamma distribution with shape alpha >= 1 and scale beta (Marsaglia and Tsang)
+  double SampleGamma(TRandom3 &rnd, const double alpha, const double beta)
+  {
+    const double d = alpha - 1. / 3.;
+    const double c = 1. / std::sqrt(9. * d);
+    while (true)
+    {
+      double x = 0;
+      double v = 0;
+      do
+      {
+        x = rnd.Gaus();
+        v = 1. + c * x;
+      } while (v <= 0);
+      v = v * v * v;
+      const double u = rnd.Rndm();
+      if (u < 1. - 0.0331 * x * x * x * x || std::log(u) < 0.5 * x * x + d * (1. - v + std::log(v)))
+      {
+        return d * v * beta;
+      }
+    }
+  }
+}  // namespace
+
+//____________________________________________________________________________..
+CaloFastShowerReco::CaloFastShowerReco(const std::string &name)
+  : SubsysReco(name)
+{
+}
+
+//____________________________________________________________________________..
+CaloFastShowerReco::~CaloFastShowerReco()
+{
+}
+
+//____________________________________________________________________________..
+int CaloFastShowerReco::Init(PHCompositeNode *topNode)
+{
+  if (m_Detector.empty())
+  {
+    std::cout << "CaloFastShowerReco::Init - Detector not set via Detector(<name>) method" << std::endl;
+    return Fun4AllReturnCodes::ABORTRUN;
+  }
+  if (m_ParametrizationFiles.empty())
+  {
+    std::cout << "CaloFastShowerReco::Init - no parametrization for " << m_Detector << ", use AddParametrization(<file>, <pid>)" << std::endl;
+    return Fun4AllReturnCodes::ABORTRUN;
+  }
+  for (const auto &iter : m_ParametrizationFiles)
+  {
+    CaloShowerParametrization *par = CaloShowerParametrization::Load(iter.second, m_Detector, iter.first);
+    if (!par)
+    {
+      std::cout << "CaloFastShowerReco::Init - no parametrization of pid " << iter.first << " for " << m_Detector
+                << " in " << iter.second << std::endl;
+      return Fun4AllReturnCodes::ABORTRUN;
+    }
+    if (Verbosity() > 0)
+    {
+      par->identify();
+    }
+    m_Parametrizations[iter.first].reset(par);
+  }
+  m_Random.reset(new TRandom3(m_Seed));
+  m_Timer = QAInstrumentation::instance()->Stage(Name());
+  return Fun4AllReturnCodes::EVENT_OK;
+}
+
+//____________________________________________________________________________..
+int CaloFastShowerReco::InitRun(PHCompositeNode *topNode)
+{
+  RawTowerGeomContainer *geom = findNode::getClass<RawTowerGeomContainer>(topNode, m_TowerGeoNodeName);
+  if (!geom)
+  {
+    std::cout << "CaloFastShowerReco::InitRun - could not find " << m_TowerGeoNodeName << std::endl;
+    return Fun4AllReturnCodes::ABORTRUN;
+  }
+  m_Locator.reset(new CaloTowerLocator());
+  if (m_Locator->Build(geom))
+  {
+    std::cout << "CaloFastShowerReco::InitRun - no towers in " << m_TowerGeoNodeName << std::endl;
+    return Fun4AllReturnCodes::ABORTRUN;
+  }
+  if (Verbosity() > 0)
+  {
+    std::cout << "CaloFastShowerReco " << m_Detector << ": " << m_Locator->NTowers() << " towers on a "
+              << m_Locator->EtaBins() << " x " << m_Locator->PhiBins() << " eta/phi grid" << std::endl;
+  }
+  return Fun4AllReturnCodes::EVENT_OK;
+}
+
+//____________________________________________________________________________..
+const CaloShowerParametrization *CaloFastShowerReco::GetParametrization(const int pid) const
+{
+  auto iter = m_Parametrizations.find(pid);
+  if (iter != m_Parametrizations.end())
+  {
+    return iter->second.get();
+  }
+  const int abspid = std::abs(pid);
+  if (abspid == 12 || abspid == 14 || abspid == 16)
+  {
+    return nullptr;
+  }
+  iter = m_Parametrizations.find(0);
+  return (iter != m_Parametrizations.end()) ? iter->second.get() : nullptr;
+}
+
+//____________________________________________________________________________..
+int CaloFastShowerReco::process_event(PHCompositeNode *topNode)
+{
+  QAInstrumentation::Scope timer(m_Timer);
+  RawTowerContainer *towers = findNode::getClass<RawTowerContainer>(topNode, m_TowerNodeName);
+  if (!towers)
+  {
+    std::cout << "CaloFastShowerReco::process_event - could not find " << m_TowerNodeName << std::endl;
+    return Fun4AllReturnCodes::ABORTRUN;
+  }
+  PHG4TruthInfoContainer *truthinfo = findNode::getClass<PHG4TruthInfoContainer>(topNode, "G4TruthInfo");
+  if (!truthinfo)
+  {
+    std::cout << "CaloFastShowerReco::process_event - could not find G4TruthInfo" << std::endl;
+    return Fun4AllReturnCodes::ABORTRUN;
+  }
+  if (m_ResetTowers)
+  {
+    towers->Reset();
+  }
+
+  // energy per tower index of all showers of this event
+  std::map<int, double> deposits;
+  PHG4TruthInfoContainer::ConstRange range = truthinfo->GetPrimaryParticleRange();
+  for (PHG4TruthInfoContainer::ConstIterator iter = range.first; iter != range.second; ++iter)
+  {
+    const PHG4Particle *primary = iter->second;
+    const CaloShowerParametrization *par = GetParametrization(primary->get_pid());
+    const double e = primary->get_e();
+    const double p = std::sqrt(primary->get_px() * primary->get_px() + primary->get_py() * primary->get_py() + primary->get_pz() * primary->get_pz());
+    if (!par || !(e > 0) || !(p > 0))
+    {
+      continue;
+    }
+    const double ux = primary->get_px() / p;
+    const double uy = primary->get_py() / p;
+    const double uz = primary->get_pz() / p;
+    double vx = 0;
+    double vy = 0;
+    double vz = 0;
+    const PHG4VtxPoint *vtx = truthinfo->GetPrimaryVtx(primary->get_vtx_id());
+    if (vtx)
+    {
+      vx = vtx->get_x();
+      vy = vtx->get_y();
+      vz = vtx->get_z();
+    }
+
+    // tower the particle points to, the tower geometry is seen from the origin:
+    // start with the direction and correct once for the vertex
+    int itower = m_Locator->Find(ux, uy, uz);
+    double dist = 0;
+    for (int i = 0; i < 2 && itower >= 0; i++)
+    {
+      const CaloTowerLocator::TowerCenter &center = m_Locator->Tower(itower);
+      dist = std::sqrt((center.x - vx) * (center.x - vx) + (center.y - vy) * (center.y - vy) + (center.z - vz) * (center.z - vz));
+      const double x = vx + dist * ux;
+      const double y = vy + dist * uy;
+      const double z = vz + dist * uz;
+      itower = m_Locator->Find(x, y, z);
+    }
+    if (itower < 0)
+    {
+      continue;
+    }
+    m_NShowers++;
+
+    const double evis = e * par->Response(e) * (1 + par->Resolution(e) * m_Random->Gaus());
+    if (!(evis > 0))
+    {
+      continue;
+    }
+    const double espot = evis / m_NSpots;
+    const double alpha = par->LongitudinalAlpha(e);
+    const double beta = par->LongitudinalBeta();
+    const bool longitudinal = (beta > 0);
+    const double tmean = longitudinal ? alpha * beta : 0;
+    const bool lateral = (par->LateralCoreRadius() > 0);
+
+    // axes perpendicular to the particle direction
+    double ax = 0;
+    double ay = 0;
+    double az = 1;
+    if (std::fabs(uz) > 0.9)
+    {
+      ax = 1;
+      az = 0;
+    }
+    double e1x = ay * uz - az * uy;
+    double e1y = az * ux - ax * uz;
+    double e1z = ax * uy - ay * ux;
+    const double norm = std::sqrt(e1x * e1x + e1y * e1y + e1z * e1z);
+    e1x /= norm;
+    e1y /= norm;
+    e1z /= norm;
+    const double e2x = uy * e1z - uz * e1y;
+    const double e2y = uz * e1x - ux * e1z;
+    const double e2z = ux * e1y - uy * e1x;
+
+    // the mean shower depth is at the center of the tower the particle points to
+    const double cx = vx + dist * ux;
+    const double cy = vy + dist * uy;
+    const double cz = vz + dist * uz;
+    for (int ispot = 0; ispot < m_NSpots; ispot++)
+    {
+      const double t = longitudinal ? SampleGamma(*m_Random, alpha, beta) - tmean : 0;
+      double r = 0;
+      if (lateral)
+      {
+        // r exp(-r/R) is the sum of two exponentials
+        const double radius = (m_Random->Rndm() < par->LateralCoreFraction()) ? par->LateralCoreRadius() : par->LateralTailRadius();
+        r = m_Random->Exp(radius) + m_Random->Exp(radius);
+      }
+      const double angle = 2 * M_PI * m_Random->Rndm();
+      const double x = cx + t * ux + r * (std::cos(angle) * e1x + std::sin(angle) * e2x);
+      const double y = cy + t * uy + r * (std::cos(angle) * e1y + std::sin(angle) * e2y);
+      const double z = cz + t * uz + r * (std::cos(angle) * e1z + std::sin(angle) * e2z);
+      const int ispottower = m_Locator->Find(x, y, z);
+      if (ispottower < 0)
+      {
+        m_NSpotsOutside++;
+        continue;
+      }
+      deposits[ispottower] += espot;
+    }
+  }
+
+  for (const auto &deposit : deposits)
+  {
+    const unsigned int key = m_Locator->Tower(deposit.first).key;
+    RawTower *tower = towers->getTower(key);
+    if (!tower)
+    {
+      tower = new RawTowerv1(key);
+      towers->AddTower(key, tower);
+    }
+    tower->set_energy(tower->get_energy() + deposit.second);
+  }
+  if (Verbosity() > 1)
+  {
+    std::cout << "CaloFastShowerReco " << m_Detector << ": " << deposits.size() << " towers filled" << std::endl;
+  }
+  return Fun4AllReturnCodes::EVENT_OK;
+}
+
+//____________________________________________________________________________..
+int CaloFastShowerReco::End(PHCompositeNode *topNode)
+{
+  if (Verbosity() > 0)
+  {
+    Print();
+  }
+  QAInstrumentation::instance()->End();
+  return Fun4AllReturnCodes::EVENT_OK;
+}
+
+//____________________________________________________________________________..
+void CaloFastShowerReco::Print(const std::string &what) const
+{
+  std::cout << "CaloFastShowerReco " << m_Detector << ": " << m_NShowers << " showers, " << m_NSpots << " spots per shower, "
+            << m_NSpotsOutside << " spots outside the towers" << std::endl;
+  if (what == "ALL" || what == "PARAMETRIZATION")
+  {
+    for (const auto &iter : m_Parametrizations)
+    {
+      iter.second->identify();
+    }
+  }
+}
+
+//____________________________________________________________________________..
+void CaloFastShowerReco::Detector(const std::string &name)
+{
+  m_Detector = name;
+  m_TowerNodeName = "TOWER_CALIB_" + name;
+  m_TowerGeoNodeName = "TOWERGEOM_" + name;
+}
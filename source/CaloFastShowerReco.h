@@ -0,0 +1,97 @@
+// Tell emacs that this is a C++ source
+//  -*- C++ -*-.
+#ifndef CALOFASTSHOWERRECO_H
+#define CALOFASTSHOWERRECO_H
+
+#include <fun4all/SubsysReco.h>
+
+#include <map>
+#include <memory>
+#include <string>
+
+class CaloShowerParametrization;
+class CaloTowerLocator;
+class PHCompositeNode;
+class TRandom3;
+
+//! Parametrized fast shower: fills the towers of a calorimeter without Geant4 showers
+/*!
+ * For QA scans the calorimeter is made a black hole in the G4 setup, this
+ * module then fills TOWER_CALIB_<det> (after the tower calibration, before
+ * the clustering) from the CaloShowerParametrization of the primaries:
+ *  - the visible energy is sampled from the response and resolution,
+ *  - it is split into NSpots spots with a depth along the particle
+ *    direction from the longitudinal and a distance to it from the lateral
+ *    profile; the depth is relative to the mean shower depth, which is placed
+ *    at the center of the tower the particle points to,
+ *  - every spot goes to the tower closest in eta and phi (CaloTowerLocator).
+ * The primaries go straight from their vertex (the QA drivers run without
+ * field), secondaries are not simulated. A parametrization for pid 0 is used
+ * for all primaries (except neutrinos) without their own parametrization.
+ */
+class CaloFastShowerReco : public SubsysReco
+{
+ public:
+  CaloFastShowerReco(const std::string &name = "CaloFastShowerReco");
+
+  virtual ~CaloFastShowerReco();
+
+  /** Called during initialization.
+      Reads the parametrizations.
+   */
+  int Init(PHCompositeNode *topNode) override;
+
+  /** Called for first event when run number is known.
+      Gets the tower geometry.
+   */
+  int InitRun(PHCompositeNode *topNode) override;
+
+  /** Called for each event.
+      This is where you do the real work.
+   */
+  int process_event(PHCompositeNode *topNode) override;
+
+  /// Called at the end of all processing.
+  int End(PHCompositeNode *topNode) override;
+
+  void Print(const std::string &what = "ALL") const override;
+
+  void Detector(const std::string &name);
+
+  //! read the parametrization of pid from file (written by CaloShowerFitter), pid 0 = all particles
+  void AddParametrization(const std::string &file, const int pid) { m_ParametrizationFiles[pid] = file; }
+
+  //! number of energy deposits per shower
+  void SetNSpots(const int n) { m_NSpots = n; }
+
+  void SetSeed(const unsigned int seed) { m_Seed = seed; }
+
+  //! remove the towers from the black hole (or an earlier module) before filling
+  void ResetTowers(const bool b = true) { m_ResetTowers = b; }
+
+ private:
+  const CaloShowerParametrization *GetParametrization(const int pid) const;
+
+  bool m_ResetTowers = true;
+
+  int m_NSpots = 100;
+  int m_Timer = -1;  // QAInstrumentation stage
+
+  unsigned int m_Seed = 4357;
+
+  long long m_NShowers = 0;
+  long long m_NSpotsOutside = 0;
+
+  std::string m_Detector;
+  std::string m_TowerNodeName;
+  std::string m_TowerGeoNodeName;
+
+  std::map<int, std::string> m_ParametrizationFiles;
+  std::map<int, std::unique_ptr<CaloShowerParametrization>> m_Parametrizations;
+
+  std::unique_ptr<TRandom3> m_Random;
+
+  std::unique_ptr<CaloTowerLocator> m_Locator;
+};
+
+#endif  // CALOFASTSHOWERRECO_H
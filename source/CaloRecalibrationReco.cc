@@ -0,0 +1,186 @@
+#include "CaloRecalibrationReco.h"
+
+#include "CaloCalibrationTable.h"
+#include "QAInstrumentation.h"
+
+#include <g4main/PHG4Particle.h>
+#include <g4main/PHG4TruthInfoContainer.h>
+
+#include <calobase/RawCluster.h>
+#include <calobase/RawClusterContainer.h>
+#include <calobase/RawTower.h>
+#include <calobase/RawTowerContainer.h>
+
+#include <fun4all/Fun4AllReturnCodes.h>
+
+#include <phool/PHCompositeNode.h>
+#include <phool/getClass.h>
+
+#include <cmath>
+#include <iostream>  // for operator<<, endl, basic_ost...
+
+//____________________________________________________________________________..
+CaloRecalibrationReco::CaloRecalibrationReco(const std::string &name)
+  : SubsysReco(name)
+{
+}
+
+//____________________________________________________________________________..
+int CaloRecalibrationReco::InitRun(PHCompositeNode *topNode)
+{
+  if (m_Detector.empty())
+  {
+    std::cout << "CaloRecalibrationReco::InitRun - Detector not set via Detector(<name>) method" << std::endl;
+    return Fun4AllReturnCodes::ABORTRUN;
+  }
+  CaloCalibrationTable table;
+  if (table.Read(m_TableFile) < 0)
+  {
+    return Fun4AllReturnCodes::ABORTRUN;
+  }
+  const CaloCalibrationTable::Entry *det = table.Get(m_Detector);
+  if (!det)
+  {
+    std::cout << "CaloRecalibrationReco::InitRun - no entry " << m_Detector << " in " << m_TableFile << std::endl;
+    return Fun4AllReturnCodes::ABORTRUN;
+  }
+  const CaloCalibrationTable::Entry *sum = nullptr;
+  if (!m_SumEntry.empty())
+  {
+    sum = table.Get(m_SumEntry);
+    if (!sum || sum->limits != det->limits)
+    {
+      std::cout << "CaloRecalibrationReco::InitRun - no entry " << m_SumEntry << " with the slices of "
+                << m_Detector << " in " << m_TableFile << std::endl;
+      return Fun4AllReturnCodes::ABORTRUN;
+    }
+  }
+
+  // one multiplication per tower in the event loop
+  m_Limits = det->limits;
+  m_Scale.clear();
+  for (size_t i = 0; i < det->factors.size(); i++)
+  {
+    double scale = 1;
+    if (det->factors[i] > 0 && (!sum || sum->factors[i] > 0))
+    {
+      scale = det->weight / det->factors[i] / (sum ? sum->factors[i] : 1);
+    }
+    else
+    {
+      std::cout << "CaloRecalibrationReco::InitRun - no factor for " << m_Limits[i] << " - " << m_Limits[i + 1]
+                << " GeV in " << m_TableFile << ", the slice is not recalibrated" << std::endl;
+    }
+    m_Scale.push_back(scale);
+  }
+  m_Timer = QAInstrumentation::instance()->Stage(Name());
+  if (Verbosity() > 0)
+  {
+    Print();
+  }
+  return Fun4AllReturnCodes::EVENT_OK;
+}
+
+//____________________________________________________________________________..
+double CaloRecalibrationReco::GeneratedEnergy(PHCompositeNode *topNode) const
+{
+  PHG4TruthInfoContainer *truthinfo = findNode::getClass<PHG4TruthInfoContainer>(topNode, "G4TruthInfo");
+  if (!truthinfo)
+  {
+    return -1;
+  }
+  // single particle QA, the analysis takes ge of the first primary as well
+  PHG4TruthInfoContainer::ConstRange range = truthinfo->GetPrimaryParticleRange();
+  if (range.first == range.second)
+  {
+    return -1;
+  }
+  return range.first->second->get_e();
+}
+
+//____________________________________________________________________________..
+int CaloRecalibrationReco::process_event(PHCompositeNode *topNode)
+{
+  QAInstrumentation::Scope timer(m_Timer);
+  const double ge = GeneratedEnergy(topNode);
+  if (ge < 0)
+  {
+    m_NNoParticle++;
+    return Fun4AllReturnCodes::EVENT_OK;
+  }
+  const double scale = m_Scale[CaloCalibrationTable::Slice(m_Limits, ge)];
+  if (m_Mode == kTower)
+  {
+    RawTowerContainer *towers = findNode::getClass<RawTowerContainer>(topNode, m_TowerNodeName);
+    if (!towers)
+    {
+      std::cout << "CaloRecalibrationReco::process_event - could not find " << m_TowerNodeName << std::endl;
+      return Fun4AllReturnCodes::ABORTRUN;
+    }
+    RawTowerContainer::ConstRange range = towers->getTowers();
+    for (RawTowerContainer::ConstIterator iter = range.first; iter != range.second; ++iter)
+    {
+      iter->second->set_energy(iter->second->get_energy() * scale);
+    }
+  }
+  else
+  {
+    RawClusterContainer *clusters = findNode::getClass<RawClusterContainer>(topNode, m_ClusterNodeName);
+    if (!clusters)
+    {
+      std::cout << "CaloRecalibrationReco::process_event - could not find " << m_ClusterNodeName << std::endl;
+      return Fun4AllReturnCodes::ABORTRUN;
+    }
+    for (const auto &iterator : clusters->getClustersMap())
+    {
+      RawCluster *cluster = iterator.second;
+      cluster->set_energy(cluster->get_energy() * scale);
+      if (std::isfinite(cluster->get_ecore()))
+      {
+        cluster->set_ecore(cluster->get_ecore() * scale);
+      }
+    }
+  }
+  m_NEvents++;
+  return Fun4AllReturnCodes::EVENT_OK;
+}
+
+//____________________________________________________________________________..
+int CaloRecalibrationReco::End(PHCompositeNode *topNode)
+{
+  if (m_NNoParticle > 0 || Verbosity() > 0)
+  {
+    std::cout << "CaloRecalibrationReco " << m_Detector << ": " << m_NEvents << " events recalibrated, "
+              << m_NNoParticle << " events without generated particle left unchanged" << std::endl;
+  }
+  QAInstrumentation::instance()->End();
+  return Fun4AllReturnCodes::EVENT_OK;
+}
+
+//____________________________________________________________________________..
+void CaloRecalibrationReco::Print(const std::string &what) const
+{
+  std::cout << "CaloRecalibrationReco " << m_Detector << ": " << ((m_Mode == kTower) ? m_TowerNodeName : m_ClusterNodeName)
+            << " recalibrated with " << m_TableFile << " (" << m_Detector;
+  if (!m_SumEntry.empty())
+  {
+    std::cout << ", " << m_SumEntry;
+  }
+  std::cout << ")" << std::endl;
+  if (what != "ALL")
+  {
+    return;
+  }
+  for (size_t i = 0; i < m_Scale.size(); i++)
+  {
+    std::cout << "  " << m_Limits[i] << " - " << m_Limits[i + 1] << " GeV: scale " << m_Scale[i] << std::endl;
+  }
+}
+
+//____________________________________________________________________________..
+void CaloRecalibrationReco::Detector(const std::string &name)
+{
+  m_Detector = name;
+  m_TowerNodeName = "TOWER_CALIB_" + name;
+  m_ClusterNodeName = "CLUSTER_" + name;
+}
@@ -0,0 +1,87 @@
+// Tell emacs that this is a C++ source
+//  -*- C++ -*-.
+#ifndef CALORECALIBRATIONRECO_H
+#define CALORECALIBRATIONRECO_H
+
+#include <fun4all/SubsysReco.h>
+
+#include <string>
+#include <vector>
+
+class PHCompositeNode;
+
+//! Applies the recalibration of a CaloCalibrationTable in the event loop
+/*!
+ * The table (written by LoopEvalFR.C/LoopEvalHR.C or LoopEvalMT.C) is read
+ * once in InitRun(), the factors of the detector entry and the optional sum
+ * entry are combined into one scale per energy slice:
+ *   scale = weight / factor_detector[slice] / factor_sum[slice]
+ * which is the normalisation of the resolution analysis. Per event the slice
+ * is picked by the energy of the generated particle, as in the analysis, and
+ * every tower of TOWER_CALIB_<det> (kTower) or every cluster of CLUSTER_<det>
+ * (kCluster) is scaled in place. Register it after the tower calibration
+ * (kTower, before the clustering) or after the clustering (kCluster), so the
+ * QA and Eval modules see recalibrated energies without another pass over
+ * the Eval trees. Slices with a factor <= 0 (no events in the analysis) are
+ * left unchanged.
+ */
+class CaloRecalibrationReco : public SubsysReco
+{
+ public:
+  enum Mode
+  {
+    kTower,
+    kCluster
+  };
+
+  CaloRecalibrationReco(const std::string &name = "CaloRecalibrationReco");
+
+  virtual ~CaloRecalibrationReco() {}
+
+  /** Called for first event when run number is known.
+      Reads the calibration table.
+   */
+  int InitRun(PHCompositeNode *topNode) override;
+
+  /** Called for each event.
+      This is where you do the real work.
+   */
+  int process_event(PHCompositeNode *topNode) override;
+
+  /// Called at the end of all processing.
+  int End(PHCompositeNode *topNode) override;
+
+  void Print(const std::string &what = "ALL") const override;
+
+  void Detector(const std::string &name);
+
+  void SetMode(const Mode mode) { m_Mode = mode; }
+
+  void SetTable(const std::string &file) { m_TableFile = file; }
+
+  //! entry of the recalibrated sum (e.g. FEMC_FHCAL), empty = detector entry only
+  void SetSumEntry(const std::string &name) { m_SumEntry = name; }
+
+ private:
+  //! energy of the generated particle, < 0 if there is none
+  double GeneratedEnergy(PHCompositeNode *topNode) const;
+
+  Mode m_Mode = kTower;
+
+  int m_Timer = -1;  // QAInstrumentation stage
+
+  long long m_NEvents = 0;
+  long long m_NNoParticle = 0;
+
+  std::string m_Detector;
+  std::string m_TowerNodeName;
+  std::string m_ClusterNodeName;
+  std::string m_TableFile = "calibration.txt";
+  std::string m_SumEntry;
+
+  // slice edges and combined scale per slice
+  std::vector<double> m_Limits;
+  std::vector<double> m_Scale;
+};
+
+#endif  // CALORECALIBRATIONRECO_H
@@ -0,0 +1,756 @@
+#include "CaloResolutionAnalysis.h"
+
+#include "CaloCalibrationTable.h"
+#include "EvalRootTTree.h"
+#include "EvalTower.h"
+#include "EvalTreeReader.h"
+#include "SliceFitter.h"
+
+#include <ROOT/TSeq.hxx>
+#include <ROOT/TThreadExecutor.hxx>
+
+#include <TF1.h>
+#include <TFile.h>
+#include <TH1.h>
+#include <TH2.h>
+#include <TObjArray.h>
+#include <TProfile.h>
+#include <TROOT.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>  // for operator<<, endl, basic_ost...
+
+namespace
+{
+  //! histograms created here must not end up in gDirectory, the threads
+  //! would otherwise register their copies in the same directory
+  class NoAddDirectory
+  {
+   public:
+    NoAddDirectory()
+      : m_Status(TH1::AddDirectoryStatus())
+    {
+      TH1::AddDirectory(kFALSE);
+    }
+    ~NoAddDirectory() { TH1::AddDirectory(m_Status); }
+
+   private:
+    bool m_Status;
+  };
+
+  void FormatAxes(TH1 *h, const char *xtitle, const char *ytitle)
+  {
+    h->GetXaxis()->SetTitle(xtitle);
+    h->GetXaxis()->SetLabelSize(0.05);
+    h->GetXaxis()->SetTitleSize(0.05);
+    h->GetYaxis()->SetTitle(ytitle);
+    h->GetYaxis()->SetLabelSize(0.05);
+    h->GetYaxis()->SetTitleSize(0.05);
+  }
+}  // namespace
+
+//____________________________________________________________________________..
+CaloResolutionAnalysis::CaloResolutionAnalysis(const std::string &name)
+  : m_Name(name)
+{
+  SetEnergyBinning(m_LowEnergy, m_MaxEnergy, m_LowBins, m_HighBins);
+}
+
+//____________________________________________________________________________..
+CaloResolutionAnalysis::~CaloResolutionAnalysis()
+{
+  for (auto &iter : m_Histos)
+  {
+    delete iter.second;
+  }
+  for (auto slice : m_Slices)
+  {
+    delete slice;
+  }
+}
+
+//____________________________________________________________________________..
+void CaloResolutionAnalysis::AddDetector(const std::string &det, const double x_radius, const double y_radius, const bool emc, const std::string &file)
+{
+  DetectorConfig config;
+  config.name = det;
+  config.file = file.empty() ? "merged_Eval_" + det + ".root" : file;
+  config.x_radius = x_radius;
+  config.y_radius = y_radius;
+  config.emc = emc;
+  m_Detectors.push_back(config);
+}
+
+//____________________________________________________________________________..
+void CaloResolutionAnalysis::SetMIPCut(const std::string &formula)
+{
+  m_MIPCut.reset(new TF1(("mip_pmzn_energy_cut_ftheta_" + m_Name).c_str(), formula.c_str()));
+}
+
+//____________________________________________________________________________..
+int CaloResolutionAnalysis::SetEventSelection(const std::string &expr)
+{
+  if (m_EventSelection.Compile(expr))
+  {
+    return -1;
+  }
+  if (m_EventSelection.GetLevel() == CaloCutExpression::kTower)
+  {
+    std::cout << "CaloResolutionAnalysis::SetEventSelection - tower variables in event selection " << expr << std::endl;
+    m_EventSelection = CaloCutExpression();
+    return -1;
+  }
+  return 0;
+}
+
+//____________________________________________________________________________..
+int CaloResolutionAnalysis::AddTowerSelection(const std::string &det, const std::string &expr)
+{
+  for (auto &config : m_Detectors)
+  {
+    if (config.name == det)
+    {
+      return config.tower_selection.Compile(expr);
+    }
+  }
+  std::cout << "CaloResolutionAnalysis::AddTowerSelection - detector " << det << " not added via AddDetector()" << std::endl;
+  return -1;
+}
+
+//____________________________________________________________________________..
+void CaloResolutionAnalysis::SetEnergyBinning(const double lowEnergy, const double maxEnergy, const int lowBins, const int highBins)
+{
+  m_LowEnergy = lowEnergy;
+  m_MaxEnergy = maxEnergy;
+  m_LowBins = lowBins;
+  m_HighBins = highBins;
+  // finer bins below the threshold energy where the response changes quickly
+  m_BinLimits.clear();
+  for (int i = 0; i <= m_LowBins + m_HighBins; i++)
+  {
+    if (i <= m_LowBins)
+    {
+      m_BinLimits.push_back(m_LowEnergy * i / m_LowBins);
+    }
+    else
+    {
+      m_BinLimits.push_back(m_LowEnergy + (m_MaxEnergy - m_LowEnergy) * (i - m_LowBins) / m_HighBins);
+    }
+  }
+}
+
+//____________________________________________________________________________..
+void CaloResolutionAnalysis::SetResolutionAxis(const int nbins, const double ymin, const double ymax)
+{
+  m_ResolutionBins = nbins;
+  m_ResolutionMin = ymin;
+  m_ResolutionMax = ymax;
+}
+
+//____________________________________________________________________________..
+int CaloResolutionAnalysis::Run()
+{
+  if (m_Detectors.empty())
+  {
+    std::cout << "CaloResolutionAnalysis::Run - no detector set via AddDetector()" << std::endl;
+    return -1;
+  }
+  // the detectors are matched by job and event number, events missing in
+  // one of them are skipped
+  m_Reader.reset(new EvalTreeReader());
+  m_Reader->Verbosity(m_Verbosity);
+  for (const auto &det : m_Detectors)
+  {
+    m_Reader->AddDetector(det.name, det.file);
+  }
+  if (m_Reader->Open())
+  {
+    return -1;
+  }
+  m_Entries = m_Reader->GetEntries();
+  if (m_Entries <= 0)
+  {
+    std::cout << "CaloResolutionAnalysis::Run - no entries in the input trees" << std::endl;
+    return -1;
+  }
+  BookHistos();
+  m_TotalTe = 0;
+  m_TotalTeCircularCut = 0;
+  m_TotalGe = 0;
+  m_MissingEvents = 0;
+
+  if (ReadTrees())
+  {
+    return -1;
+  }
+  // per detector response, used to normalise the detectors to each other
+  const int nslices = m_BinLimits.size() - 1;
+  m_Weights.clear();
+  m_DetectorRecalibration.clear();
+  for (const auto &det : m_Detectors)
+  {
+    m_Weights.push_back(GetHisto("te_by_ge_ge_EtaCut_CircularCut_" + det.name)->GetMean(2));
+    TH1 *mean = GetHisto("mean_te_by_ge_ge_EtaCut_CircularCut_" + det.name);
+    std::vector<double> recal;
+    for (int i = 1; i <= nslices; i++)
+    {
+      recal.push_back(mean->GetBinContent(i));
+    }
+    m_DetectorRecalibration.push_back(recal);
+    if (m_Verbosity > 0)
+    {
+      std::cout << det.name << " weight is : " << m_Weights.back() << std::endl;
+    }
+  }
+
+  RecalibrationPass(2);
+  m_Recalibration.clear();
+  TH1 *mean = GetHisto("mean_te_by_ge_ge_EtaCut_CircularCut");
+  for (int i = 1; i <= nslices; i++)
+  {
+    m_Recalibration.push_back(mean->GetBinContent(i));
+    if (m_Verbosity > 0)
+    {
+      std::cout << "Recalibration factor for slice " << i << " is: " << m_Recalibration.back() << std::endl;
+    }
+  }
+
+  RecalibrationPass(3);
+  FitSlices();
+  EstimateSlices();
+
+  std::cout << "The total te is: " << m_TotalTe << std::endl;
+  std::cout << "The total te_CircularCut is: " << m_TotalTeCircularCut << std::endl;
+  std::cout << "The total ge is: " << m_TotalGe << std::endl;
+  return 0;
+}
+
+//____________________________________________________________________________..
+int CaloResolutionAnalysis::Write(const std::string &fname) const
+{
+  std::string outname = fname.empty() ? "energy_verification_EtaCut_CircularCut_" + m_Name + ".root" : fname;
+  std::unique_ptr<TFile> f(TFile::Open(outname.c_str(), "RECREATE"));
+  if (!f || f->IsZombie())
+  {
+    std::cout << "CaloResolutionAnalysis::Write - cannot open " << outname << std::endl;
+    return -1;
+  }
+  for (const auto &hname : m_OutputOrder)
+  {
+    TH1 *h = GetHisto(hname);
+    if (h)
+    {
+      h->Write();
+    }
+  }
+  for (auto slice : m_Slices)
+  {
+    slice->Write();
+  }
+  f->Close();
+  return 0;
+}
+
+//____________________________________________________________________________..
+int CaloResolutionAnalysis::WriteCalibration(const std::string &fname) const
+{
+  if (m_Recalibration.empty())
+  {
+    std::cout << "CaloResolutionAnalysis::WriteCalibration - no recalibration factors, call Run() first" << std::endl;
+    return -1;
+  }
+  CaloCalibrationTable table;
+  for (size_t idet = 0; idet < m_Detectors.size(); idet++)
+  {
+    table.Set(m_Detectors[idet].name, m_Weights[idet], m_BinLimits, m_DetectorRecalibration[idet]);
+  }
+  table.Set(m_Name, 1, m_BinLimits, m_Recalibration);
+  if (table.Write(fname))
+  {
+    return -1;
+  }
+  std::cout << "CaloResolutionAnalysis::WriteCalibration - recalibration of " << m_Name << " written to " << fname << std::endl;
+  return 0;
+}
+
+//____________________________________________________________________________..
+TH1 *CaloResolutionAnalysis::GetHisto(const std::string &hname) const
+{
+  auto iter = m_Histos.find(hname);
+  if (iter == m_Histos.end())
+  {
+    return nullptr;
+  }
+  return iter->second;
+}
+
+//____________________________________________________________________________..
+TH1D *CaloResolutionAnalysis::GetSlice(const int i) const
+{
+  if (i < 0 || i >= GetNSlices())
+  {
+    return nullptr;
+  }
+  return m_Slices[i];
+}
+
+//____________________________________________________________________________..
+void CaloResolutionAnalysis::Print(const std::string & /*what*/) const
+{
+  std::cout << "CaloResolutionAnalysis " << m_Name << ": " << m_EtaMin << " < geta < " << m_EtaMax
+            << ", tower cut " << m_TowerEnergyCut << ", aggregate cut " << m_AggregateEnergyCut << std::endl;
+  for (const auto &det : m_Detectors)
+  {
+    std::cout << "  " << det.name << " from " << det.file << ", ellipse " << det.x_radius << " x " << det.y_radius
+              << (det.emc && m_MIPCut ? ", MIP cut " + std::string(m_MIPCut->GetExpFormula().Data()) : "") << std::endl;
+    if (det.tower_selection.IsValid())
+    {
+      det.tower_selection.Print();
+    }
+  }
+  if (m_EventSelection.IsValid())
+  {
+    m_EventSelection.Print();
+  }
+  std::cout << "  energy bins:";
+  for (auto limit : m_BinLimits)
+  {
+    std::cout << " " << limit;
+  }
+  std::cout << std::endl;
+}
+
+//____________________________________________________________________________..
+void CaloResolutionAnalysis::BookHistos()
+{
+  for (auto &iter : m_Histos)
+  {
+    delete iter.second;
+  }
+  m_Histos.clear();
+  m_OutputOrder.clear();
+  for (auto slice : m_Slices)
+  {
+    delete slice;
+  }
+  m_Slices.clear();
+
+  NoAddDirectory noadd;
+  const int nslices = m_BinLimits.size() - 1;
+  const double *bins = m_BinLimits.data();
+  auto book = [this](TH1 *h, const char *xtitle, const char *ytitle, const bool output) {
+    FormatAxes(h, xtitle, ytitle);
+    m_Histos[h->GetName()] = h;
+    if (output)
+    {
+      m_OutputOrder.push_back(h->GetName());
+    }
+  };
+
+  book(new TH2D("te_by_ge_ge_EtaCut", "te_{agg}/ge vs ge", 200, 0, 30, 200, -0.5, 1.5), "Generated Energy (GeV)", "te_{agg}/ge", true);
+  book(new TH2D("te_by_ge_ge_EtaCut_CircularCut", "te_{agg}/ge vs ge", 200, 0, 30, 200, m_RatioMin, m_RatioMax), "Generated Energy (GeV)", "te_{agg}/ge", true);
+  book(new TH2D("te_minus_ge_by_ge_ge_EtaCut", "#frac{#Delta e_{agg}}{truth e} vs truth e", 200, 0, 30, 200, -2, 1), "Generated Energy (GeV)", "(te_{agg}-ge)/ge", true);
+  book(new TH2D("te_minus_ge_by_ge_ge_EtaCut_CircularCut", "#frac{#Delta e_{agg}}{truth e} vs truth e", 200, 0, 30, 200, -1.5, 2), "Generated Energy (GeV)", "(te_{agg}-ge)/ge", true);
+  book(new TProfile("mean_te_by_ge_ge_EtaCut_CircularCut", "Mean_{te/ge}", nslices, bins, -0.5, 35), "Generated Energy (GeV)", "Mean of te_{agg}/ge", true);
+  for (const auto &det : m_Detectors)
+  {
+    std::string ytitle = "Mean of te_{agg}/ge (" + det.name + ")";
+    book(new TProfile(("mean_te_by_ge_ge_EtaCut_CircularCut_" + det.name).c_str(), "Mean_{te/ge}", nslices, bins, -0.5, 35), "Generated Energy (GeV)", ytitle.c_str(), true);
+  }
+  book(new TH2D("te_minus_ge_by_ge_ge_EtaCut_CircularCut_Recalibrated", "#frac{#Delta e_{agg}}{truth e} vs truth e", 200, 0, 30, 200, -1.5, 1.5), "Generated Energy (GeV)", "(te_{agg}-ge)/ge", true);
+  // histogram from which mean vs ge, sigma vs ge, and reduced_chi2 vs ge plots are derived
+  book(new TH2D("te_minus_ge_by_ge_ge_EtaCut_CircularCut_Recalibrated_temp", "#frac{#Delta e_{agg}}{truth e} vs truth e", nslices, bins, m_ResolutionBins, m_ResolutionMin, m_ResolutionMax), "Generated Energy (GeV)", "(te_{agg}-ge)/ge", false);
+  for (const auto &det : m_Detectors)
+  {
+    book(new TH2D(("te_by_ge_ge_EtaCut_CircularCut_" + det.name).c_str(), "te_{agg}/ge vs ge", 200, 0, 30, 200, -1, 2), "Generated Energy (GeV)", "te_{agg}/ge", false);
+    if (det.emc)
+    {
+      book(new TH1D(("te_aggregate_EtaCut_CircularCut_" + det.name).c_str(), "", 200, 0, 1), "te_{agg} (GeV)", "Counts", false);
+    }
+  }
+}
+
+//____________________________________________________________________________..
+int CaloResolutionAnalysis::ReadTrees()
+{
+  const long long nentries = m_Entries;
+  const long long nchunks = (nentries + m_ChunkSize - 1) / m_ChunkSize;
+  const std::vector<std::string> names = ResponseHistos();
+
+  auto work = [&](const size_t ichunk) {
+    ChunkResult result;
+    result.histos = CloneHistos(names);
+    long long first = ichunk * m_ChunkSize;
+    ProcessChunk(first, std::min(first + m_ChunkSize, nentries), result);
+    return result;
+  };
+
+  // every task opens the input files itself and fills its own histograms
+  ROOT::EnableThreadSafety();
+  ROOT::TThreadExecutor pool(m_NThreads);
+  std::vector<ChunkResult> results = pool.Map(work, ROOT::TSeqUL(nchunks));
+
+  // add the chunks up in entry order, independent of the thread scheduling
+  m_EventCache.clear();
+  for (auto &result : results)
+  {
+    for (size_t i = 0; i < names.size(); i++)
+    {
+      if (result.histos[i])
+      {
+        m_Histos[names[i]]->Add(result.histos[i]);
+        delete result.histos[i];
+      }
+    }
+    m_TotalTe += result.total_te;
+    m_TotalTeCircularCut += result.total_te_CircularCut;
+    m_TotalGe += result.total_ge;
+    m_MissingEvents += result.missing;
+    m_EventCache.insert(m_EventCache.end(), result.events.begin(), result.events.end());
+  }
+  if (m_Verbosity > 0)
+  {
+    std::cout << "CaloResolutionAnalysis::ReadTrees - " << nentries << " entries in " << nchunks
+              << " chunks, " << m_EventCache.size() / CacheStride() << " events cached" << std::endl;
+  }
+  if (m_MissingEvents > 0)
+  {
+    std::cout << "CaloResolutionAnalysis::ReadTrees - " << m_MissingEvents
+              << " events skipped, they are not present in all detectors" << std::endl;
+  }
+  return 0;
+}
+
+//____________________________________________________________________________..
+void CaloResolutionAnalysis::ProcessChunk(const long long first, const long long last, ChunkResult &result) const
+{
+  // every task reads through its own copy of the reader (own TFiles)
+  std::unique_ptr<EvalTreeReader> reader = m_Reader->Clone();
+  if (!reader)
+  {
+    return;
+  }
+  std::vector<EvalRootTTree *> evals(m_Detectors.size(), nullptr);
+  // TF1::Eval is not thread safe, every task uses its own copy
+  std::unique_ptr<TF1> mipcut(m_MIPCut ? static_cast<TF1 *>(m_MIPCut->Clone()) : nullptr);
+  // the compiled selections keep their intermediate values in the object
+  Selection sel;
+  sel.event = m_EventSelection;
+  for (const auto &det : m_Detectors)
+  {
+    sel.towers.push_back(det.tower_selection);
+  }
+
+  EventSums ev;
+  for (long long i = first; i < last; i++)
+  {
+    if (!reader->GetEntry(i))
+    {
+      continue;
+    }
+    for (size_t idet = 0; idet < evals.size(); idet++)
+    {
+      evals[idet] = reader->Get(idet);
+    }
+    if (!ReadEvent(evals, mipcut.get(), sel, ev))
+    {
+      continue;
+    }
+    FillResponse(ev, result);
+    result.events.push_back(ev.ge);
+    result.events.push_back(ev.te_aggregate_CircularCut);
+    result.events.insert(result.events.end(), ev.te_detector_CircularCut.begin(), ev.te_detector_CircularCut.end());
+  }
+  result.missing = reader->MissingEvents();
+  if (m_Verbosity > 1)
+  {
+    std::cout << "CaloResolutionAnalysis::ProcessChunk - entries " << first << " - " << last << std::endl;
+  }
+}
+
+//____________________________________________________________________________..
+bool CaloResolutionAnalysis::ReadEvent(const std::vector<EvalRootTTree *> &evals, TF1 *mipcut, Selection &sel, EventSums &ev) const
+{
+  // the generated particle is the same in all trees
+  const EvalRootTTree *gen = evals[0];
+  ev.geta = gen->get_geta();
+  if (ev.geta < m_EtaMin || ev.geta > m_EtaMax)
+  {
+    return false;
+  }
+  if (sel.event.IsValid())
+  {
+    sel.event.SetEvent(gen);
+    if (sel.event.EvalEvent() == 0)
+    {
+      return false;
+    }
+  }
+  ev.ge = gen->get_ge();
+  ev.gtheta = gen->get_gtheta();
+  const double gphi = gen->get_gphi();
+
+  ev.te_aggregate = 0;
+  ev.te_aggregate_CircularCut = 0;
+  ev.te_detector_CircularCut.assign(m_Detectors.size(), 0);
+  for (size_t idet = 0; idet < m_Detectors.size(); idet++)
+  {
+    const DetectorConfig &det = m_Detectors[idet];
+    double cut = m_TowerEnergyCut;
+    if (det.emc && mipcut)
+    {
+      cut += mipcut->Eval(ev.gtheta);
+    }
+    auto add = [&](const double te, const double tphi, const double ttheta) {
+      if (te <= cut)
+      {
+        return;
+      }
+      ev.te_aggregate += te;
+      double dphi = tphi - gphi;
+      double dtheta = ttheta - ev.gtheta;
+      if (pow(dphi / det.y_radius, 2) + pow(dtheta / det.x_radius, 2) <= 1)
+      {
+        ev.te_aggregate_CircularCut += te;
+        ev.te_detector_CircularCut[idet] += te;
+      }
+    };
+    const EvalRootTTree *eval = evals[idet];
+    CaloCutExpression &towersel = sel.towers[idet];
+    if (towersel.IsValid())
+    {
+      // the selection is evaluated for all towers of the detector at once
+      CaloTowerColumns &cols = sel.columns;
+      cols.Fill(eval);
+      towersel.SetEvent(eval);
+      towersel.SelectTowers(cols, sel.pass);
+      for (size_t k = 0; k < cols.size(); k++)
+      {
+        if (sel.pass[k])
+        {
+          add(cols.te[k], cols.tphi[k], cols.ttheta[k]);
+        }
+      }
+      continue;
+    }
+    for (int j = 0; j < eval->get_ntowers(); j++)
+    {
+      EvalTower *twr = eval->get_tower(j);
+      if (!twr)
+      {
+        continue;
+      }
+      add(twr->get_te(), twr->get_tphi(), twr->get_ttheta());
+    }
+  }
+  return true;
+}
+
+//____________________________________________________________________________..
+void CaloResolutionAnalysis::FillResponse(const EventSums &ev, ChunkResult &result) const
+{
+  std::vector<TH1 *> &h = result.histos;
+  const double ge = ev.ge;
+  result.total_ge += ge;
+  result.total_te += ev.te_aggregate;
+  result.total_te_CircularCut += ev.te_aggregate_CircularCut;
+  if (ev.te_aggregate_CircularCut <= m_AggregateEnergyCut)
+  {
+    return;
+  }
+  h[0]->Fill(ge, (ev.te_aggregate - ge) / ge);
+  h[1]->Fill(ge, (ev.te_aggregate_CircularCut - ge) / ge);
+  h[2]->Fill(ge, ev.te_aggregate / ge);
+  h[3]->Fill(ge, ev.te_aggregate_CircularCut / ge);
+  for (size_t idet = 0; idet < m_Detectors.size(); idet++)
+  {
+    const double te = ev.te_detector_CircularCut[idet];
+    h[4 + 3 * idet]->Fill(ge, te / ge);
+    h[5 + 3 * idet]->Fill(ge, te / ge);
+    if (h[6 + 3 * idet])
+    {
+      h[6 + 3 * idet]->Fill(te);
+    }
+  }
+}
+
+//____________________________________________________________________________..
+void CaloResolutionAnalysis::RecalibrationPass(const int pass)
+{
+  const size_t ndet = m_Detectors.size();
+  const size_t stride = CacheStride();
+  TH1 *hmean = GetHisto("mean_te_by_ge_ge_EtaCut_CircularCut");
+  TH1 *hres = GetHisto("te_minus_ge_by_ge_ge_EtaCut_CircularCut_Recalibrated");
+  TH1 *hres_temp = GetHisto("te_minus_ge_by_ge_ge_EtaCut_CircularCut_Recalibrated_temp");
+  if (pass == 3)
+  {
+    m_ResolutionGe.clear();
+    m_Resolution.clear();
+  }
+  for (size_t i = 0; i < m_EventCache.size(); i += stride)
+  {
+    const double ge = m_EventCache[i];
+    if (m_EventCache[i + 1] <= m_AggregateEnergyCut)
+    {
+      continue;
+    }
+    // every detector is weighted by its mean response and recalibrated in its energy bin
+    const int bin = RecalibrationBin(ge);
+    double te_normalised = 0;
+    for (size_t idet = 0; idet < ndet; idet++)
+    {
+      te_normalised += m_EventCache[i + 2 + idet] * m_Weights[idet] / m_DetectorRecalibration[idet][bin];
+    }
+    if (pass == 2)
+    {
+      hmean->Fill(ge, te_normalised / ge);
+      continue;
+    }
+    const double res = ((te_normalised / m_Recalibration[bin]) - ge) / ge;
+    hres->Fill(ge, res);
+    hres_temp->Fill(ge, res);
+    m_ResolutionGe.push_back(ge);
+    m_Resolution.push_back(res);
+  }
+}
+
+//____________________________________________________________________________..
+void CaloResolutionAnalysis::FitSlices()
+{
+  NoAddDirectory noadd;
+  TH2 *temp = static_cast<TH2 *>(GetHisto("te_minus_ge_by_ge_ge_EtaCut_CircularCut_Recalibrated_temp"));
+  // gaus fit of every energy slice, the array gets constant, mean, sigma and chi2
+  SliceFitter fitter("CaloResolutionAnalysis_" + m_Name);
+  fitter.SetMinEntries(0);
+  fitter.SetNThreads(m_NThreads);
+  std::vector<TH1D *> slices;
+  m_SliceFits = fitter.Fit(temp, &slices);
+  TObjArray fits;
+  SliceFitter::MakeHistos(temp, m_SliceFits, fits);
+  const char *ytitles[] = {"Constant", "Mean_{e_{agg}}", "#sigma_{e_{agg}}", "Reduced_#chi^{2}_{e_{agg}}"};
+  for (int i = 0; i < fits.GetEntriesFast(); i++)
+  {
+    TH1 *h = static_cast<TH1 *>(fits.At(i));
+    if (!h)
+    {
+      continue;
+    }
+    FormatAxes(h, "Generated Energy (GeV)", ytitles[std::min(i, 3)]);
+    m_Histos[h->GetName()] = h;
+  }
+  // same order as in LoopEvalFR.C/LoopEvalHR.C
+  m_OutputOrder.insert(std::find(m_OutputOrder.begin(), m_OutputOrder.end(), "te_minus_ge_by_ge_ge_EtaCut_CircularCut_Recalibrated") + 1,
+                       {temp->GetName() + std::string("_2"), temp->GetName() + std::string("_1"), temp->GetName() + std::string("_chi2")});
+  for (const auto &det : m_Detectors)
+  {
+    if (det.emc)
+    {
+      m_OutputOrder.push_back("te_aggregate_EtaCut_CircularCut_" + det.name);
+    }
+  }
+
+  // the projections come with the fitted gaus attached
+  for (size_t i = 0; i < slices.size(); i++)
+  {
+    TH1D *slice = slices[i];
+    slice->SetName(("slice " + std::to_string(i + 1)).c_str());
+    FormatAxes(slice, "#Delta e^{agg}/ ge", "Counts");
+    m_Slices.push_back(slice);
+  }
+}
+
+//____________________________________________________________________________..
+void CaloResolutionAnalysis::EstimateSlices()
+{
+  ResolutionEstimator estimator("CaloResolutionAnalysis_" + m_Name);
+  estimator.SetNThreads(m_NThreads);
+  m_RobustEstimates = estimator.Estimate(m_ResolutionGe, m_Resolution, m_BinLimits);
+  // the per event values are not needed any more
+  std::vector<double>().swap(m_ResolutionGe);
+  std::vector<double>().swap(m_Resolution);
+
+  NoAddDirectory noadd;
+  const std::string base = "te_minus_ge_by_ge_ge_EtaCut_CircularCut_Recalibrated";
+  const int nslices = m_BinLimits.size() - 1;
+  TH1 *hmedian = new TH1D((base + "_median").c_str(), "median of (te_{agg}-ge)/ge", nslices, m_BinLimits.data());
+  TH1 *hsigmaeff = new TH1D((base + "_sigma_eff").c_str(), "#sigma_{eff} of (te_{agg}-ge)/ge", nslices, m_BinLimits.data());
+  TH1 *hsigma = new TH1D((base + "_truncated_sigma").c_str(), "truncated gaussian #sigma of (te_{agg}-ge)/ge", nslices, m_BinLimits.data());
+  for (const auto &est : m_RobustEstimates)
+  {
+    if (std::isnan(est.median))
+    {
+      continue;
+    }
+    const int bin = est.slice + 1;
+    hmedian->SetBinContent(bin, est.median);
+    hmedian->SetBinError(bin, est.median_error);
+    hsigmaeff->SetBinContent(bin, est.sigma_eff);
+    hsigmaeff->SetBinError(bin, est.sigma_eff_error);
+    hsigma->SetBinContent(bin, est.truncated_sigma);
+    hsigma->SetBinError(bin, est.truncated_sigma_error);
+  }
+  FormatAxes(hmedian, "Generated Energy (GeV)", "Median_{e_{agg}}");
+  FormatAxes(hsigmaeff, "Generated Energy (GeV)", "#sigma_{eff, e_{agg}}");
+  FormatAxes(hsigma, "Generated Energy (GeV)", "#sigma_{trunc, e_{agg}}");
+  for (TH1 *h : {hmedian, hsigmaeff, hsigma})
+  {
+    m_Histos[h->GetName()] = h;
+    m_OutputOrder.push_back(h->GetName());
+  }
+  if (m_Verbosity > 0)
+  {
+    std::cout << "CaloResolutionAnalysis " << m_Name << ": unbinned estimates" << std::endl;
+    ResolutionEstimator::Print(m_RobustEstimates);
+  }
+}
+
+//____________________________________________________________________________..
+std::vector<TH1 *> CaloResolutionAnalysis::CloneHistos(const std::vector<std::string> &names) const
+{
+  NoAddDirectory noadd;
+  std::vector<TH1 *> clones;
+  for (const auto &hname : names)
+  {
+    TH1 *h = nullptr;
+    if (!hname.empty())
+    {
+      h = static_cast<TH1 *>(GetHisto(hname)->Clone());
+      h->Reset();
+    }
+    clones.push_back(h);
+  }
+  return clones;
+}
+
+//____________________________________________________________________________..
+std::vector<std::string> CaloResolutionAnalysis::ResponseHistos() const
+{
+  // the histograms filled while reading the trees
+  std::vector<std::string> names = {"te_minus_ge_by_ge_ge_EtaCut", "te_minus_ge_by_ge_ge_EtaCut_CircularCut", "te_by_ge_ge_EtaCut", "te_by_ge_ge_EtaCut_CircularCut"};
+  for (const auto &det : m_Detectors)
+  {
+    names.push_back("te_by_ge_ge_EtaCut_CircularCut_" + det.name);
+    names.push_back("mean_te_by_ge_ge_EtaCut_CircularCut_" + det.name);
+    names.push_back(det.emc ? "te_aggregate_EtaCut_CircularCut_" + det.name : "");
+  }
+  return names;
+}
+
+//____________________________________________________________________________..
+int CaloResolutionAnalysis::RecalibrationBin(const double ge) const
+{
+  // bin of ge in m_BinLimits, same formula as in LoopEvalFR.C and LoopEvalHR.C
+  int bin = 0;
+  if (ge > m_LowEnergy)
+  {
+    double eRangeBin = (m_MaxEnergy - m_LowEnergy) / m_HighBins;
+    bin = m_LowBins + ceil((ge - m_LowEnergy) / eRangeBin) - 1;
+  }
+  else
+  {
+    bin = ceil((ge / m_LowEnergy) * m_LowBins) - 1;
+  }
+  // the macros run off the array for energies outside the binning
+  return std::max(0, std::min(bin, static_cast<int>(m_BinLimits.size()) - 2));
+}
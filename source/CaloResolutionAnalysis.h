@@ -0,0 +1,236 @@
+// Tell emacs that this is a C++ source
+//  -*- C++ -*-.
+#ifndef CALORESOLUTIONANALYSIS_H
+#define CALORESOLUTIONANALYSIS_H
+
+#include "CaloCutExpression.h"
+#include "ResolutionEstimator.h"
+#include "SliceFitter.h"
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+class EvalRootTTree;
+class EvalTreeReader;
+class TF1;
+class TH1;
+class TH1D;
+
+//! Compiled version of the LoopEvalFR.C/LoopEvalHR.C energy resolution analysis
+/*!
+ * The merged_Eval_<det>.root trees of all configured detectors are read side
+ * by side with an EvalTreeReader, which matches the events of the detectors by
+ * job and event number and skips events missing in one of them. Per event the towers above the energy cut (plus the theta dependent
+ * MIP cut on the EMC) are summed, once in total and once inside the ellipse
+ * around the generated particle direction. Three passes are made as in the
+ * macros: per detector response, per detector recalibrated sum and the final
+ * recalibrated resolution. Only the first pass reads the trees: the entries
+ * are split into chunks which are processed in parallel, each chunk with its
+ * own copy of the reader and its own copy of the histograms. The copies are added up
+ * in chunk order, so the result does not depend on the number of threads.
+ * The first pass also keeps ge and the per detector ellipse sums of every
+ * event in memory, the recalibration passes only loop over this cache.
+ * Besides the gaus fits of the energy slices the resolution is also estimated
+ * unbinned from the per event values of the last pass (ResolutionEstimator).
+ */
+class CaloResolutionAnalysis
+{
+ public:
+  //! name is used for the output file energy_verification_EtaCut_CircularCut_<name>.root
+  CaloResolutionAnalysis(const std::string &name = "FEMC_FHCAL");
+
+  virtual ~CaloResolutionAnalysis();
+
+  //! read merged_Eval_<det>.root (or file), the generated particle is taken from the first detector
+  //! x_radius/y_radius are the theta/phi half axes of the elliptical cut, emc enables the MIP cut
+  void AddDetector(const std::string &det, const double x_radius, const double y_radius, const bool emc = false, const std::string &file = "");
+
+  void SetEtaRange(const double etamin, const double etamax)
+  {
+    m_EtaMin = etamin;
+    m_EtaMax = etamax;
+  }
+
+  //! cut on every tower energy
+  void SetTowerEnergyCut(const double cut) { m_TowerEnergyCut = cut; }
+
+  //! cut on the summed energy in the ellipse of all detectors
+  void SetAggregateEnergyCut(const double cut) { m_AggregateEnergyCut = cut; }
+
+  //! additional tower energy cut on the EMC, TF1 formula evaluated at the generated theta
+  void SetMIPCut(const std::string &formula);
+
+  //! events are only used if the expression (event variables only, see
+  //! CaloCutExpression) is non zero, e.g. "gpid == 11 && abs(gvz) < 10"
+  int SetEventSelection(const std::string &expr);
+
+  //! towers of det (added before) are only summed if the expression is non
+  //! zero, on top of the energy and MIP cut, e.g. "tt > 0 && te > 0.002*ge"
+  int AddTowerSelection(const std::string &det, const std::string &expr);
+
+  //! lowBins bins up to lowEnergy, highBins bins from lowEnergy to maxEnergy
+  void SetEnergyBinning(const double lowEnergy, const double maxEnergy, const int lowBins, const int highBins);
+
+  //! y axis of the (te-ge)/ge histogram which is sliced for the resolution
+  void SetResolutionAxis(const int nbins, const double ymin, const double ymax);
+
+  //! y range of te_by_ge_ge_EtaCut_CircularCut
+  void SetRatioRange(const double ymin, const double ymax)
+  {
+    m_RatioMin = ymin;
+    m_RatioMax = ymax;
+  }
+
+  //! number of threads, 0 = number of cores
+  void SetNThreads(const unsigned int n) { m_NThreads = n; }
+
+  //! number of tree entries processed by one task
+  void SetChunkSize(const long long n) { m_ChunkSize = n; }
+
+  void Verbosity(const int i) { m_Verbosity = i; }
+
+  //! run the three passes and fit the slices, returns 0 on success
+  int Run();
+
+  //! write the histograms, empty file name = energy_verification_EtaCut_CircularCut_<name>.root
+  int Write(const std::string &fname = "") const;
+
+  //! after Run(): writes the weights and per slice recalibration factors of the
+  //! detectors and of the sum (entry Name()) for CaloRecalibrationReco
+  int WriteCalibration(const std::string &fname) const;
+
+  //! any histogram by its name in the output file
+  TH1 *GetHisto(const std::string &hname) const;
+
+  //! projections of the energy slices with the fitted gaus attached
+  int GetNSlices() const { return m_Slices.size(); }
+  TH1D *GetSlice(const int i) const;
+
+  //! mean, sigma and chi2/ndf of the gaus fit of every energy slice
+  const std::vector<SliceFitter::SliceFit> &GetSliceFits() const { return m_SliceFits; }
+
+  //! unbinned median, sigma_eff and truncated gaussian sigma of (te-ge)/ge per energy slice
+  const std::vector<ResolutionEstimator::SliceEstimate> &GetRobustEstimates() const { return m_RobustEstimates; }
+
+  const std::string &Name() const { return m_Name; }
+
+  void Print(const std::string &what = "ALL") const;
+
+ private:
+  struct DetectorConfig
+  {
+    std::string name;
+    std::string file;
+    double x_radius = 0;
+    double y_radius = 0;
+    bool emc = false;
+    CaloCutExpression tower_selection;
+  };
+
+  // per task copies of the compiled selections and their scratch space
+  struct Selection
+  {
+    CaloCutExpression event;
+    std::vector<CaloCutExpression> towers;
+    CaloTowerColumns columns;
+    std::vector<char> pass;
+  };
+
+  struct EventSums
+  {
+    double ge = 0;
+    double geta = 0;
+    double gtheta = 0;
+    double te_aggregate = 0;
+    double te_aggregate_CircularCut = 0;
+    std::vector<double> te_detector_CircularCut;
+  };
+
+  typedef std::map<std::string, TH1 *> HistoMap;
+
+  struct ChunkResult
+  {
+    // same order as ResponseHistos(), nullptr for unused slots
+    std::vector<TH1 *> histos;
+    // cached events of this chunk, layout as m_EventCache
+    std::vector<double> events;
+    long double total_te = 0;
+    long double total_te_CircularCut = 0;
+    long double total_ge = 0;
+    long long missing = 0;
+  };
+
+  void BookHistos();
+  int ReadTrees();
+  void ProcessChunk(const long long first, const long long last, ChunkResult &result) const;
+  bool ReadEvent(const std::vector<EvalRootTTree *> &evals, TF1 *mipcut, Selection &sel, EventSums &ev) const;
+  void FillResponse(const EventSums &ev, ChunkResult &result) const;
+  void RecalibrationPass(const int pass);
+  void FitSlices();
+  void EstimateSlices();
+
+  std::vector<TH1 *> CloneHistos(const std::vector<std::string> &names) const;
+  std::vector<std::string> ResponseHistos() const;
+  int RecalibrationBin(const double ge) const;
+
+  int m_Verbosity = 0;
+  int m_LowBins = 2;
+  int m_HighBins = 9;
+  int m_ResolutionBins = 350;
+
+  unsigned int m_NThreads = 0;
+
+  long long m_ChunkSize = 20000;
+  long long m_Entries = 0;
+  long long m_MissingEvents = 0;
+
+  double m_EtaMin = -5;
+  double m_EtaMax = 5;
+  double m_TowerEnergyCut = 0;
+  double m_AggregateEnergyCut = 0;
+  double m_LowEnergy = 3;
+  double m_MaxEnergy = 30;
+  double m_ResolutionMin = -0.99;
+  double m_ResolutionMax = 1;
+  double m_RatioMin = -0.5;
+  double m_RatioMax = 1.5;
+
+  long double m_TotalTe = 0;
+  long double m_TotalTeCircularCut = 0;
+  long double m_TotalGe = 0;
+
+  std::string m_Name;
+
+  std::unique_ptr<TF1> m_MIPCut;
+  std::unique_ptr<EvalTreeReader> m_Reader;
+
+  CaloCutExpression m_EventSelection;
+
+  std::vector<DetectorConfig> m_Detectors;
+  std::vector<double> m_BinLimits;
+
+  // pass 1 -> 2: mean te/ge and te/ge per energy bin of every detector
+  std::vector<double> m_Weights;
+  std::vector<std::vector<double>> m_DetectorRecalibration;
+  // pass 2 -> 3: recalibration of the normalised sum per energy bin
+  std::vector<double> m_Recalibration;
+
+  // per event ge, summed ellipse energy and ellipse energy of every detector
+  // for all events inside the eta range, CacheStride() values per event
+  std::vector<double> m_EventCache;
+  size_t CacheStride() const { return 2 + m_Detectors.size(); }
+
+  HistoMap m_Histos;
+  std::vector<std::string> m_OutputOrder;
+  std::vector<TH1D *> m_Slices;
+  std::vector<SliceFitter::SliceFit> m_SliceFits;
+
+  // pass 3: ge and (te-ge)/ge of every event for the unbinned estimates
+  std::vector<double> m_ResolutionGe;
+  std::vector<double> m_Resolution;
+  std::vector<ResolutionEstimator::SliceEstimate> m_RobustEstimates;
+};
+
+#endif  // CALORESOLUTIONANALYSIS_H
@@ -0,0 +1,174 @@
+#include "CaloResponseSketch.h"
+
+#include <TCollection.h>
+#include <TObject.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>  // for operator<<, endl, basic_ost...
+
+//____________________________________________________________________________..
+CaloResponseSketch::CaloResponseSketch(const std::string &name, const std::string &title, const std::vector<double> &energyedges,
+                                       const std::vector<double> &etaedges, const int k)
+  : TNamed(name.c_str(), title.c_str())
+  , m_EnergyEdges(energyedges)
+  , m_EtaEdges(etaedges)
+{
+  if (m_EnergyEdges.size() < 2 || m_EtaEdges.size() < 2 || !std::is_sorted(m_EnergyEdges.begin(), m_EnergyEdges.end()) || !std::is_sorted(m_EtaEdges.begin(), m_EtaEdges.end()))
+  {
+    std::cout << "CaloResponseSketch::CaloResponseSketch - " << name << ": energy and eta edges need at least 2 increasing values, using the defaults" << std::endl;
+    m_EnergyEdges = DefaultEnergyEdges();
+    m_EtaEdges = DefaultEtaEdges();
+  }
+  m_Sketches.assign(NEnergySlices() * NEtaSlices(), QuantileSketch(k));
+}
+
+//____________________________________________________________________________..
+void CaloResponseSketch::Fill(const double etruth, const double eta, const double ratio)
+{
+  const int ienergy = FindSlice(m_EnergyEdges, etruth);
+  const int ieta = FindSlice(m_EtaEdges, eta);
+  if (ienergy < 0 || ieta < 0)
+  {
+    m_NOutside++;
+    return;
+  }
+  m_Sketches[ienergy * NEtaSlices() + ieta].Fill(ratio);
+}
+
+//____________________________________________________________________________..
+int CaloResponseSketch::Add(const CaloResponseSketch &other)
+{
+  if (other.m_EnergyEdges != m_EnergyEdges || other.m_EtaEdges != m_EtaEdges)
+  {
+    std::cout << "CaloResponseSketch::Add - slices of " << other.GetName() << " differ from " << GetName() << std::endl;
+    return -1;
+  }
+  for (size_t i = 0; i < m_Sketches.size(); i++)
+  {
+    m_Sketches[i].Add(other.m_Sketches[i]);
+  }
+  m_NOutside += other.m_NOutside;
+  return 0;
+}
+
+//____________________________________________________________________________..
+Long64_t CaloResponseSketch::Merge(TCollection *list)
+{
+  if (!list)
+  {
+    return 0;
+  }
+  TIter next(list);
+  while (TObject *obj = next())
+  {
+    const CaloResponseSketch *other = dynamic_cast<const CaloResponseSketch *>(obj);
+    if (!other || Add(*other))
+    {
+      std::cout << "CaloResponseSketch::Merge - cannot add " << obj->GetName() << " to " << GetName() << std::endl;
+      return -1;
+    }
+  }
+  long long n = 0;
+  for (const auto &sketch : m_Sketches)
+  {
+    n += sketch.GetN();
+  }
+  return n;
+}
+
+//____________________________________________________________________________..
+void CaloResponseSketch::Reset()
+{
+  for (auto &sketch : m_Sketches)
+  {
+    sketch.Reset();
+  }
+  m_NOutside = 0;
+}
+
+//____________________________________________________________________________..
+const QuantileSketch *CaloResponseSketch::GetSketch(const int ienergy, const int ieta) const
+{
+  if (ienergy < 0 || ienergy >= NEnergySlices() || ieta < 0 || ieta >= NEtaSlices())
+  {
+    return nullptr;
+  }
+  return &m_Sketches[ienergy * NEtaSlices() + ieta];
+}
+
+//____________________________________________________________________________..
+double CaloResponseSketch::Quantile(const int ienergy, const int ieta, const double q) const
+{
+  const QuantileSketch *sketch = GetSketch(ienergy, ieta);
+  return sketch ? sketch->Quantile(q) : NAN;
+}
+
+//____________________________________________________________________________..
+double CaloResponseSketch::SigmaEff(const int ienergy, const int ieta, const double fraction) const
+{
+  const QuantileSketch *sketch = GetSketch(ienergy, ieta);
+  return sketch ? sketch->SigmaEff(fraction) : NAN;
+}
+
+//____________________________________________________________________________..
+size_t CaloResponseSketch::NRetained() const
+{
+  size_t n = 0;
+  for (const auto &sketch : m_Sketches)
+  {
+    n += sketch.NRetained();
+  }
+  return n;
+}
+
+//____________________________________________________________________________..
+int CaloResponseSketch::FindSlice(const std::vector<double> &edges, const double x)
+{
+  if (edges.size() < 2 || !(x >= edges.front()) || x >= edges.back())
+  {
+    return -1;
+  }
+  return std::upper_bound(edges.begin(), edges.end(), x) - edges.begin() - 1;
+}
+
+//____________________________________________________________________________..
+std::vector<double> CaloResponseSketch::DefaultEnergyEdges()
+{
+  return {0, 0.5, 1, 2, 3, 5, 7.5, 10, 15, 20, 30, 50, 100};
+}
+
+//____________________________________________________________________________..
+std::vector<double> CaloResponseSketch::DefaultEtaEdges()
+{
+  std::vector<double> edges;
+  for (int i = -8; i <= 8; i++)
+  {
+    edges.push_back(0.5 * i);
+  }
+  return edges;
+}
+
+//____________________________________________________________________________..
+void CaloResponseSketch::Print(Option_t *option) const
+{
+  std::cout << "CaloResponseSketch " << GetName() << ": " << NEnergySlices() << " energy x " << NEtaSlices()
+            << " eta slices, " << m_NOutside << " entries outside" << std::endl;
+  // empty slices are skipped, a single detector covers a few eta slices only
+  for (int ienergy = 0; ienergy < NEnergySlices(); ienergy++)
+  {
+    for (int ieta = 0; ieta < NEtaSlices(); ieta++)
+    {
+      const QuantileSketch *sketch = GetSketch(ienergy, ieta);
+      if (sketch->GetN() == 0)
+      {
+        continue;
+      }
+      std::cout << "  E " << std::setw(5) << m_EnergyEdges[ienergy] << " -" << std::setw(5) << m_EnergyEdges[ienergy + 1]
+                << " GeV, eta " << std::setw(4) << m_EtaEdges[ieta] << " -" << std::setw(4) << m_EtaEdges[ieta + 1]
+                << ": N " << sketch->GetN() << " median " << sketch->Median() << " sigma_eff " << sketch->SigmaEff()
+                << " q05 " << sketch->Quantile(0.05) << " q95 " << sketch->Quantile(0.95) << std::endl;
+    }
+  }
+}
@@ -0,0 +1,85 @@
+// Tell emacs that this is a C++ source
+//  -*- C++ -*-.
+#ifndef CALORESPONSESKETCH_H
+#define CALORESPONSESKETCH_H
+
+#include "QuantileSketch.h"
+
+#include <TNamed.h>
+
+#include <string>
+#include <vector>
+
+class TCollection;
+
+//! Calorimeter response E_reco/E_truth per truth energy and eta slice
+/*!
+ * One QuantileSketch per (truth energy, truth eta) slice instead of the
+ * full TH2 or the per event arrays of the resolution analysis: median,
+ * sigma_eff and the tail quantiles of every slice come out of a few kB,
+ * whatever the number of events. Booked by QAG4SimulationEicCalorimeter and
+ * QAEvalCalorimeter as <prefix>_Cluster_ResponseSketch, written to the QA
+ * file like a histogram and added up by hadd (Merge()) when the slices are
+ * the same. Entries outside the slices are only counted.
+ */
+class CaloResponseSketch : public TNamed
+{
+ public:
+  // ctor with no args to make root happy
+  CaloResponseSketch() {}
+  CaloResponseSketch(const std::string &name, const std::string &title, const std::vector<double> &energyedges = DefaultEnergyEdges(),
+                     const std::vector<double> &etaedges = DefaultEtaEdges(), const int k = 200);
+  virtual ~CaloResponseSketch() {}
+
+  //! truth energy (GeV) and eta of the particle, reconstructed/truth energy
+  void Fill(const double etruth, const double eta, const double ratio);
+
+  //! adds other, returns -1 if the slices differ
+  int Add(const CaloResponseSketch &other);
+
+  //! adds the sketches of list, used by hadd and TFileMerger
+  Long64_t Merge(TCollection *list);
+
+  //! removes all entries, the slices are kept
+  void Reset();
+
+  void Print(Option_t *option = "") const override;
+
+  int NEnergySlices() const { return m_EnergyEdges.empty() ? 0 : m_EnergyEdges.size() - 1; }
+  int NEtaSlices() const { return m_EtaEdges.empty() ? 0 : m_EtaEdges.size() - 1; }
+  const std::vector<double> &GetEnergyEdges() const { return m_EnergyEdges; }
+  const std::vector<double> &GetEtaEdges() const { return m_EtaEdges; }
+
+  //! sketch of a slice, nullptr out of range
+  const QuantileSketch *GetSketch(const int ienergy, const int ieta) const;
+
+  //! NAN for an empty or unknown slice
+  double Quantile(const int ienergy, const int ieta, const double q) const;
+  double Median(const int ienergy, const int ieta) const { return Quantile(ienergy, ieta, 0.5); }
+  double SigmaEff(const int ienergy, const int ieta, const double fraction = 0.683) const;
+
+  long long GetNOutside() const { return m_NOutside; }
+
+  //! number of values kept by all sketches
+  size_t NRetained() const;
+
+  //! slice of x, -1 outside the edges
+  static int FindSlice(const std::vector<double> &edges, const double x);
+
+  //! 0 - 100 GeV as in the energy scans and eta -4 - 4 in steps of 0.5
+  static std::vector<double> DefaultEnergyEdges();
+  static std::vector<double> DefaultEtaEdges();
+
+ private:
+  std::vector<double> m_EnergyEdges;
+  std::vector<double> m_EtaEdges;
+
+  //! ienergy * NEtaSlices() + ieta
+  std::vector<QuantileSketch> m_Sketches;
+
+  long long m_NOutside = 0;
+
+  ClassDefOverride(CaloResponseSketch, 1)
+};
+
+#endif  // CALORESPONSESKETCH_H
@@ -0,0 +1,435 @@
+#include "CaloShowerFitter.h"
+
+#include "CaloShowerParametrization.h"
+#include "EvalHit.h"
+#include "EvalRootTTree.h"
+#include "EvalTreeReader.h"
+#include "ResolutionEstimator.h"
+
+#include <TDirectory.h>
+#include <TF1.h>
+#include <TFile.h>
+#include <TGraphErrors.h>
+#include <TH1.h>
+#include <TH2.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>  // for operator<<, endl, basic_ost...
+#include <limits>
+
+namespace
+{
+  // gamma distribution of the depth t
+  const char *const kLongitudinal = "[0]*TMath::Power(x,[1]-1)*TMath::Exp(-x/[2])";
+  // dE/dr of a core and a tail exponential in the transverse distance r
+  const char *const kLateral = "[0]*([1]*x/([2]*[2])*TMath::Exp(-x/[2])+(1-[1])*x/([3]*[3])*TMath::Exp(-x/[3]))";
+  const char *const kResolution = "sqrt([0]*[0]/x+[1]*[1]+[2]*[2]/(x*x))";
+
+  //! mean and variance of the histogram, without under- and overflow
+  void Moments(const TH1 *h, double &mean, double &variance)
+  {
+    double sw = 0;
+    double swx = 0;
+    double swxx = 0;
+    for (int i = 1; i <= h->GetNbinsX(); i++)
+    {
+      const double w = h->GetBinContent(i);
+      const double x = h->GetXaxis()->GetBinCenter(i);
+      sw += w;
+      swx += w * x;
+      swxx += w * x * x;
+    }
+    mean = (sw > 0) ? swx / sw : NAN;
+    variance = (sw > 0) ? swxx / sw - mean * mean : NAN;
+  }
+}  // namespace
+
+//____________________________________________________________________________..
+CaloShowerFitter::CaloShowerFitter(const std::string &det, const int pid)
+  : m_Pid(pid)
+  , m_Detector(det)
+{
+}
+
+//____________________________________________________________________________..
+CaloShowerFitter::~CaloShowerFitter()
+{
+  for (TH1 *h : m_Longitudinal)
+  {
+    delete h;
+  }
+  delete m_Lateral;
+  for (TGraphErrors *g : m_Graphs)
+  {
+    delete g;
+  }
+}
+
+//____________________________________________________________________________..
+int CaloShowerFitter::Slice(const double e) const
+{
+  if (m_Limits.size() < 2 || e < m_Limits.front() || e >= m_Limits.back())
+  {
+    return -1;
+  }
+  return std::upper_bound(m_Limits.begin(), m_Limits.end(), e) - m_Limits.begin() - 1;
+}
+
+//____________________________________________________________________________..
+int CaloShowerFitter::Fit()
+{
+  if (m_Limits.size() < 2)
+  {
+    std::cout << "CaloShowerFitter::Fit - no energy slices set" << std::endl;
+    return -1;
+  }
+  m_Parametrization.reset(new CaloShowerParametrization(m_Detector, m_Pid));
+  m_Parametrization->set_energy_range(m_Limits.front(), m_Limits.back());
+
+  const std::string key = CaloShowerParametrization::Key(m_Detector, m_Pid);
+  const int nslices = m_Limits.size() - 1;
+  for (int i = 0; i < nslices; i++)
+  {
+    TH1 *h = new TH1D((key + "_longitudinal_" + std::to_string(i)).c_str(),
+                      (m_Detector + " longitudinal profile, " + std::to_string(m_Limits[i]) + " <= E < " + std::to_string(m_Limits[i + 1]) +
+                       " GeV;Depth from first hit (cm);dE/dt")
+                          .c_str(),
+                      200, 0, m_MaxDepth);
+    h->SetDirectory(nullptr);
+    m_Longitudinal.push_back(h);
+  }
+  m_Lateral = new TH1D((key + "_lateral").c_str(), (m_Detector + " lateral profile;Distance to shower axis (cm);dE/dr").c_str(), 300, 0, m_MaxRadius);
+  m_Lateral->SetDirectory(nullptr);
+
+  if (FillProfiles())
+  {
+    return -1;
+  }
+  if (!m_QAFile.empty() && FillLateralFromQA())
+  {
+    return -1;
+  }
+  m_Parametrization->set_nevents(m_NEvents);
+
+  FitResponse();
+  FitLongitudinal();
+  FitLateral();
+  if (m_Verbosity > 0)
+  {
+    Print();
+  }
+  return 0;
+}
+
+//____________________________________________________________________________..
+int CaloShowerFitter::FillProfiles()
+{
+  EvalTreeReader reader;
+  reader.AddDetector(m_Detector, m_EvalFile);
+  if (reader.Open())
+  {
+    std::cout << "CaloShowerFitter::FillProfiles - cannot read the Eval tree of " << m_Detector << std::endl;
+    return -1;
+  }
+  std::vector<double> depth;
+  const long long nentries = reader.GetEntries();
+  for (long long i = 0; i < nentries; i++)
+  {
+    if (m_MaxEvents > 0 && m_NEvents >= m_MaxEvents)
+    {
+      break;
+    }
+    if (!reader.GetEntry(i))
+    {
+      continue;
+    }
+    const EvalRootTTree *ev = reader.Get(0);
+    if (m_Pid != 0 && ev->get_gpid() != m_Pid)
+    {
+      continue;
+    }
+    const double ge = ev->get_ge();
+    const int slice = Slice(ge);
+    if (slice < 0)
+    {
+      continue;
+    }
+    m_NEvents++;
+    m_Ge.push_back(ge);
+    m_Response.push_back(ev->get_tesum() / ge);
+
+    const double p = std::sqrt(ev->get_gpx() * ev->get_gpx() + ev->get_gpy() * ev->get_gpy() + ev->get_gpz() * ev->get_gpz());
+    if (!(p > 0))
+    {
+      continue;
+    }
+    const double ux = ev->get_gpx() / p;
+    const double uy = ev->get_gpy() / p;
+    const double uz = ev->get_gpz() / p;
+    // depth of every hit along the generated direction, the first hit is the shower start
+    depth.clear();
+    double tmin = std::numeric_limits<double>::max();
+    for (int ihit = 0; ihit < ev->get_nhits(); ihit++)
+    {
+      const EvalHit *hit = ev->get_hit(ihit);
+      if (!hit || !(hit->get_edep() > 0))
+      {
+        depth.push_back(NAN);
+        continue;
+      }
+      const double dx = 0.5 * (hit->get_xin() + hit->get_xout()) - ev->get_gvx();
+      const double dy = 0.5 * (hit->get_yin() + hit->get_yout()) - ev->get_gvy();
+      const double dz = 0.5 * (hit->get_zin() + hit->get_zout()) - ev->get_gvz();
+      const double t = dx * ux + dy * uy + dz * uz;
+      depth.push_back(t);
+      tmin = std::min(tmin, t);
+      if (m_QAFile.empty())
+      {
+        const double rx = dx - t * ux;
+        const double ry = dy - t * uy;
+        const double rz = dz - t * uz;
+        m_Lateral->Fill(std::sqrt(rx * rx + ry * ry + rz * rz), hit->get_edep());
+      }
+    }
+    for (size_t ihit = 0; ihit < depth.size(); ihit++)
+    {
+      if (!std::isnan(depth[ihit]))
+      {
+        m_Longitudinal[slice]->Fill(depth[ihit] - tmin, ev->get_hit(ihit)->get_edep());
+      }
+    }
+  }
+  if (m_Verbosity > 0)
+  {
+    std::cout << "CaloShowerFitter " << m_Detector << " pid " << m_Pid << ": " << m_NEvents << " events of " << nentries << std::endl;
+  }
+  if (m_NEvents == 0)
+  {
+    std::cout << "CaloShowerFitter::FillProfiles - no events of pid " << m_Pid << " in the energy range of " << m_Detector << std::endl;
+    return -1;
+  }
+  return 0;
+}
+
+//____________________________________________________________________________..
+int CaloShowerFitter::FillLateralFromQA()
+{
+  std::unique_ptr<TFile> f(TFile::Open(m_QAFile.c_str(), "READ"));
+  if (!f || f->IsZombie())
+  {
+    std::cout << "CaloShowerFitter::FillLateralFromQA - cannot open " << m_QAFile << std::endl;
+    return -1;
+  }
+  const std::string name = "h_QAG4Sim_" + m_Detector + "_G4Hit_LateralTruthProjection";
+  TH2 *h2 = nullptr;
+  f->GetObject(name.c_str(), h2);
+  if (!h2)
+  {
+    std::cout << "CaloShowerFitter::FillLateralFromQA - " << name << " not in " << m_QAFile << std::endl;
+    return -1;
+  }
+  m_Lateral->Reset();
+  for (int ix = 1; ix <= h2->GetNbinsX(); ix++)
+  {
+    const double x = h2->GetXaxis()->GetBinCenter(ix);
+    for (int iy = 1; iy <= h2->GetNbinsY(); iy++)
+    {
+      const double content = h2->GetBinContent(ix, iy);
+      if (content > 0)
+      {
+        m_Lateral->Fill(std::hypot(x, h2->GetYaxis()->GetBinCenter(iy)), content);
+      }
+    }
+  }
+  return 0;
+}
+
+//____________________________________________________________________________..
+void CaloShowerFitter::FitResponse()
+{
+  ResolutionEstimator estimator("CaloShowerFitter_" + m_Detector);
+  const std::vector<ResolutionEstimator::SliceEstimate> estimates = estimator.Estimate(m_Ge, m_Response, m_Limits);
+  const std::string key = CaloShowerParametrization::Key(m_Detector, m_Pid);
+
+  // response linear in ln(E), relative resolution sigma_eff/median
+  TGraphErrors *gresp = new TGraphErrors();
+  gresp->SetName((key + "_response").c_str());
+  TGraphErrors *gres = new TGraphErrors();
+  gres->SetName((key + "_resolution").c_str());
+  for (const auto &est : estimates)
+  {
+    if (std::isnan(est.median) || !(est.median > 0) || std::isnan(est.sigma_eff))
+    {
+      continue;
+    }
+    const int n = gresp->GetN();
+    gresp->SetPoint(n, std::log(est.x_mean), est.median);
+    gresp->SetPointError(n, 0, est.median_error);
+    gres->SetPoint(n, est.x_mean, est.sigma_eff / est.median);
+    gres->SetPointError(n, 0, est.sigma_eff_error / est.median);
+  }
+  m_Graphs.push_back(gresp);
+  m_Graphs.push_back(gres);
+  if (gresp->GetN() == 0)
+  {
+    std::cout << "CaloShowerFitter::FitResponse - no slice of " << m_Detector << " has enough events" << std::endl;
+    return;
+  }
+
+  TF1 fresp((key + "_response_fit").c_str(), "pol1", std::log(m_Limits.front()), std::log(m_Limits.back()), TF1::EAddToList::kNo);
+  fresp.SetParameters(estimates.front().median, 0);
+  if (gresp->GetN() < 2)
+  {
+    fresp.FixParameter(1, 0);
+  }
+  gresp->Fit(&fresp, "Q0R");
+  m_Parametrization->set_response(fresp.GetParameter(0), fresp.GetParameter(1));
+
+  TF1 fres((key + "_resolution_fit").c_str(), kResolution, m_Limits.front(), m_Limits.back(), TF1::EAddToList::kNo);
+  fres.SetParameters(0.1, 0.01, 0);
+  if (gres->GetN() < 4)
+  {
+    // not enough points for the noise term
+    fres.FixParameter(2, 0);
+  }
+  if (gres->GetN() < 2)
+  {
+    fres.FixParameter(1, 0);
+  }
+  gres->Fit(&fres, "Q0R");
+  m_Parametrization->set_resolution(std::fabs(fres.GetParameter(0)), std::fabs(fres.GetParameter(1)), std::fabs(fres.GetParameter(2)));
+}
+
+//____________________________________________________________________________..
+void CaloShowerFitter::FitLongitudinal()
+{
+  const std::string key = CaloShowerParametrization::Key(m_Detector, m_Pid);
+  TGraphErrors *galpha = new TGraphErrors();
+  galpha->SetName((key + "_alpha").c_str());
+  m_Graphs.push_back(galpha);
+  double sumbeta = 0;
+  double sumw = 0;
+  for (size_t i = 0; i < m_Longitudinal.size(); i++)
+  {
+    TH1 *h = m_Longitudinal[i];
+    double mean = NAN;
+    double variance = NAN;
+    Moments(h, mean, variance);
+    if (!(variance > 0))
+    {
+      continue;
+    }
+    // start values from the moments of the gamma distribution
+    // the fit keeps a copy of the function with the histogram
+    TF1 gamma((std::string(h->GetName()) + "_gamma").c_str(), kLongitudinal, 0, m_MaxDepth, TF1::EAddToList::kNo);
+    TF1 *f = &gamma;
+    f->SetParameters(h->GetMaximum(), mean * mean / variance, variance / mean);
+    f->SetParLimits(1, 1, 100);
+    f->SetParLimits(2, 1e-3, m_MaxDepth);
+    h->Fit(f, "Q0R");
+    const int n = galpha->GetN();
+    galpha->SetPoint(n, std::log(0.5 * (m_Limits[i] + m_Limits[i + 1])), f->GetParameter(1));
+    galpha->SetPointError(n, 0, f->GetParError(1));
+    if (f->GetParError(2) > 0)
+    {
+      const double w = 1. / (f->GetParError(2) * f->GetParError(2));
+      sumbeta += w * f->GetParameter(2);
+      sumw += w;
+    }
+  }
+  if (galpha->GetN() == 0 || !(sumw > 0))
+  {
+    if (m_Verbosity > 0)
+    {
+      std::cout << "CaloShowerFitter " << m_Detector << ": no hits, longitudinal profile not fitted" << std::endl;
+    }
+    return;
+  }
+  TF1 falpha((key + "_alpha_fit").c_str(), "pol1", std::log(m_Limits.front()), std::log(m_Limits.back()), TF1::EAddToList::kNo);
+  falpha.SetParameters(3, 0.5);
+  if (galpha->GetN() < 2)
+  {
+    falpha.FixParameter(1, 0);
+  }
+  galpha->Fit(&falpha, "Q0R");
+  m_Parametrization->set_longitudinal(falpha.GetParameter(0), falpha.GetParameter(1), sumbeta / sumw);
+}
+
+//____________________________________________________________________________..
+void CaloShowerFitter::FitLateral()
+{
+  double mean = NAN;
+  double variance = NAN;
+  Moments(m_Lateral, mean, variance);
+  if (!(mean > 0))
+  {
+    if (m_Verbosity > 0)
+    {
+      std::cout << "CaloShowerFitter " << m_Detector << ": no hits, lateral profile not fitted" << std::endl;
+    }
+    return;
+  }
+  TF1 lateral((std::string(m_Lateral->GetName()) + "_fit").c_str(), kLateral, 0, m_MaxRadius, TF1::EAddToList::kNo);
+  TF1 *f = &lateral;
+  f->SetParameters(m_Lateral->Integral("width"), 0.7, 0.25 * mean, mean);
+  f->SetParLimits(1, 0, 1);
+  f->SetParLimits(2, 1e-3, m_MaxRadius);
+  f->SetParLimits(3, 1e-3, m_MaxRadius);
+  m_Lateral->Fit(f, "Q0R");
+  double fcore = f->GetParameter(1);
+  double rcore = f->GetParameter(2);
+  double rtail = f->GetParameter(3);
+  // the core is the narrow component
+  if (rcore > rtail)
+  {
+    std::swap(rcore, rtail);
+    fcore = 1 - fcore;
+  }
+  m_Parametrization->set_lateral(fcore, rcore, rtail);
+}
+
+//____________________________________________________________________________..
+int CaloShowerFitter::Write(const std::string &file) const
+{
+  if (!m_Parametrization)
+  {
+    std::cout << "CaloShowerFitter::Write - call Fit() first" << std::endl;
+    return -1;
+  }
+  TDirectory *save = gDirectory;
+  std::unique_ptr<TFile> f(TFile::Open(file.c_str(), "UPDATE"));
+  if (!f || f->IsZombie())
+  {
+    std::cout << "CaloShowerFitter::Write - cannot open " << file << std::endl;
+    return -1;
+  }
+  f->cd();
+  int iret = m_Parametrization->Save();
+  for (TH1 *h : m_Longitudinal)
+  {
+    f->WriteObject(h, h->GetName(), "Overwrite");
+  }
+  f->WriteObject(m_Lateral, m_Lateral->GetName(), "Overwrite");
+  for (TGraphErrors *g : m_Graphs)
+  {
+    f->WriteObject(g, g->GetName(), "Overwrite");
+  }
+  f->Close();
+  if (save)
+  {
+    save->cd();
+  }
+  return iret;
+}
+
+//____________________________________________________________________________..
+void CaloShowerFitter::Print(const std::string &what) const
+{
+  std::cout << "CaloShowerFitter " << m_Detector << " pid " << m_Pid << ": " << m_NEvents << " events, "
+            << m_Limits.size() - 1 << " energy slices" << std::endl;
+  if (m_Parametrization && (what == "ALL" || what == "PARAMETRIZATION"))
+  {
+    m_Parametrization->identify();
+  }
+}
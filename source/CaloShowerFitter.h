@@ -0,0 +1,102 @@
+// Tell emacs that this is a C++ source
+//  -*- C++ -*-.
+#ifndef CALOSHOWERFITTER_H
+#define CALOSHOWERFITTER_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+class CaloShowerParametrization;
+class TGraphErrors;
+class TH1;
+
+//! Fits a CaloShowerParametrization from the single particle output of a full simulation
+/*!
+ * Reads the Eval tree of one detector (events of one generated particle type)
+ * and, per slice of the generated energy,
+ *  - estimates the response tesum/ge with the median and its relative
+ *    resolution sigma_eff/median (ResolutionEstimator), the energy dependence
+ *    is fitted with r0 + r1 ln(E) and a/sqrt(E) (+) b (+) c/E,
+ *  - fills the edep weighted depth of the G4 hits along the generated
+ *    direction, measured from the first hit of the event, and fits it with a
+ *    gamma distribution; alpha is fitted linear in ln(E), beta is averaged.
+ * The lateral profile is the edep weighted distance of the hits to the
+ * generated direction. If a QA file is given it is taken from the
+ * h_QAG4Sim_<det>_G4Hit_LateralTruthProjection histogram instead, which also
+ * contains the hits of Eval trees written without hits (DropHits()).
+ * The longitudinal profile needs the hits in the Eval tree, without them the
+ * showers of the fast simulation are not smeared in depth.
+ */
+class CaloShowerFitter
+{
+ public:
+  CaloShowerFitter(const std::string &det, const int pid);
+
+  virtual ~CaloShowerFitter();
+
+  //! Eval tree file, empty = merged_Eval_<det>.root
+  void SetEvalFile(const std::string &file) { m_EvalFile = file; }
+
+  //! QA histogram file with the lateral shower projection
+  void SetQAFile(const std::string &file) { m_QAFile = file; }
+
+  //! limits of the energy slices in GeV, slice i is limits[i] <= ge < limits[i+1]
+  void SetEnergySlices(const std::vector<double> &limits) { m_Limits = limits; }
+
+  //! range of the longitudinal and lateral profiles in cm
+  void SetMaxDepth(const double d) { m_MaxDepth = d; }
+  void SetMaxRadius(const double r) { m_MaxRadius = r; }
+
+  //! 0 = all entries
+  void SetMaxEvents(const long long n) { m_MaxEvents = n; }
+
+  void Verbosity(const int i) { m_Verbosity = i; }
+
+  //! returns 0 on success
+  int Fit();
+
+  const CaloShowerParametrization *Get() const { return m_Parametrization.get(); }
+
+  //! add the parametrization and the fitted profiles to file (UPDATE), returns 0 on success
+  int Write(const std::string &file) const;
+
+  void Print(const std::string &what = "ALL") const;
+
+ private:
+  int FillProfiles();
+  int FillLateralFromQA();
+  void FitResponse();
+  void FitLongitudinal();
+  void FitLateral();
+  int Slice(const double e) const;
+
+  int m_Pid = 0;
+  int m_Verbosity = 0;
+
+  long long m_MaxEvents = 0;
+  long long m_NEvents = 0;
+
+  double m_MaxDepth = 200;
+  double m_MaxRadius = 30;
+
+  std::string m_Detector;
+  std::string m_EvalFile;
+  std::string m_QAFile;
+
+  std::vector<double> m_Limits = {1, 2, 3, 5, 7, 10, 15, 20, 30, 50, 70, 100};
+
+  // per event generated energy and response
+  std::vector<double> m_Ge;
+  std::vector<double> m_Response;
+
+  // per slice edep weighted depth, lateral profile of all slices
+  std::vector<TH1 *> m_Longitudinal;
+  TH1 *m_Lateral = nullptr;
+
+  std::vector<TGraphErrors *> m_Graphs;
+
+  std::unique_ptr<CaloShowerParametrization> m_Parametrization;
+};
+
+#endif  // CALOSHOWERFITTER_H
@@ -0,0 +1,319 @@
+#include "CaloShowerLibrary.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>  // for operator<<, endl, basic_ost...
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+  const char kMagic[8] = {'E', 'I', 'C', 'S', 'H', 'L', 'I', 'B'};
+  const uint32_t kByteOrder = 0x01020304;
+
+  size_t Align8(const size_t n)
+  {
+    return (n + 7) & ~size_t(7);
+  }
+
+  //! offsets of the sections behind the header
+  struct Layout
+  {
+    size_t pids = 0;
+    size_t edges = 0;
+    size_t bins = 0;
+    size_t showers = 0;
+    size_t hits = 0;
+    size_t end = 0;
+  };
+
+  Layout MakeLayout(const CaloShowerLibrary::Header &h)
+  {
+    Layout l;
+    const size_t nbins = size_t(h.npids) * h.nenergy * h.neta * h.nphi;
+    l.pids = Align8(sizeof(CaloShowerLibrary::Header));
+    l.edges = Align8(l.pids + h.npids * sizeof(int32_t));
+    l.bins = Align8(l.edges + (h.nenergy + h.neta + h.nphi + 3) * sizeof(double));
+    l.showers = Align8(l.bins + nbins * sizeof(CaloShowerLibrary::Bin));
+    l.hits = Align8(l.showers + h.nshowers * sizeof(CaloShowerLibrary::Shower));
+    l.end = l.hits + h.nhits * sizeof(CaloShowerLibrary::Hit);
+    return l;
+  }
+
+  int EdgeBin(const std::vector<double> &edges, const double x)
+  {
+    if (edges.size() < 2 || !(x >= edges.front()) || !(x < edges.back()))
+    {
+      return -1;
+    }
+    return std::upper_bound(edges.begin(), edges.end(), x) - edges.begin() - 1;
+  }
+}  // namespace
+
+//____________________________________________________________________________..
+CaloShowerLibrary::~CaloShowerLibrary()
+{
+  Close();
+}
+
+//____________________________________________________________________________..
+void CaloShowerLibrary::SetBinning(const std::string &det, const std::vector<int> &pids, const std::vector<double> &energy, const std::vector<double> &eta, const int nphi)
+{
+  Close();
+  m_Detector = det;
+  m_Pids = pids;
+  m_Energy = energy;
+  m_Eta = eta;
+  m_Phi.clear();
+  for (int i = 0; i <= std::max(nphi, 1); i++)
+  {
+    m_Phi.push_back(-M_PI + 2 * M_PI * i / std::max(nphi, 1));
+  }
+  m_NBins = m_Pids.size() * (std::max<size_t>(m_Energy.size(), 1) - 1) * (std::max<size_t>(m_Eta.size(), 1) - 1) * (m_Phi.size() - 1);
+  m_NewShowers.assign(m_NBins, std::vector<Shower>());
+  m_NewHits.assign(m_NBins, std::vector<Hit>());
+}
+
+//____________________________________________________________________________..
+int CaloShowerLibrary::Index(const int ipid, const int ie, const int ieta, const int iphi) const
+{
+  return ((ipid * (m_Energy.size() - 1) + ie) * (m_Eta.size() - 1) + ieta) * (m_Phi.size() - 1) + iphi;
+}
+
+//____________________________________________________________________________..
+int CaloShowerLibrary::FindBin(const int pid, const double e, const double eta, const double phi) const
+{
+  auto iter = std::find(m_Pids.begin(), m_Pids.end(), pid);
+  if (iter == m_Pids.end())
+  {
+    return -1;
+  }
+  const int ie = EdgeBin(m_Energy, e);
+  const int ieta = EdgeBin(m_Eta, eta);
+  // phi = pi is the same as -pi
+  const int iphi = EdgeBin(m_Phi, (phi >= M_PI) ? phi - 2 * M_PI : phi);
+  if (ie < 0 || ieta < 0 || iphi < 0)
+  {
+    return -1;
+  }
+  return Index(iter - m_Pids.begin(), ie, ieta, iphi);
+}
+
+//____________________________________________________________________________..
+bool CaloShowerLibrary::Add(const int pid, const Shower &shower, const std::vector<Hit> &hits)
+{
+  if (m_Map)
+  {
+    std::cout << "CaloShowerLibrary::Add - library is opened read only" << std::endl;
+    return false;
+  }
+  const double eta = std::asinh(shower.uz / std::hypot(shower.ux, shower.uy));
+  const int bin = FindBin(pid, shower.e, eta, std::atan2(shower.uy, shower.ux));
+  if (bin < 0)
+  {
+    return false;
+  }
+  Shower s = shower;
+  // relative to the bin, made global in Write()
+  s.first_hit = m_NewHits[bin].size();
+  s.nhits = hits.size();
+  m_NewShowers[bin].push_back(s);
+  m_NewHits[bin].insert(m_NewHits[bin].end(), hits.begin(), hits.end());
+  return true;
+}
+
+//____________________________________________________________________________..
+int CaloShowerLibrary::Write(const std::string &file) const
+{
+  if (m_NBins == 0)
+  {
+    std::cout << "CaloShowerLibrary::Write - no binning set" << std::endl;
+    return -1;
+  }
+  Header h;
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, kMagic, sizeof(h.magic));
+  h.version = kVersion;
+  h.byteorder = kByteOrder;
+  strncpy(h.detector, m_Detector.c_str(), sizeof(h.detector) - 1);
+  h.npids = m_Pids.size();
+  h.nenergy = m_Energy.size() - 1;
+  h.neta = m_Eta.size() - 1;
+  h.nphi = m_Phi.size() - 1;
+  for (size_t bin = 0; bin < m_NBins; bin++)
+  {
+    h.nshowers += m_NewShowers[bin].size();
+    h.nhits += m_NewHits[bin].size();
+  }
+  const Layout layout = MakeLayout(h);
+
+  std::ofstream out(file, std::ios::binary | std::ios::trunc);
+  if (!out)
+  {
+    std::cout << "CaloShowerLibrary::Write - cannot open " << file << std::endl;
+    return -1;
+  }
+  auto pad = [&out](const size_t offset) {
+    static const char zeros[8] = {0};
+    out.write(zeros, offset - out.tellp());
+  };
+  out.write(reinterpret_cast<const char *>(&h), sizeof(h));
+  pad(layout.pids);
+  for (const int pid : m_Pids)
+  {
+    const int32_t p = pid;
+    out.write(reinterpret_cast<const char *>(&p), sizeof(p));
+  }
+  pad(layout.edges);
+  for (const std::vector<double> *edges : {&m_Energy, &m_Eta, &m_Phi})
+  {
+    out.write(reinterpret_cast<const char *>(edges->data()), edges->size() * sizeof(double));
+  }
+  pad(layout.bins);
+  uint64_t nshowers = 0;
+  for (size_t bin = 0; bin < m_NBins; bin++)
+  {
+    const Bin b = {nshowers, m_NewShowers[bin].size()};
+    out.write(reinterpret_cast<const char *>(&b), sizeof(b));
+    nshowers += b.nshowers;
+  }
+  pad(layout.showers);
+  uint64_t nhits = 0;
+  for (size_t bin = 0; bin < m_NBins; bin++)
+  {
+    for (Shower s : m_NewShowers[bin])
+    {
+      s.first_hit += nhits;
+      out.write(reinterpret_cast<const char *>(&s), sizeof(s));
+    }
+    nhits += m_NewHits[bin].size();
+  }
+  pad(layout.hits);
+  for (size_t bin = 0; bin < m_NBins; bin++)
+  {
+    out.write(reinterpret_cast<const char *>(m_NewHits[bin].data()), m_NewHits[bin].size() * sizeof(Hit));
+  }
+  out.close();
+  if (!out)
+  {
+    std::cout << "CaloShowerLibrary::Write - error writing " << file << std::endl;
+    return -1;
+  }
+  return 0;
+}
+
+//____________________________________________________________________________..
+int CaloShowerLibrary::Open(const std::string &file)
+{
+  Close();
+  const int fd = open(file.c_str(), O_RDONLY);
+  if (fd < 0)
+  {
+    std::cout << "CaloShowerLibrary::Open - cannot open " << file << std::endl;
+    return -1;
+  }
+  struct stat st;
+  if (fstat(fd, &st) || st.st_size < static_cast<off_t>(sizeof(Header)))
+  {
+    std::cout << "CaloShowerLibrary::Open - " << file << " is not a shower library" << std::endl;
+    close(fd);
+    return -1;
+  }
+  void *map = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  // the mapping stays valid after the file is closed
+  close(fd);
+  if (map == MAP_FAILED)
+  {
+    std::cout << "CaloShowerLibrary::Open - cannot map " << file << std::endl;
+    return -1;
+  }
+  m_Map = map;
+  m_MapSize = st.st_size;
+
+  const char *base = static_cast<const char *>(m_Map);
+  const Header *h = reinterpret_cast<const Header *>(base);
+  if (memcmp(h->magic, kMagic, sizeof(kMagic)) || h->byteorder != kByteOrder || h->version != kVersion)
+  {
+    std::cout << "CaloShowerLibrary::Open - " << file << " is not a shower library of version " << kVersion
+              << " in the byte order of this machine" << std::endl;
+    Close();
+    return -1;
+  }
+  const Layout layout = MakeLayout(*h);
+  if (layout.end != m_MapSize)
+  {
+    std::cout << "CaloShowerLibrary::Open - " << file << " has " << m_MapSize << " bytes instead of " << layout.end << std::endl;
+    Close();
+    return -1;
+  }
+  m_Header = h;
+  m_Detector = std::string(h->detector, strnlen(h->detector, sizeof(h->detector)));
+  const int32_t *pids = reinterpret_cast<const int32_t *>(base + layout.pids);
+  m_Pids.assign(pids, pids + h->npids);
+  const double *edges = reinterpret_cast<const double *>(base + layout.edges);
+  m_Energy.assign(edges, edges + h->nenergy + 1);
+  edges += h->nenergy + 1;
+  m_Eta.assign(edges, edges + h->neta + 1);
+  edges += h->neta + 1;
+  m_Phi.assign(edges, edges + h->nphi + 1);
+  m_NBins = size_t(h->npids) * h->nenergy * h->neta * h->nphi;
+  m_Bins = reinterpret_cast<const Bin *>(base + layout.bins);
+  m_Showers = reinterpret_cast<const Shower *>(base + layout.showers);
+  m_Hits = reinterpret_cast<const Hit *>(base + layout.hits);
+  return 0;
+}
+
+//____________________________________________________________________________..
+void CaloShowerLibrary::Close()
+{
+  if (m_Map)
+  {
+    munmap(m_Map, m_MapSize);
+  }
+  m_Map = nullptr;
+  m_MapSize = 0;
+  m_Header = nullptr;
+  m_Bins = nullptr;
+  m_Showers = nullptr;
+  m_Hits = nullptr;
+}
+
+//____________________________________________________________________________..
+void CaloShowerLibrary::Print(const std::string &what) const
+{
+  std::cout << "CaloShowerLibrary " << m_Detector << ": " << m_Pids.size() << " particle types, "
+            << m_Energy.size() - 1 << " energy, " << m_Eta.size() - 1 << " eta, " << m_Phi.size() - 1 << " phi bins";
+  if (m_Header)
+  {
+    std::cout << ", " << m_Header->nshowers << " showers, " << m_Header->nhits << " hits, "
+              << m_MapSize / (1024 * 1024) << " MB mapped";
+  }
+  std::cout << std::endl;
+  if (what != "ALL" || !m_Bins)
+  {
+    return;
+  }
+  // showers per pid, energy and eta bin, summed over phi
+  for (size_t ipid = 0; ipid < m_Pids.size(); ipid++)
+  {
+    for (size_t ie = 0; ie + 1 < m_Energy.size(); ie++)
+    {
+      std::cout << "  pid " << m_Pids[ipid] << ", " << m_Energy[ie] << " - " << m_Energy[ie + 1] << " GeV:";
+      for (size_t ieta = 0; ieta + 1 < m_Eta.size(); ieta++)
+      {
+        uint64_t n = 0;
+        for (size_t iphi = 0; iphi + 1 < m_Phi.size(); iphi++)
+        {
+          n += m_Bins[Index(ipid, ie, ieta, iphi)].nshowers;
+        }
+        std::cout << " " << n;
+      }
+      std::cout << std::endl;
+    }
+  }
+}
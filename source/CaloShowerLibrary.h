@@ -0,0 +1,139 @@
+// Tell emacs that this is a C++ source
+//  -*- C++ -*-.
+#ifndef CALOSHOWERLIBRARY_H
+#define CALOSHOWERLIBRARY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//! Library of recorded calorimeter showers, binned in particle type, energy, eta and phi
+/*!
+ * Filled by CaloShowerLibraryRecorder from a full simulation, replayed by
+ * CaloShowerLibraryReplay. The file is a flat binary image which is mapped
+ * into memory (mmap) for the replay, so opening it costs nothing and all
+ * jobs on a node share the pages:
+ *   Header | pids | energy, eta, phi edges | Bin[nbins] | Shower[nshowers] | Hit[nhits]
+ * The showers of a bin and the hits of a shower are contiguous. Positions
+ * and times are stored as recorded, together with the vertex and direction
+ * of the primary, so the replay can rotate them onto a new particle. The
+ * file is written in the byte order of the machine, the header has a
+ * version and a byte order mark.
+ */
+class CaloShowerLibrary
+{
+ public:
+  static const uint32_t kVersion = 1;
+
+  struct Header
+  {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteorder;
+    char detector[32];
+    uint32_t npids;
+    uint32_t nenergy;
+    uint32_t neta;
+    uint32_t nphi;
+    uint64_t nshowers;
+    uint64_t nhits;
+  };
+
+  struct Bin
+  {
+    uint64_t first_shower;
+    uint64_t nshowers;
+  };
+
+  struct Shower
+  {
+    double e;  // generated energy (GeV)
+    double vx;  // vertex (cm)
+    double vy;
+    double vz;
+    double ux;  // unit vector of the momentum
+    double uy;
+    double uz;
+    double tower_scale;  // calibrated tower energy / active edep, NAN if no towers
+    uint64_t first_hit;
+    uint64_t nhits;
+  };
+
+  //! one G4 hit, unset indices are stored as the PHG4Hit defaults
+  struct Hit
+  {
+    float x[2];
+    float y[2];
+    float z[2];
+    float t[2];
+    float edep;
+    float eion;
+    float light_yield;
+    uint32_t layer;
+    int32_t index_i;
+    int32_t index_j;
+    int32_t index_k;
+    int32_t index_l;
+    int32_t scint_id;
+    int32_t hit_type;
+    int32_t detid;
+    int32_t absorber;  // 1 for G4HIT_ABSORBER_<det>
+  };
+
+  CaloShowerLibrary() {}
+
+  virtual ~CaloShowerLibrary();
+
+  //! binning of a new library, pids are the particle types to record
+  void SetBinning(const std::string &det, const std::vector<int> &pids, const std::vector<double> &energy, const std::vector<double> &eta, const int nphi = 1);
+
+  //! bin of a particle, -1 if it is not in the library
+  int FindBin(const int pid, const double e, const double eta, const double phi) const;
+
+  //! adds a shower to a new library (not when reading), returns false if the particle is outside the binning
+  bool Add(const int pid, const Shower &shower, const std::vector<Hit> &hits);
+
+  //! writes a new library, returns 0 on success
+  int Write(const std::string &file) const;
+
+  //! maps a library file read only, returns 0 on success
+  int Open(const std::string &file);
+
+  void Close();
+
+  size_t NBins() const { return m_NBins; }
+  uint64_t NShowers() const { return m_Header ? m_Header->nshowers : 0; }
+  uint64_t NShowers(const int bin) const { return m_Bins[bin].nshowers; }
+  const std::string &Detector() const { return m_Detector; }
+
+  //! shower i of a bin and its hits, only for an opened library
+  const Shower &GetShower(const int bin, const uint64_t i) const { return m_Showers[m_Bins[bin].first_shower + i]; }
+  const Hit *GetHits(const Shower &shower) const { return m_Hits + shower.first_hit; }
+
+  void Print(const std::string &what = "ALL") const;
+
+ private:
+  int Index(const int ipid, const int ie, const int ieta, const int iphi) const;
+
+  std::string m_Detector;
+  std::vector<int> m_Pids;
+  std::vector<double> m_Energy;
+  std::vector<double> m_Eta;
+  std::vector<double> m_Phi;
+  size_t m_NBins = 0;
+
+  // new library: showers and hits per bin
+  std::vector<std::vector<Shower>> m_NewShowers;
+  std::vector<std::vector<Hit>> m_NewHits;
+
+  // opened library: pointers into the mapped file
+  void *m_Map = nullptr;
+  size_t m_MapSize = 0;
+  const Header *m_Header = nullptr;
+  const Bin *m_Bins = nullptr;
+  const Shower *m_Showers = nullptr;
+  const Hit *m_Hits = nullptr;
+};
+
+#endif  // CALOSHOWERLIBRARY_H
@@ -0,0 +1,200 @@
+#include "CaloShowerLibraryRecorder.h"
+
+#include "CaloShowerLibrary.h"
+#include "QAInstrumentation.h"
+
+#include <g4main/PHG4Hit.h>
+#include <g4main/PHG4HitContainer.h>
+#include <g4main/PHG4Particle.h>
+#include <g4main/PHG4TruthInfoContainer.h>
+#include <g4main/PHG4VtxPoint.h>
+
+#include <calobase/RawTower.h>
+#include <calobase/RawTowerContainer.h>
+
+#include <fun4all/Fun4AllReturnCodes.h>
+
+#include <phool/PHCompositeNode.h>
+#include <phool/getClass.h>
+
+#include <cmath>
+#include <iostream>  // for operator<<, endl, basic_ost...
+#include <iterator>
+
+namespace
+{
+  CaloShowerLibrary::Hit MakeHit(const PHG4Hit *g4hit, const bool absorber)
+  {
+    CaloShowerLibrary::Hit hit;
+    for (int i = 0; i < 2; i++)
+    {
+      hit.x[i] = g4hit->get_x(i);
+      hit.y[i] = g4hit->get_y(i);
+      hit.z[i] = g4hit->get_z(i);
+      hit.t[i] = g4hit->get_t(i);
+    }
+    hit.edep = g4hit->get_edep();
+    hit.eion = g4hit->get_eion();
+    hit.light_yield = g4hit->get_light_yield();
+    hit.layer = g4hit->get_layer();
+    hit.index_i = g4hit->get_index_i();
+    hit.index_j = g4hit->get_index_j();
+    hit.index_k = g4hit->get_index_k();
+    hit.index_l = g4hit->get_index_l();
+    hit.scint_id = g4hit->get_scint_id();
+    hit.hit_type = g4hit->get_hit_type();
+    hit.detid = g4hit->get_detid();
+    hit.absorber = absorber;
+    return hit;
+  }
+}  // namespace
+
+//____________________________________________________________________________..
+CaloShowerLibraryRecorder::CaloShowerLibraryRecorder(const std::string &name, const std::string &filename)
+  : SubsysReco(name)
+  , m_FileName(filename)
+{
+}
+
+//____________________________________________________________________________..
+CaloShowerLibraryRecorder::~CaloShowerLibraryRecorder()
+{
+}
+
+//____________________________________________________________________________..
+int CaloShowerLibraryRecorder::Init(PHCompositeNode *topNode)
+{
+  if (m_Detector.empty())
+  {
+    std::cout << "CaloShowerLibraryRecorder::Init - Detector not set via Detector(<name>) method" << std::endl;
+    return Fun4AllReturnCodes::ABORTRUN;
+  }
+  m_Library.reset(new CaloShowerLibrary());
+  m_Library->SetBinning(m_Detector, m_Pids, m_Energy, m_Eta, m_NPhi);
+  if (m_Library->NBins() == 0)
+  {
+    std::cout << "CaloShowerLibraryRecorder::Init - empty binning" << std::endl;
+    return Fun4AllReturnCodes::ABORTRUN;
+  }
+  m_Timer = QAInstrumentation::instance()->Stage(Name());
+  return Fun4AllReturnCodes::EVENT_OK;
+}
+
+//____________________________________________________________________________..
+int CaloShowerLibraryRecorder::process_event(PHCompositeNode *topNode)
+{
+  QAInstrumentation::Scope timer(m_Timer);
+  PHG4TruthInfoContainer *truthinfo = findNode::getClass<PHG4TruthInfoContainer>(topNode, "G4TruthInfo");
+  if (!truthinfo)
+  {
+    std::cout << "CaloShowerLibraryRecorder::process_event - could not find G4TruthInfo" << std::endl;
+    return Fun4AllReturnCodes::ABORTRUN;
+  }
+  PHG4TruthInfoContainer::ConstRange range = truthinfo->GetPrimaryParticleRange();
+  if (std::distance(range.first, range.second) != 1)
+  {
+    m_NSkipped++;
+    return Fun4AllReturnCodes::EVENT_OK;
+  }
+  const PHG4Particle *primary = range.first->second;
+  const double p = std::sqrt(primary->get_px() * primary->get_px() + primary->get_py() * primary->get_py() + primary->get_pz() * primary->get_pz());
+  if (!(p > 0))
+  {
+    m_NSkipped++;
+    return Fun4AllReturnCodes::EVENT_OK;
+  }
+  CaloShowerLibrary::Shower shower;
+  shower.e = primary->get_e();
+  shower.ux = primary->get_px() / p;
+  shower.uy = primary->get_py() / p;
+  shower.uz = primary->get_pz() / p;
+  const PHG4VtxPoint *vtx = truthinfo->GetPrimaryVtx(primary->get_vtx_id());
+  shower.vx = vtx ? vtx->get_x() : 0;
+  shower.vy = vtx ? vtx->get_y() : 0;
+  shower.vz = vtx ? vtx->get_z() : 0;
+
+  std::vector<CaloShowerLibrary::Hit> hits;
+  double edep = 0;
+  PHG4HitContainer *g4hits = findNode::getClass<PHG4HitContainer>(topNode, m_HitNodeName);
+  if (!g4hits)
+  {
+    std::cout << "CaloShowerLibraryRecorder::process_event - could not find " << m_HitNodeName << std::endl;
+    return Fun4AllReturnCodes::ABORTRUN;
+  }
+  PHG4HitContainer::ConstRange hit_range = g4hits->getHits();
+  for (PHG4HitContainer::ConstIterator hit_iter = hit_range.first; hit_iter != hit_range.second; hit_iter++)
+  {
+    hits.push_back(MakeHit(hit_iter->second, false));
+    edep += hit_iter->second->get_edep();
+  }
+  // the absorber hits are only there with Enable::<det>_ABSORBER
+  g4hits = findNode::getClass<PHG4HitContainer>(topNode, m_AbsorberNodeName);
+  if (g4hits)
+  {
+    hit_range = g4hits->getHits();
+    for (PHG4HitContainer::ConstIterator hit_iter = hit_range.first; hit_iter != hit_range.second; hit_iter++)
+    {
+      hits.push_back(MakeHit(hit_iter->second, true));
+    }
+  }
+
+  shower.tower_scale = NAN;
+  RawTowerContainer *towers = findNode::getClass<RawTowerContainer>(topNode, m_TowerNodeName);
+  if (towers && edep > 0)
+  {
+    double tesum = 0;
+    RawTowerContainer::ConstRange tower_range = towers->getTowers();
+    for (RawTowerContainer::ConstIterator iter = tower_range.first; iter != tower_range.second; ++iter)
+    {
+      tesum += iter->second->get_energy();
+    }
+    shower.tower_scale = tesum / edep;
+  }
+
+  if (m_Library->Add(primary->get_pid(), shower, hits))
+  {
+    m_NRecorded++;
+  }
+  else
+  {
+    m_NSkipped++;
+  }
+  return Fun4AllReturnCodes::EVENT_OK;
+}
+
+//____________________________________________________________________________..
+int CaloShowerLibraryRecorder::End(PHCompositeNode *topNode)
+{
+  if (m_Library->Write(m_FileName))
+  {
+    return Fun4AllReturnCodes::ABORTRUN;
+  }
+  Print();
+  QAInstrumentation::instance()->End();
+  return Fun4AllReturnCodes::EVENT_OK;
+}
+
+//____________________________________________________________________________..
+void CaloShowerLibraryRecorder::Print(const std::string &what) const
+{
+  std::cout << "CaloShowerLibraryRecorder " << m_Detector << ": " << m_NRecorded << " showers recorded into " << m_FileName
+            << ", " << m_NSkipped << " events skipped (not one primary or outside the binning)" << std::endl;
+}
+
+//____________________________________________________________________________..
+void CaloShowerLibraryRecorder::SetBinning(const std::vector<int> &pids, const std::vector<double> &energy, const std::vector<double> &eta, const int nphi)
+{
+  m_Pids = pids;
+  m_Energy = energy;
+  m_Eta = eta;
+  m_NPhi = nphi;
+}
+
+//____________________________________________________________________________..
+void CaloShowerLibraryRecorder::Detector(const std::string &name)
+{
+  m_Detector = name;
+  m_HitNodeName = "G4HIT_" + name;
+  m_AbsorberNodeName = "G4HIT_ABSORBER_" + name;
+  m_TowerNodeName = "TOWER_CALIB_" + name;
+}
@@ -0,0 +1,72 @@
+// Tell emacs that this is a C++ source
+//  -*- C++ -*-.
+#ifndef CALOSHOWERLIBRARYRECORDER_H
+#define CALOSHOWERLIBRARYRECORDER_H
+
+#include <fun4all/SubsysReco.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+class CaloShowerLibrary;
+class PHCompositeNode;
+
+//! Records the G4 hits of single particle events into a CaloShowerLibrary
+/*!
+ * Run once with the full simulation of single particles (Fun4All_G4_<det>.C
+ * with Enable::SHOWERLIBRARY_RECORD), after the tower calibration of the
+ * detector: per event the hits of G4HIT_<det> and G4HIT_ABSORBER_<det> are
+ * stored with the vertex and direction of the primary, together with the
+ * ratio of the calibrated tower energy to the active edep, which the tower
+ * mode of the replay needs. Events with more than one primary are skipped.
+ * The library is written at End().
+ */
+class CaloShowerLibraryRecorder : public SubsysReco
+{
+ public:
+  CaloShowerLibraryRecorder(const std::string &name = "CaloShowerLibraryRecorder", const std::string &filename = "shower_library.bin");
+
+  virtual ~CaloShowerLibraryRecorder();
+
+  /** Called during initialization.
+      Sets up the library binning.
+   */
+  int Init(PHCompositeNode *topNode) override;
+
+  /** Called for each event.
+      This is where you do the real work.
+   */
+  int process_event(PHCompositeNode *topNode) override;
+
+  /// Called at the end of all processing.
+  int End(PHCompositeNode *topNode) override;
+
+  void Print(const std::string &what = "ALL") const override;
+
+  void Detector(const std::string &name);
+
+  //! particle types, energy (GeV) and eta bin edges and the number of phi bins of the library
+  void SetBinning(const std::vector<int> &pids, const std::vector<double> &energy, const std::vector<double> &eta, const int nphi = 1);
+
+ private:
+  int m_NPhi = 1;
+  int m_Timer = -1;  // QAInstrumentation stage
+
+  long long m_NRecorded = 0;
+  long long m_NSkipped = 0;
+
+  std::string m_FileName;
+  std::string m_Detector;
+  std::string m_HitNodeName;
+  std::string m_AbsorberNodeName;
+  std::string m_TowerNodeName;
+
+  std::vector<int> m_Pids = {11, -11, 22, 211, -211};
+  std::vector<double> m_Energy = {1, 2, 4, 8, 16, 32, 64};
+  std::vector<double> m_Eta = {-4, 4};
+
+  std::unique_ptr<CaloShowerLibrary> m_Library;
+};
+
+#endif  // CALOSHOWERLIBRARYRECORDER_H
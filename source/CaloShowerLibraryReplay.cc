@@ -0,0 +1,394 @@
+#include "CaloShowerLibraryReplay.h"
+
+#include "CaloShowerLibrary.h"
+#include "CaloTowerLocator.h"
+#include "QAInstrumentation.h"
+
+#include <g4main/PHG4Hit.h>
+#include <g4main/PHG4HitContainer.h>
+#include <g4main/PHG4Hitv1.h>
+#include <g4main/PHG4Particle.h>
+#include <g4main/PHG4TruthInfoContainer.h>
+#include <g4main/PHG4VtxPoint.h>
+
+#include <calobase/RawTower.h>
+#include <calobase/RawTowerContainer.h>
+#include <calobase/RawTowerGeomContainer.h>
+#include <calobase/RawTowerv1.h>
+
+#include <fun4all/Fun4AllReturnCodes.h>
+
+#include <phool/PHCompositeNode.h>
+#include <phool/getClass.h>
+
+#include <TRandom3.h>
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <iostream>  // for operator<<, endl, basic_ost...
+#include <map>
+
+namespace
+{
+  //! orthonormal frame with the first axis along u, the other two rotated by psi around it
+  struct Frame
+  {
+    double u[3];
+    double a[3];
+    double b[3];
+  };
+
+  Frame MakeFrame(const double ux, const double uy, const double uz, const double psi)
+  {
+    Frame f = {{ux, uy, uz}, {0, 0, 0}, {0, 0, 0}};
+    double ax = 0;
+    double ay = 0;
+    double az = 1;
+    if (std::fabs(uz) > 0.9)
+    {
+      ax = 1;
+      az = 0;
+    }
+    double e1[3] = {ay * uz - az * uy, az * ux - ax * uz, ax * uy - ay * ux};
+    const double norm = std::sqrt(e1[0] * e1[0] + e1[1] * e1[1] + e1[2] * e1[2]);
+    for (double &c : e1)
+    {
+      c /= norm;
+    }
+    const double e2[3] = {uy * e1[2] - uz * e1[1], uz * e1[0] - ux * e1[2], ux * e1[1] - uy * e1[0]};
+    for (int i = 0; i < 3; i++)
+    {
+      f.a[i] = std::cos(psi) * e1[i] + std::sin(psi) * e2[i];
+      f.b[i] = -std::sin(psi) * e1[i] + std::cos(psi) * e2[i];
+    }
+    return f;
+  }
+}  // namespace
+
+//____________________________________________________________________________..
+CaloShowerLibraryReplay::CaloShowerLibraryReplay(const std::string &name)
+  : SubsysReco(name)
+{
+}
+
+//____________________________________________________________________________..
+CaloShowerLibraryReplay::~CaloShowerLibraryReplay()
+{
+}
+
+//____________________________________________________________________________..
+int CaloShowerLibraryReplay::Init(PHCompositeNode *topNode)
+{
+  if (m_Detector.empty())
+  {
+    std::cout << "CaloShowerLibraryReplay::Init - Detector not set via Detector(<name>) method" << std::endl;
+    return Fun4AllReturnCodes::ABORTRUN;
+  }
+  m_Library.reset(new CaloShowerLibrary());
+  if (m_Library->Open(m_LibraryFile))
+  {
+    return Fun4AllReturnCodes::ABORTRUN;
+  }
+  if (m_Library->Detector() != m_Detector)
+  {
+    std::cout << "CaloShowerLibraryReplay::Init - " << m_LibraryFile << " is a library of " << m_Library->Detector()
+              << ", not of " << m_Detector << std::endl;
+    return Fun4AllReturnCodes::ABORTRUN;
+  }
+  if (m_Library->NShowers() == 0)
+  {
+    std::cout << "CaloShowerLibraryReplay::Init - no showers in " << m_LibraryFile << std::endl;
+    return Fun4AllReturnCodes::ABORTRUN;
+  }
+  if (Verbosity() > 0)
+  {
+    m_Library->Print();
+  }
+  m_Random.reset(new TRandom3(m_Seed));
+  m_Timer = QAInstrumentation::instance()->Stage(Name());
+  return Fun4AllReturnCodes::EVENT_OK;
+}
+
+//____________________________________________________________________________..
+int CaloShowerLibraryReplay::InitRun(PHCompositeNode *topNode)
+{
+  if (m_Mode == kG4Hit)
+  {
+    if (!findNode::getClass<PHG4HitContainer>(topNode, m_HitNodeName))
+    {
+      std::cout << "CaloShowerLibraryReplay::InitRun - could not find " << m_HitNodeName << std::endl;
+      return Fun4AllReturnCodes::ABORTRUN;
+    }
+    return Fun4AllReturnCodes::EVENT_OK;
+  }
+  RawTowerGeomContainer *geom = findNode::getClass<RawTowerGeomContainer>(topNode, m_TowerGeoNodeName);
+  if (!geom)
+  {
+    std::cout << "CaloShowerLibraryReplay::InitRun - could not find " << m_TowerGeoNodeName << std::endl;
+    return Fun4AllReturnCodes::ABORTRUN;
+  }
+  if (!findNode::getClass<RawTowerContainer>(topNode, m_TowerNodeName))
+  {
+    std::cout << "CaloShowerLibraryReplay::InitRun - could not find " << m_TowerNodeName << std::endl;
+    return Fun4AllReturnCodes::ABORTRUN;
+  }
+  m_Locator.reset(new CaloTowerLocator());
+  if (m_Locator->Build(geom))
+  {
+    std::cout << "CaloShowerLibraryReplay::InitRun - no towers in " << m_TowerGeoNodeName << std::endl;
+    return Fun4AllReturnCodes::ABORTRUN;
+  }
+  return Fun4AllReturnCodes::EVENT_OK;
+}
+
+//____________________________________________________________________________..
+int CaloShowerLibraryReplay::process_event(PHCompositeNode *topNode)
+{
+  QAInstrumentation::Scope timer(m_Timer);
+  std::vector<Primary> primaries;
+  int iret = SelectShowers(topNode, primaries);
+  if (iret != Fun4AllReturnCodes::EVENT_OK)
+  {
+    return iret;
+  }
+  return (m_Mode == kG4Hit) ? ReplayHits(topNode, primaries) : ReplayTowers(topNode, primaries);
+}
+
+//____________________________________________________________________________..
+int CaloShowerLibraryReplay::SelectShowers(PHCompositeNode *topNode, std::vector<Primary> &primaries)
+{
+  PHG4TruthInfoContainer *truthinfo = findNode::getClass<PHG4TruthInfoContainer>(topNode, "G4TruthInfo");
+  if (!truthinfo)
+  {
+    std::cout << "CaloShowerLibraryReplay::process_event - could not find G4TruthInfo" << std::endl;
+    return Fun4AllReturnCodes::ABORTRUN;
+  }
+  PHG4TruthInfoContainer::ConstRange range = truthinfo->GetPrimaryParticleRange();
+  for (PHG4TruthInfoContainer::ConstIterator iter = range.first; iter != range.second; ++iter)
+  {
+    const PHG4Particle *particle = iter->second;
+    const double p = std::sqrt(particle->get_px() * particle->get_px() + particle->get_py() * particle->get_py() + particle->get_pz() * particle->get_pz());
+    if (!(p > 0))
+    {
+      continue;
+    }
+    Primary primary;
+    primary.trkid = particle->get_track_id();
+    primary.e = particle->get_e();
+    primary.ux = particle->get_px() / p;
+    primary.uy = particle->get_py() / p;
+    primary.uz = particle->get_pz() / p;
+    const PHG4VtxPoint *vtx = truthinfo->GetPrimaryVtx(particle->get_vtx_id());
+    if (vtx)
+    {
+      primary.vx = vtx->get_x();
+      primary.vy = vtx->get_y();
+      primary.vz = vtx->get_z();
+    }
+    const double eta = std::asinh(primary.uz / std::hypot(primary.ux, primary.uy));
+    primary.bin = m_Library->FindBin(particle->get_pid(), primary.e, eta, std::atan2(primary.uy, primary.ux));
+    // neutrinos and particles outside the binning do not shower in the library
+    if (primary.bin < 0 || m_Library->NShowers(primary.bin) == 0)
+    {
+      m_NMissing++;
+      continue;
+    }
+    primary.shower = std::min<unsigned long long>(m_Random->Rndm() * m_Library->NShowers(primary.bin), m_Library->NShowers(primary.bin) - 1);
+    primaries.push_back(primary);
+  }
+  return Fun4AllReturnCodes::EVENT_OK;
+}
+
+//____________________________________________________________________________..
+int CaloShowerLibraryReplay::ReplayHits(PHCompositeNode *topNode, const std::vector<Primary> &primaries)
+{
+  PHG4HitContainer *hits = findNode::getClass<PHG4HitContainer>(topNode, m_HitNodeName);
+  if (!hits)
+  {
+    std::cout << "CaloShowerLibraryReplay::process_event - could not find " << m_HitNodeName << std::endl;
+    return Fun4AllReturnCodes::ABORTRUN;
+  }
+  // the absorber hits are only replayed with Enable::<det>_ABSORBER
+  PHG4HitContainer *absorber = findNode::getClass<PHG4HitContainer>(topNode, m_AbsorberNodeName);
+  if (m_ResetNodes)
+  {
+    hits->Reset();
+    if (absorber)
+    {
+      absorber->Reset();
+    }
+  }
+  for (const Primary &primary : primaries)
+  {
+    const CaloShowerLibrary::Shower &shower = m_Library->GetShower(primary.bin, primary.shower);
+    const CaloShowerLibrary::Hit *libhits = m_Library->GetHits(shower);
+    const double scale = primary.e / shower.e;
+    m_NReplayed++;
+    const double dphi = m_RotatePhi ? std::atan2(primary.uy, primary.ux) - std::atan2(shower.uy, shower.ux) : 0;
+    const double c = std::cos(dphi);
+    const double s = std::sin(dphi);
+    for (uint64_t ihit = 0; ihit < shower.nhits; ihit++)
+    {
+      const CaloShowerLibrary::Hit &libhit = libhits[ihit];
+      PHG4HitContainer *container = libhit.absorber ? absorber : hits;
+      if (!container)
+      {
+        continue;
+      }
+      PHG4Hit *hit = new PHG4Hitv1();
+      for (int i = 0; i < 2; i++)
+      {
+        hit->set_x(i, c * libhit.x[i] - s * libhit.y[i]);
+        hit->set_y(i, s * libhit.x[i] + c * libhit.y[i]);
+        hit->set_z(i, libhit.z[i]);
+        hit->set_t(i, libhit.t[i]);
+      }
+      hit->set_edep(libhit.edep * scale);
+      hit->set_eion(libhit.eion * scale);
+      hit->set_light_yield(libhit.light_yield * scale);
+      hit->set_trkid(primary.trkid);
+      // only set what the recorded hit had, the defaults mean unset
+      if (libhit.layer != UINT_MAX)
+      {
+        hit->set_layer(libhit.layer);
+      }
+      if (libhit.index_i != INT_MIN)
+      {
+        hit->set_index_i(libhit.index_i);
+      }
+      if (libhit.index_j != INT_MIN)
+      {
+        hit->set_index_j(libhit.index_j);
+      }
+      if (libhit.index_k != INT_MIN)
+      {
+        hit->set_index_k(libhit.index_k);
+      }
+      if (libhit.index_l != INT_MIN)
+      {
+        hit->set_index_l(libhit.index_l);
+      }
+      if (libhit.scint_id != INT_MIN)
+      {
+        hit->set_scint_id(libhit.scint_id);
+      }
+      if (libhit.hit_type != INT_MIN)
+      {
+        hit->set_hit_type(libhit.hit_type);
+      }
+      container->AddHit(libhit.detid, hit);
+    }
+  }
+  return Fun4AllReturnCodes::EVENT_OK;
+}
+
+//____________________________________________________________________________..
+int CaloShowerLibraryReplay::ReplayTowers(PHCompositeNode *topNode, const std::vector<Primary> &primaries)
+{
+  RawTowerContainer *towers = findNode::getClass<RawTowerContainer>(topNode, m_TowerNodeName);
+  if (!towers)
+  {
+    std::cout << "CaloShowerLibraryReplay::process_event - could not find " << m_TowerNodeName << std::endl;
+    return Fun4AllReturnCodes::ABORTRUN;
+  }
+  if (m_ResetNodes)
+  {
+    towers->Reset();
+  }
+
+  // energy per tower index of all showers of this event
+  std::map<int, double> deposits;
+  for (const Primary &primary : primaries)
+  {
+    const CaloShowerLibrary::Shower &shower = m_Library->GetShower(primary.bin, primary.shower);
+    if (!(shower.tower_scale > 0))
+    {
+      m_NMissing++;
+      continue;
+    }
+    m_NReplayed++;
+    const CaloShowerLibrary::Hit *libhits = m_Library->GetHits(shower);
+    const double scale = primary.e / shower.e * shower.tower_scale;
+    // hit positions in the frame of the recorded shower, put into the frame of the primary
+    const Frame from = MakeFrame(shower.ux, shower.uy, shower.uz, 0);
+    const Frame to = MakeFrame(primary.ux, primary.uy, primary.uz, 2 * M_PI * m_Random->Rndm());
+    for (uint64_t ihit = 0; ihit < shower.nhits; ihit++)
+    {
+      const CaloShowerLibrary::Hit &libhit = libhits[ihit];
+      if (libhit.absorber)
+      {
+        continue;
+      }
+      const double d[3] = {0.5 * (libhit.x[0] + libhit.x[1]) - shower.vx,
+                           0.5 * (libhit.y[0] + libhit.y[1]) - shower.vy,
+                           0.5 * (libhit.z[0] + libhit.z[1]) - shower.vz};
+      double lu = 0;
+      double la = 0;
+      double lb = 0;
+      for (int i = 0; i < 3; i++)
+      {
+        lu += d[i] * from.u[i];
+        la += d[i] * from.a[i];
+        lb += d[i] * from.b[i];
+      }
+      const double x = primary.vx + lu * to.u[0] + la * to.a[0] + lb * to.b[0];
+      const double y = primary.vy + lu * to.u[1] + la * to.a[1] + lb * to.b[1];
+      const double z = primary.vz + lu * to.u[2] + la * to.a[2] + lb * to.b[2];
+      const int itower = m_Locator->Find(x, y, z);
+      if (itower >= 0)
+      {
+        deposits[itower] += libhit.edep * scale;
+      }
+    }
+  }
+
+  for (const auto &deposit : deposits)
+  {
+    const unsigned int key = m_Locator->Tower(deposit.first).key;
+    RawTower *tower = towers->getTower(key);
+    if (!tower)
+    {
+      tower = new RawTowerv1(key);
+      towers->AddTower(key, tower);
+    }
+    tower->set_energy(tower->get_energy() + deposit.second);
+  }
+  if (Verbosity() > 1)
+  {
+    std::cout << "CaloShowerLibraryReplay " << m_Detector << ": " << deposits.size() << " towers filled" << std::endl;
+  }
+  return Fun4AllReturnCodes::EVENT_OK;
+}
+
+//____________________________________________________________________________..
+int CaloShowerLibraryReplay::End(PHCompositeNode *topNode)
+{
+  if (Verbosity() > 0)
+  {
+    Print();
+  }
+  QAInstrumentation::instance()->End();
+  return Fun4AllReturnCodes::EVENT_OK;
+}
+
+//____________________________________________________________________________..
+void CaloShowerLibraryReplay::Print(const std::string &what) const
+{
+  std::cout << "CaloShowerLibraryReplay " << m_Detector << ": " << m_NReplayed << " showers replayed from " << m_LibraryFile
+            << " (" << ((m_Mode == kG4Hit) ? "G4 hits" : "towers") << "), " << m_NMissing << " primaries without shower" << std::endl;
+  if (what == "ALL" && m_Library)
+  {
+    m_Library->Print(what);
+  }
+}
+
+//____________________________________________________________________________..
+void CaloShowerLibraryReplay::Detector(const std::string &name)
+{
+  m_Detector = name;
+  m_HitNodeName = "G4HIT_" + name;
+  m_AbsorberNodeName = "G4HIT_ABSORBER_" + name;
+  m_TowerNodeName = "TOWER_CALIB_" + name;
+  m_TowerGeoNodeName = "TOWERGEOM_" + name;
+}
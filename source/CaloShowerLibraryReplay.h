@@ -0,0 +1,126 @@
+// Tell emacs that this is a C++ source
+//  -*- C++ -*-.
+#ifndef CALOSHOWERLIBRARYREPLAY_H
+#define CALOSHOWERLIBRARYREPLAY_H
+
+#include <fun4all/SubsysReco.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+class CaloShowerLibrary;
+class CaloTowerLocator;
+class PHCompositeNode;
+class TRandom3;
+
+//! Replays recorded showers of a CaloShowerLibrary for the primaries of an event
+/*!
+ * The calorimeter is a black hole in the G4 setup. For every primary a random
+ * shower of its (pid, energy, eta, phi) bin is picked and its energies are
+ * scaled by the ratio of the generated energies:
+ *  - kG4Hit: the hits are added to G4HIT_<det> (and G4HIT_ABSORBER_<det>),
+ *    the module runs before the cell or tower reconstruction and everything
+ *    downstream (towers, clusters, QA, Eval) runs unchanged. The hit indices
+ *    (layer, tower indices, scintillator id) are copied, so the hits can only
+ *    be rotated around the beam axis onto the phi of the primary if the cells
+ *    of the detector come from the hit positions (RotatePhi(), CEMC); without
+ *    it the phi binning of the library has to be fine enough.
+ *  - kTower: the active hits are rotated onto the direction of the primary
+ *    (and by a random angle around it) and added to TOWER_CALIB_<det> with the
+ *    tower/edep ratio of the recorded shower, after the tower calibration.
+ * Primaries without showers in their bin are counted and skipped.
+ */
+class CaloShowerLibraryReplay : public SubsysReco
+{
+ public:
+  enum Mode
+  {
+    kG4Hit,
+    kTower
+  };
+
+  CaloShowerLibraryReplay(const std::string &name = "CaloShowerLibraryReplay");
+
+  virtual ~CaloShowerLibraryReplay();
+
+  /** Called during initialization.
+      Maps the library.
+   */
+  int Init(PHCompositeNode *topNode) override;
+
+  /** Called for first event when run number is known.
+      Gets the hit or tower nodes.
+   */
+  int InitRun(PHCompositeNode *topNode) override;
+
+  /** Called for each event.
+      This is where you do the real work.
+   */
+  int process_event(PHCompositeNode *topNode) override;
+
+  /// Called at the end of all processing.
+  int End(PHCompositeNode *topNode) override;
+
+  void Print(const std::string &what = "ALL") const override;
+
+  void Detector(const std::string &name);
+
+  void SetLibrary(const std::string &file) { m_LibraryFile = file; }
+
+  void SetMode(const Mode m) { m_Mode = m; }
+
+  //! kG4Hit: rotate the hits around the beam axis onto the phi of the primary
+  void RotatePhi(const bool b = true) { m_RotatePhi = b; }
+
+  void SetSeed(const unsigned int seed) { m_Seed = seed; }
+
+  //! remove the hits or towers of the black hole before the replay
+  void ResetNodes(const bool b = true) { m_ResetNodes = b; }
+
+ private:
+  //! a primary and the shower picked for it
+  struct Primary
+  {
+    int trkid = 0;
+    double e = 0;
+    double vx = 0;
+    double vy = 0;
+    double vz = 0;
+    double ux = 0;
+    double uy = 0;
+    double uz = 0;
+    int bin = -1;
+    unsigned long long shower = 0;
+  };
+
+  //! primaries with a shower in the library
+  int SelectShowers(PHCompositeNode *topNode, std::vector<Primary> &primaries);
+  int ReplayHits(PHCompositeNode *topNode, const std::vector<Primary> &primaries);
+  int ReplayTowers(PHCompositeNode *topNode, const std::vector<Primary> &primaries);
+
+  bool m_RotatePhi = false;
+  bool m_ResetNodes = true;
+
+  int m_Timer = -1;  // QAInstrumentation stage
+
+  unsigned int m_Seed = 4357;
+
+  Mode m_Mode = kG4Hit;
+
+  long long m_NReplayed = 0;
+  long long m_NMissing = 0;
+
+  std::string m_Detector;
+  std::string m_LibraryFile = "shower_library.bin";
+  std::string m_HitNodeName;
+  std::string m_AbsorberNodeName;
+  std::string m_TowerNodeName;
+  std::string m_TowerGeoNodeName;
+
+  std::unique_ptr<CaloShowerLibrary> m_Library;
+  std::unique_ptr<CaloTowerLocator> m_Locator;
+  std::unique_ptr<TRandom3> m_Random;
+};
+
+#endif  // CALOSHOWERLIBRARYREPLAY_H
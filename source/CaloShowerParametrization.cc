@@ -0,0 +1,55 @@
+#include "CaloShowerParametrization.h"
+
+#include <TDirectory.h>
+#include <TFile.h>
+
+#include <memory>
+
+//____________________________________________________________________________..
+CaloShowerParametrization::CaloShowerParametrization(const std::string &det, const int id)
+  : detector(det)
+  , pid(id)
+{
+}
+
+//____________________________________________________________________________..
+std::string CaloShowerParametrization::Key(const std::string &det, const int pid)
+{
+  return "ShowerParametrization_" + det + "_" + std::to_string(pid);
+}
+
+//____________________________________________________________________________..
+CaloShowerParametrization *CaloShowerParametrization::Load(const std::string &file, const std::string &det, const int pid)
+{
+  std::unique_ptr<TFile> f(TFile::Open(file.c_str(), "READ"));
+  if (!f || f->IsZombie())
+  {
+    std::cout << "CaloShowerParametrization::Load - cannot open " << file << std::endl;
+    return nullptr;
+  }
+  CaloShowerParametrization *par = nullptr;
+  f->GetObject(Key(det, pid).c_str(), par);
+  return par;
+}
+
+//____________________________________________________________________________..
+int CaloShowerParametrization::Save() const
+{
+  if (!gDirectory || !gDirectory->IsWritable())
+  {
+    std::cout << "CaloShowerParametrization::Save - current directory is not writable" << std::endl;
+    return -1;
+  }
+  return (gDirectory->WriteObject(this, Key(detector, pid).c_str(), "Overwrite") > 0) ? 0 : -1;
+}
+
+//____________________________________________________________________________..
+void CaloShowerParametrization::identify(std::ostream &os) const
+{
+  os << "CaloShowerParametrization " << detector << " pid " << pid
+     << ", " << nevents << " events, " << emin << " < E < " << emax << " GeV" << std::endl;
+  os << "  response:     " << resp0 << " + " << resp1 << " ln(E)" << std::endl;
+  os << "  resolution:   " << res_a << "/sqrt(E) + " << res_b << " + " << res_c << "/E" << std::endl;
+  os << "  longitudinal: alpha = " << long_alpha0 << " + " << long_alpha1 << " ln(E), beta = " << long_beta << " cm" << std::endl;
+  os << "  lateral:      core " << lat_fcore << " r = " << lat_rcore << " cm, tail r = " << lat_rtail << " cm" << std::endl;
+}
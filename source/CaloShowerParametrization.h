@@ -0,0 +1,115 @@
+// Tell emacs that this is a C++ source
+//  -*- C++ -*-.
+#ifndef CALOSHOWERPARAMETRIZATION_H
+#define CALOSHOWERPARAMETRIZATION_H
+
+#include <phool/PHObject.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+
+//! Shower parametrization of one particle type in one calorimeter
+/*!
+ * Fitted by CaloShowerFitter from the Eval trees of a full simulation,
+ * used by CaloFastShowerReco to deposit the energy without Geant4:
+ *  - response: visible/generated energy = r0 + r1 * ln(E)
+ *  - resolution: sigma/response = a/sqrt(E) (+) b (+) c/E
+ *  - longitudinal: gamma distribution of the depth t (cm) from the first hit,
+ *    dE/dt ~ t^(alpha-1) exp(-t/beta) with alpha = a0 + a1 * ln(E)
+ *  - lateral: dE/dr ~ f r/rc^2 exp(-r/rc) + (1-f) r/rt^2 exp(-r/rt) of the
+ *    distance r (cm) to the shower axis, a core and a tail component
+ * Energies in GeV. Written to and read from a ROOT file under Key(det, pid).
+ */
+class CaloShowerParametrization : public PHObject
+{
+ public:
+  // ctor with no args to make root happy
+  CaloShowerParametrization() {}
+  CaloShowerParametrization(const std::string &det, const int pid);
+  virtual ~CaloShowerParametrization() {}
+
+  void identify(std::ostream &os = std::cout) const override;
+
+  //! key of the parametrization in the file
+  static std::string Key(const std::string &det, const int pid);
+
+  //! read the parametrization of det and pid from file, nullptr if not there
+  static CaloShowerParametrization *Load(const std::string &file, const std::string &det, const int pid);
+
+  //! write to the current directory under Key(), returns 0 on success
+  int Save() const;
+
+  const std::string &get_detector() const { return detector; }
+  int get_pid() const { return pid; }
+
+  //! energy range of the fit
+  void set_energy_range(const double min, const double max)
+  {
+    emin = min;
+    emax = max;
+  }
+  double get_emin() const { return emin; }
+  double get_emax() const { return emax; }
+
+  void set_response(const double p0, const double p1)
+  {
+    resp0 = p0;
+    resp1 = p1;
+  }
+  double Response(const double e) const { return resp0 + resp1 * std::log(e); }
+
+  void set_resolution(const double a, const double b, const double c)
+  {
+    res_a = a;
+    res_b = b;
+    res_c = c;
+  }
+  double Resolution(const double e) const { return std::sqrt(res_a * res_a / e + res_b * res_b + res_c * res_c / (e * e)); }
+
+  void set_longitudinal(const double a0, const double a1, const double beta)
+  {
+    long_alpha0 = a0;
+    long_alpha1 = a1;
+    long_beta = beta;
+  }
+  double LongitudinalAlpha(const double e) const { return std::max(long_alpha0 + long_alpha1 * std::log(e), 1.); }
+  double LongitudinalBeta() const { return long_beta; }
+
+  void set_lateral(const double fcore, const double rcore, const double rtail)
+  {
+    lat_fcore = fcore;
+    lat_rcore = rcore;
+    lat_rtail = rtail;
+  }
+  double LateralCoreFraction() const { return lat_fcore; }
+  double LateralCoreRadius() const { return lat_rcore; }
+  double LateralTailRadius() const { return lat_rtail; }
+
+  //! number of events the parametrization was fitted from
+  void set_nevents(const long long n) { nevents = n; }
+  long long get_nevents() const { return nevents; }
+
+ private:
+  std::string detector;
+  int pid = 0;
+  long long nevents = 0;
+  double emin = NAN;
+  double emax = NAN;
+  double resp0 = NAN;
+  double resp1 = 0;
+  double res_a = NAN;
+  double res_b = 0;
+  double res_c = 0;
+  double long_alpha0 = NAN;
+  double long_alpha1 = 0;
+  double long_beta = NAN;
+  double lat_fcore = 1;
+  double lat_rcore = NAN;
+  double lat_rtail = NAN;
+
+  ClassDefOverride(CaloShowerParametrization, 1)
+};
+
+#endif  // CALOSHOWERPARAMETRIZATION_H
@@ -0,0 +1,131 @@
+#include "CaloTowerLocator.h"
+
+#include <calobase/RawTowerGeom.h>
+#include <calobase/RawTowerGeomContainer.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+
+namespace
+{
+  //! phi difference in [-pi, pi]
+  double DeltaPhi(const double a, const double b)
+  {
+    return std::remainder(a - b, 2 * M_PI);
+  }
+}  // namespace
+
+//____________________________________________________________________________..
+int CaloTowerLocator::Build(RawTowerGeomContainer *geom)
+{
+  m_Towers.clear();
+  m_Grid.clear();
+  double etamin = std::numeric_limits<double>::max();
+  double etamax = std::numeric_limits<double>::lowest();
+  RawTowerGeomContainer::ConstRange range = geom->get_tower_geometries();
+  for (RawTowerGeomContainer::ConstIterator iter = range.first; iter != range.second; ++iter)
+  {
+    const RawTowerGeom *tgeo = iter->second;
+    TowerCenter center;
+    center.key = iter->first;
+    center.eta = tgeo->get_eta();
+    center.phi = tgeo->get_phi();
+    center.x = tgeo->get_center_x();
+    center.y = tgeo->get_center_y();
+    center.z = tgeo->get_center_z();
+    etamin = std::min(etamin, center.eta);
+    etamax = std::max(etamax, center.eta);
+    m_Towers.push_back(center);
+  }
+  if (m_Towers.empty())
+  {
+    return -1;
+  }
+  const int etabins = std::max(geom->get_etabins(), 1);
+  m_PhiBins = std::max(geom->get_phibins(), 1);
+  m_PhiWidth = 2 * M_PI / m_PhiBins;
+  m_EtaWidth = (etamax > etamin) ? (etamax - etamin) / etabins : 1.;
+  m_EtaMin = etamin - 0.5 * m_EtaWidth;
+  m_EtaBins = etabins + 1;
+  for (size_t i = 0; i < m_Towers.size(); i++)
+  {
+    const int ieta = std::floor((m_Towers[i].eta - m_EtaMin) / m_EtaWidth);
+    const int iphi = std::floor((m_Towers[i].phi + M_PI) / m_PhiWidth);
+    m_Grid[Cell(ieta, iphi)].push_back(i);
+  }
+  return 0;
+}
+
+//____________________________________________________________________________..
+int CaloTowerLocator::Cell(const int ieta, const int iphi) const
+{
+  if (ieta < 0 || ieta >= m_EtaBins)
+  {
+    return -1;
+  }
+  const int wrapped = ((iphi % m_PhiBins) + m_PhiBins) % m_PhiBins;
+  return ieta * m_PhiBins + wrapped;
+}
+
+//____________________________________________________________________________..
+int CaloTowerLocator::Find(const double eta, const double phi) const
+{
+  if (m_Towers.empty() || !std::isfinite(eta))
+  {
+    return -1;
+  }
+  const int ieta = std::floor((eta - m_EtaMin) / m_EtaWidth);
+  const int iphi = std::floor((phi + M_PI) / m_PhiWidth);
+  int best = -1;
+  double bestdist = std::numeric_limits<double>::max();
+  auto scan = [&](const int ring) {
+    for (int deta = -ring; deta <= ring; deta++)
+    {
+      for (int dphi = -ring; dphi <= ring; dphi++)
+      {
+        if (std::max(std::abs(deta), std::abs(dphi)) != ring)
+        {
+          continue;
+        }
+        auto cell = m_Grid.find(Cell(ieta + deta, iphi + dphi));
+        if (cell == m_Grid.end())
+        {
+          continue;
+        }
+        for (const int i : cell->second)
+        {
+          const double de = (m_Towers[i].eta - eta) / m_EtaWidth;
+          const double dp = DeltaPhi(m_Towers[i].phi, phi) / m_PhiWidth;
+          const double dist = de * de + dp * dp;
+          if (dist < bestdist)
+          {
+            bestdist = dist;
+            best = i;
+          }
+        }
+      }
+    }
+  };
+  // the closest tower is in the cell of eta/phi or a neighbour, the second
+  // ring only covers cells left empty by uneven tower sizes
+  scan(0);
+  scan(1);
+  if (best < 0)
+  {
+    scan(2);
+  }
+  // more than a tower size away from the closest tower: outside the calorimeter
+  if (bestdist > 2.)
+  {
+    return -1;
+  }
+  return best;
+}
+
+//____________________________________________________________________________..
+int CaloTowerLocator::Find(const double x, const double y, const double z) const
+{
+  return Find(std::asinh(z / std::hypot(x, y)), std::atan2(y, x));
+}
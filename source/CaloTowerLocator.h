@@ -0,0 +1,66 @@
+// Tell emacs that this is a C++ source
+//  -*- C++ -*-.
+#ifndef CALOTOWERLOCATOR_H
+#define CALOTOWERLOCATOR_H
+
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+class RawTowerGeomContainer;
+
+//! Finds the tower closest to a direction (eta, phi seen from the origin)
+/*!
+ * The tower centers are put on an eta/phi grid with one cell per tower bin
+ * of the geometry, a lookup only checks the cell of the direction and its
+ * neighbours. For the planar calorimeters (x/y tower bins) the grid is only
+ * approximate, the search covers a second ring of cells for them.
+ * Used to deposit energy into the towers without G4 hits (CaloFastShowerReco,
+ * CaloShowerLibraryReplay).
+ */
+class CaloTowerLocator
+{
+ public:
+  struct TowerCenter
+  {
+    unsigned int key = 0;
+    double eta = 0;
+    double phi = 0;
+    double x = 0;
+    double y = 0;
+    double z = 0;
+  };
+
+  CaloTowerLocator() {}
+
+  virtual ~CaloTowerLocator() {}
+
+  //! returns 0 on success, -1 if there are no towers
+  int Build(RawTowerGeomContainer *geom);
+
+  //! index of the tower closest to eta/phi, -1 outside the calorimeter
+  int Find(const double eta, const double phi) const;
+
+  //! index of the tower closest to the direction of the point x/y/z
+  int Find(const double x, const double y, const double z) const;
+
+  const TowerCenter &Tower(const int i) const { return m_Towers[i]; }
+
+  size_t NTowers() const { return m_Towers.size(); }
+
+  int EtaBins() const { return m_EtaBins; }
+  int PhiBins() const { return m_PhiBins; }
+
+ private:
+  int Cell(const int ieta, const int iphi) const;
+
+  std::vector<TowerCenter> m_Towers;
+  std::unordered_map<int, std::vector<int>> m_Grid;
+  int m_EtaBins = 0;
+  int m_PhiBins = 0;
+  double m_EtaMin = 0;
+  double m_EtaWidth = 0;
+  double m_PhiWidth = 0;
+};
+
+#endif  // CALOTOWERLOCATOR_H
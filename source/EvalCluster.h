@@ -39,8 +39,14 @@ class EvalCluster : public PHObject
   void set_cz(const float f) { cz = f; }
   float get_cz() const { return cz; }
 
+  // first member of the cluster in the member arrays of the EvalRootTTree,
+  // the cluster has ctowers members, -1 in trees written before they were stored
+  void set_cfirst(const int i) { cfirst = i; }
+  int get_cfirst() const { return cfirst; }
+
  private:
   int ctowers = 0;
+  int cfirst = -1;
   float ce = NAN;
   float ceta = NAN;
   float cphi = NAN;
@@ -49,7 +55,7 @@ class EvalCluster : public PHObject
   float cy = NAN;
   float cz = NAN;
 
-  ClassDef(EvalCluster, 1)
+  ClassDef(EvalCluster, 2)
 };
 
 #endif
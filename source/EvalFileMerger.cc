@@ -0,0 +1,365 @@
+#include "EvalFileMerger.h"
+
+#include <TFileMerger.h>
+#include <TSystem.h>
+
+#include <algorithm>
+#include <cstdio>   // for std::rename
+#include <ctime>
+#include <fstream>
+#include <iostream>  // for operator<<, endl, basic_ost...
+#include <sstream>
+
+//____________________________________________________________________________..
+EvalFileMerger::EvalFileMerger(const std::string &topdir, const std::string &manifest)
+  : m_TopDir(topdir)
+  , m_Manifest(manifest)
+  , m_Validator(topdir)
+{
+}
+
+//____________________________________________________________________________..
+void EvalFileMerger::Detector(const std::string &name)
+{
+  MergeStream stream;
+  stream.detector = name;
+  stream.jobfile = "Eval_" + name + ".root";
+  stream.mergedfile = m_TopDir + "/merged_Eval_" + name + ".root";
+  m_Streams.push_back(stream);
+  m_Validator.Detector(name);
+}
+
+//____________________________________________________________________________..
+void EvalFileMerger::AddHistoFile(const std::string &jobfile)
+{
+  MergeStream stream;
+  stream.jobfile = jobfile;
+  stream.mergedfile = m_TopDir + "/merged_" + jobfile;
+  m_Streams.push_back(stream);
+  m_Validator.AddQAFile(jobfile);
+}
+
+//____________________________________________________________________________..
+int EvalFileMerger::Scan()
+{
+  if (m_Streams.empty())
+  {
+    std::cout << "EvalFileMerger::Scan - nothing to merge, use Detector(<name>) or AddHistoFile()" << std::endl;
+    return 0;
+  }
+  if (!m_ManifestRead)
+  {
+    ReadManifest();
+    m_ManifestRead = true;
+  }
+
+  std::vector<EvalFileValidator::FileStatus> status;
+  if (m_ValidationManifest.empty())
+  {
+    status = m_Validator.Validate(FinishedJobs());
+  }
+  else
+  {
+    status = ReadValidationManifest();
+  }
+  if (status.empty())
+  {
+    return 0;
+  }
+
+  // a job is only merged if all of its outputs are fine, otherwise the
+  // per detector trees would not contain the same events anymore
+  std::map<int, std::string> jobdirs;
+  std::set<int> badjobs;
+  std::map<int, std::vector<std::string>> entries;
+  for (const auto &st : status)
+  {
+    jobdirs[st.job] = st.path.substr(0, st.path.rfind('/'));
+    if (!st.good)
+    {
+      badjobs.insert(st.job);
+    }
+    std::ostringstream line;
+    line << st.job << " " << (st.good ? "good" : "bad") << " " << st.file << " "
+         << st.entries << " " << st.path << " " << st.reason;
+    entries[st.job].push_back(line.str());
+  }
+  std::vector<std::pair<int, std::string>> goodjobs;
+  for (const auto &job : jobdirs)
+  {
+    if (!badjobs.count(job.first))
+    {
+      goodjobs.push_back(job);
+    }
+  }
+
+  // fold the new jobs into copies of the running merged files, one merge per
+  // stream, and move the copies in place only once every stream merged, so a
+  // failing stream leaves all merged files and the manifest as they were
+  std::vector<std::string> mergedfiles;
+  bool merged = true;
+  for (const auto &stream : m_Streams)
+  {
+    std::vector<std::string> inputs;
+    for (const auto &job : goodjobs)
+    {
+      inputs.push_back(job.second + "/" + stream.jobfile);
+    }
+    if (inputs.empty())
+    {
+      continue;
+    }
+    mergedfiles.push_back(stream.mergedfile);
+    if (!MergeInto(stream, inputs, stream.mergedfile + ".tmp"))
+    {
+      std::cout << "EvalFileMerger::Scan - merging into " << stream.mergedfile
+                << " failed, merged files and manifest not updated" << std::endl;
+      merged = false;
+      break;
+    }
+  }
+  for (const auto &mergedfile : mergedfiles)
+  {
+    std::string tmpname = mergedfile + ".tmp";
+    if (!merged)
+    {
+      gSystem->Unlink(tmpname.c_str());
+    }
+    else if (std::rename(tmpname.c_str(), mergedfile.c_str()) != 0)
+    {
+      std::cout << "EvalFileMerger::Scan - cannot move " << tmpname << " to " << mergedfile << std::endl;
+      merged = false;
+    }
+  }
+  if (!merged)
+  {
+    return -1;
+  }
+  // the jobs only count as handled once the merged files are in place, after
+  // a failed merge the next Scan() tries them again
+  for (const auto &job : goodjobs)
+  {
+    m_GoodJobs.insert(job.first);
+  }
+  for (const int job : badjobs)
+  {
+    std::cout << "EvalFileMerger::Scan - rejecting job " << jobdirs[job] << std::endl;
+    m_BadJobs.insert(job);
+  }
+  for (const auto &entry : entries)
+  {
+    m_ManifestEntries[entry.first] = entry.second;
+  }
+  WriteManifest();
+  if (m_Verbosity > 0)
+  {
+    std::cout << "EvalFileMerger::Scan - merged " << goodjobs.size() << " new jobs, "
+              << m_GoodJobs.size() << " good and " << m_BadJobs.size() << " bad jobs so far" << std::endl;
+  }
+  return goodjobs.size();
+}
+
+//____________________________________________________________________________..
+int EvalFileMerger::Watch(const int poll_seconds, const int max_wait_seconds)
+{
+  time_t lastnew = time(nullptr);
+  while (true)
+  {
+    int nnew = Scan();
+    if (nnew < 0)
+    {
+      return -1;
+    }
+    if (nnew > 0)
+    {
+      lastnew = time(nullptr);
+    }
+    if (m_ExpectedJobs > 0 && GoodJobs() + BadJobs() >= m_ExpectedJobs)
+    {
+      break;
+    }
+    if (max_wait_seconds > 0 && time(nullptr) - lastnew > max_wait_seconds)
+    {
+      std::cout << "EvalFileMerger::Watch - no new job finished in the last "
+                << max_wait_seconds << " seconds, giving up" << std::endl;
+      break;
+    }
+    gSystem->Sleep(poll_seconds * 1000);
+  }
+  Print();
+  return GoodJobs();
+}
+
+//____________________________________________________________________________..
+void EvalFileMerger::Print(const std::string & /*what*/) const
+{
+  std::cout << "EvalFileMerger: " << m_GoodJobs.size() << " jobs merged, "
+            << m_BadJobs.size() << " jobs rejected, manifest " << m_Manifest << std::endl;
+  for (const auto &stream : m_Streams)
+  {
+    std::cout << "  " << stream.jobfile << " -> " << stream.mergedfile << std::endl;
+  }
+}
+
+//____________________________________________________________________________..
+std::vector<std::pair<int, std::string>> EvalFileMerger::FinishedJobs() const
+{
+  std::vector<std::pair<int, std::string>> jobs;
+  void *dir = gSystem->OpenDirectory(m_TopDir.c_str());
+  if (!dir)
+  {
+    std::cout << "EvalFileMerger::FinishedJobs - cannot open " << m_TopDir << std::endl;
+    return jobs;
+  }
+  const char *entry = nullptr;
+  while ((entry = gSystem->GetDirEntry(dir)))
+  {
+    int job = EvalFileValidator::JobNumber(entry);
+    if (job < 0 || m_GoodJobs.count(job) || m_BadJobs.count(job))
+    {
+      continue;
+    }
+    std::string jobdir = m_TopDir + "/" + entry;
+    if (IsFinished(jobdir))
+    {
+      jobs.push_back(std::make_pair(job, jobdir));
+    }
+  }
+  gSystem->FreeDirectory(dir);
+  // merge in job order, so repeated runs give the same merged files
+  std::sort(jobs.begin(), jobs.end());
+  return jobs;
+}
+
+//____________________________________________________________________________..
+bool EvalFileMerger::IsFinished(const std::string &jobdir) const
+{
+  if (m_MergeUnfinished)
+  {
+    // the validator decides
+    return true;
+  }
+  return EvalFileValidator::JobDone(jobdir, m_JobLog, m_JobDoneMarker);
+}
+
+//____________________________________________________________________________..
+std::vector<EvalFileValidator::FileStatus> EvalFileMerger::ReadValidationManifest() const
+{
+  std::vector<EvalFileValidator::FileStatus> status;
+  std::ifstream manifest(m_ValidationManifest);
+  std::string line;
+  while (std::getline(manifest, line))
+  {
+    if (line.empty() || line[0] == '#')
+    {
+      continue;
+    }
+    std::istringstream is(line);
+    EvalFileValidator::FileStatus st;
+    std::string good;
+    if (!(is >> st.job >> good >> st.file >> st.entries >> st.path >> st.reason))
+    {
+      continue;
+    }
+    if (m_GoodJobs.count(st.job) || m_BadJobs.count(st.job))
+    {
+      continue;
+    }
+    st.good = (good == "good");
+    status.push_back(st);
+  }
+  // running jobs (no done marker) are decided by a later validation, a missing
+  // file of a finished job rejects it
+  std::set<int> pending;
+  for (const auto &st : status)
+  {
+    if (st.reason == "running")
+    {
+      pending.insert(st.job);
+    }
+  }
+  status.erase(std::remove_if(status.begin(), status.end(),
+                              [&pending](const EvalFileValidator::FileStatus &st) { return pending.count(st.job) > 0; }),
+               status.end());
+  return status;
+}
+
+//____________________________________________________________________________..
+bool EvalFileMerger::MergeInto(const MergeStream &stream, const std::vector<std::string> &inputs, const std::string &output) const
+{
+  TFileMerger merger(kFALSE, kFALSE);
+  merger.SetMsgPrefix("EvalFileMerger");
+  merger.SetPrintLevel(m_Verbosity);
+  // UPDATE appends to (a copy of) the merged result of the previous passes (like hadd -a)
+  bool exists = !gSystem->AccessPathName(stream.mergedfile.c_str());
+  if (exists && gSystem->CopyFile(stream.mergedfile.c_str(), output.c_str(), kTRUE) != 0)
+  {
+    return false;
+  }
+  if (!merger.OutputFile(output.c_str(), exists ? "UPDATE" : "RECREATE"))
+  {
+    return false;
+  }
+  for (const auto &input : inputs)
+  {
+    if (!merger.AddFile(input.c_str()))
+    {
+      return false;
+    }
+  }
+  return merger.PartialMerge(TFileMerger::kAll | TFileMerger::kIncremental);
+}
+
+//____________________________________________________________________________..
+void EvalFileMerger::ReadManifest()
+{
+  std::ifstream manifest(m_Manifest);
+  std::string line;
+  while (std::getline(manifest, line))
+  {
+    if (line.empty() || line[0] == '#')
+    {
+      continue;
+    }
+    std::istringstream is(line);
+    int job;
+    std::string status;
+    if (!(is >> job >> status))
+    {
+      continue;
+    }
+    m_ManifestEntries[job].push_back(line);
+    if (status == "bad")
+    {
+      m_BadJobs.insert(job);
+      m_GoodJobs.erase(job);
+    }
+    else if (!m_BadJobs.count(job))
+    {
+      m_GoodJobs.insert(job);
+    }
+  }
+  if (m_Verbosity > 0 && !m_ManifestEntries.empty())
+  {
+    std::cout << "EvalFileMerger::ReadManifest - resuming with " << m_GoodJobs.size()
+              << " merged and " << m_BadJobs.size() << " rejected jobs" << std::endl;
+  }
+}
+
+//____________________________________________________________________________..
+void EvalFileMerger::WriteManifest() const
+{
+  // write a new manifest and move it in place, so it always matches the merged files
+  std::string tmpname = m_Manifest + ".tmp";
+  std::ofstream manifest(tmpname);
+  manifest << "# job status file entries path reason" << std::endl;
+  for (const auto &job : m_ManifestEntries)
+  {
+    for (const auto &line : job.second)
+    {
+      manifest << line << std::endl;
+    }
+  }
+  manifest.close();
+  std::rename(tmpname.c_str(), m_Manifest.c_str());
+}
@@ -0,0 +1,118 @@
+// Tell emacs that this is a C++ source
+//  -*- C++ -*-.
+#ifndef EVALFILEMERGER_H
+#define EVALFILEMERGER_H
+
+#include "EvalFileValidator.h"
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+//! Incremental merger for the per job Eval_<det>.root (and QA) outputs.
+/*!
+ * Instead of waiting for all condor jobs and running hadd.C once at the end,
+ * the merger scans the macros<N> job directories, picks up every job which
+ * finished since the last scan, checks its output files with the
+ * EvalFileValidator and folds them into the running merged_Eval_<det>.root
+ * result. Alternatively the good/bad decision is taken from a manifest
+ * written by a separate EvalFileValidator run. Every input which was folded in
+ * (or rejected) is recorded in a manifest, so the merger can be stopped and
+ * restarted at any time without merging a job twice.
+ */
+class EvalFileMerger
+{
+ public:
+  EvalFileMerger(const std::string &topdir = ".", const std::string &manifest = "merged_Eval.manifest");
+
+  virtual ~EvalFileMerger() {}
+
+  //! merge Eval_<name>.root from every job into merged_Eval_<name>.root
+  void Detector(const std::string &name);
+
+  //! merge a histogram file (e.g. the QA output) from every job into merged_<jobfile>
+  void AddHistoFile(const std::string &jobfile = "G4EICDetector_qa.root");
+
+  //! string in the job log which marks a finished job
+  void SetJobDoneMarker(const std::string &logfile, const std::string &marker)
+  {
+    m_JobLog = logfile;
+    m_JobDoneMarker = marker;
+  }
+
+  //! also merge jobs without the done marker if their files are readable, e.g.
+  //! the last checkpoint (QACheckpoint) of killed jobs; only for a final Scan()
+  //! after all jobs ended, a running job would be merged with a part of its events
+  void MergeUnfinishedJobs(const bool b = true) { m_MergeUnfinished = b; }
+
+  //! take the good/bad job list from this EvalFileValidator manifest instead of
+  //! checking condor.out and the files here, it is reread on every Scan()
+  void UseValidationManifest(const std::string &manifest) { m_ValidationManifest = manifest; }
+
+  //! number of threads used to check the files of the new jobs, 0 = number of cores
+  void SetNThreads(const unsigned int n) { m_Validator.SetNThreads(n); }
+
+  //! number of jobs in the scan, Watch() returns once all of them are handled
+  void SetExpectedJobs(const int n) { m_ExpectedJobs = n; }
+
+  //! scan the job directories once and merge every newly finished job
+  //! returns the number of jobs merged in this pass
+  int Scan();
+
+  //! call Scan() every poll_seconds until all expected jobs are handled
+  //! or max_wait_seconds passed without a new job showing up (0 = wait forever)
+  int Watch(const int poll_seconds = 60, const int max_wait_seconds = 0);
+
+  //! number of jobs merged (good) and rejected (bad) so far
+  int GoodJobs() const { return m_GoodJobs.size(); }
+  int BadJobs() const { return m_BadJobs.size(); }
+
+  void Verbosity(const int i)
+  {
+    m_Verbosity = i;
+    m_Validator.Verbosity(i);
+  }
+
+  void Print(const std::string &what = "ALL") const;
+
+ private:
+  struct MergeStream
+  {
+    std::string detector;  // empty for plain histogram files
+    std::string jobfile;
+    std::string mergedfile;
+  };
+
+  std::vector<std::pair<int, std::string>> FinishedJobs() const;
+  std::vector<EvalFileValidator::FileStatus> ReadValidationManifest() const;
+  bool IsFinished(const std::string &jobdir) const;
+  //! merges the merged file of the stream and the inputs into output
+  bool MergeInto(const MergeStream &stream, const std::vector<std::string> &inputs, const std::string &output) const;
+
+  void ReadManifest();
+  void WriteManifest() const;
+
+  bool m_ManifestRead = false;
+  bool m_MergeUnfinished = false;
+
+  int m_Verbosity = 0;
+  int m_ExpectedJobs = 0;
+
+  std::string m_TopDir;
+  std::string m_Manifest;
+  std::string m_JobLog = "condor.out";
+  std::string m_JobDoneMarker = "condorjob done";
+  std::string m_ValidationManifest;
+
+  EvalFileValidator m_Validator;
+
+  std::vector<MergeStream> m_Streams;
+
+  std::set<int> m_GoodJobs;
+  std::set<int> m_BadJobs;
+  // job number -> manifest lines of this job
+  std::map<int, std::vector<std::string>> m_ManifestEntries;
+};
+
+#endif  // EVALFILEMERGER_H
@@ -0,0 +1,332 @@
+#include "EvalFileValidator.h"
+
+#include <ROOT/TSeq.hxx>
+#include <ROOT/TThreadExecutor.hxx>
+
+#include <TFile.h>
+#include <TH1.h>
+#include <TKey.h>
+#include <TList.h>
+#include <TROOT.h>
+#include <TSystem.h>
+#include <TTree.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>  // for std::rename
+#include <fstream>
+#include <iostream>  // for operator<<, endl, basic_ost...
+#include <map>
+#include <memory>
+
+//____________________________________________________________________________..
+EvalFileValidator::EvalFileValidator(const std::string &topdir)
+  : m_TopDir(topdir)
+{
+}
+
+//____________________________________________________________________________..
+void EvalFileValidator::Detector(const std::string &name)
+{
+  Expectation exp;
+  exp.detector = name;
+  exp.jobfile = "Eval_" + name + ".root";
+  m_Expected.push_back(exp);
+}
+
+//____________________________________________________________________________..
+void EvalFileValidator::AddQAFile(const std::string &jobfile)
+{
+  Expectation exp;
+  exp.jobfile = jobfile;
+  m_Expected.push_back(exp);
+}
+
+//____________________________________________________________________________..
+std::vector<EvalFileValidator::FileStatus> EvalFileValidator::Validate(const std::vector<std::pair<int, std::string>> &jobdirs) const
+{
+  const size_t nexp = m_Expected.size();
+  const size_t ntasks = jobdirs.size() * nexp;
+  auto check = [&](const size_t itask) {
+    const auto &job = jobdirs[itask / nexp];
+    const Expectation &exp = m_Expected[itask % nexp];
+    std::string fname = job.second + "/" + exp.jobfile;
+    FileStatus status = exp.detector.empty() ? CheckQAFile(fname) : CheckEvalFile(fname, exp.detector);
+    status.job = job.first;
+    status.file = exp.jobfile;
+    status.path = fname;
+    return status;
+  };
+
+  std::vector<FileStatus> result;
+  if (ntasks == 0)
+  {
+    return result;
+  }
+  // every task opens its own TFile, nothing is shared between the threads
+  ROOT::EnableThreadSafety();
+  ROOT::TThreadExecutor pool(m_NThreads);
+  result = pool.Map(check, ROOT::TSeqUL(ntasks));
+
+  // the Eval trees of one job are read side by side in the analysis macros,
+  // a job where one detector lost events would misalign all of them
+  for (size_t ijob = 0; ijob < jobdirs.size(); ++ijob)
+  {
+    long long entries = -1;
+    bool mismatch = false;
+    for (size_t iexp = 0; iexp < nexp; ++iexp)
+    {
+      const FileStatus &status = result[ijob * nexp + iexp];
+      if (m_Expected[iexp].detector.empty() || !status.good)
+      {
+        continue;
+      }
+      if (entries >= 0 && status.entries != entries)
+      {
+        mismatch = true;
+      }
+      entries = status.entries;
+    }
+    if (!mismatch)
+    {
+      continue;
+    }
+    for (size_t iexp = 0; iexp < nexp; ++iexp)
+    {
+      FileStatus &status = result[ijob * nexp + iexp];
+      if (!m_Expected[iexp].detector.empty() && status.good)
+      {
+        status.good = false;
+        status.reason = "entry_mismatch";
+      }
+    }
+  }
+  if (m_Verbosity > 0)
+  {
+    for (const auto &status : result)
+    {
+      if (!status.good)
+      {
+        std::cout << "EvalFileValidator: bad " << status.path << " (" << status.reason << ")" << std::endl;
+      }
+    }
+  }
+  return result;
+}
+
+//____________________________________________________________________________..
+int EvalFileValidator::ValidateJobs(const std::string &manifest)
+{
+  std::vector<std::pair<int, std::string>> jobdirs;
+  std::vector<std::pair<int, std::string>> running;
+  void *dir = gSystem->OpenDirectory(m_TopDir.c_str());
+  if (!dir)
+  {
+    std::cout << "EvalFileValidator::ValidateJobs - cannot open " << m_TopDir << std::endl;
+    return -1;
+  }
+  const char *entry = nullptr;
+  while ((entry = gSystem->GetDirEntry(dir)))
+  {
+    int job = JobNumber(entry);
+    if (job < 0)
+    {
+      continue;
+    }
+    std::string jobdir = m_TopDir + "/" + entry;
+    // the files of a job which is still writing would be flagged bad for good
+    if (m_ValidateUnfinished || JobDone(jobdir, m_JobLog, m_JobDoneMarker))
+    {
+      jobdirs.push_back(std::make_pair(job, jobdir));
+    }
+    else
+    {
+      running.push_back(std::make_pair(job, jobdir));
+    }
+  }
+  gSystem->FreeDirectory(dir);
+  std::sort(jobdirs.begin(), jobdirs.end());
+  std::sort(running.begin(), running.end());
+
+  std::vector<FileStatus> status = Validate(jobdirs);
+  std::vector<FileStatus> manifeststatus = status;
+  for (const auto &job : running)
+  {
+    for (const auto &exp : m_Expected)
+    {
+      FileStatus st;
+      st.job = job.first;
+      st.file = exp.jobfile;
+      st.path = job.second + "/" + exp.jobfile;
+      st.reason = "running";
+      manifeststatus.push_back(st);
+    }
+  }
+  WriteManifest(manifest, manifeststatus);
+
+  std::map<int, bool> jobgood;
+  for (const auto &st : status)
+  {
+    auto iter = jobgood.find(st.job);
+    jobgood[st.job] = (iter == jobgood.end() ? true : iter->second) && st.good;
+  }
+  int ngood = 0;
+  for (const auto &job : jobgood)
+  {
+    ngood += job.second;
+  }
+  std::cout << "EvalFileValidator: " << ngood << " good, " << jobgood.size() - ngood
+            << " bad and " << running.size() << " running jobs, written to " << manifest << std::endl;
+  return ngood;
+}
+
+//____________________________________________________________________________..
+bool EvalFileValidator::JobDone(const std::string &jobdir, const std::string &logfile, const std::string &marker)
+{
+  std::ifstream log(jobdir + "/" + logfile);
+  std::string line;
+  while (std::getline(log, line))
+  {
+    if (line.find(marker) != std::string::npos)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+//____________________________________________________________________________..
+EvalFileValidator::FileStatus EvalFileValidator::CheckEvalFile(const std::string &fname, const std::string &detector) const
+{
+  FileStatus status;
+  if (gSystem->AccessPathName(fname.c_str()))
+  {
+    status.reason = "missing";
+    return status;
+  }
+  std::unique_ptr<TFile> f(TFile::Open(fname.c_str(), "READ"));
+  if (!f || f->IsZombie())
+  {
+    status.reason = "unreadable";
+    return status;
+  }
+  // a job killed while writing leaves a file without keys list, ROOT recovers it on open
+  if (f->TestBit(TFile::kRecovered))
+  {
+    status.reason = "recovered";
+    return status;
+  }
+  // only the tree header is read here, no baskets
+  TTree *t = nullptr;
+  f->GetObject("T", t);
+  if (!t)
+  {
+    status.reason = "no_tree";
+    return status;
+  }
+  std::string branch = "DST#EvalTTree_" + detector;
+  if (!t->GetBranch(branch.c_str()))
+  {
+    status.reason = "no_branch";
+    return status;
+  }
+  status.entries = t->GetEntries();
+  if (status.entries < m_MinEntries)
+  {
+    status.reason = "too_few_entries";
+    return status;
+  }
+  status.good = true;
+  status.reason = "ok";
+  return status;
+}
+
+//____________________________________________________________________________..
+EvalFileValidator::FileStatus EvalFileValidator::CheckQAFile(const std::string &fname) const
+{
+  FileStatus status;
+  if (gSystem->AccessPathName(fname.c_str()))
+  {
+    status.reason = "missing";
+    return status;
+  }
+  std::unique_ptr<TFile> f(TFile::Open(fname.c_str(), "READ"));
+  if (!f || f->IsZombie())
+  {
+    status.reason = "unreadable";
+    return status;
+  }
+  if (f->TestBit(TFile::kRecovered))
+  {
+    status.reason = "recovered";
+    return status;
+  }
+  // walk the key list, only the small normalization histograms are read
+  status.entries = 0;
+  int nqa = 0;
+  TIter next(f->GetListOfKeys());
+  while (TKey *key = static_cast<TKey *>(next()))
+  {
+    std::string name = key->GetName();
+    if (name.compare(0, 10, "h_QAG4Sim_") != 0)
+    {
+      continue;
+    }
+    ++nqa;
+    static const std::string norm = "Normalization";
+    if (name.size() < norm.size() || name.compare(name.size() - norm.size(), norm.size(), norm) != 0)
+    {
+      continue;
+    }
+    std::unique_ptr<TH1> h(dynamic_cast<TH1 *>(key->ReadObj()));
+    // first bin counts the processed events
+    if (!h || h->GetBinContent(1) <= 0)
+    {
+      status.reason = "empty_histos";
+      return status;
+    }
+    status.entries = std::max(status.entries, (long long) h->GetBinContent(1));
+  }
+  if (nqa == 0)
+  {
+    status.reason = "no_qa_histos";
+    return status;
+  }
+  status.good = true;
+  status.reason = "ok";
+  return status;
+}
+
+//____________________________________________________________________________..
+void EvalFileValidator::WriteManifest(const std::string &manifest, const std::vector<FileStatus> &status)
+{
+  std::string tmpname = manifest + ".tmp";
+  std::ofstream out(tmpname);
+  out << "# job status file entries path reason" << std::endl;
+  for (const auto &st : status)
+  {
+    out << st.job << " " << (st.good ? "good" : "bad") << " " << st.file << " "
+        << st.entries << " " << st.path << " " << st.reason << std::endl;
+  }
+  out.close();
+  std::rename(tmpname.c_str(), manifest.c_str());
+}
+
+//____________________________________________________________________________..
+int EvalFileValidator::JobNumber(const std::string &dirname)
+{
+  static const std::string prefix = "macros";
+  if (dirname.compare(0, prefix.size(), prefix) != 0)
+  {
+    return -1;
+  }
+  std::string number = dirname.substr(prefix.size());
+  for (char c : number)
+  {
+    if (!isdigit(c))
+    {
+      return -1;
+    }
+  }
+  return number.empty() ? 0 : std::stoi(number);
+}
@@ -0,0 +1,100 @@
+// Tell emacs that this is a C++ source
+//  -*- C++ -*-.
+#ifndef EVALFILEVALIDATOR_H
+#define EVALFILEVALIDATOR_H
+
+#include <string>
+#include <utility>
+#include <vector>
+
+//! Checks the outputs of the condor jobs at the ROOT level
+/*!
+ * Instead of grepping condor.out, every Eval_<det>.root file is opened and
+ * its key list, the T tree header (entries, DST#EvalTTree_<det> branch) and
+ * for QA files the small _Normalization histograms are inspected. No tree
+ * baskets or large histograms are read. Files are checked in parallel and the
+ * result is written as a manifest which EvalFileMerger can use directly.
+ */
+class EvalFileValidator
+{
+ public:
+  struct FileStatus
+  {
+    int job = -1;
+    bool good = false;
+    long long entries = -1;
+    std::string file;
+    std::string path;
+    std::string reason;
+  };
+
+  EvalFileValidator(const std::string &topdir = ".");
+
+  virtual ~EvalFileValidator() {}
+
+  //! expect Eval_<name>.root with tree T and branch DST#EvalTTree_<name> in every job
+  void Detector(const std::string &name);
+
+  //! expect a QA histogram file in every job with filled h_QAG4Sim_*_Normalization histograms
+  void AddQAFile(const std::string &jobfile = "G4EICDetector_qa.root");
+
+  //! minimum number of tree entries for an Eval file to be good (e.g. nEvents of the job)
+  void SetMinEntries(const long long n) { m_MinEntries = n; }
+
+  //! string in the job log which marks a finished job, ValidateJobs() only
+  //! checks the files of finished jobs and lists the others as "running"
+  void SetJobDoneMarker(const std::string &logfile, const std::string &marker)
+  {
+    m_JobLog = logfile;
+    m_JobDoneMarker = marker;
+  }
+
+  //! also check jobs without the done marker, e.g. the last checkpoint
+  //! (QACheckpoint) of killed jobs; only once all jobs ended
+  void ValidateUnfinishedJobs(const bool b = true) { m_ValidateUnfinished = b; }
+
+  //! number of threads used to check the files, 0 = number of cores
+  void SetNThreads(const unsigned int n) { m_NThreads = n; }
+
+  //! check the given job directories, results are grouped by job in the order of jobdirs
+  std::vector<FileStatus> Validate(const std::vector<std::pair<int, std::string>> &jobdirs) const;
+
+  //! check every macros<N> directory below topdir and write the manifest
+  //! returns the number of good jobs
+  int ValidateJobs(const std::string &manifest = "validated.manifest");
+
+  //! manifest format, one line per file: job status file entries path reason
+  static void WriteManifest(const std::string &manifest, const std::vector<FileStatus> &status);
+
+  //! true if the log file in jobdir contains the marker
+  static bool JobDone(const std::string &jobdir, const std::string &logfile, const std::string &marker);
+
+  //! job number from directory name, "macros" is job 0 (Combiner.csh renames it to macros0)
+  static int JobNumber(const std::string &dirname);
+
+  void Verbosity(const int i) { m_Verbosity = i; }
+
+ private:
+  struct Expectation
+  {
+    std::string detector;  // empty for QA files
+    std::string jobfile;
+  };
+
+  FileStatus CheckEvalFile(const std::string &fname, const std::string &detector) const;
+  FileStatus CheckQAFile(const std::string &fname) const;
+
+  bool m_ValidateUnfinished = false;
+
+  int m_Verbosity = 0;
+  unsigned int m_NThreads = 0;
+  long long m_MinEntries = 1;
+
+  std::string m_TopDir;
+  std::string m_JobLog = "condor.out";
+  std::string m_JobDoneMarker = "condorjob done";
+
+  std::vector<Expectation> m_Expected;
+};
+
+#endif  // EVALFILEVALIDATOR_H
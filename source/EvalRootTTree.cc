@@ -50,10 +50,14 @@ void EvalRootTTree::Reset()
     SnglClusters->Expand(NTWR);
   }
   event = 0;
+  job = -1;
   gpid = -99999;
   nhits = 0;
   ntowers = 0;
   nclusters = 0;
+  netabins = 0;
+  nphibins = 0;
+  ngeomtowers = 0;
   hesum = 0.;
   tesum = 0.;
   cesum = 0.;
@@ -67,7 +71,8 @@ void EvalRootTTree::Reset()
   geta = NAN;
   gphi = NAN;
   gtheta = NAN;
-  
+  cmtower.clear();
+  cmfrac.clear();
 }
 
 EvalHit *
@@ -121,6 +126,12 @@ EvalRootTTree::AddCluster(const RawCluster *clus)
   return (static_cast<EvalCluster *>(cl[nextindex]));
 }
 
+void EvalRootTTree::AddClusterMember(const int towerindex, const float fraction)
+{
+  cmtower.push_back(towerindex);
+  cmfrac.push_back(fraction);
+}
+
 EvalCluster *
 EvalRootTTree::get_cluster(const size_t i) const
 {
@@ -3,7 +3,10 @@
 
 #include <phool/PHObject.h>
 
+#include <Rtypes.h>
+
 #include <cmath>
+#include <vector>
 
 class EvalHit;
 class EvalTower;
@@ -27,6 +30,10 @@ class EvalRootTTree : public PHObject
   void set_event_number(const int i) { event = i; }
   int get_event_number() const { return event; }
 
+  // job and event number identify an event in the merged trees of all detectors
+  void set_job_number(const int i) { job = i; }
+  int get_job_number() const { return job; }
+
   void set_gpid(const int i) { gpid = i; }
   int get_gpid() const { return gpid; }
 
@@ -75,6 +82,14 @@ class EvalRootTTree : public PHObject
 
   EvalTower* get_tower(const size_t i) const;
 
+  // tower geometry: eta and phi bins and number of towers in the geometry
+  void set_netabins(const int n) { netabins = n; }
+  int get_netabins() const { return netabins; }
+  void set_nphibins(const int n) { nphibins = n; }
+  int get_nphibins() const { return nphibins; }
+  void set_ngeomtowers(const int n) { ngeomtowers = n; }
+  int get_ngeomtowers() const { return ngeomtowers; }
+
   void set_nclusters(const int n) { nclusters = n; }
   int get_nclusters() const { return nclusters; }
   void set_cesum(const double d) {cesum = d;}
@@ -82,16 +97,29 @@ class EvalRootTTree : public PHObject
 
   EvalCluster* get_cluster(const size_t i) const;
 
+  // cluster members in compressed sparse row layout: cluster i owns the entries
+  // get_cfirst() ... get_cfirst() + get_ctowers() - 1 of its EvalCluster,
+  // a member is the index of its EvalTower in this event (-1 if the tower is
+  // not stored) and the share of the tower energy assigned to the cluster
+  void AddClusterMember(const int towerindex, const float fraction);
+  size_t get_nmembers() const { return cmtower.size(); }
+  int get_member_tower(const size_t i) const { return cmtower[i]; }
+  float get_member_fraction(const size_t i) const { return cmfrac[i]; }
+
  private:
   TClonesArray* SnglHits = nullptr;
   TClonesArray* SnglTowers = nullptr;
   TClonesArray* SnglClusters = nullptr;
 
   int event = 0;
+  int job = -1;
   int gpid = -99999;
   int nhits = 0;
   int ntowers = 0;
   int nclusters = 0;
+  int netabins = 0;
+  int nphibins = 0;
+  int ngeomtowers = 0;
   double hesum = 0.;
   double tesum = 0.;
   double cesum = 0.;
@@ -105,8 +133,10 @@ class EvalRootTTree : public PHObject
   double geta = NAN;
   double gphi = NAN;
   double gtheta = NAN;
+  std::vector<int> cmtower;
+  std::vector<Float16_t> cmfrac;  //[0,1,12]
 
-  ClassDef(EvalRootTTree, 2)
+  ClassDef(EvalRootTTree, 5)
 };
 
 #endif
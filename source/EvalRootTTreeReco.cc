@@ -5,12 +5,12 @@
 #include "EvalHit.h"
 #include "EvalRootTTree.h"
 #include "EvalTower.h"
+#include "QAInstrumentation.h"
+#include "TruthReference.h"
+#include "TruthReferenceReco.h"
 
 #include <g4main/PHG4Hit.h>
 #include <g4main/PHG4HitContainer.h>
-#include <g4main/PHG4Particle.h>
-#include <g4main/PHG4TruthInfoContainer.h>
-#include <g4main/PHG4VtxPoint.h>
 
 #include <calobase/RawCluster.h>
 #include <calobase/RawClusterContainer.h>
@@ -19,6 +19,8 @@
 #include <calobase/RawTowerGeom.h>
 #include <calobase/RawTowerGeomContainer.h>
 
+#include <ffaobjects/EventHeader.h>
+
 #include <fun4all/Fun4AllReturnCodes.h>
 
 #include <phool/PHCompositeNode.h>
@@ -26,6 +28,7 @@
 
 #include <TSystem.h>
 
+#include <algorithm>
 #include <iostream>  // for operator<<, endl, basic_ost...
 
 //____________________________________________________________________________..
@@ -54,61 +57,54 @@ int EvalRootTTreeReco::Init(PHCompositeNode *topNode)
   EvalRootTTree *evaltree = new EvalRootTTree();
   PHIODataNode<PHObject> *node = new PHIODataNode<PHObject>(evaltree, m_OutputNode, "PHObject");
   dstNode->addNode(node);
+  m_Timer = QAInstrumentation::instance()->Stage(Name());
   return Fun4AllReturnCodes::EVENT_OK;
 }
 
 //____________________________________________________________________________..
 int EvalRootTTreeReco::InitRun(PHCompositeNode *topNode)
 {
+  if (!findNode::getClass<TruthReference>(topNode, TruthReferenceReco::NodeName()))
+  {
+    std::cout << "EvalRootTTreeReco::InitRun - could not find " << TruthReferenceReco::NodeName()
+              << ", register TruthReferenceReco before the Eval modules" << std::endl;
+    return Fun4AllReturnCodes::ABORTRUN;
+  }
   return Fun4AllReturnCodes::EVENT_OK;
 }
 
 //____________________________________________________________________________..
 int EvalRootTTreeReco::process_event(PHCompositeNode *topNode)
 {
-  PHG4TruthInfoContainer *truthinfo = findNode::getClass<PHG4TruthInfoContainer>(topNode, "G4TruthInfo");
-
+  QAInstrumentation::Scope timer(m_Timer);
   EvalRootTTree *evaltree = findNode::getClass<EvalRootTTree>(topNode, m_OutputNode);
-  PHG4VtxPoint *gvertex = truthinfo->GetPrimaryVtx(truthinfo->GetPrimaryVertexIndex());
-  if (gvertex)
+  // the event sequence of the simulation DST, counting is only a fallback
+  // if the EventHeader was not saved
+  m_EventCount++;
+  EventHeader *evthead = findNode::getClass<EventHeader>(topNode, "EventHeader");
+  evaltree->set_event_number(evthead ? evthead->get_EvtSequence() : m_EventCount);
+  evaltree->set_job_number(m_JobNumber);
+  // primary and vertex of the event, filled by TruthReferenceReco
+  const TruthReference *ref = findNode::getClass<TruthReference>(topNode, TruthReferenceReco::NodeName());
+  if (ref->isValid())
   {
-    evaltree->set_gvx(gvertex->get_x());
-    evaltree->set_gvy(gvertex->get_y());
-    evaltree->set_gvz(gvertex->get_z());
-    PHG4TruthInfoContainer::ConstRange range = truthinfo->GetPrimaryParticleRange();
-    int justone = 0;
-    for (PHG4TruthInfoContainer::ConstIterator iter = range.first;
-	 iter != range.second;
-	 ++iter)
-    {
-      justone++;
-      PHG4Particle *primary = iter->second;
-      double gpx = primary->get_px();
-      double gpy = primary->get_py();
-      double gpz = primary->get_pz();
-      double gpt = std::sqrt(gpx * gpx + gpy * gpy);
-      double gmom = std::sqrt(gpx * gpx + gpy * gpy + gpz * gpz);
-
-      evaltree->set_gpx(gpx);
-      evaltree->set_gpy(gpy);
-      evaltree->set_gpz(gpz);
-      evaltree->set_ge(primary->get_e());
-      evaltree->set_gpid(primary->get_pid());
-      double geta = NAN;
-      if (gpt > 0)
-      {
-	geta = asinh(gpz / gpt);
-      }
-      evaltree->set_geta(geta);
-      evaltree->set_gphi(atan2(gpy, gpx));
-      evaltree->set_gtheta(acos(gpz / gmom));
-    }
-    if (justone > 1)
+    if (ref->get_nprimaries() > 1)
     {
       std::cout << "this only works for single particle events"
-		<< " here I see " << justone << " primaries" << std::endl;
+		<< " here I see " << ref->get_nprimaries() << " primaries" << std::endl;
       gSystem->Exit(1);
     }
+    evaltree->set_gvx(ref->get_vx());
+    evaltree->set_gvy(ref->get_vy());
+    evaltree->set_gvz(ref->get_vz());
+    evaltree->set_gpx(ref->get_px());
+    evaltree->set_gpy(ref->get_py());
+    evaltree->set_gpz(ref->get_pz());
+    evaltree->set_ge(ref->get_e());
+    evaltree->set_gpid(ref->get_pid());
+    evaltree->set_geta(ref->get_eta());
+    evaltree->set_gphi(ref->get_phi());
+    evaltree->set_gtheta(ref->get_theta());
   }
   // add hits
   PHG4HitContainer *g4hits = findNode::getClass<PHG4HitContainer>(topNode, m_HitNodeName);
@@ -130,15 +126,20 @@ int EvalRootTTreeReco::process_event(PHCompositeNode *topNode)
   RawTowerGeomContainer *rawtowergeomcontainer = findNode::getClass<RawTowerGeomContainer>(topNode, m_TowerGeoNodeName);
 
   RawTowerContainer *g4towers = findNode::getClass<RawTowerContainer>(topNode, m_TowerNodeName);
+  m_TowerKeys.clear();
   if (g4towers)
   {
     double esum = 0.;
     evaltree->set_ntowers(g4towers->size());
+    evaltree->set_netabins(rawtowergeomcontainer->get_etabins());
+    evaltree->set_nphibins(rawtowergeomcontainer->get_phibins());
+    evaltree->set_ngeomtowers(rawtowergeomcontainer->size());
     RawTowerContainer::ConstRange tower_range = g4towers->getTowers();
     for (RawTowerContainer::ConstIterator tower_iter = tower_range.first; tower_iter != tower_range.second; tower_iter++)
     {
       RawTower *twr = tower_iter->second;
       EvalTower *evaltwr = evaltree->AddTower(twr);
+      m_TowerKeys.push_back(twr->get_key());
       RawTowerGeom *geom = rawtowergeomcontainer->get_tower_geometry(twr->get_key());
       evaltwr->set_teta(geom->get_eta());
       evaltwr->set_ttheta(geom->get_theta());
@@ -159,7 +160,23 @@ int EvalRootTTreeReco::process_event(PHCompositeNode *topNode)
     for (const auto &iterator : clusters->getClustersMap())
     {
       RawCluster *cluster = iterator.second;
-      evaltree->AddCluster(cluster);
+      EvalCluster *evalclus = evaltree->AddCluster(cluster);
+      // members in the flat arrays of the event, referencing the EvalTowers
+      evalclus->set_cfirst(evaltree->get_nmembers());
+      RawCluster::TowerConstRange towers = cluster->get_towers();
+      for (RawCluster::TowerConstIterator iter = towers.first; iter != towers.second; ++iter)
+      {
+        int towerindex = -1;
+        float fraction = 0;
+        std::vector<RawTowerDefs::keytype>::const_iterator key = std::lower_bound(m_TowerKeys.begin(), m_TowerKeys.end(), iter->first);
+        if (key != m_TowerKeys.end() && *key == iter->first)
+        {
+          towerindex = key - m_TowerKeys.begin();
+          const float te = evaltree->get_tower(towerindex)->get_te();
+          fraction = (te > 0) ? iter->second / te : 0;
+        }
+        evaltree->AddClusterMember(towerindex, fraction);
+      }
       esum += cluster->get_energy();
     }
       evaltree->set_cesum(esum);
@@ -183,6 +200,7 @@ int EvalRootTTreeReco::EndRun(const int runnumber)
 //____________________________________________________________________________..
 int EvalRootTTreeReco::End(PHCompositeNode *topNode)
 {
+  QAInstrumentation::instance()->End();
   return Fun4AllReturnCodes::EVENT_OK;
 }
 
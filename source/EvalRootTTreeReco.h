@@ -3,9 +3,12 @@
 #ifndef EVALROOTTTREERECO_H
 #define EVALROOTTTREERECO_H
 
+#include <calobase/RawTowerDefs.h>
+
 #include <fun4all/SubsysReco.h>
 
 #include <string>
+#include <vector>
 
 class PHCompositeNode;
 
@@ -53,9 +56,17 @@ class EvalRootTTreeReco : public SubsysReco
 
   void DropHits(const bool drp = true) { m_DropHitsFlag = drp; }
 
+  //! stored with every event, together with the event number it is used to
+  //! match the events of the different detectors after merging the jobs
+  void JobNumber(const int i) { m_JobNumber = i; }
+
  private:
   bool m_DropHitsFlag = false;
 
+  int m_JobNumber = -1;
+  int m_EventCount = 0;
+  int m_Timer = -1;  // QAInstrumentation stage
+
   std::string m_Detector;
 
   std::string m_OutputNode;
@@ -63,6 +74,10 @@ class EvalRootTTreeReco : public SubsysReco
   std::string m_TowerNodeName;
   std::string m_TowerGeoNodeName;
   std::string m_ClusterNodeName;
+
+  // keys of the stored towers of the event in EvalTower order (sorted),
+  // maps the cluster members to their EvalTower index
+  std::vector<RawTowerDefs::keytype> m_TowerKeys;
 };
 
 #endif  // EVALROOTTTREERECO_H
@@ -6,4 +6,6 @@ EvalTower::EvalTower(const RawTower *twr)
 {
   tt = twr->get_time();
   te = twr->get_energy();
+  bineta = twr->get_bineta();
+  binphi = twr->get_binphi();
 }
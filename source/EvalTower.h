@@ -39,7 +39,16 @@ class EvalTower : public PHObject
   void set_tz(const float f) { tz = f; }
   float get_tz() const { return tz; }
 
+  // tower indices in the tower geometry, -1 in trees written before they were stored
+  void set_bineta(const int i) { bineta = i; }
+  int get_bineta() const { return bineta; }
+
+  void set_binphi(const int i) { binphi = i; }
+  int get_binphi() const { return binphi; }
+
  private:
+  int bineta = -1;
+  int binphi = -1;
   float te = NAN;
   float teta = NAN;
   float tphi = NAN;
@@ -49,7 +58,7 @@ class EvalTower : public PHObject
   float ty = NAN;
   float tz = NAN;
 
-  ClassDef(EvalTower, 1)
+  ClassDef(EvalTower, 2)
 };
 
 #endif
@@ -0,0 +1,307 @@
+#include "EvalTreeReader.h"
+
+#include "EvalRootTTree.h"
+
+#include <TFile.h>
+#include <TLeaf.h>
+#include <TTree.h>
+#include <TVirtualIndex.h>
+
+#include <iostream>  // for operator<<, endl, basic_ost...
+
+namespace
+{
+  //! leaf of an EvalRootTTree data member, depending on how the branch was
+  //! split it is found with or without the branch name in front
+  TLeaf *FindMember(TTree *t, const std::string &det, const std::string &member)
+  {
+    TLeaf *leaf = t->FindLeaf(member.c_str());
+    if (!leaf)
+    {
+      leaf = t->FindLeaf(("DST#EvalTTree_" + det + "." + member).c_str());
+    }
+    return leaf;
+  }
+
+  //! names of the job and event number in every tree, the friend indices are built on them
+  const char *JobAlias = "evaljob";
+  const char *EventAlias = "evalevent";
+}  // namespace
+
+//____________________________________________________________________________..
+EvalTreeReader::EvalTreeReader(const std::string &treename)
+  : m_TreeName(treename)
+{
+}
+
+//____________________________________________________________________________..
+EvalTreeReader::~EvalTreeReader()
+{
+  Close();
+}
+
+//____________________________________________________________________________..
+void EvalTreeReader::AddDetector(const std::string &det, const std::string &file)
+{
+  if (m_Opened)
+  {
+    std::cout << "EvalTreeReader::AddDetector - " << det << " added after Open(), ignored" << std::endl;
+    return;
+  }
+  Input in;
+  in.detector = det;
+  in.file = file.empty() ? "merged_Eval_" + det + ".root" : file;
+  m_Inputs.push_back(std::move(in));
+}
+
+//____________________________________________________________________________..
+int EvalTreeReader::Open()
+{
+  if (m_Inputs.empty())
+  {
+    std::cout << "EvalTreeReader::Open - no detector set via AddDetector()" << std::endl;
+    return -1;
+  }
+  if (OpenFiles())
+  {
+    return -1;
+  }
+  // trees without job number cannot be indexed, their entries are matched
+  // one by one as the old macros did
+  m_ByEntry = false;
+  for (const auto &in : m_Inputs)
+  {
+    if (!FindMember(in.tree, in.detector, "job"))
+    {
+      std::cout << "EvalTreeReader::Open - " << in.file << " has no job number, "
+                << "the detectors are matched by entry number" << std::endl;
+      m_ByEntry = true;
+      break;
+    }
+  }
+  if (m_ByEntry)
+  {
+    for (const auto &in : m_Inputs)
+    {
+      if (in.tree->GetEntries() != GetEntries())
+      {
+        std::cout << "EvalTreeReader::Open - " << in.file << " has " << in.tree->GetEntries()
+                  << " entries, expected " << GetEntries() << std::endl;
+        return -1;
+      }
+    }
+  }
+  else
+  {
+    for (size_t idet = 1; idet < m_Inputs.size(); idet++)
+    {
+      if (!BuildIndex(m_Inputs[idet]))
+      {
+        return -1;
+      }
+    }
+  }
+  AttachFriends();
+  if (m_Verbosity > 0)
+  {
+    Print();
+  }
+  return 0;
+}
+
+//____________________________________________________________________________..
+std::unique_ptr<EvalTreeReader> EvalTreeReader::Clone() const
+{
+  std::unique_ptr<EvalTreeReader> reader(new EvalTreeReader(m_TreeName));
+  reader->m_CacheSize = m_CacheSize;
+  reader->m_Verbosity = m_Verbosity;
+  for (const auto &in : m_Inputs)
+  {
+    reader->AddDetector(in.detector, in.file);
+  }
+  if (reader->OpenFiles())
+  {
+    return nullptr;
+  }
+  reader->m_ByEntry = m_ByEntry;
+  if (!m_ByEntry)
+  {
+    for (size_t idet = 1; idet < m_Inputs.size(); idet++)
+    {
+      TVirtualIndex *index = static_cast<TVirtualIndex *>(m_Inputs[idet].tree->GetTreeIndex()->Clone());
+      TTree *t = reader->m_Inputs[idet].tree;
+      index->SetTree(t);
+      t->SetTreeIndex(index);
+    }
+  }
+  reader->AttachFriends();
+  return reader;
+}
+
+//____________________________________________________________________________..
+long long EvalTreeReader::GetEntries() const
+{
+  return m_Inputs.empty() || !m_Inputs[0].tree ? 0 : m_Inputs[0].tree->GetEntries();
+}
+
+//____________________________________________________________________________..
+bool EvalTreeReader::GetEntry(const long long i)
+{
+  // a friend without this event keeps the previous content, mark it as
+  // invalid so it cannot be mistaken for a match
+  for (size_t idet = 1; idet < m_Inputs.size(); idet++)
+  {
+    if (m_Inputs[idet].eval)
+    {
+      m_Inputs[idet].eval->set_event_number(-1);
+    }
+  }
+  if (m_Inputs[0].tree->GetEntry(i) <= 0)
+  {
+    m_MissingEvents++;
+    return false;
+  }
+  if (m_ByEntry)
+  {
+    return true;
+  }
+  const EvalRootTTree *ref = m_Inputs[0].eval;
+  for (size_t idet = 1; idet < m_Inputs.size(); idet++)
+  {
+    const EvalRootTTree *eval = m_Inputs[idet].eval;
+    if (!eval || eval->get_job_number() != ref->get_job_number() || eval->get_event_number() != ref->get_event_number())
+    {
+      if (m_Verbosity > 1)
+      {
+        std::cout << "EvalTreeReader::GetEntry - job " << ref->get_job_number() << " event "
+                  << ref->get_event_number() << " missing in " << m_Inputs[idet].detector << std::endl;
+      }
+      m_MissingEvents++;
+      return false;
+    }
+  }
+  return true;
+}
+
+//____________________________________________________________________________..
+EvalRootTTree *EvalTreeReader::Get(const std::string &det) const
+{
+  for (const auto &in : m_Inputs)
+  {
+    if (in.detector == det)
+    {
+      return in.eval;
+    }
+  }
+  return nullptr;
+}
+
+//____________________________________________________________________________..
+void EvalTreeReader::Print(const std::string & /*what*/) const
+{
+  std::cout << "EvalTreeReader: " << m_Inputs.size() << " detectors joined by "
+            << (m_ByEntry ? "entry number" : "job and event number") << std::endl;
+  for (const auto &in : m_Inputs)
+  {
+    std::cout << "  " << in.detector << ": " << in.file;
+    if (in.tree)
+    {
+      std::cout << ", " << in.tree->GetEntries() << " entries";
+    }
+    std::cout << std::endl;
+  }
+  if (m_MissingEvents > 0)
+  {
+    std::cout << "  " << m_MissingEvents << " events skipped so far" << std::endl;
+  }
+}
+
+//____________________________________________________________________________..
+int EvalTreeReader::OpenFiles()
+{
+  m_Opened = true;
+  const long long cachesize = m_CacheSize / m_Inputs.size();
+  for (auto &in : m_Inputs)
+  {
+    in.tfile.reset(TFile::Open(in.file.c_str(), "READ"));
+    if (in.tfile && !in.tfile->IsZombie())
+    {
+      in.tfile->GetObject(m_TreeName.c_str(), in.tree);
+    }
+    if (!in.tree)
+    {
+      std::cout << "EvalTreeReader::OpenFiles - no tree " << m_TreeName << " in " << in.file << std::endl;
+      return -1;
+    }
+    if (in.tree->SetBranchAddress(("DST#EvalTTree_" + in.detector).c_str(), &in.eval) < 0)
+    {
+      std::cout << "EvalTreeReader::OpenFiles - no branch DST#EvalTTree_" << in.detector
+                << " in " << in.file << std::endl;
+      return -1;
+    }
+    // the index of a friend is evaluated on the main tree, where the leaves
+    // carry a different detector name, so it is built on aliases which every
+    // tree resolves to its own job and event number
+    TLeaf *job = FindMember(in.tree, in.detector, "job");
+    TLeaf *event = FindMember(in.tree, in.detector, "event");
+    if (job && event)
+    {
+      in.tree->SetAlias(JobAlias, job->GetName());
+      in.tree->SetAlias(EventAlias, event->GetName());
+    }
+    in.tree->SetCacheSize(cachesize);
+    in.tree->AddBranchToCache("*", kTRUE);
+  }
+  return 0;
+}
+
+//____________________________________________________________________________..
+bool EvalTreeReader::BuildIndex(Input &in) const
+{
+  TLeaf *job = FindMember(in.tree, in.detector, "job");
+  TLeaf *event = FindMember(in.tree, in.detector, "event");
+  if (!job || !event)
+  {
+    std::cout << "EvalTreeReader::BuildIndex - no job/event number in " << in.file << std::endl;
+    return false;
+  }
+  if (in.tree->BuildIndex(JobAlias, EventAlias) < 0)
+  {
+    std::cout << "EvalTreeReader::BuildIndex - cannot build the index of " << in.file << std::endl;
+    return false;
+  }
+  // outputs of RunEval.C without job number are only unique within one job
+  if (in.tree->GetMinimum(job->GetName()) < 0)
+  {
+    std::cout << "EvalTreeReader::BuildIndex - " << in.file << " contains events without job number, "
+              << "events of different jobs cannot be told apart" << std::endl;
+  }
+  return true;
+}
+
+//____________________________________________________________________________..
+void EvalTreeReader::AttachFriends()
+{
+  // with an index on the friend its entry is looked up by the job and event
+  // number of the main tree, without one the same entry number is read
+  for (size_t idet = 1; idet < m_Inputs.size(); idet++)
+  {
+    m_Inputs[0].tree->AddFriend(m_Inputs[idet].tree, m_Inputs[idet].detector.c_str());
+  }
+}
+
+//____________________________________________________________________________..
+void EvalTreeReader::Close()
+{
+  // the main tree refers to its friends, close its file first
+  for (auto &in : m_Inputs)
+  {
+    in.tfile.reset();
+    in.tree = nullptr;
+  }
+  for (auto &in : m_Inputs)
+  {
+    delete in.eval;
+    in.eval = nullptr;
+  }
+}
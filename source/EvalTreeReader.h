@@ -0,0 +1,99 @@
+// Tell emacs that this is a C++ source
+//  -*- C++ -*-.
+#ifndef EVALTREEREADER_H
+#define EVALTREEREADER_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+class EvalRootTTree;
+class TFile;
+class TTree;
+
+//! Reads the Eval trees of any number of detectors side by side
+/*!
+ * The trees are joined on the job and event number which EvalRootTTreeReco
+ * stores with every event. The first detector is the main tree, for all other
+ * trees an index on job and event is built once in Open() and they are
+ * attached to the main tree as friends, so loading an entry of the main tree
+ * loads the same event of every detector. Events which are missing in one of
+ * the detectors (e.g. a job which failed for this detector only) are skipped
+ * instead of shifting all following events. Trees written before the job
+ * number existed are joined by entry number as in the old macros, this
+ * requires the same number of entries in all trees.
+ * Clone() opens the files again and reuses the indices, so every thread can
+ * have its own reader without building the indices again.
+ */
+class EvalTreeReader
+{
+ public:
+  EvalTreeReader(const std::string &treename = "T");
+
+  virtual ~EvalTreeReader();
+
+  //! read the tree of this detector from file, empty = merged_Eval_<det>.root
+  void AddDetector(const std::string &det, const std::string &file = "");
+
+  //! TTreeCache size in bytes, split between the trees of all detectors
+  void SetCacheSize(const long long bytes) { m_CacheSize = bytes; }
+
+  //! open the files and build the indices, returns 0 on success
+  int Open();
+
+  //! new reader on the same files with the indices of this one, nullptr on failure
+  std::unique_ptr<EvalTreeReader> Clone() const;
+
+  //! entries of the main (first) tree
+  long long GetEntries() const;
+
+  //! load entry i of the main tree and the same event of all other detectors
+  //! returns false if one of the detectors does not have this event
+  bool GetEntry(const long long i);
+
+  size_t NDetectors() const { return m_Inputs.size(); }
+  const std::string &Detector(const size_t idet) const { return m_Inputs[idet].detector; }
+
+  //! event of detector idet (order of AddDetector) after GetEntry()
+  EvalRootTTree *Get(const size_t idet) const { return m_Inputs[idet].eval; }
+  EvalRootTTree *Get(const std::string &det) const;
+
+  //! number of main tree entries skipped by GetEntry() so far
+  long long MissingEvents() const { return m_MissingEvents; }
+
+  //! true if the trees are joined by entry number (no job number stored)
+  bool JoinedByEntry() const { return m_ByEntry; }
+
+  void Verbosity(const int i) { m_Verbosity = i; }
+
+  void Print(const std::string &what = "ALL") const;
+
+ private:
+  struct Input
+  {
+    std::string detector;
+    std::string file;
+    std::unique_ptr<TFile> tfile;
+    TTree *tree = nullptr;
+    EvalRootTTree *eval = nullptr;
+  };
+
+  int OpenFiles();
+  bool BuildIndex(Input &in) const;
+  void AttachFriends();
+  void Close();
+
+  bool m_ByEntry = false;
+  bool m_Opened = false;
+
+  int m_Verbosity = 0;
+
+  long long m_CacheSize = 30000000;
+  long long m_MissingEvents = 0;
+
+  std::string m_TreeName;
+
+  std::vector<Input> m_Inputs;
+};
+
+#endif  // EVALTREEREADER_H
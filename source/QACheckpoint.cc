@@ -0,0 +1,357 @@
+#include "QACheckpoint.h"
+
+#include "CaloResponseSketch.h"
+
+#include <qa_modules/QAHistManagerDef.h>
+
+#include <fun4all/Fun4AllHistoManager.h>
+#include <fun4all/Fun4AllReturnCodes.h>
+#include <fun4all/SubsysReco.h>  // for SubsysReco
+
+#include <TCollection.h>
+#include <TDirectory.h>
+#include <TFile.h>
+#include <TH1.h>
+#include <THnBase.h>
+#include <TList.h>
+#include <TNamed.h>
+#include <TObject.h>
+#include <TParameter.h>
+#include <TROOT.h>
+#include <TSeqCollection.h>
+#include <TSystem.h>
+#include <TTree.h>
+
+#include <cassert>
+#include <cstdio>
+#include <iostream>  // for operator<<, endl, basic_ost...
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace
+{
+  const char *const kEventsName = "QACheckpoint_Events";
+
+  //! key suffix of the sparse maps, the registered TH2 has the same name
+  const char *const kSparseSuffix = "_Sparse";
+
+  //! owner -> flush, owners are the QA modules
+  std::map<const void *, std::function<void()>> &FlushRegistry()
+  {
+    static std::map<const void *, std::function<void()>> registry;
+    return registry;
+  }
+
+  //! owner -> sparse maps written and resumed besides the QA histogram manager
+  std::multimap<const void *, THnBase *> &SparseRegistry()
+  {
+    static std::multimap<const void *, THnBase *> registry;
+    return registry;
+  }
+}  // namespace
+
+//____________________________________________________________________________..
+QACheckpoint::QACheckpoint(const std::string &name, const std::string &qafile)
+  : SubsysReco(name)
+  , m_QAFile(qafile)
+{
+}
+
+//____________________________________________________________________________..
+void QACheckpoint::AddFlush(const void *owner, const std::function<void()> &flush)
+{
+  FlushRegistry()[owner] = flush;
+}
+
+//____________________________________________________________________________..
+void QACheckpoint::RemoveFlush(const void *owner)
+{
+  FlushRegistry().erase(owner);
+  SparseRegistry().erase(owner);
+}
+
+//____________________________________________________________________________..
+void QACheckpoint::AddSparseMap(const void *owner, THnBase *h)
+{
+  SparseRegistry().insert(std::make_pair(owner, h));
+}
+
+//____________________________________________________________________________..
+int QACheckpoint::InitRun(PHCompositeNode *topNode)
+{
+  m_LastTime = std::chrono::steady_clock::now();
+  if (m_Resume && !m_QAFile.empty() && ReadCheckpoint())
+  {
+    return Fun4AllReturnCodes::ABORTRUN;
+  }
+  m_LastCheckpoint = m_Events;
+  return Fun4AllReturnCodes::EVENT_OK;
+}
+
+//____________________________________________________________________________..
+int QACheckpoint::process_event(PHCompositeNode *topNode)
+{
+  // the previous event is complete here, also in the output managers
+  bool due = m_EventInterval > 0 && m_Events - m_LastCheckpoint >= m_EventInterval;
+  if (!due && m_TimeInterval > 0 && m_Events > m_LastCheckpoint)
+  {
+    due = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_LastTime).count() >= 60 * m_TimeInterval;
+  }
+  if (due)
+  {
+    // a failed checkpoint is no reason to lose the job
+    Write();
+  }
+  m_Events++;
+  return Fun4AllReturnCodes::EVENT_OK;
+}
+
+//____________________________________________________________________________..
+int QACheckpoint::End(PHCompositeNode *topNode)
+{
+  // saveQARootFile() writes the final QA file after End()
+  if (Verbosity() > 0)
+  {
+    Print();
+  }
+  return Fun4AllReturnCodes::EVENT_OK;
+}
+
+//____________________________________________________________________________..
+int QACheckpoint::Write()
+{
+  m_LastCheckpoint = m_Events;
+  m_LastTime = std::chrono::steady_clock::now();
+
+  AutoSaveTrees();
+  if (m_QAFile.empty())
+  {
+    return 0;
+  }
+
+  Flush();
+  Fun4AllHistoManager *hm = QAHistManagerDef::getHistoManager();
+  assert(hm);
+  const std::string tmpfile = m_QAFile + ".tmp";
+  {
+    TDirectory::TContext context;
+    std::unique_ptr<TFile> f(TFile::Open(tmpfile.c_str(), "RECREATE"));
+    if (!f || f->IsZombie())
+    {
+      std::cout << "QACheckpoint::Write - cannot open " << tmpfile << std::endl;
+      return -1;
+    }
+    for (int i = 0; i < hm->nHistos(); i++)
+    {
+      f->WriteTObject(hm->getHisto(i));
+    }
+    for (const auto &iter : SparseRegistry())
+    {
+      f->WriteTObject(iter.second, (std::string(iter.second->GetName()) + kSparseSuffix).c_str());
+    }
+    TParameter<Long64_t> counter(kEventsName, m_Events);
+    f->WriteTObject(&counter);
+    f->Close();
+  }
+  if (std::rename(tmpfile.c_str(), m_QAFile.c_str()))
+  {
+    std::cout << "QACheckpoint::Write - cannot rename " << tmpfile << " to " << m_QAFile << std::endl;
+    return -1;
+  }
+  m_NCheckpoints++;
+  if (Verbosity() > 0)
+  {
+    std::cout << "QACheckpoint::Write - " << m_Events << " events written to " << m_QAFile << std::endl;
+  }
+  return 0;
+}
+
+//____________________________________________________________________________..
+long long QACheckpoint::EventsDone(const std::string &qafile)
+{
+  TDirectory::TContext context;
+  std::unique_ptr<TFile> f(TFile::Open(qafile.c_str(), "READ"));
+  if (!f || f->IsZombie())
+  {
+    return 0;
+  }
+  TParameter<Long64_t> *counter = dynamic_cast<TParameter<Long64_t> *>(f->Get(kEventsName));
+  const long long events = counter ? counter->GetVal() : 0;
+  delete counter;
+  return events;
+}
+
+//____________________________________________________________________________..
+int QACheckpoint::KeepOutputs(const std::string &dir, const std::string &prefix, const std::string &qafile, const long long done)
+{
+  const std::string base = gSystem->BaseName(prefix.c_str());
+  const std::string qabase = gSystem->BaseName(qafile.c_str());
+  const std::string suffix = ".root";
+  const std::string kept = "_upto";
+  void *dirp = gSystem->OpenDirectory(dir.c_str());
+  if (!dirp)
+  {
+    std::cout << "QACheckpoint::KeepOutputs - cannot open " << dir << std::endl;
+    return 0;
+  }
+  std::vector<std::string> files;
+  const char *entry = nullptr;
+  while ((entry = gSystem->GetDirEntry(dirp)))
+  {
+    const std::string name = entry;
+    if (name == qabase || name.size() < base.size() + suffix.size() ||
+        name.compare(0, base.size(), base) != 0 ||
+        name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0 ||
+        name.find(kept, base.size()) != std::string::npos)
+    {
+      continue;
+    }
+    files.push_back(name);
+  }
+  gSystem->FreeDirectory(dirp);
+  int nkept = 0;
+  for (const std::string &name : files)
+  {
+    const std::string oldname = dir + "/" + name;
+    const std::string newname = dir + "/" + name.substr(0, name.size() - suffix.size()) + kept + std::to_string(done) + suffix;
+    if (std::rename(oldname.c_str(), newname.c_str()))
+    {
+      std::cout << "QACheckpoint::KeepOutputs - cannot rename " << oldname << " to " << newname << std::endl;
+      continue;
+    }
+    std::cout << "QACheckpoint::KeepOutputs - " << oldname << " of the killed job kept as " << newname << std::endl;
+    nkept++;
+  }
+  return nkept;
+}
+
+//____________________________________________________________________________..
+void QACheckpoint::Flush() const
+{
+  for (const auto &iter : FlushRegistry())
+  {
+    iter.second();
+  }
+}
+
+//____________________________________________________________________________..
+int QACheckpoint::ReadCheckpoint()
+{
+  TDirectory::TContext context;
+  std::unique_ptr<TFile> f(TFile::Open(m_QAFile.c_str(), "READ"));
+  if (!f || f->IsZombie())
+  {
+    // nothing to resume, a fresh job
+    return 0;
+  }
+  TParameter<Long64_t> *counter = dynamic_cast<TParameter<Long64_t> *>(f->Get(kEventsName));
+  if (!counter)
+  {
+    std::cout << "QACheckpoint::ReadCheckpoint - " << m_QAFile << " is the output of a finished job, not resuming" << std::endl;
+    return 0;
+  }
+  m_Events = counter->GetVal();
+  delete counter;
+
+  Flush();
+  Fun4AllHistoManager *hm = QAHistManagerDef::getHistoManager();
+  assert(hm);
+  int nadded = 0;
+  for (int i = 0; i < hm->nHistos(); i++)
+  {
+    if (CaloResponseSketch *sketch = dynamic_cast<CaloResponseSketch *>(hm->getHisto(i)))
+    {
+      CaloResponseSketch *saved = dynamic_cast<CaloResponseSketch *>(f->Get(sketch->GetName()));
+      if (!saved)
+      {
+        continue;
+      }
+      const int iret = sketch->Add(*saved);
+      delete saved;
+      if (iret)
+      {
+        return -1;
+      }
+      nadded++;
+      continue;
+    }
+    TH1 *h = dynamic_cast<TH1 *>(hm->getHisto(i));
+    if (!h)
+    {
+      continue;
+    }
+    TH1 *saved = dynamic_cast<TH1 *>(f->Get(h->GetName()));
+    if (!saved)
+    {
+      continue;
+    }
+    if (!h->Add(saved))
+    {
+      std::cout << "QACheckpoint::ReadCheckpoint - binning of " << h->GetName() << " differs from " << m_QAFile << std::endl;
+      delete saved;
+      return -1;
+    }
+    delete saved;
+    nadded++;
+  }
+  for (const auto &iter : SparseRegistry())
+  {
+    THnBase *saved = dynamic_cast<THnBase *>(f->Get((std::string(iter.second->GetName()) + kSparseSuffix).c_str()));
+    if (!saved)
+    {
+      continue;
+    }
+    iter.second->Add(saved);
+    delete saved;
+    nadded++;
+  }
+  std::cout << "QACheckpoint::ReadCheckpoint - resuming after " << m_Events << " events, "
+            << nadded << " histograms from " << m_QAFile << std::endl;
+  return 0;
+}
+
+//____________________________________________________________________________..
+int QACheckpoint::AutoSaveTrees() const
+{
+  TDirectory::TContext context;
+  int nsaved = 0;
+  TIter next(gROOT->GetListOfFiles());
+  while (TFile *f = dynamic_cast<TFile *>(next()))
+  {
+    if (!f->IsWritable())
+    {
+      continue;
+    }
+    TIter nextobj(f->GetList());
+    while (TObject *obj = nextobj())
+    {
+      if (TTree *t = dynamic_cast<TTree *>(obj))
+      {
+        t->AutoSave("SaveSelf FlushBaskets");
+        nsaved++;
+      }
+    }
+  }
+  if (Verbosity() > 1)
+  {
+    std::cout << "QACheckpoint::AutoSaveTrees - " << nsaved << " trees saved" << std::endl;
+  }
+  return nsaved;
+}
+
+//____________________________________________________________________________..
+void QACheckpoint::Print(const std::string &what) const
+{
+  std::cout << "QACheckpoint " << Name() << ": " << m_Events << " events, " << m_NCheckpoints << " checkpoints";
+  if (!m_QAFile.empty())
+  {
+    std::cout << " in " << m_QAFile;
+  }
+  std::cout << " (every " << m_EventInterval << " events";
+  if (m_TimeInterval > 0)
+  {
+    std::cout << " or " << m_TimeInterval << " minutes";
+  }
+  std::cout << ")" << std::endl;
+}
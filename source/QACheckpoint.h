@@ -0,0 +1,121 @@
+// Tell emacs that this is a C++ source
+//  -*- C++ -*-.
+#ifndef QACHECKPOINT_H
+#define QACHECKPOINT_H
+
+#include <fun4all/SubsysReco.h>
+
+#include <chrono>
+#include <functional>
+#include <string>
+
+class PHCompositeNode;
+class THnBase;
+
+//! Periodic checkpoint of the QA histograms and the open output trees
+/*!
+ * Every SetEventInterval() events and/or SetTimeInterval() minutes the module
+ *  - merges the per thread replicas of the QA modules into the registered
+ *    histograms (the QA modules register this with AddFlush()),
+ *  - writes all histograms of the QA histogram manager together with the
+ *    number of processed events (TParameter QACheckpoint_Events) to
+ *    <qafile>.tmp and renames it to qafile, so a killed job always leaves a
+ *    complete and readable QA file; the sparse maps which QAHistFactory only
+ *    expands at End() are written as THnSparse <name>_Sparse (AddSparseMap()),
+ *    the TH2 <name> stays empty in a checkpoint,
+ *  - auto saves the trees of all writable open files (DST, Eval), they can be
+ *    read and merged up to the last checkpoint.
+ * The checkpoint is taken at the start of the event after the interval, when
+ * the previous event went through all modules and output managers, so it has
+ * to be registered before the QA and Eval modules. saveQARootFile() at the end
+ * of the job overwrites the checkpoint without the event counter, a file with
+ * QACheckpoint_Events is an unfinished job.
+ *
+ * With Resume() a restarted job adds the histograms (and response sketches) of
+ * an existing checkpoint to the freshly booked ones and continues the event
+ * counter; the macro skips the EventsDone(qafile) events in its input (or
+ * reseeds its generators) and runs the remaining ones. The output files would
+ * be recreated by the restarted job, so before it opens them the macro renames
+ * the DST and Eval files of the killed job with KeepOutputs(), they keep the
+ * events up to the checkpoint and the new files hold the events after it.
+ * The intermediate merges change the order of the floating point sums, the
+ * result is not bitwise identical to a job without checkpoints.
+ */
+class QACheckpoint : public SubsysReco
+{
+ public:
+  QACheckpoint(const std::string &name = "QACheckpoint", const std::string &qafile = "G4EICDetector_qa.root");
+
+  virtual ~QACheckpoint() {}
+
+  /** Called for first event when run number is known.
+      Resumes from the checkpoint in qafile if requested, all QA
+      histograms are booked by now.
+   */
+  int InitRun(PHCompositeNode *topNode) override;
+
+  /** Called for each event.
+      Writes the checkpoint of the previous events when due.
+   */
+  int process_event(PHCompositeNode *topNode) override;
+
+  /// Called at the end of all processing.
+  int End(PHCompositeNode *topNode) override;
+
+  void Print(const std::string &what = "ALL") const override;
+
+  //! checkpoint every n events, 0 = no event interval
+  void SetEventInterval(const int n) { m_EventInterval = n; }
+
+  //! checkpoint every m minutes, 0 = no time interval
+  void SetTimeInterval(const double m) { m_TimeInterval = m; }
+
+  //! histogram checkpoint file, empty = only auto save the output trees
+  void SetQAFile(const std::string &file) { m_QAFile = file; }
+
+  //! add the histograms and the event counter of an existing checkpoint
+  void Resume(const bool b = true) { m_Resume = b; }
+
+  //! takes the checkpoint now, returns 0 on success
+  int Write();
+
+  //! events processed so far, including the resumed ones
+  long long Events() const { return m_Events; }
+
+  //! event counter of the checkpoint in qafile, 0 for a missing or finished file
+  static long long EventsDone(const std::string &qafile);
+
+  //! renames the ROOT files <dir>/<prefix>*.root of a killed job (DST, Eval) to
+  //! <name>_upto<done>.root, so the restarted job does not recreate them; skips
+  //! qafile and files kept before, returns the number of renamed files
+  static int KeepOutputs(const std::string &dir, const std::string &prefix, const std::string &qafile, const long long done);
+
+  //! called before every checkpoint (and before resuming), merges the histograms of owner
+  static void AddFlush(const void *owner, const std::function<void()> &flush);
+  //! also removes the sparse maps of owner
+  static void RemoveFlush(const void *owner);
+
+  //! written to (and resumed from) the checkpoint besides the QA histogram manager
+  static void AddSparseMap(const void *owner, THnBase *h);
+
+ private:
+  void Flush() const;
+  int ReadCheckpoint();
+  //! returns the number of saved trees
+  int AutoSaveTrees() const;
+
+  bool m_Resume = false;
+
+  int m_EventInterval = 1000;
+  double m_TimeInterval = 0;
+
+  long long m_Events = 0;
+  long long m_LastCheckpoint = 0;
+  int m_NCheckpoints = 0;
+
+  std::chrono::steady_clock::time_point m_LastTime;
+
+  std::string m_QAFile;
+};
+
+#endif  // QACHECKPOINT_H
@@ -0,0 +1,368 @@
+#include "QAEvalCalorimeter.h"
+
+#include "CaloResponseSketch.h"
+#include "EvalCluster.h"
+#include "EvalRootTTree.h"
+#include "EvalTower.h"
+#include "EvalTreeReader.h"
+#include "QAG4SimulationEicCalorimeter.h"
+
+#include <ROOT/TSeq.hxx>
+#include <ROOT/TThreadExecutor.hxx>
+
+#include <TFile.h>
+#include <TH1.h>
+#include <TH2.h>
+#include <TROOT.h>
+#include <TVector3.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>  // for operator<<, endl, basic_ost...
+#include <memory>
+
+namespace
+{
+  // position of the histograms in the list booked by RunDetector()
+  const size_t kNormalization = 0;
+  const size_t kTower = 1;  // NxN at kTower + 2 * (N - 1), NxN max at kTower + 2 * (N - 1) + 1
+  const size_t kClusterRatio = 11;
+  const size_t kClusterLateral = 12;
+
+  const int kMaxWindow = 5;
+
+  class NoAddDirectory
+  {
+   public:
+    NoAddDirectory()
+      : m_Status(TH1::AddDirectoryStatus())
+    {
+      TH1::AddDirectory(kFALSE);
+    }
+    ~NoAddDirectory() { TH1::AddDirectory(m_Status); }
+
+   private:
+    bool m_Status;
+  };
+}  // namespace
+
+//____________________________________________________________________________..
+QAEvalCalorimeter::QAEvalCalorimeter(const std::string &outfile)
+  : m_OutFile(outfile)
+{
+}
+
+//____________________________________________________________________________..
+QAEvalCalorimeter::~QAEvalCalorimeter()
+{
+}
+
+//____________________________________________________________________________..
+void QAEvalCalorimeter::AddDetector(const std::string &det, const std::string &file)
+{
+  Detector d;
+  d.name = det;
+  d.file = file.empty() ? "merged_Eval_" + det + ".root" : file;
+  m_Detectors.push_back(d);
+}
+
+//____________________________________________________________________________..
+int QAEvalCalorimeter::SetTowerGrid(const std::string &det, const int netabins, const int nphibins, const int ngeomtowers)
+{
+  for (auto &d : m_Detectors)
+  {
+    if (d.name == det)
+    {
+      d.netabins = netabins;
+      d.nphibins = nphibins;
+      d.ngeomtowers = ngeomtowers;
+      return 0;
+    }
+  }
+  std::cout << "QAEvalCalorimeter::SetTowerGrid - detector " << det << " not added" << std::endl;
+  return -1;
+}
+
+//____________________________________________________________________________..
+int QAEvalCalorimeter::Run()
+{
+  if (m_Detectors.empty())
+  {
+    std::cout << "QAEvalCalorimeter::Run - no detectors added" << std::endl;
+    return -1;
+  }
+  std::vector<TH1 *> histos;
+  std::vector<CaloResponseSketch *> sketches;
+  int iret = 0;
+  for (auto &det : m_Detectors)
+  {
+    if (RunDetector(det, histos, sketches))
+    {
+      iret = -1;
+    }
+  }
+
+  TFile *fout = TFile::Open(m_OutFile.c_str(), "RECREATE");
+  if (!fout || fout->IsZombie())
+  {
+    std::cout << "QAEvalCalorimeter::Run - cannot write " << m_OutFile << std::endl;
+    iret = -1;
+  }
+  else
+  {
+    for (TH1 *h : histos)
+    {
+      h->Write();
+    }
+    for (CaloResponseSketch *sketch : sketches)
+    {
+      sketch->Write();
+    }
+    fout->Close();
+  }
+  delete fout;
+  for (TH1 *h : histos)
+  {
+    delete h;
+  }
+  for (CaloResponseSketch *sketch : sketches)
+  {
+    delete sketch;
+  }
+  if (m_Verbosity > 0)
+  {
+    Print();
+  }
+  return iret;
+}
+
+//____________________________________________________________________________..
+int QAEvalCalorimeter::RunDetector(Detector &det, std::vector<TH1 *> &histos, std::vector<CaloResponseSketch *> &sketches) const
+{
+  EvalTreeReader master;
+  master.AddDetector(det.name, det.file);
+  if (master.Open())
+  {
+    std::cout << "QAEvalCalorimeter::RunDetector - cannot read the Eval tree of " << det.name
+              << " from " << det.file << std::endl;
+    return -1;
+  }
+  det.entries = master.GetEntries();
+
+  // same histograms as QAG4SimulationEicCalorimeter::Init() books
+  std::vector<TH1 *> booked;
+  {
+    NoAddDirectory noadd;
+    for (const auto &make : {QAG4SimulationEicCalorimeter::make_normalization_histos,
+                             QAG4SimulationEicCalorimeter::make_tower_histos,
+                             QAG4SimulationEicCalorimeter::make_cluster_histos})
+    {
+      for (TH1 *h : make(det.name))
+      {
+        booked.push_back(h);
+      }
+    }
+  }
+  CaloResponseSketch *sketch = QAG4SimulationEicCalorimeter::make_response_sketch(det.name, m_ResponseEnergyEdges, m_ResponseEtaEdges);
+
+  const long long nchunks = (det.entries + m_ChunkSize - 1) / m_ChunkSize;
+  auto work = [&](const size_t ichunk) {
+    ChunkResult result;
+    {
+      NoAddDirectory noadd;
+      for (const TH1 *h : booked)
+      {
+        TH1 *clone = static_cast<TH1 *>(h->Clone());
+        clone->Reset();
+        result.histos.push_back(clone);
+      }
+    }
+    result.sketch.reset(static_cast<CaloResponseSketch *>(sketch->Clone()));
+    // every task reads through its own copy of the reader (own TFiles)
+    std::unique_ptr<EvalTreeReader> reader = master.Clone();
+    if (reader)
+    {
+      const long long first = ichunk * m_ChunkSize;
+      ProcessChunk(det, *reader, first, std::min(first + m_ChunkSize, det.entries), result);
+    }
+    return result;
+  };
+  ROOT::EnableThreadSafety();
+  ROOT::TThreadExecutor pool(m_NThreads);
+  std::vector<ChunkResult> results = pool.Map(work, ROOT::TSeqUL(nchunks));
+
+  // add the chunks up in entry order, independent of the thread scheduling
+  for (auto &result : results)
+  {
+    for (size_t i = 0; i < booked.size(); i++)
+    {
+      booked[i]->Add(result.histos[i]);
+      delete result.histos[i];
+    }
+    sketch->Add(*result.sketch);
+    det.notowerbins += result.notowerbins;
+  }
+  if (det.notowerbins > 0)
+  {
+    std::cout << "QAEvalCalorimeter::RunDetector - " << det.name << ": tower histograms not filled for "
+              << det.notowerbins << " events, the Eval tree has no tower bins or tower grid (see SetTowerGrid)" << std::endl;
+  }
+  histos.insert(histos.end(), booked.begin(), booked.end());
+  sketches.push_back(sketch);
+  return 0;
+}
+
+//____________________________________________________________________________..
+void QAEvalCalorimeter::ProcessChunk(const Detector &det, EvalTreeReader &reader, const long long first, const long long last, ChunkResult &result) const
+{
+  std::vector<double> grid;
+  for (long long i = first; i < last; i++)
+  {
+    if (!reader.GetEntry(i))
+    {
+      continue;
+    }
+    const EvalRootTTree *eval = reader.Get(0);
+    TH1 *h_norm = result.histos[kNormalization];
+    h_norm->Fill("Event", 1);
+    if (!FillTowers(det, eval, grid, result.histos))
+    {
+      result.notowerbins++;
+    }
+    h_norm->Fill("Cluster", eval->get_nclusters());
+    FillCluster(eval, result.histos, result.sketch.get());
+  }
+  if (m_Verbosity > 1)
+  {
+    std::cout << "QAEvalCalorimeter::ProcessChunk - " << det.name << " entries " << first << " - " << last << std::endl;
+  }
+}
+
+//____________________________________________________________________________..
+bool QAEvalCalorimeter::FillTowers(const Detector &det, const EvalRootTTree *eval, std::vector<double> &grid, const std::vector<TH1 *> &histos) const
+{
+  const int netabins = eval->get_netabins() > 0 ? eval->get_netabins() : det.netabins;
+  const int nphibins = eval->get_nphibins() > 0 ? eval->get_nphibins() : det.nphibins;
+  int ngeomtowers = eval->get_ngeomtowers() > 0 ? eval->get_ngeomtowers() : det.ngeomtowers;
+  if (ngeomtowers < 0)
+  {
+    ngeomtowers = netabins * nphibins;
+  }
+  if (netabins <= 0 || nphibins <= 0)
+  {
+    return false;
+  }
+  grid.assign(netabins * nphibins, 0);
+  for (int i = 0; i < eval->get_ntowers(); i++)
+  {
+    const EvalTower *twr = eval->get_tower(i);
+    if (twr->get_bineta() < 0 || twr->get_bineta() >= netabins || twr->get_binphi() < 0 || twr->get_binphi() >= nphibins)
+    {
+      // EvalTower written before the bins were stored
+      return false;
+    }
+    grid[twr->get_bineta() * nphibins + twr->get_binphi()] = twr->get_te();
+  }
+  histos[kNormalization]->Fill("Tower", ngeomtowers);
+  histos[kNormalization]->Fill("Tower Hit", eval->get_ntowers());
+
+  // same windows and summation order as QAG4SimulationEicCalorimeter::process_event_Tower()
+  double max_energy[kMaxWindow + 1] = {0};
+  for (int binphi = 0; binphi < nphibins; ++binphi)
+  {
+    for (int bineta = 0; bineta < netabins; ++bineta)
+    {
+      for (int size = 1; size <= kMaxWindow; ++size)
+      {
+        // for 2x2 and 4x4 use slide-2 window as implemented in DAQ
+        if ((size == 2 || size == 4) && ((binphi % 2 != 0) && (bineta % 2 != 0)))
+        {
+          continue;
+        }
+        double energy = 0;
+        for (int iphi = binphi; iphi < binphi + size; ++iphi)
+        {
+          // wrap around
+          const int wrapphi = (iphi >= nphibins) ? iphi - nphibins : iphi;
+          for (int ieta = bineta; ieta < bineta + size && ieta < netabins; ++ieta)
+          {
+            energy += grid[ieta * nphibins + wrapphi];
+          }
+        }
+        histos[kTower + 2 * (size - 1)]->Fill(energy == 0 ? 9.1e-4 : energy);  // trick to fill 0 energy tower to the first bin
+        max_energy[size] = std::max(max_energy[size], energy);
+      }
+    }
+  }
+  for (int size = 1; size <= kMaxWindow; ++size)
+  {
+    histos[kTower + 2 * (size - 1) + 1]->Fill(max_energy[size]);
+  }
+  return true;
+}
+
+//____________________________________________________________________________..
+void QAEvalCalorimeter::FillCluster(const EvalRootTTree *eval, const std::vector<TH1 *> &histos, CaloResponseSketch *sketch) const
+{
+  const EvalCluster *best = nullptr;
+  for (int i = 0; i < eval->get_nclusters(); i++)
+  {
+    const EvalCluster *clus = eval->get_cluster(i);
+    if (!best || clus->get_ce() > best->get_ce())
+    {
+      best = clus;
+    }
+  }
+  if (!best)
+  {
+    histos[kClusterRatio]->Fill(0);  // no cluster matched
+    sketch->Fill(eval->get_ge(), eval->get_geta(), 0);
+    return;
+  }
+  histos[kClusterRatio]->Fill(best->get_ce() / (eval->get_ge() + 1e-9));  //avoids divide zero
+  sketch->Fill(eval->get_ge(), eval->get_geta(), best->get_ce() / (eval->get_ge() + 1e-9));
+
+  // lateral projection relative to the generated particle direction
+  const TVector3 hit(best->get_cx(), best->get_cy(), best->get_cz());
+  const TVector3 vertex(eval->get_gvx(), eval->get_gvy(), eval->get_gvz());
+  TVector3 axis_proj(eval->get_gpx(), eval->get_gpy(), eval->get_gpz());
+  if (std::isnan(axis_proj.Mag()) || std::isnan(vertex.Mag()))
+  {
+    return;
+  }
+  if (axis_proj.Mag() == 0)
+  {
+    axis_proj.SetXYZ(0, 0, 1);
+  }
+  axis_proj = axis_proj.Unit();
+
+  TVector3 axis_azimuth = axis_proj.Cross(TVector3(0, 0, 1));
+  if (axis_azimuth.Mag() == 0)
+  {
+    axis_azimuth.SetXYZ(1, 0, 0);
+  }
+  axis_azimuth = axis_azimuth.Unit();
+
+  const TVector3 axis_polar = axis_proj.Cross(axis_azimuth).Unit();
+
+  static_cast<TH2 *>(histos[kClusterLateral])->Fill(axis_polar.Dot(hit - vertex), axis_azimuth.Dot(hit - vertex));
+}
+
+//____________________________________________________________________________..
+void QAEvalCalorimeter::Print(const std::string &what) const
+{
+  std::cout << "QAEvalCalorimeter: output " << m_OutFile << ", " << m_Detectors.size() << " detectors" << std::endl;
+  for (const auto &det : m_Detectors)
+  {
+    std::cout << "  " << det.name << " from " << det.file << ": " << det.entries << " entries";
+    if (det.netabins > 0)
+    {
+      std::cout << ", tower grid " << det.netabins << " x " << det.nphibins;
+    }
+    if (det.notowerbins > 0)
+    {
+      std::cout << ", " << det.notowerbins << " events without tower bins";
+    }
+    std::cout << std::endl;
+  }
+}
@@ -0,0 +1,107 @@
+// Tell emacs that this is a C++ source
+//  -*- C++ -*-.
+#ifndef QAEVALCALORIMETER_H
+#define QAEVALCALORIMETER_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+class CaloResponseSketch;
+class EvalRootTTree;
+class EvalTreeReader;
+class TFile;
+class TH1;
+
+//! Rebuilds the QAG4SimulationEicCalorimeter tower and cluster histograms from merged Eval trees
+/*!
+ * Re-running Fun4All over the DSTs is not needed after a change of the QA
+ * binning or of the tower windows: the histograms are booked by the static
+ * QAG4SimulationEicCalorimeter::make_*_histos() functions and filled from the
+ * towers (energy, eta/phi bin) and clusters stored by EvalRootTTreeReco, so
+ * the output has the same names and binning as the Fun4All QA file and the
+ * QA_Draw_*_TowerCluster.C macros work on it unchanged. The response sketch
+ * (<prefix>_Cluster_ResponseSketch) is filled with the generated energy and
+ * eta of the Eval tree.
+ * The entries are split into chunks which are processed in parallel, each
+ * chunk with its own reader and histograms; the chunks are added up in entry
+ * order, so the result does not depend on the number of threads.
+ * Differences to the Fun4All QA module:
+ *  - tower energies are the float values of the Eval tree,
+ *  - the best matched cluster is the most energetic cluster (the truth
+ *    association of CaloRawClusterEval is not stored in the Eval tree), which
+ *    is the same cluster for single particle events,
+ *  - the G4Hit histograms are not rebuilt.
+ */
+class QAEvalCalorimeter
+{
+ public:
+  QAEvalCalorimeter(const std::string &outfile = "G4EICDetector_qa_eval.root");
+
+  virtual ~QAEvalCalorimeter();
+
+  //! rebuild the histograms of det from merged_Eval_<det>.root (or file)
+  void AddDetector(const std::string &det, const std::string &file = "");
+
+  //! tower geometry for Eval trees written before it was stored in the tree,
+  //! ngeomtowers < 0 uses netabins * nphibins
+  int SetTowerGrid(const std::string &det, const int netabins, const int nphibins, const int ngeomtowers = -1);
+
+  //! truth energy and eta slices of the response sketch, empty = CaloResponseSketch defaults
+  void SetResponseSlices(const std::vector<double> &energyedges, const std::vector<double> &etaedges)
+  {
+    m_ResponseEnergyEdges = energyedges;
+    m_ResponseEtaEdges = etaedges;
+  }
+
+  //! entries per parallel task
+  void SetChunkSize(const long long n) { m_ChunkSize = n; }
+
+  //! number of threads, 0 = number of cores
+  void SetNThreads(const unsigned int n) { m_NThreads = n; }
+
+  void Verbosity(const int i) { m_Verbosity = i; }
+
+  //! returns 0 on success, -1 if an input cannot be read or the output cannot be written
+  int Run();
+
+  void Print(const std::string &what = "ALL") const;
+
+ private:
+  struct Detector
+  {
+    std::string name;
+    std::string file;
+    int netabins = 0;
+    int nphibins = 0;
+    int ngeomtowers = -1;
+    long long entries = 0;
+    long long notowerbins = 0;
+  };
+
+  struct ChunkResult
+  {
+    std::vector<TH1 *> histos;
+    std::shared_ptr<CaloResponseSketch> sketch;
+    long long notowerbins = 0;
+  };
+
+  int RunDetector(Detector &det, std::vector<TH1 *> &histos, std::vector<CaloResponseSketch *> &sketches) const;
+  void ProcessChunk(const Detector &det, EvalTreeReader &reader, const long long first, const long long last, ChunkResult &result) const;
+  bool FillTowers(const Detector &det, const EvalRootTTree *eval, std::vector<double> &grid, const std::vector<TH1 *> &histos) const;
+  void FillCluster(const EvalRootTTree *eval, const std::vector<TH1 *> &histos, CaloResponseSketch *sketch) const;
+
+  int m_Verbosity = 0;
+  unsigned int m_NThreads = 0;
+
+  long long m_ChunkSize = 20000;
+
+  std::string m_OutFile;
+
+  std::vector<double> m_ResponseEnergyEdges;
+  std::vector<double> m_ResponseEtaEdges;
+
+  std::vector<Detector> m_Detectors;
+};
+
+#endif  // QAEVALCALORIMETER_H
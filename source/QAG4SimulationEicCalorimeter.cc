@@ -1,12 +1,19 @@
 #include "QAG4SimulationEicCalorimeter.h"
 
+#include "CaloResponseSketch.h"
+#include "QACheckpoint.h"
+#include "QAHistFactory.h"
+#include "QAHistShards.h"
+#include "QAInstrumentation.h"
+#include "TruthReference.h"
+#include "TruthReferenceReco.h"
+
 #include <qa_modules/QAHistManagerDef.h>
 
 #include <g4main/PHG4Hit.h>
 #include <g4main/PHG4HitContainer.h>
 #include <g4main/PHG4Particle.h>
 #include <g4main/PHG4TruthInfoContainer.h>
-#include <g4main/PHG4VtxPoint.h>
 
 #include <calobase/RawCluster.h>
 #include <calobase/RawClusterContainer.h>
@@ -41,18 +48,27 @@
 #include <iterator>  // for reverse_iterator
 #include <map>
 #include <utility>
+#include <vector>
 
 using namespace std;
 
 QAG4SimulationEicCalorimeter::QAG4SimulationEicCalorimeter(const string &calo_name,
                                                            QAG4SimulationEicCalorimeter::enu_flags flags)
   : SubsysReco("QAG4SimulationEicCalorimeter_" + calo_name)
+  , m_Histos(new QAHistShards("QAG4SimulationEicCalorimeter_" + calo_name))
+  , m_HistFactory(new QAHistFactory(m_Histos))
   , _calo_name(calo_name)
   , _flags(flags)
   , _calo_hit_container(nullptr)
   , _calo_abs_hit_container(nullptr)
   , _truth_container(nullptr)
 {
+  // the hit maps cover the whole detector envelope but only the active volume
+  // is hit, fill them sparse and expand them at End()
+  QAHistFactory::Layout sparse;
+  sparse.storage = QAHistFactory::kSparse;
+  m_HistFactory->SetLayout("*_G4Hit_RZ", sparse);
+  m_HistFactory->SetLayout("*_G4Hit_XY", sparse);
 }
 
 int QAG4SimulationEicCalorimeter::InitRun(PHCompositeNode *topNode)
@@ -95,6 +111,16 @@ int QAG4SimulationEicCalorimeter::InitRun(PHCompositeNode *topNode)
     assert(_truth_container);
   }
 
+  // primary, vertex and projection frame of the event, filled once for all detectors
+  m_TruthReference = findNode::getClass<TruthReference>(topNode, TruthReferenceReco::NodeName());
+  if (!m_TruthReference)
+  {
+    cout << "QAG4SimulationEicCalorimeter::InitRun - Fatal Error - "
+         << "unable to find node " << TruthReferenceReco::NodeName()
+         << ", register TruthReferenceReco before the QA modules" << endl;
+    return Fun4AllReturnCodes::ABORTRUN;
+  }
+
   if (flag(kProcessCluster))
   {
     if (!_caloevalstack)
@@ -113,19 +139,20 @@ int QAG4SimulationEicCalorimeter::InitRun(PHCompositeNode *topNode)
 
 int QAG4SimulationEicCalorimeter::Init(PHCompositeNode *topNode)
 {
-  Fun4AllHistoManager *hm = QAHistManagerDef::getHistoManager();
-  assert(hm);
-  TH1D *h = new TH1D(TString(get_histo_prefix()) + "_Normalization",  //
-                     TString(_calo_name) + " Normalization;Items;Count", 10, .5, 10.5);
-  int i = 1;
-  h->GetXaxis()->SetBinLabel(i++, "Event");
-  h->GetXaxis()->SetBinLabel(i++, "G4Hit Active");
-  h->GetXaxis()->SetBinLabel(i++, "G4Hit Absor.");
-  h->GetXaxis()->SetBinLabel(i++, "Tower");
-  h->GetXaxis()->SetBinLabel(i++, "Tower Hit");
-  h->GetXaxis()->SetBinLabel(i++, "Cluster");
-  h->GetXaxis()->LabelsOption("v");
-  hm->registerHisto(h);
+  // stages stay at -1 unless the instrumentation is enabled
+  QAInstrumentation *instr = QAInstrumentation::instance();
+  m_TimerEvent = instr->Stage(Name());
+  if (flag(kProcessG4Hit))
+    m_TimerG4Hit = instr->Stage(Name() + "_G4Hit");
+  if (flag(kProcessTower))
+    m_TimerTower = instr->Stage(Name() + "_Tower");
+  if (flag(kProcessCluster))
+    m_TimerCluster = instr->Stage(Name() + "_Cluster");
+
+  for (TH1 *h : make_normalization_histos(_calo_name))
+  {
+    m_Histos->Register(h);
+  }
 
   if (flag(kProcessG4Hit))
   {
@@ -149,6 +176,14 @@ int QAG4SimulationEicCalorimeter::Init(PHCompositeNode *topNode)
     Init_Cluster(topNode);
   }
 
+  // merged by QACheckpoint before it writes the histograms, the sparse maps
+  // are written as they are and only expanded at End()
+  QACheckpoint::AddFlush(this, [this]() { m_Histos->Merge(); });
+  for (THnBase *h : m_HistFactory->SparseMaps())
+  {
+    QACheckpoint::AddSparseMap(this, h);
+  }
+
   return Fun4AllReturnCodes::EVENT_OK;
 }
 
@@ -157,11 +192,14 @@ int QAG4SimulationEicCalorimeter::process_event(PHCompositeNode *topNode)
   if (Verbosity() > 2)
     cout << "QAG4SimulationEicCalorimeter::process_event() entered" << endl;
 
+  QAInstrumentation::Scope timer(m_TimerEvent);
+
   if (_caloevalstack)
     _caloevalstack->next_event(topNode);
 
   if (flag(kProcessG4Hit))
   {
+    QAInstrumentation::Scope timer_g4hit(m_TimerG4Hit);
     int ret = process_event_G4Hit(topNode);
 
     if (ret != Fun4AllReturnCodes::EVENT_OK)
@@ -170,6 +208,7 @@ int QAG4SimulationEicCalorimeter::process_event(PHCompositeNode *topNode)
 
   if (flag(kProcessTower))
   {
+    QAInstrumentation::Scope timer_tower(m_TimerTower);
     int ret = process_event_Tower(topNode);
 
     if (ret != Fun4AllReturnCodes::EVENT_OK)
@@ -178,6 +217,7 @@ int QAG4SimulationEicCalorimeter::process_event(PHCompositeNode *topNode)
 
   if (flag(kProcessCluster))
   {
+    QAInstrumentation::Scope timer_cluster(m_TimerCluster);
     int ret = process_event_Cluster(topNode);
 
     if (ret != Fun4AllReturnCodes::EVENT_OK)
@@ -185,9 +225,7 @@ int QAG4SimulationEicCalorimeter::process_event(PHCompositeNode *topNode)
   }
 
   // at the end, count success events
-  Fun4AllHistoManager *hm = QAHistManagerDef::getHistoManager();
-  assert(hm);
-  TH1D *h_norm = dynamic_cast<TH1D *>(hm->getHisto(
+  TH1D *h_norm = dynamic_cast<TH1D *>(m_Histos->Get(
       get_histo_prefix() + "_Normalization"));
   assert(h_norm);
   h_norm->Fill("Event", 1);
@@ -195,36 +233,145 @@ int QAG4SimulationEicCalorimeter::process_event(PHCompositeNode *topNode)
   return Fun4AllReturnCodes::EVENT_OK;
 }
 
+int QAG4SimulationEicCalorimeter::End(PHCompositeNode *topNode)
+{
+  QACheckpoint::RemoveFlush(this);
+
+  // replicas of all threads, in slot order
+  m_Histos->Merge();
+  if (Verbosity() >= 1)
+  {
+    m_HistFactory->Print("MEMORY");
+  }
+  m_HistFactory->Finish();
+
+  QAInstrumentation::instance()->End();
+
+  return Fun4AllReturnCodes::EVENT_OK;
+}
+
 string
 QAG4SimulationEicCalorimeter::get_histo_prefix()
 {
-  return "h_QAG4Sim_" + string(_calo_name);
+  return get_histo_prefix(_calo_name);
 }
 
-int QAG4SimulationEicCalorimeter::Init_G4Hit(PHCompositeNode *topNode)
+string
+QAG4SimulationEicCalorimeter::get_histo_prefix(const string &calo_name)
 {
-  Fun4AllHistoManager *hm = QAHistManagerDef::getHistoManager();
-  assert(hm);
+  return "h_QAG4Sim_" + calo_name;
+}
+
+vector<TH1 *> QAG4SimulationEicCalorimeter::make_normalization_histos(const string &calo_name)
+{
+  vector<TH1 *> histos;
+  TH1D *h = new TH1D(TString(get_histo_prefix(calo_name)) + "_Normalization",  //
+                     TString(calo_name) + " Normalization;Items;Count", 10, .5, 10.5);
+  int i = 1;
+  h->GetXaxis()->SetBinLabel(i++, "Event");
+  h->GetXaxis()->SetBinLabel(i++, "G4Hit Active");
+  h->GetXaxis()->SetBinLabel(i++, "G4Hit Absor.");
+  h->GetXaxis()->SetBinLabel(i++, "Tower");
+  h->GetXaxis()->SetBinLabel(i++, "Tower Hit");
+  h->GetXaxis()->SetBinLabel(i++, "Cluster");
+  h->GetXaxis()->LabelsOption("v");
+  histos.push_back(h);
+  return histos;
+}
+
+vector<TH1 *> QAG4SimulationEicCalorimeter::make_tower_histos(const string &calo_name)
+{
+  vector<TH1 *> histos;
+  TH1F *h = new TH1F(TString(get_histo_prefix(calo_name)) + "_Tower_1x1",  //
+                     TString(calo_name) + " 1x1 tower;1x1 TOWER Energy (GeV)", 100, 9e-4, 100);
+  QAHistManagerDef::useLogBins(h->GetXaxis());
+  histos.push_back(h);
+
+  histos.push_back(
+      new TH1F(TString(get_histo_prefix(calo_name)) + "_Tower_1x1_max",  //
+               TString(calo_name) + " 1x1 tower max per event;1x1 tower max per event (GeV)", 5000,
+               0, 50));
+
+  h = new TH1F(TString(get_histo_prefix(calo_name)) + "_Tower_2x2",  //
+               TString(calo_name) + " 2x2 tower;2x2 TOWER Energy (GeV)", 100, 9e-4, 100);
+  QAHistManagerDef::useLogBins(h->GetXaxis());
+  histos.push_back(h);
+  histos.push_back(
+      new TH1F(TString(get_histo_prefix(calo_name)) + "_Tower_2x2_max",  //
+               TString(calo_name) + " 2x2 tower max per event;2x2 tower max per event (GeV)", 5000,
+               0, 50));
+
+  h = new TH1F(TString(get_histo_prefix(calo_name)) + "_Tower_3x3",  //
+               TString(calo_name) + " 3x3 tower;3x3 TOWER Energy (GeV)", 100, 9e-4, 100);
+  QAHistManagerDef::useLogBins(h->GetXaxis());
+  histos.push_back(h);
+  histos.push_back(
+      new TH1F(TString(get_histo_prefix(calo_name)) + "_Tower_3x3_max",  //
+               TString(calo_name) + " 3x3 tower max per event;3x3 tower max per event (GeV)", 5000,
+               0, 50));
+
+  h = new TH1F(TString(get_histo_prefix(calo_name)) + "_Tower_4x4",  //
+               TString(calo_name) + " 4x4 tower;4x4 TOWER Energy (GeV)", 100, 9e-4, 100);
+  QAHistManagerDef::useLogBins(h->GetXaxis());
+  histos.push_back(h);
+  histos.push_back(
+      new TH1F(TString(get_histo_prefix(calo_name)) + "_Tower_4x4_max",  //
+               TString(calo_name) + " 4x4 tower max per event;4x4 tower max per event (GeV)", 5000,
+               0, 50));
+
+  h = new TH1F(TString(get_histo_prefix(calo_name)) + "_Tower_5x5",  //
+               TString(calo_name) + " 5x5 tower;5x5 TOWER Energy (GeV)", 100, 9e-4, 100);
+  QAHistManagerDef::useLogBins(h->GetXaxis());
+  histos.push_back(h);
+  histos.push_back(
+      new TH1F(TString(get_histo_prefix(calo_name)) + "_Tower_5x5_max",  //
+               TString(calo_name) + " 5x5 tower max per event;5x5 tower max per event (GeV)", 5000,
+               0, 50));
+  return histos;
+}
 
-  hm->registerHisto(
-      new TH2F(TString(get_histo_prefix()) + "_G4Hit_RZ",  //
-               TString(_calo_name) + " RZ projection;G4 Hit Z (cm);G4 Hit R (cm)", 1200, -300, 300,
-               600, -000, 300));
+vector<TH1 *> QAG4SimulationEicCalorimeter::make_cluster_histos(const string &calo_name)
+{
+  vector<TH1 *> histos;
+  histos.push_back(
+      new TH1F(TString(get_histo_prefix(calo_name)) + "_Cluster_BestMatchERatio",  //
+               TString(calo_name) + " best matched cluster E/E_{Truth};E_{Cluster}/E_{Truth}", 150,
+               0, 1.5));
 
-  hm->registerHisto(
-      new TH2F(TString(get_histo_prefix()) + "_G4Hit_XY",  //
-               TString(_calo_name) + " XY projection;G4 Hit X (cm);G4 Hit Y (cm)", 1200, -300, 300,
-               1200, -300, 300));
+  histos.push_back(
+      new TH2F(TString(get_histo_prefix(calo_name)) + "_Cluster_LateralTruthProjection",  //
+               TString(calo_name) + " best cluster lateral projection (last primary);Polar direction (cm);Azimuthal direction (cm)",
+               200, -15, 15, 200, -15, 15));
+  return histos;
+}
 
-  hm->registerHisto(
-      new TH2F(TString(get_histo_prefix()) + "_G4Hit_LateralTruthProjection",  //
-               TString(_calo_name) + " shower lateral projection (last primary);Polar direction (cm);Azimuthal direction (cm)",
-               200, -30, 30, 200, -30, 30));
+CaloResponseSketch *QAG4SimulationEicCalorimeter::make_response_sketch(const string &calo_name, const vector<double> &energyedges,
+                                                                       const vector<double> &etaedges)
+{
+  return new CaloResponseSketch(get_histo_prefix(calo_name) + "_Cluster_ResponseSketch",  //
+                                calo_name + " best matched cluster E/E_{Truth} per truth energy and eta slice",
+                                energyedges.empty() ? CaloResponseSketch::DefaultEnergyEdges() : energyedges,
+                                etaedges.empty() ? CaloResponseSketch::DefaultEtaEdges() : etaedges);
+}
 
-  hm->registerHisto(new TH1F(TString(get_histo_prefix()) + "_G4Hit_SF",  //
+int QAG4SimulationEicCalorimeter::Init_G4Hit(PHCompositeNode *topNode)
+{
+  m_HistFactory->MakeTH2(get_histo_prefix() + "_G4Hit_RZ",  //
+                         _calo_name + " RZ projection;G4 Hit Z (cm);G4 Hit R (cm)", 1200, -300, 300,
+                         600, -000, 300);
+
+  m_HistFactory->MakeTH2(get_histo_prefix() + "_G4Hit_XY",  //
+                         _calo_name + " XY projection;G4 Hit X (cm);G4 Hit Y (cm)", 1200, -300, 300,
+                         1200, -300, 300);
+
+  m_HistFactory->MakeTH2(get_histo_prefix() + "_G4Hit_LateralTruthProjection",  //
+                         _calo_name + " shower lateral projection (last primary);Polar direction (cm);Azimuthal direction (cm)",
+                         200, -30, 30, 200, -30, 30);
+
+  m_Histos->Register(new TH1F(TString(get_histo_prefix()) + "_G4Hit_SF",  //
                              TString(_calo_name) + " sampling fraction;Sampling fraction", 1000, 0, .2));
 
-  hm->registerHisto(
+  m_Histos->Register(
       new TH1F(TString(get_histo_prefix()) + "_G4Hit_VSF",  //
                TString(_calo_name) + " visible sampling fraction;Visible sampling fraction", 1000, 0,
                .2));
@@ -234,14 +381,14 @@ int QAG4SimulationEicCalorimeter::Init_G4Hit(PHCompositeNode *topNode)
                TString(_calo_name) + " hit time (edep weighting);Hit time - T0 (ns);Geant4 energy density",
                1000, 0.5, 10000);
   QAHistManagerDef::useLogBins(h->GetXaxis());
-  hm->registerHisto(h);
+  m_Histos->Register(h);
 
-  hm->registerHisto(
+  m_Histos->Register(
       new TH1F(TString(get_histo_prefix()) + "_G4Hit_FractionTruthEnergy",  //
                TString(_calo_name) + " fraction truth energy ;G4 edep / particle energy",
                1000, 0, 1));
 
-  hm->registerHisto(
+  m_Histos->Register(
       new TH1F(TString(get_histo_prefix()) + "_G4Hit_FractionEMVisibleEnergy",  //
                TString(_calo_name) + " fraction visible energy from EM; visible energy from e^{#pm} / total visible energy",
                100, 0, 1));
@@ -256,70 +403,28 @@ int QAG4SimulationEicCalorimeter::process_event_G4Hit(PHCompositeNode *topNode)
 
   TH1F *h = nullptr;
 
-  Fun4AllHistoManager *hm = QAHistManagerDef::getHistoManager();
-  assert(hm);
-
-  TH1D *h_norm = dynamic_cast<TH1D *>(hm->getHisto(
+  TH1D *h_norm = dynamic_cast<TH1D *>(m_Histos->Get(
       get_histo_prefix() + "_Normalization"));
   assert(h_norm);
 
-  // get primary
+  // get primary, nothing is filled for events without a valid reference
   assert(_truth_container);
-  PHG4TruthInfoContainer::ConstRange primary_range =
-      _truth_container->GetPrimaryParticleRange();
-  double total_primary_energy = 1e-9;  //make it zero energy epsilon samll so it can be used for denominator
-  for (PHG4TruthInfoContainer::ConstIterator particle_iter = primary_range.first;
-       particle_iter != primary_range.second; ++particle_iter)
+  assert(m_TruthReference);
+  if (!m_TruthReference->isValid())
   {
-    const PHG4Particle *particle = particle_iter->second;
-    assert(particle);
-    total_primary_energy += particle->get_e();
+    return Fun4AllReturnCodes::EVENT_OK;
   }
-
-  assert(not _truth_container->GetMap().empty());
-  const PHG4Particle *last_primary =
-      _truth_container->GetMap().rbegin()->second;
-  assert(last_primary);
+  const double total_primary_energy = 1e-9 + m_TruthReference->get_total_primary_energy();  //make it zero energy epsilon samll so it can be used for denominator
 
   if (Verbosity() > 2)
   {
     cout
         << "QAG4SimulationEicCalorimeter::process_event_G4Hit() handle this truth particle"
         << endl;
-    last_primary->identify();
+    m_TruthReference->identify();
   }
-  const PHG4VtxPoint *primary_vtx =  //
-      _truth_container->GetPrimaryVtx(last_primary->get_vtx_id());
-  assert(primary_vtx);
-  if (Verbosity() > 2)
-  {
-    cout
-        << "QAG4SimulationEicCalorimeter::process_event_G4Hit() handle this vertex"
-        << endl;
-    primary_vtx->identify();
-  }
-
-  const double t0 = primary_vtx->get_t();
-  const TVector3 vertex(primary_vtx->get_x(), primary_vtx->get_y(),
-                        primary_vtx->get_z());
-
-  // projection axis
-  TVector3 axis_proj(last_primary->get_px(), last_primary->get_py(),
-                     last_primary->get_pz());
-  if (axis_proj.Mag() == 0)
-    axis_proj.SetXYZ(0, 0, 1);
-  axis_proj = axis_proj.Unit();
 
-  // azimuthal direction axis
-  TVector3 axis_azimuth = axis_proj.Cross(TVector3(0, 0, 1));
-  if (axis_azimuth.Mag() == 0)
-    axis_azimuth.SetXYZ(1, 0, 0);
-  axis_azimuth = axis_azimuth.Unit();
-
-  // polar direction axis
-  TVector3 axis_polar = axis_proj.Cross(axis_azimuth);
-  assert(axis_polar.Mag() > 0);
-  axis_polar = axis_polar.Unit();
+  const double t0 = m_TruthReference->get_vt();
 
   double e_calo = 0.0;      // active energy deposition
   double ev_calo = 0.0;     // visible energy
@@ -328,17 +433,17 @@ int QAG4SimulationEicCalorimeter::process_event_G4Hit(PHCompositeNode *topNode)
 
   if (_calo_hit_container)
   {
-    TH2F *hrz = dynamic_cast<TH2F *>(hm->getHisto(
-        get_histo_prefix() + "_G4Hit_RZ"));
+    const QAHistFactory::Map2D hrz = m_HistFactory->GetMap2D(
+        get_histo_prefix() + "_G4Hit_RZ");
     assert(hrz);
-    TH2F *hxy = dynamic_cast<TH2F *>(hm->getHisto(
-        get_histo_prefix() + "_G4Hit_XY"));
+    const QAHistFactory::Map2D hxy = m_HistFactory->GetMap2D(
+        get_histo_prefix() + "_G4Hit_XY");
     assert(hxy);
-    TH1F *ht = dynamic_cast<TH1F *>(hm->getHisto(
+    TH1F *ht = dynamic_cast<TH1F *>(m_Histos->Get(
         get_histo_prefix() + "_G4Hit_HitTime"));
     assert(ht);
-    TH2F *hlat = dynamic_cast<TH2F *>(hm->getHisto(
-        get_histo_prefix() + "_G4Hit_LateralTruthProjection"));
+    const QAHistFactory::Map2D hlat = m_HistFactory->GetMap2D(
+        get_histo_prefix() + "_G4Hit_LateralTruthProjection");
     assert(hlat);
 
     h_norm->Fill("G4Hit Active", _calo_hit_container->size());
@@ -368,13 +473,14 @@ int QAG4SimulationEicCalorimeter::process_event_G4Hit(PHCompositeNode *topNode)
       const TVector3 hit(this_hit->get_avg_x(), this_hit->get_avg_y(),
                          this_hit->get_avg_z());
 
-      hrz->Fill(hit.Z(), hit.Perp(), this_hit->get_edep());
-      hxy->Fill(hit.X(), hit.Y(), this_hit->get_edep());
+      hrz.Fill(hit.Z(), hit.Perp(), this_hit->get_edep());
+      hxy.Fill(hit.X(), hit.Y(), this_hit->get_edep());
       ht->Fill(this_hit->get_avg_t() - t0, this_hit->get_edep());
 
-      const double hit_azimuth = axis_azimuth.Dot(hit - vertex);
-      const double hit_polar = axis_polar.Dot(hit - vertex);
-      hlat->Fill(hit_polar, hit_azimuth, this_hit->get_edep());
+      double hit_polar = 0;
+      double hit_azimuth = 0;
+      m_TruthReference->Lateral(hit.X(), hit.Y(), hit.Z(), hit_polar, hit_azimuth);
+      hlat.Fill(hit_polar, hit_azimuth, this_hit->get_edep());
     }
   }
 
@@ -401,23 +507,23 @@ int QAG4SimulationEicCalorimeter::process_event_G4Hit(PHCompositeNode *topNode)
 
   if (e_calo + ea_calo > 0)
   {
-    h = dynamic_cast<TH1F *>(hm->getHisto(get_histo_prefix() + "_G4Hit_SF"));
+    h = dynamic_cast<TH1F *>(m_Histos->Get(get_histo_prefix() + "_G4Hit_SF"));
     assert(h);
     h->Fill(e_calo / (e_calo + ea_calo));
 
-    h = dynamic_cast<TH1F *>(hm->getHisto(get_histo_prefix() + "_G4Hit_VSF"));
+    h = dynamic_cast<TH1F *>(m_Histos->Get(get_histo_prefix() + "_G4Hit_VSF"));
     assert(h);
     h->Fill(ev_calo / (e_calo + ea_calo));
   }
 
-  h = dynamic_cast<TH1F *>(hm->getHisto(
+  h = dynamic_cast<TH1F *>(m_Histos->Get(
       get_histo_prefix() + "_G4Hit_FractionTruthEnergy"));
   assert(h);
   h->Fill((e_calo + ea_calo) / total_primary_energy);
 
   if (ev_calo > 0)
   {
-    h = dynamic_cast<TH1F *>(hm->getHisto(
+    h = dynamic_cast<TH1F *>(m_Histos->Get(
         get_histo_prefix() + "_G4Hit_FractionEMVisibleEnergy"));
     assert(h);
     h->Fill(ev_calo_em / (ev_calo));
@@ -433,55 +539,10 @@ int QAG4SimulationEicCalorimeter::process_event_G4Hit(PHCompositeNode *topNode)
 
 int QAG4SimulationEicCalorimeter::Init_Tower(PHCompositeNode *topNode)
 {
-  Fun4AllHistoManager *hm = QAHistManagerDef::getHistoManager();
-  assert(hm);
-
-  TH1F *h = new TH1F(TString(get_histo_prefix()) + "_Tower_1x1",  //
-                     TString(_calo_name) + " 1x1 tower;1x1 TOWER Energy (GeV)", 100, 9e-4, 100);
-  QAHistManagerDef::useLogBins(h->GetXaxis());
-  hm->registerHisto(h);
-
-  hm->registerHisto(
-      new TH1F(TString(get_histo_prefix()) + "_Tower_1x1_max",  //
-               TString(_calo_name) + " 1x1 tower max per event;1x1 tower max per event (GeV)", 5000,
-               0, 50));
-
-  h = new TH1F(TString(get_histo_prefix()) + "_Tower_2x2",  //
-               TString(_calo_name) + " 2x2 tower;2x2 TOWER Energy (GeV)", 100, 9e-4, 100);
-  QAHistManagerDef::useLogBins(h->GetXaxis());
-  hm->registerHisto(h);
-  hm->registerHisto(
-      new TH1F(TString(get_histo_prefix()) + "_Tower_2x2_max",  //
-               TString(_calo_name) + " 2x2 tower max per event;2x2 tower max per event (GeV)", 5000,
-               0, 50));
-
-  h = new TH1F(TString(get_histo_prefix()) + "_Tower_3x3",  //
-               TString(_calo_name) + " 3x3 tower;3x3 TOWER Energy (GeV)", 100, 9e-4, 100);
-  QAHistManagerDef::useLogBins(h->GetXaxis());
-  hm->registerHisto(h);
-  hm->registerHisto(
-      new TH1F(TString(get_histo_prefix()) + "_Tower_3x3_max",  //
-               TString(_calo_name) + " 3x3 tower max per event;3x3 tower max per event (GeV)", 5000,
-               0, 50));
-
-  h = new TH1F(TString(get_histo_prefix()) + "_Tower_4x4",  //
-               TString(_calo_name) + " 4x4 tower;4x4 TOWER Energy (GeV)", 100, 9e-4, 100);
-  QAHistManagerDef::useLogBins(h->GetXaxis());
-  hm->registerHisto(h);
-  hm->registerHisto(
-      new TH1F(TString(get_histo_prefix()) + "_Tower_4x4_max",  //
-               TString(_calo_name) + " 4x4 tower max per event;4x4 tower max per event (GeV)", 5000,
-               0, 50));
-
-  h = new TH1F(TString(get_histo_prefix()) + "_Tower_5x5",  //
-               TString(_calo_name) + " 5x5 tower;5x5 TOWER Energy (GeV)", 100, 9e-4, 100);
-  QAHistManagerDef::useLogBins(h->GetXaxis());
-  hm->registerHisto(h);
-  hm->registerHisto(
-      new TH1F(TString(get_histo_prefix()) + "_Tower_5x5_max",  //
-               TString(_calo_name) + " 5x5 tower max per event;5x5 tower max per event (GeV)", 5000,
-               0, 50));
-
+  for (TH1 *h : make_tower_histos(_calo_name))
+  {
+    m_Histos->Register(h);
+  }
   return Fun4AllReturnCodes::EVENT_OK;
 }
 
@@ -492,9 +553,7 @@ int QAG4SimulationEicCalorimeter::process_event_Tower(PHCompositeNode *topNode)
   if (Verbosity() > 2)
     cout << "QAG4SimulationEicCalorimeter::process_event_Tower() entered" << endl;
 
-  Fun4AllHistoManager *hm = QAHistManagerDef::getHistoManager();
-  assert(hm);
-  TH1D *h_norm = dynamic_cast<TH1D *>(hm->getHisto(
+  TH1D *h_norm = dynamic_cast<TH1D *>(m_Histos->Get(
       get_histo_prefix() + "_Normalization"));
   assert(h_norm);
 
@@ -533,11 +592,11 @@ int QAG4SimulationEicCalorimeter::process_event_Tower(PHCompositeNode *topNode)
   {
     max_energy[size] = 0;
 
-    TH1F *h = dynamic_cast<TH1F *>(hm->getHisto(
+    TH1F *h = dynamic_cast<TH1F *>(m_Histos->Get(
         get_histo_prefix() + "_Tower_" + size_label[size]));
     assert(h);
     energy_hist_list[size] = h;
-    h = dynamic_cast<TH1F *>(hm->getHisto(
+    h = dynamic_cast<TH1F *>(m_Histos->Get(
         get_histo_prefix() + "_Tower_" + size_label[size] + "_max"));
     assert(h);
     max_energy_hist_list[size] = h;
@@ -603,19 +662,17 @@ int QAG4SimulationEicCalorimeter::process_event_Tower(PHCompositeNode *topNode)
 
 int QAG4SimulationEicCalorimeter::Init_Cluster(PHCompositeNode *topNode)
 {
+  for (TH1 *h : make_cluster_histos(_calo_name))
+  {
+    // the threads fill sparse replicas of the 2D map
+    m_Histos->Register(h, dynamic_cast<TH2 *>(h) != nullptr);
+  }
+  // written and merged like the histograms, the replicas are added in End()
+  CaloResponseSketch *sketch = make_response_sketch(_calo_name, m_ResponseEnergyEdges, m_ResponseEtaEdges);
   Fun4AllHistoManager *hm = QAHistManagerDef::getHistoManager();
   assert(hm);
-
-  hm->registerHisto(
-      new TH1F(TString(get_histo_prefix()) + "_Cluster_BestMatchERatio",  //
-               TString(_calo_name) + " best matched cluster E/E_{Truth};E_{Cluster}/E_{Truth}", 150,
-               0, 1.5));
-
-  hm->registerHisto(
-      new TH2F(TString(get_histo_prefix()) + "_Cluster_LateralTruthProjection",  //
-               TString(_calo_name) + " best cluster lateral projection (last primary);Polar direction (cm);Azimuthal direction (cm)",
-               200, -15, 15, 200, -15, 15));
-
+  hm->registerHisto(sketch);
+  m_Histos->Book(sketch);
   return Fun4AllReturnCodes::EVENT_OK;
 }
 
@@ -625,8 +682,6 @@ int QAG4SimulationEicCalorimeter::process_event_Cluster(PHCompositeNode *topNode
     cout << "QAG4SimulationEicCalorimeter::process_event_Cluster() entered"
          << endl;
 
-  Fun4AllHistoManager *hm = QAHistManagerDef::getHistoManager();
-  assert(hm);
   string towergeomnodename = "TOWERGEOM_" + _calo_name;
   RawTowerGeomContainer *towergeom = findNode::getClass<RawTowerGeomContainer>(
       topNode, towergeomnodename.c_str());
@@ -637,8 +692,16 @@ int QAG4SimulationEicCalorimeter::process_event_Cluster(PHCompositeNode *topNode
     return Fun4AllReturnCodes::ABORTRUN;
   }
 
+  // get primary, nothing is filled for events without a valid reference
+  assert(_truth_container);
+  assert(m_TruthReference);
+  if (!m_TruthReference->isValid())
+  {
+    return Fun4AllReturnCodes::EVENT_OK;
+  }
+
   //get a cluster count
-  TH1D *h_norm = dynamic_cast<TH1D *>(hm->getHisto(
+  TH1D *h_norm = dynamic_cast<TH1D *>(m_Histos->Get(
       get_histo_prefix() + "_Normalization"));
   assert(h_norm);
 
@@ -648,10 +711,7 @@ int QAG4SimulationEicCalorimeter::process_event_Cluster(PHCompositeNode *topNode
   assert(clusters);
   h_norm->Fill("Cluster", clusters->size());
 
-  // get primary
-  assert(_truth_container);
-  assert(not _truth_container->GetMap().empty());
-  PHG4Particle *last_primary = _truth_container->GetMap().rbegin()->second;
+  PHG4Particle *last_primary = _truth_container->GetParticle(m_TruthReference->get_track_id());
   assert(last_primary);
 
   if (Verbosity() > 2)
@@ -659,16 +719,22 @@ int QAG4SimulationEicCalorimeter::process_event_Cluster(PHCompositeNode *topNode
     cout
         << "QAG4SimulationEicCalorimeter::process_event_Cluster() handle this truth particle"
         << endl;
-    last_primary->identify();
+    m_TruthReference->identify();
   }
 
   assert(_caloevalstack);
   CaloRawClusterEval *clustereval = _caloevalstack->get_rawcluster_eval();
   assert(clustereval);
 
-  TH1F *h = dynamic_cast<TH1F *>(hm->getHisto(
+  TH1F *h = dynamic_cast<TH1F *>(m_Histos->Get(
       get_histo_prefix() + "_Cluster_BestMatchERatio"));
   assert(h);
+  CaloResponseSketch *sketch = dynamic_cast<CaloResponseSketch *>(m_Histos->GetObject(
+      m_Histos->Index(get_histo_prefix() + "_Cluster_ResponseSketch")));
+  assert(sketch);
+
+  // same eta as the Eval tree, NAN (no slice) along the beam
+  const double geta = m_TruthReference->get_eta();
 
   RawCluster *cluster = clustereval->best_cluster_from(last_primary);
   if (cluster)
@@ -682,49 +748,19 @@ int QAG4SimulationEicCalorimeter::process_event_Cluster(PHCompositeNode *topNode
            << last_primary->get_e() << endl;
 
     h->Fill(cluster->get_energy() / (last_primary->get_e() + 1e-9));  //avoids divide zero
+    sketch->Fill(last_primary->get_e(), geta, cluster->get_energy() / (last_primary->get_e() + 1e-9));
 
     // now work on the projection:
     const CLHEP::Hep3Vector hit(cluster->get_position());
 
-    const PHG4VtxPoint *primary_vtx =  //
-        _truth_container->GetPrimaryVtx(last_primary->get_vtx_id());
-    assert(primary_vtx);
-    if (Verbosity() > 2)
-    {
-      cout
-          << "QAG4SimulationEicCalorimeter::process_event_Cluster() handle this vertex"
-          << endl;
-      primary_vtx->identify();
-    }
-
-    const CLHEP::Hep3Vector vertex(primary_vtx->get_x(), primary_vtx->get_y(),
-                                   primary_vtx->get_z());
-
-    // projection axis
-    CLHEP::Hep3Vector axis_proj(last_primary->get_px(), last_primary->get_py(),
-                                last_primary->get_pz());
-    if (axis_proj.mag() == 0)
-      axis_proj.set(0, 0, 1);
-    axis_proj = axis_proj.unit();
-
-    // azimuthal direction axis
-    CLHEP::Hep3Vector axis_azimuth = axis_proj.cross(CLHEP::Hep3Vector(0, 0, 1));
-    if (axis_azimuth.mag() == 0)
-      axis_azimuth.set(1, 0, 0);
-    axis_azimuth = axis_azimuth.unit();
-
-    // polar direction axis
-    CLHEP::Hep3Vector axis_polar = axis_proj.cross(axis_azimuth);
-    assert(axis_polar.mag() > 0);
-    axis_polar = axis_polar.unit();
-
-    TH2F *hlat = dynamic_cast<TH2F *>(hm->getHisto(
-        get_histo_prefix() + "_Cluster_LateralTruthProjection"));
+    const QAHistFactory::Map2D hlat = m_HistFactory->GetMap2D(
+        get_histo_prefix() + "_Cluster_LateralTruthProjection");
     assert(hlat);
 
-    const double hit_azimuth = axis_azimuth.dot(hit - vertex);
-    const double hit_polar = axis_polar.dot(hit - vertex);
-    hlat->Fill(hit_polar, hit_azimuth);
+    double hit_polar = 0;
+    double hit_azimuth = 0;
+    m_TruthReference->Lateral(hit.x(), hit.y(), hit.z(), hit_polar, hit_azimuth);
+    hlat.Fill(hit_polar, hit_azimuth);
   }
   else
   {
@@ -732,6 +768,7 @@ int QAG4SimulationEicCalorimeter::process_event_Cluster(PHCompositeNode *topNode
       cout << "QAG4SimulationEicCalorimeter::process_event_Cluster::"
            << _calo_name << " - missing cluster !";
     h->Fill(0);  // no cluster matched
+    sketch->Fill(last_primary->get_e(), geta, 0);
   }
 
   return Fun4AllReturnCodes::EVENT_OK;
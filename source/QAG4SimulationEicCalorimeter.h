@@ -6,11 +6,17 @@
 #include <cstdint>
 #include <memory>
 #include <string>
+#include <vector>
 
 class CaloEvalStack;
+class CaloResponseSketch;
 class PHCompositeNode;
 class PHG4HitContainer;
 class PHG4TruthInfoContainer;
+class QAHistFactory;
+class QAHistShards;
+class TH1;
+class TruthReference;
 
 /// \class QAG4SimulationEicCalorimeter
 class QAG4SimulationEicCalorimeter : public SubsysReco
@@ -33,6 +39,9 @@ class QAG4SimulationEicCalorimeter : public SubsysReco
   int InitRun(PHCompositeNode *topNode);
   int process_event(PHCompositeNode *topNode);
 
+  //! merges the histograms filled by the worker threads and expands the sparse maps
+  int End(PHCompositeNode *topNode);
+
   uint32_t
   get_flags() const
   {
@@ -67,6 +76,48 @@ class QAG4SimulationEicCalorimeter : public SubsysReco
   std::string
   get_histo_prefix();
 
+  static std::string
+  get_histo_prefix(const std::string &calo_name);
+
+  //! new QA histograms of calo_name as booked by Init(), also used to rebuild
+  //! them from the Eval trees (QAEvalCalorimeter)
+  static std::vector<TH1 *>
+  make_normalization_histos(const std::string &calo_name);
+
+  static std::vector<TH1 *>
+  make_tower_histos(const std::string &calo_name);
+
+  static std::vector<TH1 *>
+  make_cluster_histos(const std::string &calo_name);
+
+  //! best matched cluster E/E_{Truth} per truth energy and eta slice, empty edges use the defaults
+  static CaloResponseSketch *
+  make_response_sketch(const std::string &calo_name, const std::vector<double> &energyedges = {},
+                       const std::vector<double> &etaedges = {});
+
+  //! truth energy and eta slices of the response sketch, change them before Init()
+  void
+  set_response_slices(const std::vector<double> &energyedges, const std::vector<double> &etaedges)
+  {
+    m_ResponseEnergyEdges = energyedges;
+    m_ResponseEtaEdges = etaedges;
+  }
+
+  //! QA histograms, worker threads fill the replica returned by get_histos()->Get(),
+  //! the 2D maps through QAHistFactory::GetMap2D()
+  std::shared_ptr<QAHistShards>
+  get_histos() const
+  {
+    return m_Histos;
+  }
+
+  //! storage layout of the G4Hit maps, change it before Init()
+  std::shared_ptr<QAHistFactory>
+  get_hist_factory() const
+  {
+    return m_HistFactory;
+  }
+
  private:
   int Init_G4Hit(PHCompositeNode *topNode);
   int process_event_G4Hit(PHCompositeNode *topNode);
@@ -78,13 +129,26 @@ class QAG4SimulationEicCalorimeter : public SubsysReco
   int process_event_Cluster(PHCompositeNode *topNode);
 
   std::shared_ptr<CaloEvalStack> _caloevalstack;
+  std::shared_ptr<QAHistShards> m_Histos;
+  std::shared_ptr<QAHistFactory> m_HistFactory;
+
+  //! QAInstrumentation stages, -1 if not instrumented
+  int m_TimerEvent = -1;
+  int m_TimerG4Hit = -1;
+  int m_TimerTower = -1;
+  int m_TimerCluster = -1;
 
   std::string _calo_name;
   uint32_t _flags;
 
+  //! slices of the response sketch, empty = CaloResponseSketch defaults
+  std::vector<double> m_ResponseEnergyEdges;
+  std::vector<double> m_ResponseEtaEdges;
+
   PHG4HitContainer *_calo_hit_container;
   PHG4HitContainer *_calo_abs_hit_container;
   PHG4TruthInfoContainer *_truth_container;
+  TruthReference *m_TruthReference = nullptr;
 };
 
 #endif  // QA_QAG4SIMULATIONEICCALORIMETER_H
@@ -1,5 +1,12 @@
 #include "QAG4SimulationEicCalorimeterSum.h"
 
+#include "QACheckpoint.h"
+#include "QAHistFactory.h"
+#include "QAHistShards.h"
+#include "QAInstrumentation.h"
+#include "TruthReference.h"
+#include "TruthReferenceReco.h"
+
 #include <qa_modules/QAHistManagerDef.h>
 
 #include <g4eval/CaloEvalStack.h>
@@ -42,6 +49,7 @@ using namespace std;
 QAG4SimulationEicCalorimeterSum::QAG4SimulationEicCalorimeterSum(
     QAG4SimulationEicCalorimeterSum::enu_flags flags)
   : SubsysReco("QAG4SimulationEicCalorimeterSum")
+  , m_Histos(new QAHistShards("QAG4SimulationEicCalorimeterSum"))
   , _flags(flags)
   , m_TrackNodeName("TrackMap")
   , _calo_name_cemc("CEMC")
@@ -64,6 +72,15 @@ int QAG4SimulationEicCalorimeterSum::InitRun(PHCompositeNode *topNode)
     assert(_truth_container);
   }
 
+  m_TruthReference = findNode::getClass<TruthReference>(topNode, TruthReferenceReco::NodeName());
+  if (!m_TruthReference)
+  {
+    cout << "QAG4SimulationEicCalorimeterSum::InitRun - Fatal Error - "
+         << "unable to find node " << TruthReferenceReco::NodeName()
+         << ", register TruthReferenceReco before the QA modules" << endl;
+    return Fun4AllReturnCodes::ABORTRUN;
+  }
+
   if (flag(kProcessCluster))
   {
     if (!_caloevalstack_cemc)
@@ -101,8 +118,14 @@ int QAG4SimulationEicCalorimeterSum::InitRun(PHCompositeNode *topNode)
 
 int QAG4SimulationEicCalorimeterSum::Init(PHCompositeNode *topNode)
 {
-  Fun4AllHistoManager *hm = QAHistManagerDef::getHistoManager();
-  assert(hm);
+  // stages stay at -1 unless the instrumentation is enabled
+  QAInstrumentation *instr = QAInstrumentation::instance();
+  m_TimerEvent = instr->Stage(Name());
+  if (flag(kProcessCluster))
+    m_TimerCluster = instr->Stage(Name() + "_Cluster");
+  if (flag(kProcessTrackProj))
+    m_TimerTrackProj = instr->Stage(Name() + "_TrackProj");
+
   TH1D *h = new TH1D(TString(get_histo_prefix()) + "Normalization",  //
                      TString(get_histo_prefix()) + " Normalization;Items;Count", 10, .5, 10.5);
   int i = 1;
@@ -115,7 +138,7 @@ int QAG4SimulationEicCalorimeterSum::Init(PHCompositeNode *topNode)
   h->GetXaxis()->SetBinLabel(i++, (_calo_name_hcalout + " Cluster").c_str());
   h->GetXaxis()->SetBinLabel(i++, "Track");
   h->GetXaxis()->LabelsOption("v");
-  hm->registerHisto(h);
+  m_Histos->Register(h);
 
   //  if (flag(kProcessTower))
   //    {
@@ -139,6 +162,10 @@ int QAG4SimulationEicCalorimeterSum::Init(PHCompositeNode *topNode)
            << endl;
     Init_TrackProj(topNode);
   }
+
+  // merged by QACheckpoint before it writes the histograms
+  QACheckpoint::AddFlush(this, [this]() { m_Histos->Merge(); });
+
   return Fun4AllReturnCodes::EVENT_OK;
 }
 
@@ -147,6 +174,8 @@ int QAG4SimulationEicCalorimeterSum::process_event(PHCompositeNode *topNode)
   if (Verbosity() > 2)
     cout << "QAG4SimulationEicCalorimeterSum::process_event() entered" << endl;
 
+  QAInstrumentation::Scope timer(m_TimerEvent);
+
   if (_caloevalstack_cemc)
     _caloevalstack_cemc->next_event(topNode);
   if (_caloevalstack_hcalin)
@@ -166,6 +195,7 @@ int QAG4SimulationEicCalorimeterSum::process_event(PHCompositeNode *topNode)
 
   if (flag(kProcessCluster))
   {
+    QAInstrumentation::Scope timer_cluster(m_TimerCluster);
     int ret = process_event_Cluster(topNode);
 
     if (ret != Fun4AllReturnCodes::EVENT_OK)
@@ -174,6 +204,7 @@ int QAG4SimulationEicCalorimeterSum::process_event(PHCompositeNode *topNode)
 
   if (flag(kProcessTrackProj))
   {
+    QAInstrumentation::Scope timer_trackproj(m_TimerTrackProj);
     int ret = process_event_TrackProj(topNode);
 
     if (ret != Fun4AllReturnCodes::EVENT_OK)
@@ -181,9 +212,7 @@ int QAG4SimulationEicCalorimeterSum::process_event(PHCompositeNode *topNode)
   }
 
   // at the end, count success events
-  Fun4AllHistoManager *hm = QAHistManagerDef::getHistoManager();
-  assert(hm);
-  TH1D *h_norm = dynamic_cast<TH1D *>(hm->getHisto(
+  TH1D *h_norm = dynamic_cast<TH1D *>(m_Histos->Get(
       get_histo_prefix() + "Normalization"));
   assert(h_norm);
   h_norm->Fill("Event", 1);
@@ -191,6 +220,18 @@ int QAG4SimulationEicCalorimeterSum::process_event(PHCompositeNode *topNode)
   return Fun4AllReturnCodes::EVENT_OK;
 }
 
+int QAG4SimulationEicCalorimeterSum::End(PHCompositeNode *topNode)
+{
+  QACheckpoint::RemoveFlush(this);
+
+  // replicas of all threads, in slot order
+  m_Histos->Merge();
+
+  QAInstrumentation::instance()->End();
+
+  return Fun4AllReturnCodes::EVENT_OK;
+}
+
 string
 QAG4SimulationEicCalorimeterSum::get_histo_prefix()
 {
@@ -200,10 +241,14 @@ QAG4SimulationEicCalorimeterSum::get_histo_prefix()
 PHG4Particle *
 QAG4SimulationEicCalorimeterSum::get_truth_particle()
 {
-  // get last primary
+  // last primary of the TruthReference, nullptr if the event has none
   assert(_truth_container);
-  assert(not _truth_container->GetMap().empty());
-  PHG4Particle *last_primary = _truth_container->GetMap().rbegin()->second;
+  assert(m_TruthReference);
+  if (!m_TruthReference->isValid())
+  {
+    return nullptr;
+  }
+  PHG4Particle *last_primary = _truth_container->GetParticle(m_TruthReference->get_track_id());
   assert(last_primary);
 
   return last_primary;
@@ -211,36 +256,36 @@ QAG4SimulationEicCalorimeterSum::get_truth_particle()
 
 int QAG4SimulationEicCalorimeterSum::Init_TrackProj(PHCompositeNode *topNode)
 {
-  Fun4AllHistoManager *hm = QAHistManagerDef::getHistoManager();
-  assert(hm);
-
-  hm->registerHisto(
+  m_Histos->Register(
       new TH2F(
           TString(get_histo_prefix()) + TString(_calo_name_cemc.c_str()) + "_TrackProj",  //
           TString(_calo_name_cemc.c_str()) + " Tower Energy Distr. around Track Proj.;Polar distance / Tower width;Azimuthal distance / Tower width",
           (Max_N_Tower - 1) * 10, -Max_N_Tower / 2, Max_N_Tower / 2,
-          (Max_N_Tower - 1) * 10, -Max_N_Tower / 2, Max_N_Tower / 2));
+          (Max_N_Tower - 1) * 10, -Max_N_Tower / 2, Max_N_Tower / 2),
+      true);
 
-  hm->registerHisto(
+  m_Histos->Register(
       new TH2F(
           TString(get_histo_prefix()) + TString(_calo_name_hcalin.c_str()) + "_TrackProj",  //
           TString(_calo_name_hcalin.c_str()) + " Tower Energy Distr. around Track Proj.;Polar distance / Tower width;Azimuthal distance / Tower width",
           (Max_N_Tower - 1) * 10, -Max_N_Tower / 2, Max_N_Tower / 2,
-          (Max_N_Tower - 1) * 10, -Max_N_Tower / 2, Max_N_Tower / 2));
+          (Max_N_Tower - 1) * 10, -Max_N_Tower / 2, Max_N_Tower / 2),
+      true);
 
-  hm->registerHisto(
+  m_Histos->Register(
       new TH2F(
           TString(get_histo_prefix()) + TString(_calo_name_hcalout.c_str()) + "_TrackProj",  //
           TString(_calo_name_hcalout.c_str()) + " Tower Energy Distr. around Track Proj.;Polar distance / Tower width;Azimuthal distance / Tower width",
           (Max_N_Tower - 1) * 10, -Max_N_Tower / 2, Max_N_Tower / 2,
-          (Max_N_Tower - 1) * 10, -Max_N_Tower / 2, Max_N_Tower / 2));
+          (Max_N_Tower - 1) * 10, -Max_N_Tower / 2, Max_N_Tower / 2),
+      true);
 
-  hm->registerHisto(
+  m_Histos->Register(
       new TH1F(TString(get_histo_prefix()) + "TrackProj_3x3Tower_EP",  //
                "Tower 3x3 sum /E_{Truth};#Sigma_{3x3}[E_{Tower}] / total truth energy",
                150, 0, 1.5));
 
-  hm->registerHisto(
+  m_Histos->Register(
       new TH1F(TString(get_histo_prefix()) + "TrackProj_5x5Tower_EP",  //
                "Tower 5x5 sum /E_{Truth};#Sigma_{5x5}[E_{Tower}] / total truth energy",
                150, 0, 1.5));
@@ -264,15 +309,13 @@ int QAG4SimulationEicCalorimeterSum::process_event_TrackProj(PHCompositeNode *to
   if (!track)
     return Fun4AllReturnCodes::EVENT_OK;  // not through the whole event for missing track.
 
-  Fun4AllHistoManager *hm = QAHistManagerDef::getHistoManager();
-  assert(hm);
-  TH1D *h_norm = dynamic_cast<TH1D *>(hm->getHisto(
+  TH1D *h_norm = dynamic_cast<TH1D *>(m_Histos->Get(
       get_histo_prefix() + "Normalization"));
   assert(h_norm);
   h_norm->Fill("Track", 1);
 
   {
-    TH1F *hsum = dynamic_cast<TH1F *>(hm->getHisto(
+    TH1F *hsum = dynamic_cast<TH1F *>(m_Histos->Get(
         (get_histo_prefix()) + "TrackProj_3x3Tower_EP"));
     assert(hsum);
 
@@ -280,7 +323,7 @@ int QAG4SimulationEicCalorimeterSum::process_event_TrackProj(PHCompositeNode *to
         (track->get_cal_energy_3x3(SvtxTrack::CEMC) + track->get_cal_energy_3x3(SvtxTrack::HCALIN) + track->get_cal_energy_3x3(SvtxTrack::HCALOUT)) / (primary->get_e() + 1e-9));
   }
   {
-    TH1F *hsum = dynamic_cast<TH1F *>(hm->getHisto(
+    TH1F *hsum = dynamic_cast<TH1F *>(m_Histos->Get(
         (get_histo_prefix()) + "TrackProj_5x5Tower_EP"));
     assert(hsum);
 
@@ -302,11 +345,8 @@ bool QAG4SimulationEicCalorimeterSum::eval_trk_proj(const string &detector, Svtx
   assert(track);
   assert(topNode);
 
-  Fun4AllHistoManager *hm = QAHistManagerDef::getHistoManager();
-  assert(hm);
-
-  TH2F *h2_proj = dynamic_cast<TH2F *>(hm->getHisto(
-      (get_histo_prefix()) + detector + "_TrackProj"));
+  const QAHistFactory::Map2D h2_proj = QAHistFactory::GetMap2D(*m_Histos,
+                                                                (get_histo_prefix()) + detector + "_TrackProj");
   assert(h2_proj);
 
   // pull the tower geometry
@@ -439,8 +479,8 @@ bool QAG4SimulationEicCalorimeterSum::eval_trk_proj(const string &detector, Svtx
         energy = tower->get_energy();
       }
 
-      h2_proj->Fill(ieta - bineta + etabin_shift,
-                    iphi - binphi + phibin_shift, energy);
+      h2_proj.Fill(ieta - bineta + etabin_shift,
+                   iphi - binphi + phibin_shift, energy);
 
     }  //            for (int ieta = bineta-1; ieta < bineta+2; ++ieta) {
 
@@ -471,32 +511,31 @@ bool QAG4SimulationEicCalorimeterSum::eval_trk_proj(const string &detector, Svtx
 
 int QAG4SimulationEicCalorimeterSum::Init_Cluster(PHCompositeNode *topNode)
 {
-  Fun4AllHistoManager *hm = QAHistManagerDef::getHistoManager();
-  assert(hm);
-
-  hm->registerHisto(
+  m_Histos->Register(
       new TH2F(
           TString(get_histo_prefix()) + "Cluster_" + _calo_name_cemc.c_str() + "_" + _calo_name_hcalin.c_str(),  //
           TString(_calo_name_hcalin.c_str()) + " VS " + TString(_calo_name_cemc.c_str()) + ": best cluster energy;" + TString(_calo_name_cemc.c_str()) + " cluster energy (GeV);" + TString(_calo_name_hcalin.c_str()) + " cluster energy (GeV)",
-          70, 0, 70, 70, 0, 70));
+          70, 0, 70, 70, 0, 70),
+      true);
 
-  hm->registerHisto(
+  m_Histos->Register(
       new TH2F(
           TString(get_histo_prefix()) + "Cluster_" + _calo_name_cemc.c_str() + "_" + _calo_name_hcalin.c_str() + "_" + _calo_name_hcalout.c_str(),  //
           TString(_calo_name_cemc.c_str()) + " + " + TString(_calo_name_hcalin.c_str()) + " VS " + TString(_calo_name_hcalout.c_str()) + ": best cluster energy;" + TString(_calo_name_cemc.c_str()) + " + " + TString(_calo_name_hcalin.c_str()) + " cluster energy (GeV);" + TString(_calo_name_hcalout.c_str()) + " cluster energy (GeV)",
-          70, 0, 70, 70, 0, 70));
+          70, 0, 70, 70, 0, 70),
+      true);
 
-  hm->registerHisto(
+  m_Histos->Register(
       new TH1F(TString(get_histo_prefix()) + "Cluster_EP",  //
                "Total Cluster E_{Reco}/E_{Truth};Reco cluster energy sum / total truth energy",
                150, 0, 1.5));
 
-  hm->registerHisto(
+  m_Histos->Register(
       new TH1F(
           TString(get_histo_prefix()) + "Cluster_Ratio_" + _calo_name_cemc.c_str() + "_" + _calo_name_hcalin.c_str(),  //
           "Energy ratio " + TString(_calo_name_cemc.c_str()) + " VS " + TString(_calo_name_hcalin.c_str()) + ";Best cluster " + TString(_calo_name_cemc.c_str()) + " / (" + TString(_calo_name_cemc.c_str()) + " + " + TString(_calo_name_hcalin.c_str()) + ")", 110, 0, 1.1));
 
-  hm->registerHisto(
+  m_Histos->Register(
       new TH1F(
           TString(get_histo_prefix()) + "Cluster_Ratio_" + _calo_name_cemc.c_str() + "_" + _calo_name_hcalin.c_str() + "_" + TString(_calo_name_hcalout.c_str()),  //
           "Energy ratio " + TString(_calo_name_cemc.c_str()) + " + " + TString(_calo_name_hcalin.c_str()) + " VS " + TString(_calo_name_hcalout.c_str()) + ";Best cluster (" + TString(_calo_name_cemc.c_str()) + " + " + TString(_calo_name_hcalin.c_str()) + ") / (" + TString(_calo_name_cemc.c_str()) + " + " + TString(_calo_name_hcalin.c_str()) + " + " + TString(_calo_name_hcalout.c_str()) + ")", 110, 0, 1.1));
@@ -510,9 +549,6 @@ int QAG4SimulationEicCalorimeterSum::process_event_Cluster(PHCompositeNode *topN
     cout << "QAG4SimulationEicCalorimeterSum::process_event_Cluster() entered"
          << endl;
 
-  Fun4AllHistoManager *hm = QAHistManagerDef::getHistoManager();
-  assert(hm);
-
   PHG4Particle *primary = get_truth_particle();
   if (!primary)
     return Fun4AllReturnCodes::DISCARDEVENT;
@@ -532,13 +568,13 @@ int QAG4SimulationEicCalorimeterSum::process_event_Cluster(PHCompositeNode *topN
 
   if (cluster_cemc_e + cluster_hcalin_e > 0)
   {
-    TH2F *h2 = dynamic_cast<TH2F *>(hm->getHisto(
-        (get_histo_prefix()) + "Cluster_" + _calo_name_cemc + "_" + _calo_name_hcalin));
+    const QAHistFactory::Map2D h2 = QAHistFactory::GetMap2D(*m_Histos,
+                                                            (get_histo_prefix()) + "Cluster_" + _calo_name_cemc + "_" + _calo_name_hcalin);
     assert(h2);
 
-    h2->Fill(cluster_cemc_e, cluster_hcalin_e);
+    h2.Fill(cluster_cemc_e, cluster_hcalin_e);
 
-    TH1F *hr = dynamic_cast<TH1F *>(hm->getHisto(
+    TH1F *hr = dynamic_cast<TH1F *>(m_Histos->Get(
         (get_histo_prefix()) + "Cluster_Ratio_" + _calo_name_cemc + "_" + _calo_name_hcalin));
     assert(hr);
 
@@ -557,20 +593,20 @@ int QAG4SimulationEicCalorimeterSum::process_event_Cluster(PHCompositeNode *topN
            << endl;
     }
 
-    TH2F *h2 = dynamic_cast<TH2F *>(hm->getHisto(
-        (get_histo_prefix()) + "Cluster_" + _calo_name_cemc + "_" + _calo_name_hcalin + "_" + _calo_name_hcalout));
+    const QAHistFactory::Map2D h2 = QAHistFactory::GetMap2D(*m_Histos,
+                                                            (get_histo_prefix()) + "Cluster_" + _calo_name_cemc + "_" + _calo_name_hcalin + "_" + _calo_name_hcalout);
     assert(h2);
 
-    h2->Fill((cluster_cemc_e + cluster_hcalin_e), cluster_hcalout_e);
+    h2.Fill((cluster_cemc_e + cluster_hcalin_e), cluster_hcalout_e);
 
-    TH1F *hr = dynamic_cast<TH1F *>(hm->getHisto(
+    TH1F *hr = dynamic_cast<TH1F *>(m_Histos->Get(
         (get_histo_prefix()) + "Cluster_Ratio_" + _calo_name_cemc + "_" + _calo_name_hcalin + "_" + _calo_name_hcalout));
     assert(hr);
 
     hr->Fill(
         (cluster_cemc_e + cluster_hcalin_e) / (cluster_cemc_e + cluster_hcalin_e + cluster_hcalout_e));
 
-    TH1F *hsum = dynamic_cast<TH1F *>(hm->getHisto(
+    TH1F *hsum = dynamic_cast<TH1F *>(m_Histos->Get(
         (get_histo_prefix()) + "Cluster_EP"));
     assert(hsum);
 
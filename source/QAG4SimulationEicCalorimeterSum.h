@@ -13,6 +13,8 @@ class PHG4Particle;
 class CaloEvalStack;
 class SvtxEvalStack;
 class SvtxTrack;
+class QAHistShards;
+class TruthReference;
 
 /// \class QAG4SimulationEicCalorimeterSum
 class QAG4SimulationEicCalorimeterSum : public SubsysReco
@@ -35,6 +37,9 @@ class QAG4SimulationEicCalorimeterSum : public SubsysReco
   int InitRun(PHCompositeNode *topNode);
   int process_event(PHCompositeNode *topNode);
 
+  //! merges the histograms filled by the worker threads
+  int End(PHCompositeNode *topNode);
+
   uint32_t
   get_flags() const
   {
@@ -69,6 +74,14 @@ class QAG4SimulationEicCalorimeterSum : public SubsysReco
   std::string
   get_histo_prefix();
 
+  //! QA histograms, worker threads fill the replica returned by get_histos()->Get(),
+  //! the 2D maps through QAHistFactory::GetMap2D()
+  std::shared_ptr<QAHistShards>
+  get_histos() const
+  {
+    return m_Histos;
+  }
+
   std::string
   get_calo_name_cemc() const
   {
@@ -126,6 +139,12 @@ class QAG4SimulationEicCalorimeterSum : public SubsysReco
   std::shared_ptr<CaloEvalStack> _caloevalstack_hcalin;
   std::shared_ptr<CaloEvalStack> _caloevalstack_hcalout;
   std::shared_ptr<SvtxEvalStack> _svtxevalstack;
+  std::shared_ptr<QAHistShards> m_Histos;
+
+  //! QAInstrumentation stages, -1 if not instrumented
+  int m_TimerEvent = -1;
+  int m_TimerCluster = -1;
+  int m_TimerTrackProj = -1;
 
   uint32_t _flags;
 
@@ -135,6 +154,7 @@ class QAG4SimulationEicCalorimeterSum : public SubsysReco
   std::string _calo_name_hcalout;
 
   PHG4TruthInfoContainer *_truth_container;
+  TruthReference *m_TruthReference = nullptr;
 
   //! fetch the truth particle to be analyzed. By default it is the last primary particle in truth container (therefore works in single particle embedding)
   PHG4Particle *
@@ -0,0 +1,436 @@
+#include "QAGoldenCompare.h"
+
+#include <TAxis.h>
+#include <TClass.h>
+#include <TFile.h>
+#include <TH1.h>
+#include <TKey.h>
+#include <TLeaf.h>
+#include <TList.h>
+#include <TObjArray.h>
+#include <TTree.h>
+
+#include <algorithm>
+#include <fnmatch.h>
+#include <iostream>  // for operator<<, endl, basic_ost...
+#include <map>
+#include <memory>
+#include <set>
+
+namespace
+{
+  bool Match(const std::string &pattern, const std::string &name)
+  {
+    return fnmatch(pattern.c_str(), name.c_str(), 0) == 0;
+  }
+
+  //! histogram read from the file, not owned by the file
+  TH1 *ReadHisto(TFile *f, const std::string &name)
+  {
+    TH1 *h = dynamic_cast<TH1 *>(f->Get(name.c_str()));
+    if (h)
+    {
+      h->SetDirectory(nullptr);
+    }
+    return h;
+  }
+
+  bool SameAxis(const TAxis *a, const TAxis *b)
+  {
+    if (a->GetNbins() != b->GetNbins() || a->GetXmin() != b->GetXmin() || a->GetXmax() != b->GetXmax())
+    {
+      return false;
+    }
+    for (int i = 1; i <= a->GetNbins(); i++)
+    {
+      if (a->GetBinLowEdge(i) != b->GetBinLowEdge(i))
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  //! per leaf state of the entry loop
+  struct LeafCompare
+  {
+    std::string name;
+    TLeaf *golden = nullptr;
+    TLeaf *candidate = nullptr;
+    QAGoldenCompare::Difference diff;
+  };
+}  // namespace
+
+//____________________________________________________________________________..
+void QAGoldenCompare::SetHistoFiles(const std::string &golden, const std::string &candidate)
+{
+  m_GoldenHistos = golden;
+  m_CandidateHistos = candidate;
+}
+
+//____________________________________________________________________________..
+void QAGoldenCompare::AddEvalFiles(const std::string &det, const std::string &golden, const std::string &candidate)
+{
+  EvalFiles files;
+  files.detector = det;
+  files.golden = golden;
+  files.candidate = candidate;
+  m_EvalFiles.push_back(files);
+}
+
+//____________________________________________________________________________..
+void QAGoldenCompare::AddPattern(const std::string &pattern)
+{
+  m_Patterns.push_back(pattern);
+}
+
+//____________________________________________________________________________..
+int QAGoldenCompare::Run()
+{
+  m_NCompared = 0;
+  m_Differences.clear();
+  if (!m_GoldenHistos.empty() && !m_CandidateHistos.empty())
+  {
+    if (CompareHistos())
+    {
+      return -1;
+    }
+  }
+  for (const auto &files : m_EvalFiles)
+  {
+    if (CompareEval(files))
+    {
+      return -1;
+    }
+  }
+  if (m_Verbosity > 0)
+  {
+    Print();
+  }
+  return m_Differences.size();
+}
+
+//____________________________________________________________________________..
+int QAGoldenCompare::CompareHistos()
+{
+  std::unique_ptr<TFile> fgolden(TFile::Open(m_GoldenHistos.c_str(), "READ"));
+  std::unique_ptr<TFile> fcandidate(TFile::Open(m_CandidateHistos.c_str(), "READ"));
+  if (!fgolden || fgolden->IsZombie() || !fcandidate || fcandidate->IsZombie())
+  {
+    std::cout << "QAGoldenCompare::CompareHistos - cannot open "
+              << ((!fgolden || fgolden->IsZombie()) ? m_GoldenHistos : m_CandidateHistos) << std::endl;
+    return -1;
+  }
+
+  std::set<std::string> names;
+  for (TFile *f : {fgolden.get(), fcandidate.get()})
+  {
+    TIter next(f->GetListOfKeys());
+    TKey *key = nullptr;
+    while ((key = static_cast<TKey *>(next())))
+    {
+      TClass *cl = TClass::GetClass(key->GetClassName());
+      if (cl && cl->InheritsFrom(TH1::Class()) && Selected(key->GetName()))
+      {
+        names.insert(key->GetName());
+      }
+    }
+  }
+
+  const bool status = TH1::AddDirectoryStatus();
+  TH1::AddDirectory(kFALSE);
+  for (const auto &name : names)
+  {
+    std::unique_ptr<TH1> hgolden(ReadHisto(fgolden.get(), name));
+    std::unique_ptr<TH1> hcandidate(ReadHisto(fcandidate.get(), name));
+    m_NCompared++;
+    CompareHisto(name, hgolden.get(), hcandidate.get());
+  }
+  TH1::AddDirectory(status);
+  return 0;
+}
+
+//____________________________________________________________________________..
+bool QAGoldenCompare::CompareHisto(const std::string &name, const TH1 *golden, const TH1 *candidate)
+{
+  Difference diff;
+  diff.object = name;
+  if (!golden || !candidate)
+  {
+    diff.what = golden ? "missing" : "extra";
+    m_Differences.push_back(diff);
+    return true;
+  }
+  if (std::string(golden->ClassName()) != candidate->ClassName())
+  {
+    diff.what = "class";
+    m_Differences.push_back(diff);
+    return true;
+  }
+  if (golden->GetDimension() != candidate->GetDimension() || golden->GetNcells() != candidate->GetNcells() ||
+      !SameAxis(golden->GetXaxis(), candidate->GetXaxis()) || !SameAxis(golden->GetYaxis(), candidate->GetYaxis()) ||
+      !SameAxis(golden->GetZaxis(), candidate->GetZaxis()))
+  {
+    diff.what = "binning";
+    diff.golden = golden->GetNcells();
+    diff.candidate = candidate->GetNcells();
+    m_Differences.push_back(diff);
+    return true;
+  }
+
+  // under- and overflow included
+  for (int bin = 0; bin < golden->GetNcells(); bin++)
+  {
+    const double content_golden = golden->GetBinContent(bin);
+    const double content_candidate = candidate->GetBinContent(bin);
+    const double error_golden = golden->GetBinError(bin);
+    const double error_candidate = candidate->GetBinError(bin);
+    const bool content = Differs(name, content_golden, content_candidate);
+    if (!content && !Differs(name, error_golden, error_candidate))
+    {
+      continue;
+    }
+    if (diff.ndiff++ == 0)
+    {
+      diff.what = content ? "content" : "error";
+      diff.index = bin;
+      diff.golden = content ? content_golden : error_golden;
+      diff.candidate = content ? content_candidate : error_candidate;
+    }
+  }
+  if (diff.ndiff == 0 && Differs(name, golden->GetEntries(), candidate->GetEntries()))
+  {
+    diff.what = "entries";
+    diff.golden = golden->GetEntries();
+    diff.candidate = candidate->GetEntries();
+    diff.ndiff = 1;
+  }
+  if (diff.ndiff == 0)
+  {
+    return false;
+  }
+  m_Differences.push_back(diff);
+  return true;
+}
+
+//____________________________________________________________________________..
+int QAGoldenCompare::CompareEval(const EvalFiles &files)
+{
+  std::unique_ptr<TFile> fgolden(TFile::Open(files.golden.c_str(), "READ"));
+  std::unique_ptr<TFile> fcandidate(TFile::Open(files.candidate.c_str(), "READ"));
+  TTree *tgolden = nullptr;
+  TTree *tcandidate = nullptr;
+  if (fgolden && !fgolden->IsZombie())
+  {
+    fgolden->GetObject("T", tgolden);
+  }
+  if (fcandidate && !fcandidate->IsZombie())
+  {
+    fcandidate->GetObject("T", tcandidate);
+  }
+  if (!tgolden || !tcandidate)
+  {
+    std::cout << "QAGoldenCompare::CompareEval - cannot read the Eval tree T of " << files.detector
+              << " from " << (tgolden ? files.candidate : files.golden) << std::endl;
+    return -1;
+  }
+
+  const std::string prefix = files.detector + ":";
+  std::map<std::string, TLeaf *> candidate_leaves;
+  for (TObject *obj : *tcandidate->GetListOfLeaves())
+  {
+    TLeaf *leaf = static_cast<TLeaf *>(obj);
+    candidate_leaves[leaf->GetFullName().Data()] = leaf;
+  }
+  std::vector<LeafCompare> leaves;
+  for (TObject *obj : *tgolden->GetListOfLeaves())
+  {
+    TLeaf *leaf = static_cast<TLeaf *>(obj);
+    LeafCompare lc;
+    lc.name = leaf->GetFullName().Data();
+    lc.golden = leaf;
+    lc.diff.object = prefix + lc.name;
+    auto iter = candidate_leaves.find(lc.name);
+    m_NCompared++;
+    if (iter == candidate_leaves.end())
+    {
+      lc.diff.what = "missing";
+      m_Differences.push_back(lc.diff);
+      continue;
+    }
+    lc.candidate = iter->second;
+    candidate_leaves.erase(iter);
+    leaves.push_back(lc);
+  }
+  for (const auto &extra : candidate_leaves)
+  {
+    Difference diff;
+    diff.object = prefix + extra.first;
+    diff.what = "extra";
+    m_NCompared++;
+    m_Differences.push_back(diff);
+  }
+
+  // event and job number of the golden entry, for the report
+  const std::string branch = "DST#EvalTTree_" + files.detector;
+  TLeaf *event_leaf = tgolden->FindLeaf((branch + ".event").c_str());
+  TLeaf *job_leaf = tgolden->FindLeaf((branch + ".job").c_str());
+
+  const long long nentries = std::min(tgolden->GetEntries(), tcandidate->GetEntries());
+  if (tgolden->GetEntries() != tcandidate->GetEntries())
+  {
+    Difference diff;
+    diff.object = prefix + "T";
+    diff.what = "entries";
+    diff.entry = nentries;
+    diff.golden = tgolden->GetEntries();
+    diff.candidate = tcandidate->GetEntries();
+    diff.ndiff = 1;
+    m_Differences.push_back(diff);
+  }
+  for (long long i = 0; i < nentries; i++)
+  {
+    tgolden->GetEntry(i);
+    tcandidate->GetEntry(i);
+    for (auto &lc : leaves)
+    {
+      const int len = lc.golden->GetLen();
+      const int len_candidate = lc.candidate->GetLen();
+      int index = -1;
+      double golden = len;
+      double candidate = len_candidate;
+      if (len == len_candidate)
+      {
+        for (int j = 0; j < len; j++)
+        {
+          golden = lc.golden->GetValue(j);
+          candidate = lc.candidate->GetValue(j);
+          if (Differs(lc.diff.object, golden, candidate))
+          {
+            index = j;
+            break;
+          }
+        }
+        if (index < 0)
+        {
+          continue;
+        }
+      }
+      if (lc.diff.ndiff++ > 0)
+      {
+        continue;
+      }
+      lc.diff.what = (index < 0) ? "length" : "value";
+      lc.diff.entry = i;
+      lc.diff.index = index;
+      lc.diff.golden = golden;
+      lc.diff.candidate = candidate;
+      lc.diff.event = event_leaf ? event_leaf->GetValue() : -1;
+      lc.diff.job = job_leaf ? job_leaf->GetValue() : -1;
+    }
+  }
+  for (const auto &lc : leaves)
+  {
+    if (lc.diff.ndiff > 0)
+    {
+      m_Differences.push_back(lc.diff);
+    }
+  }
+  return 0;
+}
+
+//____________________________________________________________________________..
+bool QAGoldenCompare::Differs(const std::string &name, const double golden, const double candidate) const
+{
+  if (golden == candidate || (std::isnan(golden) && std::isnan(candidate)))
+  {
+    return false;
+  }
+  const Tolerance &t = GetTolerance(name);
+  return !(std::fabs(golden - candidate) <= t.abs + t.rel * std::max(std::fabs(golden), std::fabs(candidate)));
+}
+
+//____________________________________________________________________________..
+const QAGoldenCompare::Tolerance &QAGoldenCompare::GetTolerance(const std::string &name) const
+{
+  for (const auto &t : m_Tolerances)
+  {
+    if (Match(t.first, name))
+    {
+      return t.second;
+    }
+  }
+  return m_Default;
+}
+
+//____________________________________________________________________________..
+bool QAGoldenCompare::Selected(const std::string &name) const
+{
+  if (m_Patterns.empty())
+  {
+    return Match("h_QAG4Sim_*", name);
+  }
+  for (const auto &pattern : m_Patterns)
+  {
+    if (Match(pattern, name))
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+//____________________________________________________________________________..
+long long QAGoldenCompare::FirstDifferingEntry() const
+{
+  long long first = -1;
+  for (const auto &diff : m_Differences)
+  {
+    if (diff.entry >= 0 && (first < 0 || diff.entry < first))
+    {
+      first = diff.entry;
+    }
+  }
+  return first;
+}
+
+//____________________________________________________________________________..
+void QAGoldenCompare::Print(const std::string &what) const
+{
+  std::cout << "QAGoldenCompare: " << m_NCompared << " histograms and leaves compared, "
+            << m_Differences.size() << " differ" << std::endl;
+  if (what != "ALL")
+  {
+    return;
+  }
+  const long long first = FirstDifferingEntry();
+  for (const auto &diff : m_Differences)
+  {
+    std::cout << "  " << diff.object << ": " << diff.what;
+    if (diff.entry >= 0)
+    {
+      std::cout << " at entry " << diff.entry;
+      if (diff.event >= 0)
+      {
+        std::cout << " (event " << diff.event << ", job " << diff.job << ")";
+      }
+    }
+    if (diff.index >= 0)
+    {
+      std::cout << ((diff.what == "content" || diff.what == "error") ? " bin " : " index ") << diff.index;
+    }
+    if (!std::isnan(diff.golden) || !std::isnan(diff.candidate))
+    {
+      std::cout << ", golden " << diff.golden << " candidate " << diff.candidate;
+    }
+    if (diff.ndiff > 1)
+    {
+      std::cout << ", " << diff.ndiff << ((diff.entry >= 0) ? " entries" : " bins") << " differ";
+    }
+    std::cout << std::endl;
+  }
+  if (first >= 0)
+  {
+    std::cout << "  first differing entry of the Eval trees: " << first << std::endl;
+  }
+}
@@ -0,0 +1,110 @@
+// Tell emacs that this is a C++ source
+//  -*- C++ -*-.
+#ifndef QAGOLDENCOMPARE_H
+#define QAGOLDENCOMPARE_H
+
+#include <cmath>
+#include <string>
+#include <utility>
+#include <vector>
+
+class TH1;
+class TTree;
+
+//! Bin by bin and entry by entry comparison of a candidate output to a golden one
+/*!
+ * Before an optimized code path replaces the current one, both are run on the
+ * same events (the same DST, or qabenchmark -w with the same seed) and their
+ * outputs are compared here. Unlike QARegressionGate, which tests whether two
+ * samples are statistically compatible, this requires the same numbers:
+ *  - every QA histogram (h_QAG4Sim_* by default): class, binning, entries and
+ *    the content and error of every bin,
+ *  - every leaf of the Eval trees, including the hits, towers and clusters, for
+ *    every entry; for a tree the first differing entry and its event number
+ *    are reported.
+ * A value differs if |golden - candidate| > abs + rel * max(|golden|, |candidate|),
+ * by default exact. Run() returns the number of differing histograms and leaves.
+ */
+class QAGoldenCompare
+{
+ public:
+  struct Tolerance
+  {
+    double abs = 0;
+    double rel = 0;
+  };
+
+  //! first difference of a histogram or a leaf of an Eval tree
+  struct Difference
+  {
+    std::string object;  // histogram or detector:leaf
+    std::string what;    // content, error, entries, binning, class, length, value, missing, extra
+    long long entry = -1;  // tree entry
+    int event = -1;        // event and job number of this entry
+    int job = -1;
+    int index = -1;  // global bin or array index
+    double golden = NAN;
+    double candidate = NAN;
+    long long ndiff = 0;  // number of differing bins or entries
+  };
+
+  QAGoldenCompare() {}
+
+  virtual ~QAGoldenCompare() {}
+
+  //! QA histogram files, either may be empty to compare the Eval trees only
+  void SetHistoFiles(const std::string &golden, const std::string &candidate);
+
+  //! Eval tree files of a detector
+  void AddEvalFiles(const std::string &det, const std::string &golden, const std::string &candidate);
+
+  //! histograms to compare, '*' matches any part of the name; replaces the default h_QAG4Sim_*
+  void AddPattern(const std::string &pattern);
+
+  void SetTolerance(const Tolerance &t) { m_Default = t; }
+
+  //! tolerance of the histograms or leaves (detector:leaf) matching pattern, the first matching pattern is used
+  void SetTolerance(const std::string &pattern, const Tolerance &t) { m_Tolerances.push_back(std::make_pair(pattern, t)); }
+
+  void Verbosity(const int i) { m_Verbosity = i; }
+
+  //! returns the number of differing histograms and leaves, -1 if a file cannot be read
+  int Run();
+
+  const std::vector<Difference> &Differences() const { return m_Differences; }
+
+  //! first tree entry with a difference in any leaf of any detector, -1 if none
+  long long FirstDifferingEntry() const;
+
+  void Print(const std::string &what = "ALL") const;
+
+ private:
+  struct EvalFiles
+  {
+    std::string detector;
+    std::string golden;
+    std::string candidate;
+  };
+
+  int CompareHistos();
+  int CompareEval(const EvalFiles &files);
+  bool CompareHisto(const std::string &name, const TH1 *golden, const TH1 *candidate);
+  bool Differs(const std::string &name, const double golden, const double candidate) const;
+  const Tolerance &GetTolerance(const std::string &name) const;
+  bool Selected(const std::string &name) const;
+
+  int m_Verbosity = 0;
+
+  std::string m_GoldenHistos;
+  std::string m_CandidateHistos;
+  std::vector<EvalFiles> m_EvalFiles;
+
+  std::vector<std::string> m_Patterns;
+  Tolerance m_Default;
+  std::vector<std::pair<std::string, Tolerance>> m_Tolerances;
+
+  int m_NCompared = 0;
+  std::vector<Difference> m_Differences;
+};
+
+#endif  // QAGOLDENCOMPARE_H
@@ -0,0 +1,287 @@
+#include "QAHistFactory.h"
+
+#include "CaloResponseSketch.h"
+#include "QAHistShards.h"
+
+#include <qa_modules/QAHistManagerDef.h>
+
+#include <fun4all/Fun4AllHistoManager.h>
+
+#include <TArrayC.h>
+#include <TArrayD.h>
+#include <TArrayF.h>
+#include <TArrayI.h>
+#include <TArrayS.h>
+#include <TAxis.h>
+#include <TH1.h>
+#include <TH2.h>
+#include <THnSparse.h>
+
+#include <cassert>
+#include <cmath>
+#include <fnmatch.h>
+#include <iomanip>
+#include <iostream>  // for operator<<, endl, basic_ost...
+
+namespace
+{
+  TH2 *NewTH2(const char content, const std::string &name, const std::string &title, const int nx, const double xmin, const double xmax, const int ny, const double ymin, const double ymax)
+  {
+    switch (content)
+    {
+    case 'D':
+      return new TH2D(name.c_str(), title.c_str(), nx, xmin, xmax, ny, ymin, ymax);
+    case 'I':
+      return new TH2I(name.c_str(), title.c_str(), nx, xmin, xmax, ny, ymin, ymax);
+    case 'S':
+      return new TH2S(name.c_str(), title.c_str(), nx, xmin, xmax, ny, ymin, ymax);
+    default:
+      return new TH2F(name.c_str(), title.c_str(), nx, xmin, xmax, ny, ymin, ymax);
+    }
+  }
+
+  THnSparse *NewSparse(const char content, const std::string &name, const std::string &title, const int nx, const double xmin, const double xmax, const int ny, const double ymin, const double ymax)
+  {
+    const int nbins[2] = {nx, ny};
+    const double min[2] = {xmin, ymin};
+    const double max[2] = {xmax, ymax};
+    switch (content)
+    {
+    case 'D':
+      return new THnSparseD(name.c_str(), title.c_str(), 2, nbins, min, max);
+    case 'I':
+      return new THnSparseI(name.c_str(), title.c_str(), 2, nbins, min, max);
+    case 'S':
+      return new THnSparseS(name.c_str(), title.c_str(), 2, nbins, min, max);
+    default:
+      return new THnSparseF(name.c_str(), title.c_str(), 2, nbins, min, max);
+    }
+  }
+
+  //! bytes per bin content
+  int ElementSize(const TObject *h)
+  {
+    if (dynamic_cast<const TArrayD *>(h) || dynamic_cast<const THnSparseD *>(h))
+    {
+      return sizeof(double);
+    }
+    if (dynamic_cast<const TArrayF *>(h) || dynamic_cast<const THnSparseF *>(h))
+    {
+      return sizeof(float);
+    }
+    if (dynamic_cast<const TArrayI *>(h) || dynamic_cast<const THnSparseI *>(h))
+    {
+      return sizeof(int);
+    }
+    if (dynamic_cast<const TArrayS *>(h) || dynamic_cast<const THnSparseS *>(h))
+    {
+      return sizeof(short);
+    }
+    if (dynamic_cast<const TArrayC *>(h) || dynamic_cast<const THnSparseC *>(h))
+    {
+      return sizeof(char);
+    }
+    return sizeof(double);
+  }
+}  // namespace
+
+//____________________________________________________________________________..
+void QAHistFactory::Map2D::Fill(const double x, const double y, const double w) const
+{
+  if (dense)
+  {
+    dense->Fill(x, y, w);
+    return;
+  }
+  const double v[2] = {x, y};
+  sparse->Fill(v, w);
+}
+
+//____________________________________________________________________________..
+QAHistFactory::QAHistFactory(const std::shared_ptr<QAHistShards> &shards)
+  : m_Shards(shards)
+{
+}
+
+//____________________________________________________________________________..
+QAHistFactory::~QAHistFactory()
+{
+}
+
+//____________________________________________________________________________..
+const QAHistFactory::Layout &QAHistFactory::GetLayout(const std::string &name) const
+{
+  for (auto iter = m_Layouts.rbegin(); iter != m_Layouts.rend(); ++iter)
+  {
+    if (fnmatch(iter->first.c_str(), name.c_str(), 0) == 0)
+    {
+      return iter->second;
+    }
+  }
+  return m_Default;
+}
+
+//____________________________________________________________________________..
+TH2 *QAHistFactory::MakeTH2(const std::string &name, const std::string &title, const int nx, const double xmin, const double xmax, const int ny, const double ymin, const double ymax)
+{
+  const Layout &layout = GetLayout(name);
+  if (layout.storage == kDense)
+  {
+    TH2 *h = NewTH2(layout.content, name, title, nx, xmin, xmax, ny, ymin, ymax);
+    if (!layout.errors)
+    {
+      // weighted fills do not create the sum of squared weights
+      h->SetBit(TH1::kIsNotW);
+    }
+    // the threads fill sparse replicas, only the registered map is dense
+    m_Shards->Register(h, true);
+    return h;
+  }
+
+  // the registered histogram keeps name, title and axis range, the bins are
+  // only allocated by Finish(); the threads fill replicas of the sparse map
+  TH2 *h = NewTH2(layout.content, name, title, 1, xmin, xmax, 1, ymin, ymax);
+  Fun4AllHistoManager *hm = QAHistManagerDef::getHistoManager();
+  assert(hm);
+  hm->registerHisto(h);
+
+  SparseMap map;
+  map.registered = h;
+  map.sparse.reset(NewSparse(layout.content, name, title, nx, xmin, xmax, ny, ymin, ymax));
+  if (layout.errors)
+  {
+    map.sparse->Sumw2();
+  }
+  map.nx = nx;
+  map.xmin = xmin;
+  map.xmax = xmax;
+  map.ny = ny;
+  map.ymin = ymin;
+  map.ymax = ymax;
+  map.errors = layout.errors;
+  m_Shards->Book(map.sparse.get());
+  m_SparseMaps.push_back(std::move(map));
+  return h;
+}
+
+//____________________________________________________________________________..
+QAHistFactory::Map2D QAHistFactory::GetMap2D(const std::string &name) const
+{
+  return GetMap2D(*m_Shards, name);
+}
+
+//____________________________________________________________________________..
+QAHistFactory::Map2D QAHistFactory::GetMap2D(QAHistShards &shards, const std::string &name)
+{
+  Map2D map;
+  const int index = shards.Index(name);
+  if (index < 0)
+  {
+    return map;
+  }
+  map.sparse = shards.GetSparse(index);
+  if (!map.sparse)
+  {
+    map.dense = dynamic_cast<TH2 *>(shards.Get(index));
+  }
+  return map;
+}
+
+//____________________________________________________________________________..
+std::vector<THnBase *> QAHistFactory::SparseMaps() const
+{
+  std::vector<THnBase *> maps;
+  for (const auto &map : m_SparseMaps)
+  {
+    maps.push_back(map.sparse.get());
+  }
+  return maps;
+}
+
+//____________________________________________________________________________..
+int QAHistFactory::Finish()
+{
+  for (auto &map : m_SparseMaps)
+  {
+    if (!map.sparse)
+    {
+      continue;
+    }
+    TH2 *h = map.registered;
+    const THnSparse *sparse = map.sparse.get();
+    // the first call allocates the bins
+    if (h->GetNbinsX() != map.nx || h->GetNbinsY() != map.ny)
+    {
+      h->SetBins(map.nx, map.xmin, map.xmax, map.ny, map.ymin, map.ymax);
+      h->SetEntries(0);
+      if (map.errors)
+      {
+        h->Sumw2();
+      }
+    }
+    QAHistShards::AddSparse(h, sparse);
+    if (m_Verbosity > 0)
+    {
+      std::cout << "QAHistFactory::Finish - " << h->GetName() << ": " << sparse->GetNbins() << " filled bins" << std::endl;
+    }
+    map.sparse->Reset();
+  }
+  return 0;
+}
+
+//____________________________________________________________________________..
+double QAHistFactory::MemoryUsage(const TObject *h)
+{
+  if (const TH1 *h1 = dynamic_cast<const TH1 *>(h))
+  {
+    const TArray *array = dynamic_cast<const TArray *>(h1);
+    double size = array ? static_cast<double>(array->GetSize()) * ElementSize(h1) : 0;
+    return size + h1->GetSumw2N() * sizeof(double);
+  }
+  if (const THnSparse *hs = dynamic_cast<const THnSparse *>(h))
+  {
+    if (hs->GetNbins() == 0)
+    {
+      return 0;
+    }
+    // GetSparseFractionMem() is relative to a dense array with the same bins
+    double ncells = 1;
+    for (int d = 0; d < hs->GetNdimensions(); d++)
+    {
+      ncells *= hs->GetAxis(d)->GetNbins() + 2;
+    }
+    return hs->GetSparseFractionMem() * ncells * ElementSize(hs);
+  }
+  if (const CaloResponseSketch *sketch = dynamic_cast<const CaloResponseSketch *>(h))
+  {
+    return sketch->NRetained() * sizeof(double);
+  }
+  return 0;
+}
+
+//____________________________________________________________________________..
+void QAHistFactory::Print(const std::string &what) const
+{
+  std::cout << "QAHistFactory " << m_Shards->Name() << ": " << m_SparseMaps.size() << " sparse maps" << std::endl;
+  if (what == "ALL" || what == "MEMORY")
+  {
+    double total = 0;
+    for (size_t i = 0; i < m_Shards->NBooked(); i++)
+    {
+      const TNamed *h = m_Shards->GetBooked(i);
+      const double size = MemoryUsage(h);
+      const int nreplicas = m_Shards->NReplicas(i);
+      // replicas of dense histograms have the size of the booked one, sparse ones are merged and empty
+      const double replicas = (dynamic_cast<const TH1 *>(h) && !m_Shards->SparseReplicas(i)) ? nreplicas * size : 0;
+      total += size + replicas;
+      std::cout << "  " << std::setw(60) << std::left << h->GetName() << std::right << " " << std::setw(12) << h->ClassName()
+                << std::setw(10) << std::lround(size / 1024.) << " kB";
+      if (nreplicas > 0)
+      {
+        std::cout << " + " << nreplicas << " replicas " << std::lround(replicas / 1024.) << " kB";
+      }
+      std::cout << std::endl;
+    }
+    std::cout << "  total " << std::lround(total / 1024.) << " kB" << std::endl;
+  }
+}
@@ -0,0 +1,121 @@
+// Tell emacs that this is a C++ source
+//  -*- C++ -*-.
+#ifndef QAHISTFACTORY_H
+#define QAHISTFACTORY_H
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+class QAHistShards;
+class TH1;
+class TH2;
+class THnBase;
+class THnSparse;
+class TObject;
+
+//! Books the large QA maps with a storage layout chosen per histogram name
+/*!
+ * Maps like the 1200x1200 G4Hit_XY histogram are mostly empty and carry
+ * 8 bytes of sum of squared weights per bin on top of the content as soon as
+ * they are filled with a weight. Per name pattern the layout can be changed:
+ *  - sparse storage: the map is filled as a THnSparse which only stores the
+ *    filled bins, Finish() expands it into the registered TH2 at End() of the
+ *    job, so the output file and the draw macros see the same TH2F; until
+ *    then QACheckpoint writes and resumes the THnSparse (SparseMaps()),
+ *  - the content type (F, D, I or S; S only for counts below 32767 per bin),
+ *  - no errors: the sum of squared weights is not kept, the bin errors are
+ *    sqrt(content). Fine for maps which are only drawn.
+ * The maps are booked with a QAHistShards. The booking thread fills the
+ * registered TH2 (or the THnSparse), all other threads fill sparse replicas,
+ * also of the dense maps, so a map is held densely once. Print("MEMORY")
+ * lists the approximate memory of every histogram booked with the shards and
+ * of its replicas.
+ */
+class QAHistFactory
+{
+ public:
+  enum Storage
+  {
+    kDense,
+    kSparse
+  };
+
+  struct Layout
+  {
+    Storage storage = kDense;
+    char content = 'F';  // F, D, I or S
+    bool errors = true;
+  };
+
+  //! 2D map of the calling thread, dense or sparse
+  struct Map2D
+  {
+    TH2 *dense = nullptr;
+    THnBase *sparse = nullptr;
+
+    void Fill(const double x, const double y, const double w = 1) const;
+
+    explicit operator bool() const { return dense || sparse; }
+  };
+
+  QAHistFactory(const std::shared_ptr<QAHistShards> &shards);
+
+  virtual ~QAHistFactory();
+
+  //! layout of the histograms matching pattern, '*' matches any part of the
+  //! name; the pattern set last wins, the default is dense TH2F with errors
+  void SetLayout(const std::string &pattern, const Layout &layout) { m_Layouts.push_back(std::make_pair(pattern, layout)); }
+
+  const Layout &GetLayout(const std::string &name) const;
+
+  //! books (and registers with the QA histogram manager) a 2D map, returns the
+  //! registered histogram; a sparse map has a single bin until Finish()
+  TH2 *MakeTH2(const std::string &name, const std::string &title, const int nx, const double xmin, const double xmax, const int ny, const double ymin, const double ymax);
+
+  //! replica of the calling thread, empty if name was not booked here
+  Map2D GetMap2D(const std::string &name) const;
+
+  //! same for a TH2 booked directly with shards (QAHistShards::Register(h, true))
+  static Map2D GetMap2D(QAHistShards &shards, const std::string &name);
+
+  //! the sparse maps, written by QACheckpoint instead of expanding them
+  std::vector<THnBase *> SparseMaps() const;
+
+  //! after QAHistShards::Merge() at End(): adds the sparse maps to the registered
+  //! histograms and resets them
+  int Finish();
+
+  //! approximate memory of the bins of a TH1 or THnSparse in bytes
+  static double MemoryUsage(const TObject *h);
+
+  void Verbosity(const int i) { m_Verbosity = i; }
+
+  void Print(const std::string &what = "ALL") const;
+
+ private:
+  struct SparseMap
+  {
+    TH2 *registered = nullptr;
+    std::unique_ptr<THnSparse> sparse;
+    int nx = 0;
+    double xmin = 0;
+    double xmax = 0;
+    int ny = 0;
+    double ymin = 0;
+    double ymax = 0;
+    bool errors = true;
+  };
+
+  int m_Verbosity = 0;
+
+  std::shared_ptr<QAHistShards> m_Shards;
+
+  Layout m_Default;
+  std::vector<std::pair<std::string, Layout>> m_Layouts;
+
+  std::vector<SparseMap> m_SparseMaps;
+};
+
+#endif  // QAHISTFACTORY_H
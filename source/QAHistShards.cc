@@ -0,0 +1,378 @@
+#include "QAHistShards.h"
+
+#include "CaloResponseSketch.h"
+
+#include <qa_modules/QAHistManagerDef.h>
+
+#include <fun4all/Fun4AllHistoManager.h>
+
+#include <TArrayD.h>
+#include <TAxis.h>
+#include <TH1.h>
+#include <THnBase.h>
+#include <THnSparse.h>
+#include <TNamed.h>
+
+#include <cassert>
+#include <cmath>
+#include <iostream>  // for operator<<, endl, basic_ost...
+#include <set>
+
+namespace
+{
+  //! slots given back by threads which exited, reused lowest first
+  std::mutex s_SlotMutex;
+  std::set<unsigned int> s_FreeSlots;
+  unsigned int s_NextSlot = 0;
+
+  unsigned int AcquireSlot()
+  {
+    std::lock_guard<std::mutex> lock(s_SlotMutex);
+    if (s_FreeSlots.empty())
+    {
+      return s_NextSlot++;
+    }
+    const unsigned int slot = *s_FreeSlots.begin();
+    s_FreeSlots.erase(s_FreeSlots.begin());
+    return slot;
+  }
+
+  void ReleaseSlot(const unsigned int slot)
+  {
+    std::lock_guard<std::mutex> lock(s_SlotMutex);
+    s_FreeSlots.insert(slot);
+  }
+
+  //! slot of the thread, -1 until it is assigned; a slot taken from the pool
+  //! goes back when the thread exits, its replicas are kept for the next owner
+  struct ThreadSlot
+  {
+    int slot = -1;
+    bool bound = false;  // set by BindSlot()
+
+    ~ThreadSlot()
+    {
+      if (slot >= 0 && !bound)
+      {
+        ReleaseSlot(slot);
+      }
+    }
+  };
+
+  thread_local ThreadSlot s_Slot;
+
+  //! empty THnSparse with the binning of h, with errors unless h is filled without
+  THnSparse *EmptySparse(const TH1 *h)
+  {
+    const TAxis *axes[3] = {h->GetXaxis(), h->GetYaxis(), h->GetZaxis()};
+    const int dim = h->GetDimension();
+    int nbins[3];
+    double min[3];
+    double max[3];
+    for (int i = 0; i < dim; i++)
+    {
+      nbins[i] = axes[i]->GetNbins();
+      min[i] = axes[i]->GetXmin();
+      max[i] = axes[i]->GetXmax();
+    }
+    THnSparse *hn = nullptr;
+    if (dynamic_cast<const TArrayD *>(h))
+    {
+      hn = new THnSparseD(h->GetName(), h->GetTitle(), dim, nbins, min, max);
+    }
+    else
+    {
+      hn = new THnSparseF(h->GetName(), h->GetTitle(), dim, nbins, min, max);
+    }
+    for (int i = 0; i < dim; i++)
+    {
+      if (axes[i]->GetXbins()->GetSize() > 0)
+      {
+        hn->GetAxis(i)->Set(nbins[i], axes[i]->GetXbins()->GetArray());
+      }
+    }
+    if (!h->TestBit(TH1::kIsNotW))
+    {
+      hn->Sumw2();
+    }
+    return hn;
+  }
+}  // namespace
+
+//____________________________________________________________________________..
+QAHistShards::QAHistShards(const std::string &name)
+  : m_Name(name)
+  , m_Slots(kMaxSlots)
+{
+}
+
+//____________________________________________________________________________..
+QAHistShards::~QAHistShards()
+{
+  // the booked histograms belong to the histogram manager, only the replicas are ours
+}
+
+//____________________________________________________________________________..
+TH1 *QAHistShards::Register(TH1 *h, const bool sparsereplicas)
+{
+  Fun4AllHistoManager *hm = QAHistManagerDef::getHistoManager();
+  assert(hm);
+  hm->registerHisto(h);
+  Book(h, sparsereplicas);
+  return h;
+}
+
+//____________________________________________________________________________..
+int QAHistShards::Book(TNamed *h, const bool sparsereplicas)
+{
+  if (!h)
+  {
+    std::cout << "QAHistShards::Book - " << m_Name << ": no histogram given" << std::endl;
+    return -1;
+  }
+  auto iter = m_Index.find(h->GetName());
+  if (iter != m_Index.end())
+  {
+    std::cout << "QAHistShards::Book - " << m_Name << ": " << h->GetName() << " is already booked" << std::endl;
+    return iter->second;
+  }
+  // the booking thread fills the booked histograms, see GetObject()
+  m_Owner = std::this_thread::get_id();
+  // template of the replicas, booked histograms are still empty here
+  const TH1 *h1 = dynamic_cast<const TH1 *>(h);
+  TNamed *tmpl = (sparsereplicas && h1) ? EmptySparse(h1) : static_cast<TNamed *>(h->Clone());
+  if (TH1 *t1 = dynamic_cast<TH1 *>(tmpl))
+  {
+    t1->SetDirectory(nullptr);
+    t1->Reset();
+  }
+  else if (THnBase *tn = dynamic_cast<THnBase *>(tmpl))
+  {
+    tn->Reset();
+  }
+  else if (CaloResponseSketch *sketch = dynamic_cast<CaloResponseSketch *>(tmpl))
+  {
+    sketch->Reset();
+  }
+  m_Histos.push_back(h);
+  m_SparseReplicas.push_back(sparsereplicas && h1);
+  m_Templates.emplace_back(tmpl);
+  m_Index[h->GetName()] = m_Histos.size() - 1;
+  return m_Histos.size() - 1;
+}
+
+//____________________________________________________________________________..
+int QAHistShards::Index(const std::string &name) const
+{
+  auto iter = m_Index.find(name);
+  return (iter == m_Index.end()) ? -1 : iter->second;
+}
+
+//____________________________________________________________________________..
+TH1 *QAHistShards::Get(const int index)
+{
+  return dynamic_cast<TH1 *>(GetObject(index));
+}
+
+//____________________________________________________________________________..
+THnBase *QAHistShards::GetSparse(const int index)
+{
+  return dynamic_cast<THnBase *>(GetObject(index));
+}
+
+//____________________________________________________________________________..
+TNamed *QAHistShards::GetObject(const int index)
+{
+  if (index < 0 || index >= static_cast<int>(m_Histos.size()))
+  {
+    return nullptr;
+  }
+  // no replica for the booking thread (serial running), unless it bound a slot
+  // for a reproducible merge
+  if (!s_Slot.bound && std::this_thread::get_id() == m_Owner)
+  {
+    return m_Histos[index];
+  }
+  const unsigned int slot = Slot();
+  if (slot >= kMaxSlots)
+  {
+    std::cout << "QAHistShards::Get - " << m_Name << ": slot " << slot << " out of range, at most "
+              << kMaxSlots << " threads can fill at the same time" << std::endl;
+    return nullptr;
+  }
+  // only this thread touches its slot, the lock is needed for creating the replica only
+  const Replicas *replicas = m_Slots[slot].get();
+  if (replicas && index < static_cast<int>(replicas->size()) && (*replicas)[index])
+  {
+    return (*replicas)[index].get();
+  }
+  return CreateReplica(slot, index);
+}
+
+//____________________________________________________________________________..
+TNamed *QAHistShards::CreateReplica(const unsigned int slot, const int index)
+{
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  if (!m_Slots[slot])
+  {
+    m_Slots[slot].reset(new Replicas());
+  }
+  Replicas &replicas = *m_Slots[slot];
+  if (index >= static_cast<int>(replicas.size()))
+  {
+    replicas.resize(m_Histos.size());
+  }
+  // the booked histogram may be filled by the booking thread right now,
+  // the replica is a copy of its empty template
+  const TNamed *h = m_Histos[index];
+  TNamed *replica = static_cast<TNamed *>(m_Templates[index]->Clone());
+  if (TH1 *h1 = dynamic_cast<TH1 *>(replica))
+  {
+    h1->SetDirectory(nullptr);
+  }
+  replicas[index].reset(replica);
+  if (m_Verbosity > 1)
+  {
+    std::cout << "QAHistShards::CreateReplica - " << m_Name << ": slot " << slot << " " << h->GetName() << std::endl;
+  }
+  return replica;
+}
+
+//____________________________________________________________________________..
+int QAHistShards::Merge()
+{
+  int nmerged = 0;
+  for (size_t index = 0; index < m_Histos.size(); index++)
+  {
+    // fixed slot order, the sums do not depend on which thread finished first
+    for (const auto &replicas : m_Slots)
+    {
+      if (!replicas || index >= replicas->size() || !(*replicas)[index])
+      {
+        continue;
+      }
+      TNamed *replica = (*replicas)[index].get();
+      if (TH1 *h1 = dynamic_cast<TH1 *>(replica))
+      {
+        if (h1->GetEntries() == 0 && h1->GetSumOfWeights() == 0)
+        {
+          continue;
+        }
+        static_cast<TH1 *>(m_Histos[index])->Add(h1);
+        h1->Reset();
+      }
+      else if (THnBase *hn = dynamic_cast<THnBase *>(replica))
+      {
+        if (hn->GetEntries() == 0)
+        {
+          continue;
+        }
+        if (m_SparseReplicas[index])
+        {
+          AddSparse(static_cast<TH1 *>(m_Histos[index]), hn);
+        }
+        else
+        {
+          static_cast<THnBase *>(m_Histos[index])->Add(hn);
+        }
+        hn->Reset();
+      }
+      else if (CaloResponseSketch *sketch = dynamic_cast<CaloResponseSketch *>(replica))
+      {
+        static_cast<CaloResponseSketch *>(m_Histos[index])->Add(*sketch);
+        sketch->Reset();
+      }
+      nmerged++;
+    }
+  }
+  if (m_Verbosity > 0)
+  {
+    std::cout << "QAHistShards::Merge - " << m_Name << ": merged " << nmerged << " replicas into "
+              << m_Histos.size() << " histograms" << std::endl;
+  }
+  return nmerged;
+}
+
+//____________________________________________________________________________..
+int QAHistShards::NReplicas(const int index) const
+{
+  int nreplicas = 0;
+  for (const auto &replicas : m_Slots)
+  {
+    if (replicas && index < static_cast<int>(replicas->size()) && (*replicas)[index])
+    {
+      nreplicas++;
+    }
+  }
+  return nreplicas;
+}
+
+//____________________________________________________________________________..
+void QAHistShards::AddSparse(TH1 *h, const THnBase *sparse)
+{
+  const double entries = h->GetEntries();
+  if (h->GetSumw2N() == 0 && !h->TestBit(TH1::kIsNotW) && sparse->GetCalculateErrors())
+  {
+    // the unit weight fills of h so far have errors sqrt(content)
+    h->Sumw2();
+  }
+  const bool errors = h->GetSumw2N() > 0;
+  int coord[3] = {0, 0, 0};
+  for (Long64_t i = 0; i < sparse->GetNbins(); i++)
+  {
+    const double content = sparse->GetBinContent(i, coord);
+    const int bin = h->GetBin(coord[0], coord[1], coord[2]);
+    const double error = h->GetBinError(bin);
+    h->SetBinContent(bin, h->GetBinContent(bin) + content);
+    if (errors)
+    {
+      h->SetBinError(bin, std::sqrt(error * error + sparse->GetBinError2(i)));
+    }
+  }
+  // mean and RMS from the bin centers, the number of entries from the fills
+  h->ResetStats();
+  h->SetEntries(entries + sparse->GetEntries());
+}
+
+//____________________________________________________________________________..
+unsigned int QAHistShards::Slot()
+{
+  if (s_Slot.slot < 0)
+  {
+    s_Slot.slot = AcquireSlot();
+  }
+  return s_Slot.slot;
+}
+
+//____________________________________________________________________________..
+void QAHistShards::BindSlot(const unsigned int i)
+{
+  if (s_Slot.slot >= 0 && !s_Slot.bound)
+  {
+    ReleaseSlot(s_Slot.slot);
+  }
+  s_Slot.slot = i;
+  s_Slot.bound = true;
+}
+
+//____________________________________________________________________________..
+void QAHistShards::Print(const std::string &what) const
+{
+  std::cout << "QAHistShards " << m_Name << ": " << m_Histos.size() << " booked histograms" << std::endl;
+  if (what == "ALL" || what == "SLOTS")
+  {
+    for (size_t slot = 0; slot < m_Slots.size(); slot++)
+    {
+      if (!m_Slots[slot])
+      {
+        continue;
+      }
+      int nreplicas = 0;
+      for (const auto &replica : *m_Slots[slot])
+      {
+        nreplicas += (replica != nullptr);
+      }
+      std::cout << "  slot " << slot << ": " << nreplicas << " replicas" << std::endl;
+    }
+  }
+}
@@ -0,0 +1,131 @@
+// Tell emacs that this is a C++ source
+//  -*- C++ -*-.
+#ifndef QAHISTSHARDS_H
+#define QAHISTSHARDS_H
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class TH1;
+class THnBase;
+class TNamed;
+
+//! Per thread replicas of the histograms of a QA module
+/*!
+ * The histograms are booked once (and registered with the QA histogram
+ * manager). The booking thread fills the booked histograms directly, every
+ * other thread which fills them gets its own replica the first time it asks
+ * for it, so a serial job has no replica at all. Filling only touches the
+ * histograms of the calling thread, so QA code can run concurrently inside an
+ * event or across events without any lock; the only lock protects the
+ * creation of a replica. Merge() adds the replicas to the booked histograms in
+ * the order of the thread slots, it has to run when no thread fills (End() of
+ * the module).
+ *
+ * Threads get a slot number the first time they fill and give it back when
+ * they exit, the next thread reuses the slot and its replicas, so kMaxSlots
+ * limits the threads filling at the same time only. Tasks which need a
+ * bitwise reproducible merge bind the slot themselves, e.g. to their task
+ * index, with BindSlot(), this also applies to the booking thread. Every
+ * replica and the empty template it is cloned from cost the memory of the
+ * histogram, unless the histogram is booked with sparse replicas (as the 2D
+ * maps of QAHistFactory), then only the bins filled by the thread are kept.
+ * Besides TH1 also THnSparse (THnBase) histograms can be booked, which is how
+ * QAHistFactory keeps mostly empty maps sparse, and CaloResponseSketch.
+ */
+class QAHistShards
+{
+ public:
+  enum
+  {
+    kMaxSlots = 256
+  };
+
+  QAHistShards(const std::string &name = "QAHistShards");
+
+  virtual ~QAHistShards();
+
+  //! registers h with the QA histogram manager and books it, returns h
+  TH1 *Register(TH1 *h, const bool sparsereplicas = false);
+
+  //! books a TH1, THnBase or CaloResponseSketch owned by somebody else, returns its index;
+  //! with sparsereplicas the threads fill a THnSparse replica of a TH1 (GetSparse()),
+  //! which only stores the filled bins
+  int Book(TNamed *h, const bool sparsereplicas = false);
+
+  //! index of a booked histogram, -1 if unknown
+  int Index(const std::string &name) const;
+
+  //! replica of the calling thread (the booked histogram for the booking
+  //! thread), nullptr if the histogram is not booked
+  TNamed *GetObject(const int index);
+
+  //! replica of a booked TH1, nullptr if it is not a TH1
+  TH1 *Get(const int index);
+  TH1 *Get(const std::string &name) { return Get(Index(name)); }
+
+  //! replica of a booked THnBase, nullptr if it is not a THnBase
+  THnBase *GetSparse(const int index);
+  THnBase *GetSparse(const std::string &name) { return GetSparse(Index(name)); }
+
+  //! booked histogram, not the replica
+  size_t NBooked() const { return m_Histos.size(); }
+  TNamed *GetBooked(const int index) const { return m_Histos[index]; }
+
+  //! number of replicas of a booked histogram
+  int NReplicas(const int index) const;
+
+  //! true if the replicas of a booked TH1 are THnSparse
+  bool SparseReplicas(const int index) const { return m_SparseReplicas[index]; }
+
+  //! adds the bins of sparse to h (same binning), the statistics are recomputed from the bins
+  static void AddSparse(TH1 *h, const THnBase *sparse);
+
+  //! adds all replicas to the booked histograms in slot order and resets them
+  int Merge();
+
+  //! slot of the calling thread, assigned at the first call and given back when the thread exits
+  static unsigned int Slot();
+
+  //! uses slot i for the calling thread (also the booking thread then fills a replica);
+  //! concurrently running threads need different slots
+  static void BindSlot(const unsigned int i);
+
+  void Verbosity(const int i) { m_Verbosity = i; }
+
+  void Print(const std::string &what = "ALL") const;
+
+  const std::string &Name() const { return m_Name; }
+
+ private:
+  typedef std::vector<std::unique_ptr<TNamed>> Replicas;
+
+  TNamed *CreateReplica(const unsigned int slot, const int index);
+
+  int m_Verbosity = 0;
+
+  std::string m_Name;
+
+  //! thread which booked the histograms, it fills them without replica
+  std::thread::id m_Owner;
+
+  //! booked histograms and their index by name, not changed while filling
+  std::vector<TNamed *> m_Histos;
+  std::vector<bool> m_SparseReplicas;
+
+  //! empty copies of the booked histograms, the replicas are cloned from them
+  std::vector<std::unique_ptr<TNamed>> m_Templates;
+  std::map<std::string, int> m_Index;
+
+  //! one entry per slot, an entry is only touched by the thread owning the slot
+  std::vector<std::unique_ptr<Replicas>> m_Slots;
+
+  //! serializes the creation of replicas
+  std::mutex m_Mutex;
+};
+
+#endif  // QAHISTSHARDS_H
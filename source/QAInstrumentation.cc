@@ -0,0 +1,265 @@
+#include "QAInstrumentation.h"
+
+#include <qa_modules/QAHistManagerDef.h>
+
+#include <fun4all/Fun4AllHistoManager.h>
+
+#include <TH1.h>
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+#include <iomanip>
+#include <iostream>  // for operator<<, endl, basic_ost...
+#include <malloc.h>
+#include <unistd.h>
+
+namespace
+{
+  //! log bins for times in ms, 1 us to 10 s
+  TH1 *NewTimeHisto(const std::string &name, const std::string &title)
+  {
+    const int nbins = 140;
+    double edges[nbins + 1];
+    for (int i = 0; i <= nbins; i++)
+    {
+      edges[i] = std::pow(10., -3 + 7. * i / nbins);
+    }
+    return new TH1D(name.c_str(), title.c_str(), nbins, edges);
+  }
+
+  //! memory changes in kB, +-10 MB
+  TH1 *NewMemoryHisto(const std::string &name, const std::string &title)
+  {
+    return new TH1D(name.c_str(), title.c_str(), 200, -10000, 10000);
+  }
+}  // namespace
+
+//____________________________________________________________________________..
+QAInstrumentation::Scope::Scope(const int stage)
+  : m_Stage(stage)
+{
+  if (m_Stage < 0)
+  {
+    return;
+  }
+  m_RSS = ResidentSize();
+  m_Heap = HeapInUse();
+  m_CPU = ThreadCPUTime();
+  m_Wall = WallTime();
+}
+
+//____________________________________________________________________________..
+QAInstrumentation::Scope::~Scope()
+{
+  if (m_Stage < 0)
+  {
+    return;
+  }
+  const double wall = WallTime() - m_Wall;
+  const double cpu = ThreadCPUTime() - m_CPU;
+  const double heap = HeapInUse() - m_Heap;
+  const double rss = ResidentSize() - m_RSS;
+  QAInstrumentation::instance()->Record(m_Stage, wall, cpu, rss, heap);
+}
+
+//____________________________________________________________________________..
+QAInstrumentation *QAInstrumentation::instance()
+{
+  static QAInstrumentation instr;
+  return &instr;
+}
+
+//____________________________________________________________________________..
+QAInstrumentation::~QAInstrumentation()
+{
+  // the histograms belong to the histogram manager
+}
+
+//____________________________________________________________________________..
+int QAInstrumentation::Stage(const std::string &name)
+{
+  if (!m_Enabled)
+  {
+    return -1;
+  }
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  auto iter = m_Index.find(name);
+  if (iter != m_Index.end())
+  {
+    return iter->second;
+  }
+
+  Fun4AllHistoManager *hm = QAHistManagerDef::getHistoManager();
+  assert(hm);
+  StageData stage;
+  stage.name = name;
+  const std::string prefix = "h_QAInstrumentation_" + name;
+  stage.h_wall = NewTimeHisto(prefix + "_WallTime", name + " wall time per event;Wall time (ms)");
+  stage.h_cpu = NewTimeHisto(prefix + "_CPUTime", name + " CPU time per event;CPU time (ms)");
+  stage.h_rss = NewMemoryHisto(prefix + "_RSSDelta", name + " resident size change per event;#DeltaRSS (kB)");
+  stage.h_heap = NewMemoryHisto(prefix + "_HeapDelta", name + " heap in use change per event;#DeltaHeap (kB)");
+  for (TH1 *h : {stage.h_wall, stage.h_cpu, stage.h_rss, stage.h_heap})
+  {
+    hm->registerHisto(h);
+  }
+  m_Stages.push_back(stage);
+  m_Index[name] = m_Stages.size() - 1;
+  if (m_Verbosity > 0)
+  {
+    std::cout << "QAInstrumentation::Stage - " << name << ": stage " << m_Stages.size() - 1 << std::endl;
+  }
+  return m_Stages.size() - 1;
+}
+
+//____________________________________________________________________________..
+void QAInstrumentation::Record(const int stage, const double wall, const double cpu, const double rss, const double heap)
+{
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  if (stage < 0 || stage >= static_cast<int>(m_Stages.size()))
+  {
+    return;
+  }
+  StageData &data = m_Stages[stage];
+  data.ncalls++;
+  data.wall += wall;
+  data.cpu += cpu;
+  data.rss += rss;
+  data.heap += heap;
+  data.wall_max = std::max(data.wall_max, wall);
+  data.h_wall->Fill(wall);
+  data.h_cpu->Fill(cpu);
+  data.h_rss->Fill(rss);
+  data.h_heap->Fill(heap);
+}
+
+//____________________________________________________________________________..
+std::vector<int> QAInstrumentation::Ranked() const
+{
+  std::vector<int> ranked(m_Stages.size());
+  for (size_t i = 0; i < ranked.size(); i++)
+  {
+    ranked[i] = i;
+  }
+  std::stable_sort(ranked.begin(), ranked.end(), [this](const int a, const int b) { return m_Stages[a].wall > m_Stages[b].wall; });
+  return ranked;
+}
+
+//____________________________________________________________________________..
+int QAInstrumentation::End()
+{
+  // Fun4AllServer::End() runs after the last event, the first module which
+  // ends sees the complete measurement
+  if (!m_Enabled || m_Done)
+  {
+    return 0;
+  }
+  m_Done = true;
+  if (m_Stages.empty())
+  {
+    return 0;
+  }
+
+  Fun4AllHistoManager *hm = QAHistManagerDef::getHistoManager();
+  assert(hm);
+  const int nstages = m_Stages.size();
+  TH1 *h_wall = new TH1D("h_QAInstrumentation_Summary_WallTime", "Total wall time per stage;;Wall time (s)", nstages, 0, nstages);
+  TH1 *h_cpu = new TH1D("h_QAInstrumentation_Summary_CPUTime", "Total CPU time per stage;;CPU time (s)", nstages, 0, nstages);
+  int bin = 1;
+  for (const int i : Ranked())
+  {
+    const StageData &stage = m_Stages[i];
+    h_wall->GetXaxis()->SetBinLabel(bin, stage.name.c_str());
+    h_wall->SetBinContent(bin, stage.wall / 1000.);
+    h_cpu->GetXaxis()->SetBinLabel(bin, stage.name.c_str());
+    h_cpu->SetBinContent(bin, stage.cpu / 1000.);
+    bin++;
+  }
+  hm->registerHisto(h_wall);
+  hm->registerHisto(h_cpu);
+
+  Print("SUMMARY");
+  return 0;
+}
+
+//____________________________________________________________________________..
+double QAInstrumentation::WallTime()
+{
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//____________________________________________________________________________..
+double QAInstrumentation::ThreadCPUTime()
+{
+  timespec ts;
+  if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts))
+  {
+    return 0;
+  }
+  return ts.tv_sec * 1e3 + ts.tv_nsec * 1e-6;
+}
+
+//____________________________________________________________________________..
+double QAInstrumentation::ResidentSize()
+{
+  // second field of statm: resident pages
+  FILE *f = fopen("/proc/self/statm", "r");
+  if (!f)
+  {
+    return 0;
+  }
+  long size = 0;
+  long resident = 0;
+  const int nread = fscanf(f, "%ld %ld", &size, &resident);
+  fclose(f);
+  if (nread != 2)
+  {
+    return 0;
+  }
+  return resident * (sysconf(_SC_PAGESIZE) / 1024.);
+}
+
+//____________________________________________________________________________..
+double QAInstrumentation::HeapInUse()
+{
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+  const struct mallinfo2 mi = mallinfo2();
+  return (mi.uordblks + mi.hblkhd) / 1024.;
+#else
+  // int fields, wrap above 2 GB
+  const struct mallinfo mi = mallinfo();
+  return (static_cast<unsigned int>(mi.uordblks) + static_cast<unsigned int>(mi.hblkhd)) / 1024.;
+#endif
+}
+
+//____________________________________________________________________________..
+void QAInstrumentation::Print(const std::string &what) const
+{
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  std::cout << "QAInstrumentation: " << (m_Enabled ? "enabled" : "disabled") << ", " << m_Stages.size() << " stages" << std::endl;
+  if (what != "ALL" && what != "SUMMARY")
+  {
+    return;
+  }
+  std::cout << "  " << std::setw(50) << std::left << "stage" << std::right
+            << std::setw(10) << "events" << std::setw(12) << "wall (s)"
+            << std::setw(14) << "wall/evt (ms)" << std::setw(14) << "max (ms)" << std::setw(14) << "cpu/evt (ms)"
+            << std::setw(14) << "RSS/evt (kB)" << std::setw(14) << "heap/evt (kB)" << std::endl;
+  for (const int i : Ranked())
+  {
+    const StageData &stage = m_Stages[i];
+    const double n = std::max(stage.ncalls, 1LL);
+    std::cout << "  " << std::setw(50) << std::left << stage.name << std::right << std::fixed
+              << std::setw(10) << stage.ncalls
+              << std::setw(12) << std::setprecision(2) << stage.wall / 1000.
+              << std::setw(14) << std::setprecision(3) << stage.wall / n
+              << std::setw(14) << std::setprecision(3) << stage.wall_max
+              << std::setw(14) << std::setprecision(3) << stage.cpu / n
+              << std::setw(14) << std::setprecision(1) << stage.rss / n
+              << std::setw(14) << std::setprecision(1) << stage.heap / n
+              << std::defaultfloat << std::setprecision(6) << std::endl;
+  }
+}
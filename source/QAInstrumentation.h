@@ -0,0 +1,104 @@
+// Tell emacs that this is a C++ source
+//  -*- C++ -*-.
+#ifndef QAINSTRUMENTATION_H
+#define QAINSTRUMENTATION_H
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class TH1;
+
+//! Opt-in per event timing and memory measurement of the QA and Eval modules
+/*!
+ * Disabled by default, a macro switches it on with
+ *   QAInstrumentation::instance()->Enable();
+ * before the modules are initialized. Every module (and sub-stage like G4Hit,
+ * Tower, Cluster or TrackProj) gets a stage in Init(), a Scope around the work
+ * of an event records for this stage
+ *  - wall time and the CPU time of the calling thread,
+ *  - the change of the resident set size (/proc/self/statm),
+ *  - the change of the heap in use (mallinfo). This is process wide, with
+ *    concurrently filling threads it is not attributable to a single stage.
+ * Per stage the values are filled into histograms registered with the QA
+ * histogram manager (h_QAInstrumentation_<stage>_*), so they end up in the QA
+ * output. End() prints the stages ranked by their total wall time.
+ */
+class QAInstrumentation
+{
+ public:
+  //! measures a stage from construction to destruction, does nothing for stage < 0
+  class Scope
+  {
+   public:
+    explicit Scope(const int stage);
+    ~Scope();
+
+   private:
+    int m_Stage;
+    double m_Wall = 0;
+    double m_CPU = 0;
+    double m_RSS = 0;
+    double m_Heap = 0;
+  };
+
+  static QAInstrumentation *instance();
+
+  virtual ~QAInstrumentation();
+
+  void Enable(const bool b = true) { m_Enabled = b; }
+  bool Enabled() const { return m_Enabled; }
+
+  //! index of a stage, books its histograms at the first call; -1 if disabled
+  int Stage(const std::string &name);
+
+  //! adds one measurement: times in ms, memory changes in kB
+  void Record(const int stage, const double wall, const double cpu, const double rss, const double heap);
+
+  //! prints the ranked summary and fills h_QAInstrumentation_Summary, only at the first call
+  int End();
+
+  void Verbosity(const int i) { m_Verbosity = i; }
+
+  void Print(const std::string &what = "ALL") const;
+
+  //! current values used by Scope: ms, ms, kB, kB
+  static double WallTime();
+  static double ThreadCPUTime();
+  static double ResidentSize();
+  static double HeapInUse();
+
+ private:
+  struct StageData
+  {
+    std::string name;
+    long long ncalls = 0;
+    double wall = 0;
+    double cpu = 0;
+    double rss = 0;
+    double heap = 0;
+    double wall_max = 0;
+    TH1 *h_wall = nullptr;
+    TH1 *h_cpu = nullptr;
+    TH1 *h_rss = nullptr;
+    TH1 *h_heap = nullptr;
+  };
+
+  QAInstrumentation() {}
+
+  //! stage indices ordered by total wall time, longest first
+  std::vector<int> Ranked() const;
+
+  bool m_Enabled = false;
+  bool m_Done = false;
+  int m_Verbosity = 0;
+
+  std::vector<StageData> m_Stages;
+  std::map<std::string, int> m_Index;
+
+  //! stages may be recorded from several threads
+  mutable std::mutex m_Mutex;
+};
+
+#endif  // QAINSTRUMENTATION_H
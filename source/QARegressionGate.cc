@@ -0,0 +1,407 @@
+#include "QARegressionGate.h"
+
+#include <ROOT/TSeq.hxx>
+#include <ROOT/TThreadExecutor.hxx>
+
+#include <TClass.h>
+#include <TFile.h>
+#include <TH1.h>
+#include <TKey.h>
+#include <TList.h>
+#include <TMath.h>
+#include <TProfile.h>
+#include <TROOT.h>
+#include <TTree.h>
+
+#include <algorithm>
+#include <fnmatch.h>
+#include <fstream>
+#include <iomanip>
+#include <iostream>  // for operator<<, endl, basic_ost...
+#include <limits>
+#include <memory>
+#include <set>
+#include <sstream>
+
+namespace
+{
+  bool Match(const std::string &pattern, const std::string &name)
+  {
+    return fnmatch(pattern.c_str(), name.c_str(), 0) == 0;
+  }
+
+  //! |a - b| in units of the combined error, 0 for identical values
+  double Shift(const double a, const double b, const double error)
+  {
+    if (a == b)
+    {
+      return 0;
+    }
+    return error > 0 ? std::fabs(a - b) / error : std::numeric_limits<double>::infinity();
+  }
+
+  std::string JSONString(const std::string &s)
+  {
+    std::string out = "\"";
+    for (const char c : s)
+    {
+      if (c == '"' || c == '\\')
+      {
+        out += '\\';
+      }
+      out += c;
+    }
+    return out + "\"";
+  }
+
+  //! JSON has no NaN/inf
+  std::string JSONNumber(const double x)
+  {
+    if (!std::isfinite(x))
+    {
+      return "null";
+    }
+    std::ostringstream os;
+    os << std::setprecision(8) << x;
+    return os.str();
+  }
+
+  //! histogram read from the file, not owned by the file
+  TH1 *ReadHisto(TFile *f, const std::string &name)
+  {
+    TH1 *h = dynamic_cast<TH1 *>(f->Get(name.c_str()));
+    if (h)
+    {
+      h->SetDirectory(nullptr);
+    }
+    return h;
+  }
+}  // namespace
+
+//____________________________________________________________________________..
+QARegressionGate::QARegressionGate(const std::string &newfile, const std::string &reffile)
+  : m_NewFile(newfile)
+  , m_RefFile(reffile)
+{
+}
+
+//____________________________________________________________________________..
+void QARegressionGate::AddPattern(const std::string &pattern)
+{
+  m_Patterns.push_back(pattern);
+}
+
+//____________________________________________________________________________..
+int QARegressionGate::Run()
+{
+  std::unique_ptr<TFile> fnew(TFile::Open(m_NewFile.c_str(), "READ"));
+  std::unique_ptr<TFile> fref(TFile::Open(m_RefFile.c_str(), "READ"));
+  if (!fnew || fnew->IsZombie() || !fref || fref->IsZombie())
+  {
+    std::cout << "QARegressionGate::Run - cannot open " << ((!fnew || fnew->IsZombie()) ? m_NewFile : m_RefFile) << std::endl;
+    return -1;
+  }
+
+  // all histograms of either file, sorted by name
+  std::set<std::string> names;
+  for (TFile *f : {fnew.get(), fref.get()})
+  {
+    TIter next(f->GetListOfKeys());
+    TKey *key = nullptr;
+    while ((key = static_cast<TKey *>(next())))
+    {
+      TClass *cl = TClass::GetClass(key->GetClassName());
+      if (cl && cl->InheritsFrom(TH1::Class()) && Selected(key->GetName()))
+      {
+        names.insert(key->GetName());
+      }
+    }
+  }
+
+  // the files are read sequentially, only the comparisons run in parallel
+  std::vector<std::string> order(names.begin(), names.end());
+  std::vector<std::unique_ptr<TH1>> hnew;
+  std::vector<std::unique_ptr<TH1>> href;
+  {
+    const bool status = TH1::AddDirectoryStatus();
+    TH1::AddDirectory(kFALSE);
+    for (const auto &name : order)
+    {
+      hnew.emplace_back(ReadHisto(fnew.get(), name));
+      href.emplace_back(ReadHisto(fref.get(), name));
+    }
+    TH1::AddDirectory(status);
+  }
+  fnew->Close();
+  fref->Close();
+
+  auto compare = [&](const size_t i) { return Compare(order[i], hnew[i].get(), href[i].get()); };
+  ROOT::EnableThreadSafety();
+  ROOT::TThreadExecutor pool(m_NThreads);
+  m_Results = pool.Map(compare, ROOT::TSeqUL(order.size()));
+
+  m_Failed = 0;
+  for (const auto &res : m_Results)
+  {
+    if (!res.failed.empty())
+    {
+      m_Failed++;
+    }
+  }
+  Print(m_Verbosity > 0 ? "ALL" : "FAILED");
+  return m_Failed;
+}
+
+//____________________________________________________________________________..
+QARegressionGate::HistoResult QARegressionGate::Compare(const std::string &name, const TH1 *hnew, const TH1 *href) const
+{
+  HistoResult res;
+  res.name = name;
+  res.classname = (hnew ? hnew : href)->ClassName();
+  if (!hnew)
+  {
+    res.status = "missing";
+    if (m_FailOnMissing)
+    {
+      res.failed.push_back("missing");
+    }
+    return res;
+  }
+  res.entries_new = hnew->GetEntries();
+  if (!href)
+  {
+    res.status = "new";
+    return res;
+  }
+  res.entries_ref = href->GetEntries();
+  if (res.entries_new == 0 || res.entries_ref == 0)
+  {
+    res.status = "empty";
+    if (res.entries_new != res.entries_ref)
+    {
+      res.failed.push_back("entries");
+      res.status = "fail";
+    }
+    return res;
+  }
+
+  const TProfile *pnew = dynamic_cast<const TProfile *>(hnew);
+  const TProfile *pref = dynamic_cast<const TProfile *>(href);
+  if (pnew && pref)
+  {
+    // the shape tests do not apply to profiles, compare the bin means
+    double chi2 = 0;
+    int ndf = 0;
+    for (int bin = 0; bin < pnew->GetNcells() && bin < pref->GetNcells(); bin++)
+    {
+      if (pnew->GetBinEntries(bin) <= 0 || pref->GetBinEntries(bin) <= 0)
+      {
+        continue;
+      }
+      const double e2 = std::pow(pnew->GetBinError(bin), 2) + std::pow(pref->GetBinError(bin), 2);
+      if (e2 > 0)
+      {
+        chi2 += std::pow(pnew->GetBinContent(bin) - pref->GetBinContent(bin), 2) / e2;
+        ndf++;
+      }
+    }
+    res.chi2 = chi2;
+    res.ndf = ndf;
+    res.chi2_prob = ndf > 0 ? TMath::Prob(chi2, ndf) : NAN;
+  }
+  else
+  {
+    res.ks_prob = hnew->KolmogorovTest(href);
+    // NORM is only allowed for two unweighted histograms, with weights the test normalises itself
+    const bool wnew = hnew->GetSumw2N() > 0;
+    const bool wref = href->GetSumw2N() > 0;
+    std::string opt = std::string(wnew ? "W" : "U") + (wref ? "W" : "U");
+    if (!wnew && !wref)
+    {
+      opt += " NORM";
+    }
+    int igood = 0;
+    double chi2 = 0;
+    res.chi2_prob = hnew->Chi2TestX(href, chi2, res.ndf, igood, opt.c_str());
+    res.chi2 = chi2;
+    res.mean_shift = 0;
+    res.rms_shift = 0;
+    for (int axis = 1; axis <= hnew->GetDimension(); axis++)
+    {
+      const double error = std::sqrt(std::pow(hnew->GetMeanError(axis), 2) + std::pow(href->GetMeanError(axis), 2));
+      res.mean_shift = std::max(res.mean_shift, Shift(hnew->GetMean(axis), href->GetMean(axis), error));
+      res.rms_shift = std::max(res.rms_shift, Shift(hnew->GetStdDev(axis), href->GetStdDev(axis), href->GetStdDev(axis)));
+    }
+  }
+
+  // NAN thresholds or metrics never fail
+  const Thresholds &t = GetThresholds(name);
+  if (res.ks_prob < t.min_ks_prob)
+  {
+    res.failed.push_back("ks");
+  }
+  if (res.chi2_prob < t.min_chi2_prob)
+  {
+    res.failed.push_back("chi2");
+  }
+  if (res.mean_shift > t.max_mean_shift)
+  {
+    res.failed.push_back("mean");
+  }
+  if (res.rms_shift > t.max_rms_shift)
+  {
+    res.failed.push_back("rms");
+  }
+  res.status = res.failed.empty() ? "pass" : "fail";
+  return res;
+}
+
+//____________________________________________________________________________..
+const QARegressionGate::Thresholds &QARegressionGate::GetThresholds(const std::string &name) const
+{
+  for (const auto &iter : m_Thresholds)
+  {
+    if (Match(iter.first, name))
+    {
+      return iter.second;
+    }
+  }
+  return m_Default;
+}
+
+//____________________________________________________________________________..
+bool QARegressionGate::Selected(const std::string &name) const
+{
+  if (m_Patterns.empty())
+  {
+    return Match("h_QAG4Sim_*", name);
+  }
+  for (const auto &pattern : m_Patterns)
+  {
+    if (Match(pattern, name))
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+//____________________________________________________________________________..
+int QARegressionGate::WriteJSON(const std::string &fname) const
+{
+  std::string outname = fname.empty() ? m_NewFile + "_regression.json" : fname;
+  std::ofstream out(outname);
+  if (!out)
+  {
+    std::cout << "QARegressionGate::WriteJSON - cannot open " << outname << std::endl;
+    return -1;
+  }
+  out << "{" << std::endl;
+  out << "  \"new\": " << JSONString(m_NewFile) << "," << std::endl;
+  out << "  \"reference\": " << JSONString(m_RefFile) << "," << std::endl;
+  out << "  \"pass\": " << (m_Failed == 0 ? "true" : "false") << "," << std::endl;
+  out << "  \"histograms\": " << m_Results.size() << "," << std::endl;
+  out << "  \"failed\": " << m_Failed << "," << std::endl;
+  out << "  \"thresholds\": {\"min_ks_prob\": " << JSONNumber(m_Default.min_ks_prob)
+      << ", \"min_chi2_prob\": " << JSONNumber(m_Default.min_chi2_prob)
+      << ", \"max_mean_shift\": " << JSONNumber(m_Default.max_mean_shift)
+      << ", \"max_rms_shift\": " << JSONNumber(m_Default.max_rms_shift) << "}," << std::endl;
+  out << "  \"results\": [" << std::endl;
+  for (size_t i = 0; i < m_Results.size(); i++)
+  {
+    const HistoResult &res = m_Results[i];
+    out << "    {\"name\": " << JSONString(res.name)
+        << ", \"class\": " << JSONString(res.classname)
+        << ", \"status\": " << JSONString(res.status)
+        << ", \"failed\": [";
+    for (size_t j = 0; j < res.failed.size(); j++)
+    {
+      out << (j ? ", " : "") << JSONString(res.failed[j]);
+    }
+    out << "], \"entries_new\": " << JSONNumber(res.entries_new)
+        << ", \"entries_ref\": " << JSONNumber(res.entries_ref)
+        << ", \"ks_prob\": " << JSONNumber(res.ks_prob)
+        << ", \"chi2\": " << JSONNumber(res.chi2)
+        << ", \"ndf\": " << res.ndf
+        << ", \"chi2_prob\": " << JSONNumber(res.chi2_prob)
+        << ", \"mean_shift\": " << JSONNumber(res.mean_shift)
+        << ", \"rms_shift\": " << JSONNumber(res.rms_shift) << "}"
+        << (i + 1 < m_Results.size() ? "," : "") << std::endl;
+  }
+  out << "  ]" << std::endl;
+  out << "}" << std::endl;
+  return 0;
+}
+
+//____________________________________________________________________________..
+int QARegressionGate::WriteROOT(const std::string &fname) const
+{
+  std::string outname = fname.empty() ? m_NewFile + "_regression.root" : fname;
+  std::unique_ptr<TFile> f(TFile::Open(outname.c_str(), "RECREATE"));
+  if (!f || f->IsZombie())
+  {
+    std::cout << "QARegressionGate::WriteROOT - cannot open " << outname << std::endl;
+    return -1;
+  }
+  HistoResult res;
+  std::string failed;
+  TTree *t = new TTree("qa_regression", ("QA regression " + m_NewFile + " vs " + m_RefFile).c_str());
+  t->Branch("name", &res.name);
+  t->Branch("class", &res.classname);
+  t->Branch("status", &res.status);
+  t->Branch("failed", &failed);
+  t->Branch("entries_new", &res.entries_new, "entries_new/D");
+  t->Branch("entries_ref", &res.entries_ref, "entries_ref/D");
+  t->Branch("ks_prob", &res.ks_prob, "ks_prob/D");
+  t->Branch("chi2", &res.chi2, "chi2/D");
+  t->Branch("ndf", &res.ndf, "ndf/I");
+  t->Branch("chi2_prob", &res.chi2_prob, "chi2_prob/D");
+  t->Branch("mean_shift", &res.mean_shift, "mean_shift/D");
+  t->Branch("rms_shift", &res.rms_shift, "rms_shift/D");
+  for (const auto &r : m_Results)
+  {
+    // assign member by member, the branches point into res
+    res.name = r.name;
+    res.classname = r.classname;
+    res.status = r.status;
+    failed.clear();
+    for (const auto &metric : r.failed)
+    {
+      failed += (failed.empty() ? "" : ",") + metric;
+    }
+    res.entries_new = r.entries_new;
+    res.entries_ref = r.entries_ref;
+    res.ks_prob = r.ks_prob;
+    res.chi2 = r.chi2;
+    res.ndf = r.ndf;
+    res.chi2_prob = r.chi2_prob;
+    res.mean_shift = r.mean_shift;
+    res.rms_shift = r.rms_shift;
+    t->Fill();
+  }
+  t->Write();
+  f->Close();
+  return 0;
+}
+
+//____________________________________________________________________________..
+void QARegressionGate::Print(const std::string &what) const
+{
+  std::cout << "QARegressionGate: " << m_NewFile << " vs " << m_RefFile << ": " << m_Results.size()
+            << " histograms, " << m_Failed << " failed" << std::endl;
+  for (const auto &res : m_Results)
+  {
+    if (what == "FAILED" && res.failed.empty())
+    {
+      continue;
+    }
+    std::cout << "  " << std::setw(50) << std::left << res.name << std::right << " " << std::setw(7) << res.status
+              << " ks " << res.ks_prob << " chi2/ndf " << res.chi2 << "/" << res.ndf
+              << " mean shift " << res.mean_shift << " rms shift " << res.rms_shift;
+    for (const auto &metric : res.failed)
+    {
+      std::cout << " [" << metric << "]";
+    }
+    std::cout << std::endl;
+  }
+}
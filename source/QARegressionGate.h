@@ -0,0 +1,104 @@
+// Tell emacs that this is a C++ source
+//  -*- C++ -*-.
+#ifndef QAREGRESSIONGATE_H
+#define QAREGRESSIONGATE_H
+
+#include <cmath>
+#include <string>
+#include <utility>
+#include <vector>
+
+class TH1;
+
+//! Compares the QA histograms of a new file to a reference without drawing
+/*!
+ * Every histogram matching the name patterns (h_QAG4Sim_* by default) is read
+ * from both files, then the comparisons run in parallel: Kolmogorov and chi2
+ * test of the shapes, the shift of the mean in units of its error and the
+ * relative change of the RMS (per axis for TH2). Each metric has a threshold,
+ * the defaults can be overridden for histograms matching a pattern. The result
+ * is written as JSON and as a ROOT tree, Run() returns the number of failed
+ * histograms so a nightly build can stop on it.
+ */
+class QARegressionGate
+{
+ public:
+  //! histograms fail if a metric is outside these limits, NAN disables a metric
+  struct Thresholds
+  {
+    double min_ks_prob = 1e-3;
+    double min_chi2_prob = 1e-3;
+    double max_mean_shift = 5;   // |mean_new - mean_ref| / error
+    double max_rms_shift = 0.1;  // |rms_new - rms_ref| / rms_ref
+  };
+
+  struct HistoResult
+  {
+    std::string name;
+    std::string classname;
+    std::string status;  // pass, fail, new (missing in reference), missing (missing in new file), empty
+    std::vector<std::string> failed;  // metrics outside the thresholds
+    double entries_new = 0;
+    double entries_ref = 0;
+    double ks_prob = NAN;
+    double chi2 = NAN;
+    int ndf = 0;
+    double chi2_prob = NAN;
+    double mean_shift = NAN;
+    double rms_shift = NAN;
+  };
+
+  QARegressionGate(const std::string &newfile, const std::string &reffile);
+
+  virtual ~QARegressionGate() {}
+
+  //! histograms to compare, '*' matches any part of the name; replaces the default h_QAG4Sim_*
+  void AddPattern(const std::string &pattern);
+
+  void SetThresholds(const Thresholds &t) { m_Default = t; }
+
+  //! thresholds for the histograms matching pattern, the first matching pattern is used
+  void SetThresholds(const std::string &pattern, const Thresholds &t) { m_Thresholds.push_back(std::make_pair(pattern, t)); }
+
+  //! a histogram of the reference missing in the new file fails (default true)
+  void FailOnMissing(const bool b) { m_FailOnMissing = b; }
+
+  //! number of threads, 0 = number of cores
+  void SetNThreads(const unsigned int n) { m_NThreads = n; }
+
+  void Verbosity(const int i) { m_Verbosity = i; }
+
+  //! returns the number of failed histograms, -1 if a file cannot be read
+  int Run();
+
+  const std::vector<HistoResult> &Results() const { return m_Results; }
+
+  //! empty name = <new file>_regression.json
+  int WriteJSON(const std::string &fname = "") const;
+
+  //! tree qa_regression, one entry per histogram; empty name = <new file>_regression.root
+  int WriteROOT(const std::string &fname = "") const;
+
+  void Print(const std::string &what = "ALL") const;
+
+ private:
+  HistoResult Compare(const std::string &name, const TH1 *hnew, const TH1 *href) const;
+  const Thresholds &GetThresholds(const std::string &name) const;
+  bool Selected(const std::string &name) const;
+
+  int m_Verbosity = 0;
+  unsigned int m_NThreads = 0;
+  bool m_FailOnMissing = true;
+  int m_Failed = 0;
+
+  std::string m_NewFile;
+  std::string m_RefFile;
+
+  std::vector<std::string> m_Patterns;
+  Thresholds m_Default;
+  std::vector<std::pair<std::string, Thresholds>> m_Thresholds;
+
+  std::vector<HistoResult> m_Results;
+};
+
+#endif  // QAREGRESSIONGATE_H
@@ -0,0 +1,481 @@
+#include "QAReportGenerator.h"
+
+#include <TFile.h>
+#include <TH1.h>
+#include <TKey.h>
+#include <TList.h>
+#include <TMemFile.h>
+#include <TObject.h>
+#include <TROOT.h>
+#include <TSystem.h>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>  // for std::rename
+#include <fnmatch.h>
+#include <fstream>
+#include <iomanip>
+#include <iostream>  // for operator<<, endl, basic_ost...
+#include <memory>
+#include <sstream>
+#include <thread>
+
+namespace
+{
+  //! FNV-1a, enough to notice a changed histogram
+  void Hash(unsigned long long &h, const char *data, const size_t n)
+  {
+    for (size_t i = 0; i < n; i++)
+    {
+      h ^= static_cast<unsigned char>(data[i]);
+      h *= 1099511628211ULL;
+    }
+  }
+
+  void Hash(unsigned long long &h, const std::string &s)
+  {
+    // the terminating 0 separates consecutive strings
+    Hash(h, s.c_str(), s.size() + 1);
+  }
+
+  const unsigned long long HashSeed = 14695981039346656037ULL;
+
+  bool Exists(const std::string &fname)
+  {
+    // AccessPathName returns true if the file does not exist
+    return !gSystem->AccessPathName(fname.c_str());
+  }
+}  // namespace
+
+//____________________________________________________________________________..
+QAReportGenerator::QAReportGenerator(const std::string &newfile, const std::string &reffile)
+  : m_NewFile(newfile)
+  , m_RefFile(reffile)
+{
+}
+
+//____________________________________________________________________________..
+QAReportGenerator::~QAReportGenerator()
+{
+  ClearObjects();
+}
+
+//____________________________________________________________________________..
+void QAReportGenerator::AddPage(const std::string &macro, const std::vector<std::string> &keys)
+{
+  Page page;
+  page.macro = macro;
+  page.name = macro.substr(0, macro.rfind(".C"));
+  page.patterns = keys;
+  m_Pages.push_back(page);
+}
+
+//____________________________________________________________________________..
+int QAReportGenerator::Run()
+{
+  if (m_StateFile.empty())
+  {
+    m_StateFile = m_NewFile + "_report.state";
+  }
+  std::unique_ptr<TFile> newfile(TFile::Open(m_NewFile.c_str(), "READ"));
+  if (!newfile || newfile->IsZombie())
+  {
+    std::cout << "QAReportGenerator::Run - cannot open " << m_NewFile << std::endl;
+    return -1;
+  }
+  std::unique_ptr<TFile> reffile;
+  if (!m_RefFile.empty())
+  {
+    reffile.reset(TFile::Open(m_RefFile.c_str(), "READ"));
+    if (!reffile || reffile->IsZombie())
+    {
+      std::cout << "QAReportGenerator::Run - cannot open reference " << m_RefFile << std::endl;
+      return -1;
+    }
+  }
+  ClearObjects();
+  IndexFile(newfile.get(), m_NewKeys);
+  if (reffile)
+  {
+    IndexFile(reffile.get(), m_RefKeys);
+  }
+  ReadState();
+
+  // only the keys of pages which have to be drawn are read
+  std::vector<Page *> todo;
+  for (auto &page : m_Pages)
+  {
+    page.status = kPending;
+    MatchKeys(page);
+    if (page.keys.empty())
+    {
+      std::cout << "QAReportGenerator::Run - no histogram of page " << page.name << " in " << m_NewFile << std::endl;
+      page.status = kFailed;
+      continue;
+    }
+    page.fingerprint = Fingerprint(page, newfile.get(), reffile.get());
+    auto iter = m_State.find(page.name);
+    if (!m_Force && iter != m_State.end() && iter->second == page.fingerprint && Exists(OutputName(page, ".png")))
+    {
+      page.status = kUnchanged;
+      continue;
+    }
+    if (ReadObjects(newfile.get(), m_NewKeys, page.keys) ||
+        (reffile && ReadObjects(reffile.get(), m_RefKeys, page.keys)))
+    {
+      page.status = kFailed;
+      continue;
+    }
+    todo.push_back(&page);
+  }
+  // the workers only see the objects in memory
+  newfile->Close();
+  if (reffile)
+  {
+    reffile->Close();
+  }
+
+  RenderPages(todo);
+
+  int failed = 0;
+  for (const auto &page : m_Pages)
+  {
+    if (page.status == kRendered)
+    {
+      m_State[page.name] = page.fingerprint;
+    }
+    else if (page.status == kFailed)
+    {
+      m_State.erase(page.name);
+      failed++;
+    }
+  }
+  WriteState();
+  ClearObjects();
+  Print("STATUS");
+  return failed;
+}
+
+//____________________________________________________________________________..
+void QAReportGenerator::Print(const std::string &what) const
+{
+  static const char *status[] = {"pending", "unchanged", "rendered", "FAILED"};
+  std::cout << "QAReportGenerator: " << m_NewFile << (m_RefFile.empty() ? "" : " vs " + m_RefFile) << std::endl;
+  for (const auto &page : m_Pages)
+  {
+    std::cout << "  " << std::setw(40) << std::left << page.name << std::right;
+    if (what == "STATUS")
+    {
+      std::cout << " " << std::setw(9) << status[page.status] << " " << page.keys.size() << " histograms";
+      if (page.status == kRendered || page.status == kFailed)
+      {
+        std::cout << ", " << std::fixed << std::setprecision(1) << page.seconds << std::defaultfloat << " s";
+      }
+      if (page.status == kFailed && page.exit_code)
+      {
+        std::cout << ", exit code " << page.exit_code << ", see " << OutputName(page, ".log");
+      }
+    }
+    else
+    {
+      for (const auto &pattern : page.patterns)
+      {
+        std::cout << " " << pattern;
+      }
+    }
+    std::cout << std::endl;
+  }
+}
+
+//____________________________________________________________________________..
+int QAReportGenerator::IndexFile(TFile *file, KeyMap &keys) const
+{
+  // the key list is read with the file header, no object is read here
+  TIter next(file->GetListOfKeys());
+  TKey *key = nullptr;
+  while ((key = static_cast<TKey *>(next())))
+  {
+    KeyData &data = keys[key->GetName()];
+    // highest cycle only
+    if (data.key && data.key->GetCycle() >= key->GetCycle())
+    {
+      continue;
+    }
+    data.key = key;
+    data.classname = key->GetClassName();
+  }
+  return keys.size();
+}
+
+//____________________________________________________________________________..
+void QAReportGenerator::MatchKeys(Page &page) const
+{
+  page.keys.clear();
+  for (const auto &iter : m_NewKeys)
+  {
+    for (const auto &pattern : page.patterns)
+    {
+      if (fnmatch(pattern.c_str(), iter.first.c_str(), 0) == 0)
+      {
+        page.keys.push_back(iter.first);
+        break;
+      }
+    }
+  }
+}
+
+//____________________________________________________________________________..
+unsigned long long QAReportGenerator::KeyHash(TFile *file, KeyData &data) const
+{
+  if (data.hashed)
+  {
+    return data.hash;
+  }
+  // the stored object without the key header, which also holds the write time
+  TKey *key = data.key;
+  const int len = key->GetNbytes() - key->GetKeylen();
+  std::vector<char> buffer(std::max(len, 0));
+  data.hash = HashSeed;
+  if (len > 0 && file->ReadBuffer(buffer.data(), key->GetSeekKey() + key->GetKeylen(), len))
+  {
+    std::cout << "QAReportGenerator::KeyHash - cannot read " << key->GetName() << " from " << file->GetName() << std::endl;
+    // never matches a previous report
+    Hash(data.hash, std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()));
+  }
+  else
+  {
+    Hash(data.hash, buffer.data(), buffer.size());
+  }
+  data.hashed = true;
+  return data.hash;
+}
+
+//____________________________________________________________________________..
+std::string QAReportGenerator::Fingerprint(const Page &page, TFile *newfile, TFile *reffile)
+{
+  unsigned long long h = HashSeed;
+  // a changed draw macro also needs a new page
+  std::ifstream macro(m_MacroPath + "/" + page.macro);
+  std::stringstream text;
+  text << macro.rdbuf();
+  Hash(h, text.str());
+  Hash(h, m_RefFile);
+  for (const auto &name : page.keys)
+  {
+    KeyData &data = m_NewKeys[name];
+    Hash(h, name);
+    Hash(h, data.classname);
+    const unsigned long long keyhash = KeyHash(newfile, data);
+    Hash(h, reinterpret_cast<const char *>(&keyhash), sizeof(keyhash));
+    if (!reffile)
+    {
+      continue;
+    }
+    auto iter = m_RefKeys.find(name);
+    if (iter == m_RefKeys.end() || !iter->second.key)
+    {
+      Hash(h, "missing");
+      continue;
+    }
+    const unsigned long long refhash = KeyHash(reffile, iter->second);
+    Hash(h, reinterpret_cast<const char *>(&refhash), sizeof(refhash));
+  }
+  std::ostringstream os;
+  os << std::hex << std::setw(16) << std::setfill('0') << h;
+  return os.str();
+}
+
+//____________________________________________________________________________..
+int QAReportGenerator::ReadObjects(TFile *file, KeyMap &keys, const std::vector<std::string> &names) const
+{
+  for (const auto &name : names)
+  {
+    auto iter = keys.find(name);
+    // histograms missing in the reference are left to the draw macro
+    if (iter == keys.end() || !iter->second.key || iter->second.object)
+    {
+      continue;
+    }
+    TObject *obj = iter->second.key->ReadObj();
+    if (!obj)
+    {
+      std::cout << "QAReportGenerator::ReadObjects - cannot read " << name << " from " << file->GetName() << std::endl;
+      return -1;
+    }
+    // keep the histogram when the file is closed
+    TH1 *h = dynamic_cast<TH1 *>(obj);
+    if (h)
+    {
+      h->SetDirectory(nullptr);
+    }
+    iter->second.object = obj;
+  }
+  return 0;
+}
+
+//____________________________________________________________________________..
+int QAReportGenerator::RenderPages(std::vector<Page *> &pages)
+{
+  typedef std::chrono::steady_clock clock;
+  const unsigned int nworkers = m_NWorkers > 0 ? m_NWorkers : std::max(1U, std::thread::hardware_concurrency());
+  std::map<pid_t, std::pair<Page *, clock::time_point>> running;
+  size_t next = 0;
+  int failed = 0;
+  while (next < pages.size() || !running.empty())
+  {
+    if (next < pages.size() && running.size() < nworkers)
+    {
+      Page *page = pages[next++];
+      if (m_Verbosity > 0)
+      {
+        std::cout << "QAReportGenerator::RenderPages - drawing " << page->name << std::endl;
+      }
+      // otherwise the worker repeats what is still buffered
+      std::cout.flush();
+      std::fflush(stdout);
+      std::fflush(stderr);
+      const pid_t pid = fork();
+      if (pid == 0)
+      {
+        RenderPage(*page);
+      }
+      if (pid < 0)
+      {
+        std::cout << "QAReportGenerator::RenderPages - cannot start worker for " << page->name << std::endl;
+        page->status = kFailed;
+        failed++;
+        continue;
+      }
+      running[pid] = std::make_pair(page, clock::now());
+      continue;
+    }
+    int status = 0;
+    const pid_t pid = waitpid(-1, &status, 0);
+    if (pid < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      break;
+    }
+    auto iter = running.find(pid);
+    if (iter == running.end())
+    {
+      continue;
+    }
+    Page *page = iter->second.first;
+    page->seconds = std::chrono::duration<double>(clock::now() - iter->second.second).count();
+    page->exit_code = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+    page->status = (page->exit_code == 0 && Exists(OutputName(*page, ".png"))) ? kRendered : kFailed;
+    if (page->status == kFailed)
+    {
+      failed++;
+    }
+    running.erase(iter);
+  }
+  return failed;
+}
+
+//____________________________________________________________________________..
+void QAReportGenerator::RenderPage(const Page &page) const
+{
+  // runs in the worker process, never returns
+  if (!std::freopen(OutputName(page, ".log").c_str(), "w", stdout))
+  {
+    _exit(2);
+  }
+  dup2(fileno(stdout), fileno(stderr));
+  gROOT->SetBatch(kTRUE);
+
+  // QA_OpenFile() finds these by the file names passed to the macro
+  TMemFile *newfile = new TMemFile(m_NewFile.c_str(), "RECREATE");
+  for (const auto &name : page.keys)
+  {
+    newfile->Append(m_NewKeys.find(name)->second.object);
+  }
+  std::string refarg = "NULL";
+  if (!m_RefFile.empty())
+  {
+    TMemFile *reffile = new TMemFile(m_RefFile.c_str(), "RECREATE");
+    for (const auto &name : page.keys)
+    {
+      auto iter = m_RefKeys.find(name);
+      if (iter != m_RefKeys.end() && iter->second.object)
+      {
+        reffile->Append(iter->second.object);
+      }
+    }
+    refarg = "\"" + m_RefFile + "\"";
+  }
+  newfile->cd();
+
+  const std::string cmd = ".x " + m_MacroPath + "/" + page.macro + "(\"" + m_NewFile + "\", " + refarg + ")";
+  int error = 0;
+  gROOT->ProcessLine(cmd.c_str(), &error);
+  std::cout.flush();
+  std::fflush(stdout);
+  // no ROOT cleanup, the objects are copies of the parent process
+  _exit(error ? 1 : 0);
+}
+
+//____________________________________________________________________________..
+void QAReportGenerator::ReadState()
+{
+  m_State.clear();
+  std::ifstream state(m_StateFile);
+  std::string line;
+  while (std::getline(state, line))
+  {
+    if (line.empty() || line[0] == '#')
+    {
+      continue;
+    }
+    std::istringstream is(line);
+    std::string page;
+    std::string fingerprint;
+    if (is >> page >> fingerprint)
+    {
+      m_State[page] = fingerprint;
+    }
+  }
+}
+
+//____________________________________________________________________________..
+void QAReportGenerator::WriteState() const
+{
+  // written next to the final name and moved in place, a crash leaves the old state
+  std::string tmpname = m_StateFile + ".tmp";
+  std::ofstream state(tmpname);
+  state << "# page fingerprint" << std::endl;
+  for (const auto &iter : m_State)
+  {
+    state << iter.first << " " << iter.second << std::endl;
+  }
+  state.close();
+  std::rename(tmpname.c_str(), m_StateFile.c_str());
+}
+
+//____________________________________________________________________________..
+std::string QAReportGenerator::OutputName(const Page &page, const std::string &ext) const
+{
+  // same as SaveCanvas(c1, TString(qa_file_name_new) + TString(c1->GetName())) in the macros
+  return m_NewFile + page.name + ext;
+}
+
+//____________________________________________________________________________..
+void QAReportGenerator::ClearObjects()
+{
+  for (KeyMap *keys : {&m_NewKeys, &m_RefKeys})
+  {
+    for (auto &iter : *keys)
+    {
+      delete iter.second.object;
+    }
+    keys->clear();
+  }
+}
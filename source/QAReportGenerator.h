@@ -0,0 +1,120 @@
+// Tell emacs that this is a C++ source
+//  -*- C++ -*-.
+#ifndef QAREPORTGENERATOR_H
+#define QAREPORTGENERATOR_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+class TFile;
+class TKey;
+class TObject;
+
+//! Renders the QA_Draw_*.C pages of a QA file and its reference in parallel
+/*!
+ * Replaces the serial loop of QA_Draw_ALL.sh. The new and reference QA files
+ * are opened once, every page declares the histograms it uses as key patterns
+ * and only the keys matching them are read. The fingerprint of a page is made
+ * from the stored (compressed) bytes of its keys in both files and the draw
+ * macro itself; pages whose fingerprint did not change since the last report
+ * and whose plots exist are not rendered again.
+ * The remaining pages are drawn by forked worker processes. The histograms are
+ * read before forking and handed to the macro as an in memory TMemFile with
+ * the name of the QA file (QA_OpenFile() of QA_Draw_Utility.C picks it up), so
+ * the workers do not touch the input files. The output of every page goes to
+ * <new QA file><page>.log.
+ */
+class QAReportGenerator
+{
+ public:
+  //! reffile empty = no reference
+  QAReportGenerator(const std::string &newfile, const std::string &reffile = "");
+
+  virtual ~QAReportGenerator();
+
+  //! draw macro (QA_Draw_<page>.C) and the histogram names it reads, '*' matches any part of a name
+  void AddPage(const std::string &macro, const std::vector<std::string> &keys);
+
+  //! directory of the draw macros
+  void SetMacroPath(const std::string &dir) { m_MacroPath = dir; }
+
+  //! number of worker processes, 0 = number of cores
+  void SetNWorkers(const unsigned int n) { m_NWorkers = n; }
+
+  //! fingerprints of the last report, default <new QA file>_report.state
+  void SetStateFile(const std::string &name) { m_StateFile = name; }
+
+  //! render all pages, also unchanged ones
+  void Force(const bool b = true) { m_Force = b; }
+
+  void Verbosity(const int i) { m_Verbosity = i; }
+
+  //! returns the number of pages which failed, -1 if the QA files cannot be read
+  int Run();
+
+  void Print(const std::string &what = "ALL") const;
+
+ private:
+  enum PageStatus
+  {
+    kPending,
+    kUnchanged,
+    kRendered,
+    kFailed
+  };
+
+  struct Page
+  {
+    std::string macro;
+    std::string name;  // canvas name = macro without .C
+    std::vector<std::string> patterns;
+    std::vector<std::string> keys;
+    std::string fingerprint;
+    PageStatus status = kPending;
+    int exit_code = 0;
+    double seconds = 0;
+  };
+
+  struct KeyData
+  {
+    std::string classname;
+    TKey *key = nullptr;
+    bool hashed = false;
+    unsigned long long hash = 0;
+    TObject *object = nullptr;
+  };
+
+  typedef std::map<std::string, KeyData> KeyMap;
+
+  int IndexFile(TFile *file, KeyMap &keys) const;
+  void MatchKeys(Page &page) const;
+  unsigned long long KeyHash(TFile *file, KeyData &data) const;
+  std::string Fingerprint(const Page &page, TFile *newfile, TFile *reffile);
+  int ReadObjects(TFile *file, KeyMap &keys, const std::vector<std::string> &names) const;
+  int RenderPages(std::vector<Page *> &pages);
+  void RenderPage(const Page &page) const;
+  void ReadState();
+  void WriteState() const;
+  std::string OutputName(const Page &page, const std::string &ext) const;
+  void ClearObjects();
+
+  int m_Verbosity = 0;
+  unsigned int m_NWorkers = 0;
+  bool m_Force = false;
+
+  std::string m_NewFile;
+  std::string m_RefFile;
+  std::string m_MacroPath = ".";
+  std::string m_StateFile;
+
+  std::vector<Page> m_Pages;
+
+  KeyMap m_NewKeys;
+  KeyMap m_RefKeys;
+
+  // page -> fingerprint of the last report
+  std::map<std::string, std::string> m_State;
+};
+
+#endif  // QAREPORTGENERATOR_H
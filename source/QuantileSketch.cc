@@ -0,0 +1,223 @@
+#include "QuantileSketch.h"
+
+#include <algorithm>
+
+//____________________________________________________________________________..
+QuantileSketch::QuantileSketch(const int k)
+  : m_K(std::max(k, 8))
+{
+}
+
+//____________________________________________________________________________..
+void QuantileSketch::Fill(const double x)
+{
+  if (!std::isfinite(x))
+  {
+    return;
+  }
+  if (m_Levels.empty())
+  {
+    m_Levels.resize(1);
+  }
+  if (m_N == 0)
+  {
+    m_Min = x;
+    m_Max = x;
+  }
+  else
+  {
+    m_Min = std::min(m_Min, x);
+    m_Max = std::max(m_Max, x);
+  }
+  m_N++;
+  m_Levels[0].push_back(x);
+  if (m_Levels[0].size() >= Capacity(0))
+  {
+    Compress();
+  }
+}
+
+//____________________________________________________________________________..
+void QuantileSketch::Add(const QuantileSketch &other)
+{
+  if (other.m_N == 0)
+  {
+    return;
+  }
+  if (m_N == 0)
+  {
+    m_Min = other.m_Min;
+    m_Max = other.m_Max;
+  }
+  else
+  {
+    m_Min = std::min(m_Min, other.m_Min);
+    m_Max = std::max(m_Max, other.m_Max);
+  }
+  m_N += other.m_N;
+  if (m_Levels.size() < other.m_Levels.size())
+  {
+    m_Levels.resize(other.m_Levels.size());
+  }
+  for (size_t h = 0; h < other.m_Levels.size(); h++)
+  {
+    m_Levels[h].insert(m_Levels[h].end(), other.m_Levels[h].begin(), other.m_Levels[h].end());
+  }
+  Compress();
+}
+
+//____________________________________________________________________________..
+void QuantileSketch::Reset()
+{
+  m_N = 0;
+  m_Min = NAN;
+  m_Max = NAN;
+  m_NCompactions = 0;
+  m_Levels.clear();
+}
+
+//____________________________________________________________________________..
+size_t QuantileSketch::NRetained() const
+{
+  size_t n = 0;
+  for (const auto &level : m_Levels)
+  {
+    n += level.size();
+  }
+  return n;
+}
+
+//____________________________________________________________________________..
+size_t QuantileSketch::Capacity(const size_t h) const
+{
+  const double depth = m_Levels.size() - 1 - h;
+  return std::max<size_t>(2, std::ceil(m_K * std::pow(2. / 3., depth)));
+}
+
+//____________________________________________________________________________..
+void QuantileSketch::Compress()
+{
+  for (;;)
+  {
+    size_t size = 0;
+    size_t capacity = 0;
+    for (size_t h = 0; h < m_Levels.size(); h++)
+    {
+      size += m_Levels[h].size();
+      capacity += Capacity(h);
+    }
+    if (size < capacity)
+    {
+      return;
+    }
+    for (size_t h = 0; h < m_Levels.size(); h++)
+    {
+      if (m_Levels[h].size() < Capacity(h))
+      {
+        continue;
+      }
+      if (h + 1 == m_Levels.size())
+      {
+        m_Levels.emplace_back();
+      }
+      std::vector<double> &level = m_Levels[h];
+      std::sort(level.begin(), level.end());
+      // an odd value out stays, the weight moved up is exactly the weight removed
+      const size_t npairs = level.size() / 2;
+      const size_t offset = (m_NCompactions++) % 2;
+      std::vector<double> &up = m_Levels[h + 1];
+      for (size_t i = 0; i < npairs; i++)
+      {
+        up.push_back(level[2 * i + offset]);
+      }
+      if (level.size() % 2)
+      {
+        level.front() = level.back();
+        level.resize(1);
+      }
+      else
+      {
+        level.clear();
+      }
+      break;
+    }
+  }
+}
+
+//____________________________________________________________________________..
+void QuantileSketch::Sorted(std::vector<std::pair<double, double>> &items) const
+{
+  items.clear();
+  items.reserve(NRetained());
+  double weight = 1;
+  for (const auto &level : m_Levels)
+  {
+    for (double x : level)
+    {
+      items.emplace_back(x, weight);
+    }
+    weight *= 2;
+  }
+  std::sort(items.begin(), items.end());
+}
+
+//____________________________________________________________________________..
+double QuantileSketch::Quantile(const double q) const
+{
+  if (m_N == 0)
+  {
+    return NAN;
+  }
+  if (q <= 0)
+  {
+    return m_Min;
+  }
+  if (q >= 1)
+  {
+    return m_Max;
+  }
+  std::vector<std::pair<double, double>> items;
+  Sorted(items);
+  const double target = q * m_N;
+  double sum = 0;
+  for (const auto &item : items)
+  {
+    sum += item.second;
+    if (sum >= target)
+    {
+      return item.first;
+    }
+  }
+  return m_Max;
+}
+
+//____________________________________________________________________________..
+double QuantileSketch::SigmaEff(const double fraction) const
+{
+  if (m_N == 0)
+  {
+    return NAN;
+  }
+  std::vector<std::pair<double, double>> items;
+  Sorted(items);
+  const double target = fraction * m_N;
+  double best = m_Max - m_Min;
+  double sum = 0;
+  size_t last = 0;
+  // smallest [items[first], items[last]] with a weight of at least target
+  for (size_t first = 0; first < items.size(); first++)
+  {
+    while (last < items.size() && sum < target)
+    {
+      sum += items[last].second;
+      last++;
+    }
+    if (sum < target)
+    {
+      break;
+    }
+    best = std::min(best, items[last - 1].first - items[first].first);
+    sum -= items[first].second;
+  }
+  return best / 2;
+}
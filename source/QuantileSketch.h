@@ -0,0 +1,78 @@
+// Tell emacs that this is a C++ source
+//  -*- C++ -*-.
+#ifndef QUANTILESKETCH_H
+#define QUANTILESKETCH_H
+
+#include <Rtypes.h>
+
+#include <cmath>
+#include <utility>
+#include <vector>
+
+//! Mergeable streaming quantile sketch (KLL) of one distribution
+/*!
+ * Keeps at most about 3k of the filled values in a stack of compactors:
+ * level h holds values of weight 2^h, its capacity is k (2/3)^(H-1-h) with H
+ * the number of levels. A full level is sorted and every other value (the
+ * odd or even ones, alternating) moves one level up with twice the weight.
+ * The rank error of a quantile is about 1.7/k of the number of entries,
+ * independent of the number of entries; two sketches are merged by stacking
+ * their levels and compacting, so sketches of many jobs can be added in any
+ * order to the same accuracy. The compaction offset alternates instead of
+ * being random, filling and merging in the same order give the same sketch.
+ */
+class QuantileSketch
+{
+ public:
+  QuantileSketch(const int k = 200);
+
+  virtual ~QuantileSketch() {}
+
+  void Fill(const double x);
+
+  //! adds the values of other
+  void Add(const QuantileSketch &other);
+
+  //! removes all values, k is kept
+  void Reset();
+
+  int GetK() const { return m_K; }
+  long long GetN() const { return m_N; }
+  double GetMin() const { return m_Min; }
+  double GetMax() const { return m_Max; }
+
+  //! number of values kept
+  size_t NRetained() const;
+
+  //! value below which a fraction q of the entries are, NAN if empty
+  double Quantile(const double q) const;
+  double Median() const { return Quantile(0.5); }
+
+  //! half width of the smallest interval holding a fraction of the entries, NAN if empty
+  double SigmaEff(const double fraction = 0.683) const;
+
+ private:
+  //! capacity of level h in the current stack
+  size_t Capacity(const size_t h) const;
+
+  //! compacts the lowest full level until the sketch fits
+  void Compress();
+
+  //! kept values sorted, with their weights
+  void Sorted(std::vector<std::pair<double, double>> &items) const;
+
+  int m_K = 200;
+  long long m_N = 0;
+  double m_Min = NAN;
+  double m_Max = NAN;
+
+  //! number of compactions, its parity picks the kept half
+  unsigned int m_NCompactions = 0;
+
+  //! values of weight 2^h at level h
+  std::vector<std::vector<double>> m_Levels;
+
+  ClassDef(QuantileSketch, 1)
+};
+
+#endif  // QUANTILESKETCH_H
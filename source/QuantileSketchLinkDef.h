@@ -0,0 +1,7 @@
+#ifdef __CINT__
+
+#pragma link C++ class std::vector<std::vector<double> > + ;
+#pragma link C++ class QuantileSketch + ;
+#pragma link C++ class std::vector<QuantileSketch> + ;
+
+#endif /* __CINT__ */
@@ -0,0 +1,208 @@
+#include "ResolutionEstimator.h"
+
+#include <ROOT/TSeq.hxx>
+#include <ROOT/TThreadExecutor.hxx>
+
+#include <TGraphErrors.h>
+#include <TROOT.h>
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>  // for operator<<, endl, basic_ost...
+
+namespace
+{
+  //! variance of a unit gaussian truncated to +-a
+  double TruncatedVariance(const double a)
+  {
+    const double pdf = std::exp(-0.5 * a * a) / std::sqrt(2 * M_PI);
+    const double inside = std::erf(a / std::sqrt(2.));
+    return 1 - 2 * a * pdf / inside;
+  }
+}  // namespace
+
+//____________________________________________________________________________..
+ResolutionEstimator::ResolutionEstimator(const std::string &name)
+  : m_Name(name)
+{
+}
+
+//____________________________________________________________________________..
+std::vector<ResolutionEstimator::SliceEstimate> ResolutionEstimator::Estimate(const std::vector<double> &x, const std::vector<double> &y, const std::vector<double> &limits) const
+{
+  if (limits.size() < 2)
+  {
+    return std::vector<SliceEstimate>();
+  }
+  const size_t nslices = limits.size() - 1;
+  // one pass to split the events into the slices
+  std::vector<std::vector<double>> values(nslices);
+  std::vector<double> xsum(nslices, 0);
+  for (size_t i = 0; i < x.size() && i < y.size(); i++)
+  {
+    if (x[i] < limits.front() || x[i] >= limits.back())
+    {
+      continue;
+    }
+    const size_t islice = std::upper_bound(limits.begin(), limits.end(), x[i]) - limits.begin() - 1;
+    values[islice].push_back(y[i]);
+    xsum[islice] += x[i];
+  }
+
+  // every task only touches the values of its own slice
+  auto estimate = [&](const size_t islice) {
+    SliceEstimate est = Estimate(values[islice]);
+    est.slice = islice;
+    est.x_low = limits[islice];
+    est.x_high = limits[islice + 1];
+    if (!values[islice].empty())
+    {
+      est.x_mean = xsum[islice] / values[islice].size();
+    }
+    return est;
+  };
+  ROOT::EnableThreadSafety();
+  ROOT::TThreadExecutor pool(m_NThreads);
+  return pool.Map(estimate, ROOT::TSeqUL(nslices));
+}
+
+//____________________________________________________________________________..
+ResolutionEstimator::SliceEstimate ResolutionEstimator::Estimate(std::vector<double> &values) const
+{
+  SliceEstimate est;
+  const size_t n = values.size();
+  est.entries = n;
+  if (n < 2 || static_cast<long long>(n) < m_MinEntries)
+  {
+    return est;
+  }
+  std::sort(values.begin(), values.end());
+  const double *v = values.data();
+
+  est.median = (n % 2) ? v[n / 2] : 0.5 * (v[n / 2 - 1] + v[n / 2]);
+
+  // smallest window of k consecutive ordered values
+  const size_t k = std::min(n, std::max<size_t>(2, std::ceil(m_Coverage * n)));
+  double width = v[k - 1] - v[0];
+  for (size_t i = 1; i + k <= n; i++)
+  {
+    width = std::min(width, v[i + k - 1] - v[i]);
+  }
+  est.sigma_eff = width / 2;
+  // gaussian approximations
+  est.median_error = std::sqrt(M_PI / 2) * est.sigma_eff / std::sqrt(n);
+  est.sigma_eff_error = est.sigma_eff / std::sqrt(2. * n);
+
+  // prefix sums relative to the median to keep the differences precise
+  std::vector<long double> sum1(n + 1, 0);
+  std::vector<long double> sum2(n + 1, 0);
+  for (size_t i = 0; i < n; i++)
+  {
+    const long double d = v[i] - est.median;
+    sum1[i + 1] = sum1[i] + d;
+    sum2[i + 1] = sum2[i] + d * d;
+  }
+  const double correction = TruncatedVariance(m_Truncation);
+  double mean = est.median;
+  double sigma = est.sigma_eff;
+  long long inside = n;
+  if (sigma <= 0)
+  {
+    // more than the coverage fraction in one value
+    est.truncated_mean = mean;
+    est.truncated_sigma = 0;
+    est.truncated_entries = n;
+    est.converged = true;
+    return est;
+  }
+  for (est.iterations = 1; est.iterations <= m_MaxIterations; est.iterations++)
+  {
+    const size_t lo = std::lower_bound(values.begin(), values.end(), mean - m_Truncation * sigma) - values.begin();
+    const size_t hi = std::upper_bound(values.begin(), values.end(), mean + m_Truncation * sigma) - values.begin();
+    inside = hi - lo;
+    if (inside < 2)
+    {
+      break;
+    }
+    const long double mu = (sum1[hi] - sum1[lo]) / inside;
+    const double var = std::max<long double>((sum2[hi] - sum2[lo]) / inside - mu * mu, 0);
+    const double newmean = est.median + mu;
+    const double newsigma = std::sqrt(var / correction);
+    const bool converged = std::fabs(newsigma - sigma) <= m_Tolerance * sigma && std::fabs(newmean - mean) <= m_Tolerance * sigma;
+    mean = newmean;
+    sigma = newsigma;
+    if (converged || sigma <= 0)
+    {
+      est.converged = true;
+      break;
+    }
+  }
+  est.iterations = std::min(est.iterations, m_MaxIterations);
+  est.truncated_entries = inside;
+  est.truncated_mean = mean;
+  est.truncated_sigma = sigma;
+  if (inside > 1)
+  {
+    est.truncated_mean_error = sigma / std::sqrt(inside);
+    est.truncated_sigma_error = sigma / std::sqrt(2. * (inside - 1));
+  }
+  return est;
+}
+
+//____________________________________________________________________________..
+TGraphErrors *ResolutionEstimator::Graph(const std::vector<SliceEstimate> &estimates, const Quantity what, const std::string &name)
+{
+  TGraphErrors *ge = new TGraphErrors();
+  ge->SetName(name.c_str());
+  for (const auto &est : estimates)
+  {
+    double y = NAN;
+    double ey = NAN;
+    switch (what)
+    {
+    case kMedian:
+      y = est.median;
+      ey = est.median_error;
+      break;
+    case kSigmaEff:
+      y = est.sigma_eff;
+      ey = est.sigma_eff_error;
+      break;
+    case kTruncatedMean:
+      y = est.truncated_mean;
+      ey = est.truncated_mean_error;
+      break;
+    case kTruncatedSigma:
+      y = est.truncated_sigma;
+      ey = est.truncated_sigma_error;
+      break;
+    }
+    if (std::isnan(y) || std::isnan(est.x_mean))
+    {
+      continue;
+    }
+    const int n = ge->GetN();
+    ge->SetPoint(n, est.x_mean, y);
+    ge->SetPointError(n, 0, std::isnan(ey) ? 0 : ey);
+  }
+  return ge;
+}
+
+//____________________________________________________________________________..
+void ResolutionEstimator::Print(const std::vector<SliceEstimate> &estimates)
+{
+  for (const auto &est : estimates)
+  {
+    std::cout << "  slice " << std::setw(3) << est.slice << " [" << est.x_low << ", " << est.x_high << ") "
+              << est.entries << " entries";
+    if (std::isnan(est.median))
+    {
+      std::cout << ": not estimated" << std::endl;
+      continue;
+    }
+    std::cout << ": median " << est.median << " +- " << est.median_error
+              << ", sigma_eff " << est.sigma_eff << " +- " << est.sigma_eff_error
+              << ", truncated mean " << est.truncated_mean << ", sigma " << est.truncated_sigma << " +- " << est.truncated_sigma_error
+              << " (" << est.iterations << " iterations" << (est.converged ? "" : ", not converged") << ")" << std::endl;
+  }
+}
@@ -0,0 +1,103 @@
+// Tell emacs that this is a C++ source
+//  -*- C++ -*-.
+#ifndef RESOLUTIONESTIMATOR_H
+#define RESOLUTIONESTIMATOR_H
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+class TGraphErrors;
+
+//! Unbinned robust estimates of the response in slices of the generated energy
+/*!
+ * Works on the per event (ge, response) pairs instead of a TH2, so the result
+ * does not depend on the binning of the response axis and nothing has to be
+ * fitted. Per slice the values are ordered once, after that
+ *  - the median is the middle element,
+ *  - sigma_eff is half of the smallest interval holding 68.27% of the events
+ *    (one pass over the ordered values),
+ *  - the truncated gaussian sigma iterates mean/RMS inside mean +- n sigma and
+ *    corrects the RMS for the truncation; with prefix sums over the ordered
+ *    values every iteration is two binary searches.
+ * The slices are independent and run in parallel.
+ */
+class ResolutionEstimator
+{
+ public:
+  enum Quantity
+  {
+    kMedian,
+    kSigmaEff,
+    kTruncatedMean,
+    kTruncatedSigma
+  };
+
+  struct SliceEstimate
+  {
+    int slice = 0;
+    double x_low = 0;
+    double x_high = 0;
+    double x_mean = NAN;
+    long long entries = 0;
+    double median = NAN;
+    double median_error = NAN;
+    double sigma_eff = NAN;
+    double sigma_eff_error = NAN;
+    double truncated_mean = NAN;
+    double truncated_mean_error = NAN;
+    double truncated_sigma = NAN;
+    double truncated_sigma_error = NAN;
+    long long truncated_entries = 0;
+    int iterations = 0;
+    bool converged = false;
+  };
+
+  ResolutionEstimator(const std::string &name = "ResolutionEstimator");
+
+  virtual ~ResolutionEstimator() {}
+
+  //! half width of the truncation window in units of sigma
+  void SetTruncation(const double nsigma) { m_Truncation = nsigma; }
+
+  //! fraction of the events inside the sigma_eff interval
+  void SetCoverage(const double f) { m_Coverage = f; }
+
+  void SetMaxIterations(const int n) { m_MaxIterations = n; }
+
+  //! relative change of the truncated sigma at which the iteration stops
+  void SetTolerance(const double t) { m_Tolerance = t; }
+
+  //! slices with fewer events are not estimated
+  void SetMinEntries(const long long n) { m_MinEntries = n; }
+
+  //! number of threads, 0 = number of cores
+  void SetNThreads(const unsigned int n) { m_NThreads = n; }
+
+  //! x/y are the per event ge and response, slice i is limits[i] <= x < limits[i+1]
+  std::vector<SliceEstimate> Estimate(const std::vector<double> &x, const std::vector<double> &y, const std::vector<double> &limits) const;
+
+  //! estimate of a single set of values, values is reordered
+  SliceEstimate Estimate(std::vector<double> &values) const;
+
+  //! graph of one quantity vs the mean x of the slices
+  static TGraphErrors *Graph(const std::vector<SliceEstimate> &estimates, const Quantity what, const std::string &name);
+
+  static void Print(const std::vector<SliceEstimate> &estimates);
+
+  const std::string &Name() const { return m_Name; }
+
+ private:
+  int m_MaxIterations = 20;
+  unsigned int m_NThreads = 0;
+
+  long long m_MinEntries = 10;
+
+  double m_Truncation = 2;
+  double m_Coverage = 0.6827;
+  double m_Tolerance = 1e-4;
+
+  std::string m_Name;
+};
+
+#endif  // RESOLUTIONESTIMATOR_H
@@ -1,10 +1,12 @@
 
 #include "SamplingFractionReco.h"
 
+#include "QAInstrumentation.h"
+#include "TruthReference.h"
+#include "TruthReferenceReco.h"
+
 #include <g4main/PHG4Hit.h>
 #include <g4main/PHG4HitContainer.h>
-#include <g4main/PHG4Particle.h>
-#include <g4main/PHG4TruthInfoContainer.h>
 
 #include <fun4all/Fun4AllReturnCodes.h>
 
@@ -42,51 +44,43 @@ int SamplingFractionReco::Init(PHCompositeNode *topNode)
   outfile = new TFile(outfilename.c_str(), "RECREATE");
   std::string title = "Sampling Fraction " + m_Detector;
   ntup = new TNtuple("sfntup", title.c_str(), "theta:phi:eta:p:escin:eabs:eion:light:esum");
+  m_Timer = QAInstrumentation::instance()->Stage(Name());
   return Fun4AllReturnCodes::EVENT_OK;
 }
 
 //____________________________________________________________________________..
 int SamplingFractionReco::InitRun(PHCompositeNode *topNode)
 {
+  if (!findNode::getClass<TruthReference>(topNode, TruthReferenceReco::NodeName()))
+  {
+    std::cout << "SamplingFractionReco::InitRun - could not find " << TruthReferenceReco::NodeName()
+              << ", register TruthReferenceReco before" << std::endl;
+    return Fun4AllReturnCodes::ABORTRUN;
+  }
   return Fun4AllReturnCodes::EVENT_OK;
 }
 
 //____________________________________________________________________________..
 int SamplingFractionReco::process_event(PHCompositeNode *topNode)
 {
-  PHG4TruthInfoContainer *truthinfo = findNode::getClass<PHG4TruthInfoContainer>(topNode, "G4TruthInfo");
+  QAInstrumentation::Scope timer(m_Timer);
+  // primary of the event, filled by TruthReferenceReco
+  const TruthReference *ref = findNode::getClass<TruthReference>(topNode, TruthReferenceReco::NodeName());
   double phi = NAN;
   double eta = NAN;
   double theta = NAN;
   double mom = NAN;
-  if (truthinfo)
+  if (ref->isValid())
   {
-    PHG4TruthInfoContainer::ConstRange range = truthinfo->GetPrimaryParticleRange();
-    int justone = 0;
-
-    for (PHG4TruthInfoContainer::ConstIterator iter = range.first;
-         iter != range.second;
-         ++iter)
-    {
-      justone++;
-      PHG4Particle *primary = iter->second;
-      double gpx = primary->get_px();
-      double gpy = primary->get_py();
-      phi = atan2(gpy, gpx) * 180. / M_PI;
-      double gpz = primary->get_pz();
-      double gpt = std::sqrt(gpx * gpx + gpy * gpy);
-      mom = std::sqrt(gpx * gpx + gpy * gpy + gpz * gpz);
-      if (gpt > 0)
-      {
-        eta = asinh(gpz / gpt);
-      }
-    }
-    if (justone > 1)
+    if (ref->get_nprimaries() > 1)
     {
       std::cout << "this only works for single particle events"
-                << " here I see " << justone << " primaries" << std::endl;
+                << " here I see " << ref->get_nprimaries() << " primaries" << std::endl;
       gSystem->Exit(1);
     }
+    phi = ref->get_phi() * 180. / M_PI;
+    mom = ref->get_p();
+    eta = ref->get_eta();
   }
   // add hits
   PHG4HitContainer *g4hits = findNode::getClass<PHG4HitContainer>(topNode, m_HitNodeName);
@@ -164,6 +158,7 @@ int SamplingFractionReco::End(PHCompositeNode *topNode)
   outfile->Write();
   outfile->Close();
   delete outfile;
+  QAInstrumentation::instance()->End();
   return Fun4AllReturnCodes::EVENT_OK;
 }
 
@@ -60,6 +60,7 @@ class SamplingFractionReco : public SubsysReco
   TFile *outfile = nullptr;
 
   int m_SupportFlag = 0;
+  int m_Timer = -1;  // QAInstrumentation stage
 
   std::string outfilename;
   std::string m_Detector;
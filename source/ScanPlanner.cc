@@ -0,0 +1,296 @@
+#include "ScanPlanner.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>  // for operator<<, endl, basic_ost...
+#include <map>
+#include <sstream>
+
+namespace
+{
+  //! false for empty and comment lines
+  bool DataLine(const std::string &line)
+  {
+    const size_t first = line.find_first_not_of(" \t");
+    return first != std::string::npos && line[first] != '#';
+  }
+
+  bool ReadPoint(std::istream &in, ScanPlanner::Point &p)
+  {
+    in >> p.particle >> p.emin >> p.emax >> p.etamin >> p.etamax >> p.detector >> p.nevents;
+    return !in.fail();
+  }
+
+  void WritePoint(std::ostream &out, const ScanPlanner::Point &p)
+  {
+    out << p.particle << " " << p.emin << " " << p.emax << " " << p.etamin << " " << p.etamax
+        << " " << p.detector << " " << p.nevents;
+  }
+
+  double MeanEnergy(const ScanPlanner::Point &p)
+  {
+    return 0.5 * (p.emin + p.emax);
+  }
+
+  bool EtaOverlap(const ScanPlanner::Point &a, const ScanPlanner::Point &b)
+  {
+    return a.etamin <= b.etamax && b.etamin <= a.etamax;
+  }
+}  // namespace
+
+//____________________________________________________________________________..
+int ScanPlanner::ReadScan(const std::string &file)
+{
+  std::ifstream in(file);
+  if (!in)
+  {
+    std::cout << "ScanPlanner::ReadScan - cannot open " << file << std::endl;
+    return -1;
+  }
+  int npoints = 0;
+  std::string line;
+  for (int iline = 1; std::getline(in, line); iline++)
+  {
+    if (!DataLine(line))
+    {
+      continue;
+    }
+    std::istringstream is(line);
+    Point p;
+    if (!ReadPoint(is, p) || p.nevents <= 0 || p.emax < p.emin || p.etamax < p.etamin)
+    {
+      std::cout << "ScanPlanner::ReadScan - " << file << ":" << iline << " is not a scan point: " << line << std::endl;
+      return -1;
+    }
+    AddPoint(p);
+    npoints++;
+  }
+  return npoints;
+}
+
+//____________________________________________________________________________..
+int ScanPlanner::ReadCosts(const std::string &file)
+{
+  std::ifstream in(file);
+  if (!in)
+  {
+    return 0;
+  }
+  int n = 0;
+  std::string line;
+  for (int iline = 1; std::getline(in, line); iline++)
+  {
+    if (!DataLine(line))
+    {
+      continue;
+    }
+    std::istringstream is(line);
+    Point p;
+    double seconds = 0;
+    if (!ReadPoint(is, p) || !(is >> seconds) || p.nevents <= 0 || !(seconds > 0))
+    {
+      // a job killed while the line was written, keep the rest
+      std::cout << "ScanPlanner::ReadCosts - skipping " << file << ":" << iline << ": " << line << std::endl;
+      continue;
+    }
+    AddMeasurement(p, seconds);
+    n++;
+  }
+  return n;
+}
+
+//____________________________________________________________________________..
+void ScanPlanner::AddMeasurement(const Point &point, const double seconds)
+{
+  Measurement m;
+  m.point = point;
+  m.seconds = seconds / point.nevents;
+  m_Measurements.push_back(m);
+}
+
+//____________________________________________________________________________..
+double ScanPlanner::EstimateCost(const Point &point) const
+{
+  std::vector<const Measurement *> selected;
+  for (const Measurement &m : m_Measurements)
+  {
+    if (m.point.detector == point.detector && m.point.particle == point.particle)
+    {
+      selected.push_back(&m);
+    }
+  }
+  if (selected.empty())
+  {
+    for (const Measurement &m : m_Measurements)
+    {
+      if (m.point.detector == point.detector)
+      {
+        selected.push_back(&m);
+      }
+    }
+  }
+  const double e = MeanEnergy(point);
+  if (selected.empty())
+  {
+    return m_DefaultCost * std::max(e, 1.);
+  }
+  if (std::any_of(selected.begin(), selected.end(), [&point](const Measurement *m) { return EtaOverlap(m->point, point); }))
+  {
+    selected.erase(std::remove_if(selected.begin(), selected.end(), [&point](const Measurement *m) { return !EtaOverlap(m->point, point); }),
+                   selected.end());
+  }
+
+  // event weighted mean cost per measured energy
+  std::map<double, std::pair<double, double>> sums;
+  for (const Measurement *m : selected)
+  {
+    std::pair<double, double> &sum = sums[MeanEnergy(m->point)];
+    sum.first += m->seconds * m->point.nevents;
+    sum.second += m->point.nevents;
+  }
+  std::vector<std::pair<double, double>> costs;
+  for (const auto &iter : sums)
+  {
+    costs.push_back(std::make_pair(iter.first, iter.second.first / iter.second.second));
+  }
+  if (e <= costs.front().first)
+  {
+    return costs.front().second;
+  }
+  if (e >= costs.back().first)
+  {
+    // the shower simulation scales with the energy
+    return (costs.back().first > 0) ? costs.back().second * e / costs.back().first : costs.back().second;
+  }
+  auto upper = std::upper_bound(costs.begin(), costs.end(), std::make_pair(e, 0.),
+                                [](const std::pair<double, double> &a, const std::pair<double, double> &b) { return a.first < b.first; });
+  auto lower = upper - 1;
+  const double f = (e - lower->first) / (upper->first - lower->first);
+  return lower->second + f * (upper->second - lower->second);
+}
+
+//____________________________________________________________________________..
+int ScanPlanner::Plan()
+{
+  m_Jobs.clear();
+  std::vector<double> costs;
+  double total = 0;
+  for (const Point &p : m_Points)
+  {
+    costs.push_back(EstimateCost(p));
+    total += costs.back() * p.nevents;
+  }
+  const double target = (m_NJobs > 0) ? total / m_NJobs : m_TargetTime;
+  if (!(target > 0))
+  {
+    std::cout << "ScanPlanner::Plan - no target time per job" << std::endl;
+    return 0;
+  }
+  for (size_t i = 0; i < m_Points.size(); i++)
+  {
+    const Point &p = m_Points[i];
+    // a tiny tolerance, otherwise an exact multiple of the target gets one more job
+    const long long njobs = std::min(p.nevents, std::max(1LL, static_cast<long long>(std::ceil(costs[i] * p.nevents / target - 1e-9))));
+    for (long long j = 0; j < njobs; j++)
+    {
+      Job job;
+      job.point = p;
+      job.point.nevents = p.nevents / njobs + ((j < p.nevents % njobs) ? 1 : 0);
+      job.seconds = costs[i] * job.point.nevents;
+      m_Jobs.push_back(job);
+    }
+  }
+  std::stable_sort(m_Jobs.begin(), m_Jobs.end(), [](const Job &a, const Job &b) { return a.seconds > b.seconds; });
+  for (size_t i = 0; i < m_Jobs.size(); i++)
+  {
+    m_Jobs[i].index = i;
+  }
+  if (m_Verbosity > 0)
+  {
+    Print();
+  }
+  return m_Jobs.size();
+}
+
+//____________________________________________________________________________..
+int ScanPlanner::WritePlan(const std::string &file) const
+{
+  std::ofstream out(file);
+  if (!out)
+  {
+    std::cout << "ScanPlanner::WritePlan - cannot open " << file << std::endl;
+    return -1;
+  }
+  out << "# job particle emin emax etamin etamax detector nevents seconds" << std::endl;
+  for (const Job &job : m_Jobs)
+  {
+    out << job.index << " ";
+    WritePoint(out, job.point);
+    out << " " << job.seconds << std::endl;
+  }
+  out.close();
+  if (!out)
+  {
+    std::cout << "ScanPlanner::WritePlan - error writing " << file << std::endl;
+    return -1;
+  }
+  return 0;
+}
+
+//____________________________________________________________________________..
+int ScanPlanner::ReadPlan(const std::string &file)
+{
+  std::ifstream in(file);
+  if (!in)
+  {
+    std::cout << "ScanPlanner::ReadPlan - cannot open " << file << std::endl;
+    return -1;
+  }
+  m_Jobs.clear();
+  std::string line;
+  for (int iline = 1; std::getline(in, line); iline++)
+  {
+    if (!DataLine(line))
+    {
+      continue;
+    }
+    std::istringstream is(line);
+    Job job;
+    if (!(is >> job.index) || !ReadPoint(is, job.point) || !(is >> job.seconds) || job.index != static_cast<int>(m_Jobs.size()))
+    {
+      std::cout << "ScanPlanner::ReadPlan - " << file << ":" << iline << " is not job " << m_Jobs.size() << ": " << line << std::endl;
+      m_Jobs.clear();
+      return -1;
+    }
+    m_Jobs.push_back(job);
+  }
+  return 0;
+}
+
+//____________________________________________________________________________..
+void ScanPlanner::Print(const std::string &what) const
+{
+  double total = 0;
+  for (const Job &job : m_Jobs)
+  {
+    total += job.seconds;
+  }
+  std::cout << "ScanPlanner: " << m_Points.size() << " scan points, " << m_Measurements.size() << " cost measurements, "
+            << m_Jobs.size() << " jobs, " << total / 3600. << " h expected in total" << std::endl;
+  if (what != "ALL")
+  {
+    return;
+  }
+  for (const Job &job : m_Jobs)
+  {
+    std::cout << std::setw(6) << job.index << "  " << std::setw(6) << job.point.particle
+              << std::setw(8) << job.point.emin << " -" << std::setw(6) << job.point.emax << " GeV"
+              << std::setw(7) << job.point.etamin << " <eta<" << std::setw(5) << job.point.etamax
+              << std::setw(9) << job.point.detector << std::setw(9) << job.point.nevents << " events"
+              << std::setw(10) << std::fixed << std::setprecision(0) << job.seconds << " s" << std::endl;
+    std::cout.unsetf(std::ios::floatfield);
+    std::cout << std::setprecision(6);
+  }
+}
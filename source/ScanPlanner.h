@@ -0,0 +1,101 @@
+// Tell emacs that this is a C++ source
+//  -*- C++ -*-.
+#ifndef SCANPLANNER_H
+#define SCANPLANNER_H
+
+#include <string>
+#include <vector>
+
+//! Splits a (particle, energy, eta, detector) scan into jobs of about equal run time
+/*!
+ * Replaces the fixed nEvents per job of SetUp.csh. The cost of a scan point
+ * (seconds per event) is estimated from the job times measured in earlier
+ * scans (ScanRunner appends them to the cost file): measurements of the same
+ * particle and detector with an overlapping eta range are interpolated
+ * linearly in the mean energy, above the highest measured energy the cost is
+ * extrapolated proportional to the energy, below the lowest it is kept
+ * constant. Without measurements of the particle the other particles of the
+ * detector are used, without any measurement DefaultCost() per GeV.
+ * Every point is split into jobs of at most the target time (given directly
+ * or as total cost / number of jobs), the events are shared evenly between
+ * the jobs of a point. The jobs are numbered longest first, so a runner
+ * starting them in order finishes the expensive ones early.
+ */
+class ScanPlanner
+{
+ public:
+  struct Point
+  {
+    std::string particle;
+    double emin = 0;  // generated momentum range (GeV)
+    double emax = 0;
+    double etamin = 0;
+    double etamax = 0;
+    std::string detector;  // runs Fun4All_G4_<detector>.C
+    long long nevents = 0;
+  };
+
+  struct Job
+  {
+    int index = 0;
+    Point point;  // nevents of this job
+    double seconds = 0;  // expected run time
+  };
+
+  ScanPlanner() {}
+
+  virtual ~ScanPlanner() {}
+
+  //! scan points, one per line: particle emin emax etamin etamax detector nevents; returns the number of points, -1 on error
+  int ReadScan(const std::string &file);
+
+  void AddPoint(const Point &point) { m_Points.push_back(point); }
+
+  //! measured jobs, one per line: particle emin emax etamin etamax detector nevents seconds; a missing file is no error
+  int ReadCosts(const std::string &file);
+
+  void AddMeasurement(const Point &point, const double seconds);
+
+  //! seconds per event
+  double EstimateCost(const Point &point) const;
+
+  //! maximum expected run time of a job (s), used if NJobs is not set
+  void SetTargetTime(const double s) { m_TargetTime = s; }
+
+  //! about this number of jobs instead of a target time, 0 = use the target time
+  void SetNJobs(const int n) { m_NJobs = n; }
+
+  //! seconds per event and GeV without any measurement
+  void DefaultCost(const double s) { m_DefaultCost = s; }
+
+  //! returns the number of jobs
+  int Plan();
+
+  const std::vector<Job> &Jobs() const { return m_Jobs; }
+
+  //! plan file, one job per line: index particle emin emax etamin etamax detector nevents seconds; returns 0 on success
+  int WritePlan(const std::string &file) const;
+  int ReadPlan(const std::string &file);
+
+  void Verbosity(const int i) { m_Verbosity = i; }
+
+  void Print(const std::string &what = "ALL") const;
+
+ private:
+  struct Measurement
+  {
+    Point point;
+    double seconds = 0;  // per event
+  };
+
+  int m_NJobs = 0;
+  int m_Verbosity = 0;
+  double m_TargetTime = 3600;
+  double m_DefaultCost = 0.1;
+
+  std::vector<Point> m_Points;
+  std::vector<Measurement> m_Measurements;
+  std::vector<Job> m_Jobs;
+};
+
+#endif  // SCANPLANNER_H
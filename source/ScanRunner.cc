@@ -0,0 +1,368 @@
+#include "ScanRunner.h"
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>  // for operator<<, endl, basic_ost...
+#include <map>
+#include <regex>
+#include <sstream>
+#include <thread>
+
+namespace
+{
+  bool ReadFile(const std::string &name, std::string &content)
+  {
+    std::ifstream in(name, std::ios::binary);
+    if (!in)
+    {
+      return false;
+    }
+    std::ostringstream ss;
+    ss << in.rdbuf();
+    content = ss.str();
+    return true;
+  }
+
+  bool WriteFile(const std::string &name, const std::string &content, const mode_t mode)
+  {
+    {
+      std::ofstream out(name, std::ios::binary | std::ios::trunc);
+      out << content;
+      if (!out)
+      {
+        return false;
+      }
+    }
+    return chmod(name.c_str(), mode) == 0;
+  }
+
+  void ReplaceAll(std::string &text, const std::string &from, const std::string &to)
+  {
+    for (size_t pos = text.find(from); pos != std::string::npos; pos = text.find(from, pos + to.size()))
+    {
+      text.replace(pos, from.size(), to);
+    }
+  }
+
+  //! replaces the first match, false if there is none
+  bool ReplaceFirst(std::string &text, const std::regex &re, const std::string &to)
+  {
+    std::smatch match;
+    if (!std::regex_search(text, match, re))
+    {
+      return false;
+    }
+    text.replace(match.position(0), match.length(0), to);
+    return true;
+  }
+
+  //! copies a directory with its subdirectories, keeps the file modes
+  int CopyTree(const std::string &src, const std::string &dst)
+  {
+    struct stat st;
+    if (stat(src.c_str(), &st) || !S_ISDIR(st.st_mode))
+    {
+      std::cout << "ScanRunner - " << src << " is not a directory" << std::endl;
+      return -1;
+    }
+    if (mkdir(dst.c_str(), st.st_mode & 07777))
+    {
+      std::cout << "ScanRunner - cannot create " << dst << ": " << strerror(errno) << std::endl;
+      return -1;
+    }
+    DIR *dir = opendir(src.c_str());
+    if (!dir)
+    {
+      std::cout << "ScanRunner - cannot read " << src << std::endl;
+      return -1;
+    }
+    int iret = 0;
+    while (struct dirent *entry = readdir(dir))
+    {
+      const std::string name = entry->d_name;
+      if (name == "." || name == "..")
+      {
+        continue;
+      }
+      const std::string from = src + "/" + name;
+      const std::string to = dst + "/" + name;
+      if (stat(from.c_str(), &st))
+      {
+        continue;
+      }
+      if (S_ISDIR(st.st_mode))
+      {
+        iret = CopyTree(from, to);
+      }
+      else if (S_ISREG(st.st_mode))
+      {
+        std::string content;
+        if (!ReadFile(from, content) || !WriteFile(to, content, st.st_mode & 07777))
+        {
+          std::cout << "ScanRunner - cannot copy " << from << " to " << to << std::endl;
+          iret = -1;
+        }
+      }
+      if (iret)
+      {
+        break;
+      }
+    }
+    closedir(dir);
+    return iret;
+  }
+
+  std::string Range(const double a, const double b)
+  {
+    std::ostringstream ss;
+    ss.precision(10);
+    ss << "(" << a << ", " << b << ")";
+    return ss.str();
+  }
+}  // namespace
+
+//____________________________________________________________________________..
+ScanRunner::ScanRunner(const std::string &macrodir, const std::string &outdir)
+  : m_MacroDir(macrodir)
+  , m_OutDir(outdir)
+{
+}
+
+//____________________________________________________________________________..
+std::string ScanRunner::JobDir(const int index) const
+{
+  // Combiner.csh renames macros to macros0
+  return m_OutDir + "/macros" + ((index > 0) ? std::to_string(index) : "");
+}
+
+//____________________________________________________________________________..
+int ScanRunner::Prepare(const std::vector<ScanPlanner::Job> &jobs)
+{
+  m_Jobs = jobs;
+  m_Results.assign(jobs.size(), Result());
+  if (mkdir(m_OutDir.c_str(), 0755) && errno != EEXIST)
+  {
+    std::cout << "ScanRunner::Prepare - cannot create " << m_OutDir << ": " << strerror(errno) << std::endl;
+    return -1;
+  }
+  for (const ScanPlanner::Job &job : m_Jobs)
+  {
+    if (PrepareJob(job))
+    {
+      return -1;
+    }
+  }
+  if (m_CombinerDir.empty())
+  {
+    return 0;
+  }
+  std::string combiner;
+  std::string hadd;
+  if (!ReadFile(m_CombinerDir + "/Combiner.csh", combiner) || !ReadFile(m_CombinerDir + "/hadd.C", hadd))
+  {
+    std::cout << "ScanRunner::Prepare - no Combiner.csh and hadd.C in " << m_CombinerDir << std::endl;
+    return -1;
+  }
+  ReplaceAll(combiner, "noOfJobsCombiner", std::to_string(m_Jobs.size()));
+  if (!WriteFile(m_OutDir + "/Combiner.csh", combiner, 0755) || !WriteFile(m_OutDir + "/hadd.C", hadd, 0644))
+  {
+    std::cout << "ScanRunner::Prepare - cannot write Combiner.csh and hadd.C to " << m_OutDir << std::endl;
+    return -1;
+  }
+  return 0;
+}
+
+//____________________________________________________________________________..
+int ScanRunner::PrepareJob(const ScanPlanner::Job &job) const
+{
+  const std::string dir = JobDir(job.index);
+  if (CopyTree(m_MacroDir, dir))
+  {
+    return -1;
+  }
+  const std::string script = dir + "/myscript.csh";
+  const std::string macro = "Fun4All_G4_" + job.point.detector + ".C";
+  std::string text;
+  if (!ReadFile(script, text))
+  {
+    std::cout << "ScanRunner::PrepareJob - no myscript.csh in " << m_MacroDir << std::endl;
+    return -1;
+  }
+  ReplaceAll(text, "nEvents", std::to_string(job.point.nevents));
+  ReplaceAll(text, "jobNumber", std::to_string(job.index));
+  ReplaceAll(text, "Fun4All_G4_EICDetector.C", macro);
+  if (!WriteFile(script, text, 0755))
+  {
+    std::cout << "ScanRunner::PrepareJob - cannot write " << script << std::endl;
+    return -1;
+  }
+
+  if (!ReadFile(dir + "/" + macro, text))
+  {
+    std::cout << "ScanRunner::PrepareJob - no " << macro << " in " << m_MacroDir << std::endl;
+    return -1;
+  }
+  static const std::regex particle("add_particles\\(\"[^\"]*\"");
+  static const std::regex eta("set_eta_range\\([^)]*\\)");
+  static const std::regex momentum("set_p_range\\([^)]*\\)");
+  if (!ReplaceFirst(text, particle, "add_particles(\"" + job.point.particle + "\"") ||
+      !ReplaceFirst(text, eta, "set_eta_range" + Range(job.point.etamin, job.point.etamax)) ||
+      !ReplaceFirst(text, momentum, "set_p_range" + Range(job.point.emin, job.point.emax)))
+  {
+    std::cout << "ScanRunner::PrepareJob - no simple event generator (add_particles, set_eta_range, set_p_range) in " << macro << std::endl;
+    return -1;
+  }
+  if (!WriteFile(dir + "/" + macro, text, 0644))
+  {
+    std::cout << "ScanRunner::PrepareJob - cannot write " << dir << "/" << macro << std::endl;
+    return -1;
+  }
+  return 0;
+}
+
+//____________________________________________________________________________..
+int ScanRunner::Run(const std::vector<ScanPlanner::Job> &jobs)
+{
+  if (Prepare(jobs))
+  {
+    return -1;
+  }
+  typedef std::chrono::steady_clock clock;
+  const unsigned int nprocesses = m_NProcesses > 0 ? m_NProcesses : std::max(1U, std::thread::hardware_concurrency());
+  std::map<pid_t, std::pair<size_t, clock::time_point>> running;
+  size_t next = 0;
+  int failed = 0;
+  while (next < m_Jobs.size() || !running.empty())
+  {
+    if (next < m_Jobs.size() && running.size() < nprocesses)
+    {
+      const size_t ijob = next++;
+      if (m_Verbosity > 0)
+      {
+        std::cout << "ScanRunner::Run - starting job " << ijob << " in " << JobDir(ijob) << std::endl;
+      }
+      // otherwise the job repeats what is still buffered
+      std::cout.flush();
+      std::fflush(stdout);
+      std::fflush(stderr);
+      const pid_t pid = fork();
+      if (pid == 0)
+      {
+        RunJob(m_Jobs[ijob]);
+      }
+      if (pid < 0)
+      {
+        std::cout << "ScanRunner::Run - cannot start job " << ijob << std::endl;
+        m_Results[ijob].exit_code = -1;
+        failed++;
+        continue;
+      }
+      running[pid] = std::make_pair(ijob, clock::now());
+      continue;
+    }
+    int status = 0;
+    const pid_t pid = waitpid(-1, &status, 0);
+    if (pid < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      break;
+    }
+    auto iter = running.find(pid);
+    if (iter == running.end())
+    {
+      continue;
+    }
+    const size_t ijob = iter->second.first;
+    Result &result = m_Results[ijob];
+    result.seconds = std::chrono::duration<double>(clock::now() - iter->second.second).count();
+    result.exit_code = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+    std::string out;
+    result.done = ReadFile(JobDir(ijob) + "/condor.out", out) && out.find("condorjob done") != std::string::npos;
+    if (result.exit_code == 0 && result.done)
+    {
+      RecordCost(m_Jobs[ijob], result);
+    }
+    else
+    {
+      failed++;
+    }
+    if (m_Verbosity > 0)
+    {
+      std::cout << "ScanRunner::Run - job " << ijob << " finished after " << result.seconds << " s (expected "
+                << m_Jobs[ijob].seconds << " s), exit code " << result.exit_code << (result.done ? "" : ", not done") << std::endl;
+    }
+    running.erase(iter);
+  }
+  return failed;
+}
+
+//____________________________________________________________________________..
+void ScanRunner::RunJob(const ScanPlanner::Job &job) const
+{
+  // runs in the forked process, like a condor job with Output = condor.out, Error = condor.err
+  const std::string dir = JobDir(job.index);
+  if (chdir(dir.c_str()) || !std::freopen("condor.out", "w", stdout) || !std::freopen("condor.err", "w", stderr))
+  {
+    _exit(126);
+  }
+  execl("/bin/sh", "sh", "-c", m_Command.c_str(), static_cast<char *>(nullptr));
+  _exit(127);
+}
+
+//____________________________________________________________________________..
+void ScanRunner::RecordCost(const ScanPlanner::Job &job, const Result &result) const
+{
+  if (m_CostFile.empty())
+  {
+    return;
+  }
+  std::ofstream out(m_CostFile, std::ios::app);
+  out << job.point.particle << " " << job.point.emin << " " << job.point.emax << " " << job.point.etamin << " "
+      << job.point.etamax << " " << job.point.detector << " " << job.point.nevents << " " << result.seconds << std::endl;
+  if (!out)
+  {
+    std::cout << "ScanRunner::RecordCost - cannot write " << m_CostFile << std::endl;
+  }
+}
+
+//____________________________________________________________________________..
+void ScanRunner::Print(const std::string &what) const
+{
+  int ndone = 0;
+  double expected = 0;
+  double measured = 0;
+  for (size_t i = 0; i < m_Results.size(); i++)
+  {
+    if (m_Results[i].exit_code == 0 && m_Results[i].done)
+    {
+      ndone++;
+      expected += m_Jobs[i].seconds;
+      measured += m_Results[i].seconds;
+    }
+  }
+  std::cout << "ScanRunner: " << ndone << " of " << m_Jobs.size() << " jobs done in " << m_OutDir << ", "
+            << measured / 3600. << " h run time (" << expected / 3600. << " h expected)" << std::endl;
+  if (what != "ALL")
+  {
+    return;
+  }
+  for (size_t i = 0; i < m_Results.size(); i++)
+  {
+    if (m_Results[i].exit_code != 0 || !m_Results[i].done)
+    {
+      std::cout << "  job " << i << " failed (exit code " << m_Results[i].exit_code << "), see " << JobDir(i) << "/condor.out/err" << std::endl;
+    }
+  }
+}
@@ -0,0 +1,80 @@
+// Tell emacs that this is a C++ source
+//  -*- C++ -*-.
+#ifndef SCANRUNNER_H
+#define SCANRUNNER_H
+
+#include "ScanPlanner.h"
+
+#include <string>
+#include <vector>
+
+//! Runs the jobs of a ScanPlanner on the cores of this machine
+/*!
+ * Local replacement of SetUp.csh and condor. Every job gets a copy of the
+ * macros directory in the layout Combiner.csh expects (job 0 in
+ * <outdir>/macros, job j in <outdir>/macros<j>) with the substitutions of
+ * SetUp.csh done per job: nEvents and jobNumber in myscript.csh, which runs
+ * Fun4All_G4_<detector>.C, and the particle, momentum and eta range of the
+ * simple event generator in that macro. Combiner.csh and hadd.C are copied
+ * to <outdir> with the number of jobs filled in.
+ * The jobs are started in plan order (longest first) by a pool of forked
+ * processes, stdout and stderr go to condor.out and condor.err of the job.
+ * The run time of every job which finished with "condorjob done" is
+ * appended to the cost file the ScanPlanner reads for the next scan.
+ */
+class ScanRunner
+{
+ public:
+  ScanRunner(const std::string &macrodir = "macros", const std::string &outdir = "scan");
+
+  virtual ~ScanRunner() {}
+
+  //! number of parallel jobs, 0 = number of cores
+  void SetNProcesses(const unsigned int n) { m_NProcesses = n; }
+
+  //! run in the job directory, default tcsh myscript.csh
+  void SetCommand(const std::string &cmd) { m_Command = cmd; }
+
+  //! directory of Combiner.csh and hadd.C, empty = do not copy them
+  void SetCombinerDir(const std::string &dir) { m_CombinerDir = dir; }
+
+  void SetCostFile(const std::string &file) { m_CostFile = file; }
+
+  void Verbosity(const int i) { m_Verbosity = i; }
+
+  //! creates the job directories, returns 0 on success
+  int Prepare(const std::vector<ScanPlanner::Job> &jobs);
+
+  //! Prepare() and run all jobs, returns the number of failed jobs, -1 if the jobs could not be set up
+  int Run(const std::vector<ScanPlanner::Job> &jobs);
+
+  void Print(const std::string &what = "ALL") const;
+
+ private:
+  struct Result
+  {
+    int exit_code = 0;
+    bool done = false;  // "condorjob done" in condor.out
+    double seconds = 0;
+  };
+
+  std::string JobDir(const int index) const;
+  int PrepareJob(const ScanPlanner::Job &job) const;
+  //! in the forked process, never returns
+  void RunJob(const ScanPlanner::Job &job) const;
+  void RecordCost(const ScanPlanner::Job &job, const Result &result) const;
+
+  unsigned int m_NProcesses = 0;
+  int m_Verbosity = 0;
+
+  std::string m_MacroDir;
+  std::string m_OutDir;
+  std::string m_Command = "tcsh myscript.csh";
+  std::string m_CombinerDir = ".";
+  std::string m_CostFile = "scan_costs.txt";
+
+  std::vector<ScanPlanner::Job> m_Jobs;
+  std::vector<Result> m_Results;
+};
+
+#endif  // SCANRUNNER_H
@@ -0,0 +1,285 @@
+#include "SliceFitter.h"
+
+#include <ROOT/TSeq.hxx>
+#include <ROOT/TThreadExecutor.hxx>
+
+#include <Fit/BinData.h>
+#include <Fit/DataOptions.h>
+#include <Fit/DataRange.h>
+#include <Fit/FitResult.h>
+#include <Fit/Fitter.h>
+#include <HFitInterface.h>
+#include <Math/WrappedParamFunction.h>
+
+#include <TAxis.h>
+#include <TF1.h>
+#include <TGraphErrors.h>
+#include <TH1.h>
+#include <TH2.h>
+#include <TList.h>
+#include <TObjArray.h>
+#include <TROOT.h>
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>  // for operator<<, endl, basic_ost...
+#include <memory>
+
+namespace
+{
+  //! same parametrisation as the TF1 "gaus"
+  double Gaus(const double *x, const double *p)
+  {
+    const double t = (x[0] - p[1]) / p[2];
+    return p[0] * std::exp(-0.5 * t * t);
+  }
+
+  //! histogram with the binning of axis, not attached to any directory
+  TH1D *BookLike(const std::string &name, const std::string &title, const TAxis *axis)
+  {
+    const bool status = TH1::AddDirectoryStatus();
+    TH1::AddDirectory(kFALSE);
+    TH1D *h = nullptr;
+    if (axis->GetXbins()->GetSize() > 0)
+    {
+      h = new TH1D(name.c_str(), title.c_str(), axis->GetNbins(), axis->GetXbins()->GetArray());
+    }
+    else
+    {
+      h = new TH1D(name.c_str(), title.c_str(), axis->GetNbins(), axis->GetXmin(), axis->GetXmax());
+    }
+    TH1::AddDirectory(status);
+    return h;
+  }
+}  // namespace
+
+//____________________________________________________________________________..
+SliceFitter::SliceFitter(const std::string &name)
+  : m_Name(name)
+{
+}
+
+//____________________________________________________________________________..
+std::vector<SliceFitter::SliceFit> SliceFitter::Fit(const TH2 *h2, std::vector<TH1D *> *slices, const int firstbin, const int lastbin) const
+{
+  std::vector<SliceFit> rows;
+  const int nx = h2->GetNbinsX();
+  const int ny = h2->GetNbinsY();
+  const int first = std::max(firstbin, 1);
+  const int last = lastbin < 0 ? nx : std::min(lastbin, nx);
+  if (last < first)
+  {
+    return rows;
+  }
+
+  // all slices in one sweep over the TH2, the projections are not attached
+  // to any directory and do not need unique names
+  std::vector<std::unique_ptr<TH1D>> projections;
+  for (int ix = first; ix <= last; ix++)
+  {
+    std::string hname = std::string(h2->GetName()) + "_slice_" + std::to_string(ix);
+    projections.emplace_back(BookLike(hname, h2->GetTitle(), h2->GetYaxis()));
+    projections.back()->GetXaxis()->SetTitle(h2->GetYaxis()->GetTitle());
+    SliceFit row;
+    row.bin = ix;
+    row.x = h2->GetXaxis()->GetBinCenter(ix);
+    row.x_error = h2->GetXaxis()->GetBinWidth(ix) / 2;
+    rows.push_back(row);
+  }
+  for (int ix = first; ix <= last; ix++)
+  {
+    TH1D *h = projections[ix - first].get();
+    double sum = 0;
+    for (int iy = 0; iy <= ny + 1; iy++)
+    {
+      const int bin = h2->GetBin(ix, iy);
+      const double content = h2->GetBinContent(bin);
+      h->SetBinContent(iy, content);
+      h->SetBinError(iy, h2->GetBinError(bin));
+      if (iy >= 1 && iy <= ny)
+      {
+        sum += content;
+      }
+    }
+    h->SetEntries(sum);
+    rows[ix - first].entries = sum;
+  }
+
+  // every fit only reads its own projection
+  auto fit = [&](const size_t i) { return FitSlice(*projections[i], rows[i]); };
+  ROOT::EnableThreadSafety();
+  ROOT::TThreadExecutor pool(m_NThreads);
+  rows = pool.Map(fit, ROOT::TSeqUL(projections.size()));
+
+  if (slices)
+  {
+    for (size_t i = 0; i < projections.size(); i++)
+    {
+      const SliceFit &row = rows[i];
+      TH1D *h = projections[i].release();
+      if (row.fitted)
+      {
+        const TAxis *axis = h->GetXaxis();
+        TF1 *f = new TF1((std::string(h->GetName()) + "_gaus").c_str(), "gaus", axis->GetXmin(), axis->GetXmax(), TF1::EAddToList::kNo);
+        f->SetParameters(row.constant, row.mean, row.sigma);
+        f->SetParError(0, row.constant_error);
+        f->SetParError(1, row.mean_error);
+        f->SetParError(2, row.sigma_error);
+        f->SetChisquare(row.chi2 * row.ndf);
+        f->SetNDF(row.ndf);
+        h->GetListOfFunctions()->Add(f);
+      }
+      slices->push_back(h);
+    }
+  }
+  if (m_Verbosity > 0)
+  {
+    std::cout << "SliceFitter " << m_Name << ": " << h2->GetName() << std::endl;
+    Print(rows);
+  }
+  return rows;
+}
+
+//____________________________________________________________________________..
+TGraphErrors *SliceFitter::Graph(const std::vector<SliceFit> &fits, const Quantity what, const std::string &name, const bool xerrors)
+{
+  TGraphErrors *ge = new TGraphErrors();
+  ge->SetName(name.c_str());
+  for (const auto &row : fits)
+  {
+    if (!row.fitted)
+    {
+      continue;
+    }
+    double y = 0;
+    double ey = 0;
+    switch (what)
+    {
+    case kMean:
+      y = row.mean;
+      ey = row.mean_error;
+      break;
+    case kSigma:
+      y = row.sigma;
+      ey = row.sigma_error;
+      break;
+    case kChi2:
+      y = row.chi2;
+      break;
+    case kResolution:
+      y = row.sigma / row.mean;
+      ey = row.sigma_error / row.mean;
+      break;
+    }
+    const int n = ge->GetN();
+    ge->SetPoint(n, row.x, y);
+    ge->SetPointError(n, xerrors ? row.x_error : 0, ey);
+  }
+  return ge;
+}
+
+//____________________________________________________________________________..
+void SliceFitter::MakeHistos(const TH2 *h2, const std::vector<SliceFit> &fits, TObjArray &arr)
+{
+  const char *parnames[] = {"Constant", "Mean", "Sigma"};
+  std::vector<TH1D *> histos;
+  for (int ipar = 0; ipar < 3; ipar++)
+  {
+    std::string title = "Fitted value of par[" + std::to_string(ipar) + "]=" + parnames[ipar];
+    histos.push_back(BookLike(std::string(h2->GetName()) + "_" + std::to_string(ipar), title, h2->GetXaxis()));
+  }
+  histos.push_back(BookLike(std::string(h2->GetName()) + "_chi2", "chisquare", h2->GetXaxis()));
+  for (const auto &row : fits)
+  {
+    if (!row.fitted)
+    {
+      continue;
+    }
+    histos[0]->SetBinContent(row.bin, row.constant);
+    histos[0]->SetBinError(row.bin, row.constant_error);
+    histos[1]->SetBinContent(row.bin, row.mean);
+    histos[1]->SetBinError(row.bin, row.mean_error);
+    histos[2]->SetBinContent(row.bin, row.sigma);
+    histos[2]->SetBinError(row.bin, row.sigma_error);
+    histos[3]->SetBinContent(row.bin, row.chi2);
+  }
+  for (auto h : histos)
+  {
+    arr.Add(h);
+  }
+}
+
+//____________________________________________________________________________..
+void SliceFitter::Print(const std::vector<SliceFit> &fits)
+{
+  for (const auto &row : fits)
+  {
+    std::cout << "  bin " << std::setw(3) << row.bin << " x " << row.x << " +- " << row.x_error
+              << ", " << row.entries << " entries";
+    if (row.fitted)
+    {
+      std::cout << ": mean " << row.mean << " +- " << row.mean_error
+                << ", sigma " << row.sigma << " +- " << row.sigma_error
+                << ", chi2/ndf " << row.chi2;
+    }
+    else
+    {
+      std::cout << ": not fitted";
+    }
+    std::cout << std::endl;
+  }
+}
+
+//____________________________________________________________________________..
+SliceFitter::SliceFit SliceFitter::FitSlice(const TH1D &slice, SliceFit row) const
+{
+  if (row.entries <= 0 || row.entries < m_MinEntries)
+  {
+    return row;
+  }
+  // seeds from the slice itself, independent of any previous fit
+  double seed[3] = {slice.GetMaximum(), slice.GetMean(), slice.GetStdDev()};
+  if (seed[2] <= 0)
+  {
+    seed[2] = slice.GetXaxis()->GetBinWidth(1);
+  }
+
+  ROOT::Fit::DataOptions opt;
+  ROOT::Fit::DataRange range;
+  if (m_FitRangeSigma > 0)
+  {
+    range.SetRange(seed[1] - m_FitRangeSigma * seed[2], seed[1] + m_FitRangeSigma * seed[2]);
+  }
+  ROOT::Fit::BinData data(opt, range);
+  ROOT::Fit::FillData(data, &slice);
+  // as FitSlicesY, not enough non empty bins for three parameters
+  if (data.Size() < 3)
+  {
+    return row;
+  }
+
+  ROOT::Math::WrappedParamFunction<> gaus(&Gaus, 1, 3);
+  ROOT::Fit::Fitter fitter;
+  fitter.Config().SetMinimizer("Minuit2");
+  fitter.Config().MinimizerOptions().SetPrintLevel(0);
+  fitter.SetFunction(gaus, false);
+  fitter.Config().SetParamsSettings(3, seed);
+  const bool ok = fitter.Fit(data);
+  const ROOT::Fit::FitResult &result = fitter.Result();
+  row.status = result.Status();
+  if (!ok)
+  {
+    return row;
+  }
+  row.fitted = true;
+  row.constant = result.Parameter(0);
+  row.constant_error = result.ParError(0);
+  row.mean = result.Parameter(1);
+  row.mean_error = result.ParError(1);
+  // the gaus is symmetric in sigma, the minimizer may end up on the negative side
+  row.sigma = std::fabs(result.Parameter(2));
+  row.sigma_error = result.ParError(2);
+  row.ndf = result.Ndf();
+  row.chi2 = row.ndf > 0 ? result.Chi2() / row.ndf : 0;
+  return row;
+}
@@ -0,0 +1,97 @@
+// Tell emacs that this is a C++ source
+//  -*- C++ -*-.
+#ifndef SLICEFITTER_H
+#define SLICEFITTER_H
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+class TGraphErrors;
+class TH1D;
+class TH2;
+class TObjArray;
+
+//! Gaussian fits of the y slices of a TH2 (response vs energy)
+/*!
+ * Replaces FitSlicesY and the per slice ProjectionY/Fit loops of the
+ * LoopEval and QA_Draw macros. All slices are projected in one sweep over
+ * the bins of the TH2, then fitted concurrently. Every fit is seeded with the
+ * maximum, mean and RMS of its slice and uses its own Minuit2 fitter without
+ * any TF1/gROOT state, so the result does not depend on the number of
+ * threads or on the order in which the slices are done. The result is one
+ * table row per slice, from which graphs or FitSlicesY like histograms are
+ * made.
+ */
+class SliceFitter
+{
+ public:
+  enum Quantity
+  {
+    kMean,
+    kSigma,
+    kChi2,
+    kResolution  // sigma/mean
+  };
+
+  struct SliceFit
+  {
+    int bin = 0;
+    double x = 0;
+    double x_error = 0;  // half bin width
+    double entries = 0;
+    bool fitted = false;
+    int status = -1;
+    double constant = NAN;
+    double constant_error = NAN;
+    double mean = NAN;
+    double mean_error = NAN;
+    double sigma = NAN;
+    double sigma_error = NAN;
+    double chi2 = NAN;  // chi2/ndf
+    int ndf = 0;
+  };
+
+  SliceFitter(const std::string &name = "SliceFitter");
+
+  virtual ~SliceFitter() {}
+
+  //! slices with fewer entries are not fitted
+  void SetMinEntries(const double n) { m_MinEntries = n; }
+
+  //! fit range mean +- nsigma * RMS of the slice, 0 = full y axis
+  void SetFitRange(const double nsigma) { m_FitRangeSigma = nsigma; }
+
+  //! number of threads, 0 = number of cores
+  void SetNThreads(const unsigned int n) { m_NThreads = n; }
+
+  void Verbosity(const int i) { m_Verbosity = i; }
+
+  //! fit the x bins firstbin..lastbin (-1 = last bin) of h2, one row per bin
+  //! if slices is given it gets the projections (owned by the caller) with
+  //! the fitted gaus attached, so they can be drawn directly
+  std::vector<SliceFit> Fit(const TH2 *h2, std::vector<TH1D *> *slices = nullptr, const int firstbin = 1, const int lastbin = -1) const;
+
+  //! graph of one quantity vs x for the fitted slices
+  static TGraphErrors *Graph(const std::vector<SliceFit> &fits, const Quantity what, const std::string &name, const bool xerrors = true);
+
+  //! histograms <h2>_0 (constant), _1 (mean), _2 (sigma) and _chi2 as FitSlicesY makes them
+  static void MakeHistos(const TH2 *h2, const std::vector<SliceFit> &fits, TObjArray &arr);
+
+  static void Print(const std::vector<SliceFit> &fits);
+
+  const std::string &Name() const { return m_Name; }
+
+ private:
+  SliceFit FitSlice(const TH1D &slice, SliceFit row) const;
+
+  int m_Verbosity = 0;
+  unsigned int m_NThreads = 0;
+
+  double m_MinEntries = 10;
+  double m_FitRangeSigma = 0;
+
+  std::string m_Name;
+};
+
+#endif  // SLICEFITTER_H
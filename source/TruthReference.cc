@@ -0,0 +1,119 @@
+#include "TruthReference.h"
+
+namespace
+{
+  void Cross(const double *a, const double *b, double *c)
+  {
+    c[0] = a[1] * b[2] - a[2] * b[1];
+    c[1] = a[2] * b[0] - a[0] * b[2];
+    c[2] = a[0] * b[1] - a[1] * b[0];
+  }
+
+  //! same rounding as TVector3::Unit() and Hep3Vector::unit()
+  void Unit(double *a)
+  {
+    const double mag2 = a[0] * a[0] + a[1] * a[1] + a[2] * a[2];
+    if (mag2 > 0)
+    {
+      const double scale = 1.0 / std::sqrt(mag2);
+      for (int i = 0; i < 3; i++)
+      {
+        a[i] *= scale;
+      }
+    }
+  }
+
+  bool IsNull(const double *a)
+  {
+    return a[0] == 0 && a[1] == 0 && a[2] == 0;
+  }
+}  // namespace
+
+//____________________________________________________________________________..
+void TruthReference::identify(std::ostream &os) const
+{
+  os << "TruthReference: " << nprimaries << " primaries with " << total_primary_energy << " GeV" << std::endl;
+  if (!isValid())
+  {
+    return;
+  }
+  os << "  track " << track_id << " pid " << pid << " e " << e << " p (" << px << ", " << py << ", " << pz << ")"
+     << " eta " << get_eta() << " phi " << get_phi() << std::endl;
+  os << "  vertex (" << vx << ", " << vy << ", " << vz << ") t " << vt << std::endl;
+  os << "  axis_proj (" << axis_proj[0] << ", " << axis_proj[1] << ", " << axis_proj[2] << ")"
+     << " axis_azimuth (" << axis_azimuth[0] << ", " << axis_azimuth[1] << ", " << axis_azimuth[2] << ")"
+     << " axis_polar (" << axis_polar[0] << ", " << axis_polar[1] << ", " << axis_polar[2] << ")" << std::endl;
+}
+
+//____________________________________________________________________________..
+void TruthReference::Reset()
+{
+  track_id = 0;
+  pid = 0;
+  nprimaries = 0;
+  e = NAN;
+  px = NAN;
+  py = NAN;
+  pz = NAN;
+  vx = NAN;
+  vy = NAN;
+  vz = NAN;
+  vt = NAN;
+  total_primary_energy = 0;
+  // frame of a particle along z
+  for (int i = 0; i < 3; i++)
+  {
+    axis_proj[i] = (i == 2);
+    axis_azimuth[i] = (i == 0);
+    axis_polar[i] = (i == 1);
+  }
+}
+
+//____________________________________________________________________________..
+void TruthReference::set_primary(const int trackid, const int id, const double energy, const double momx, const double momy, const double momz)
+{
+  track_id = trackid;
+  pid = id;
+  e = energy;
+  px = momx;
+  py = momy;
+  pz = momz;
+
+  // projection axis
+  axis_proj[0] = px;
+  axis_proj[1] = py;
+  axis_proj[2] = pz;
+  if (IsNull(axis_proj))
+  {
+    axis_proj[2] = 1;
+  }
+  Unit(axis_proj);
+
+  // azimuthal direction axis
+  const double beam[3] = {0, 0, 1};
+  Cross(axis_proj, beam, axis_azimuth);
+  if (IsNull(axis_azimuth))
+  {
+    axis_azimuth[0] = 1;
+  }
+  Unit(axis_azimuth);
+
+  // polar direction axis
+  Cross(axis_proj, axis_azimuth, axis_polar);
+  Unit(axis_polar);
+}
+
+//____________________________________________________________________________..
+double TruthReference::get_eta() const
+{
+  const double pt = get_pt();
+  return (pt > 0) ? std::asinh(pz / pt) : NAN;
+}
+
+//____________________________________________________________________________..
+void TruthReference::Lateral(const double x, const double y, const double z, double &polar, double &azimuth) const
+{
+  const double d[3] = {x - vx, y - vy, z - vz};
+  polar = axis_polar[0] * d[0] + axis_polar[1] * d[1] + axis_polar[2] * d[2];
+  azimuth = axis_azimuth[0] * d[0] + axis_azimuth[1] * d[1] + axis_azimuth[2] * d[2];
+}
@@ -0,0 +1,106 @@
+// Tell emacs that this is a C++ source
+//  -*- C++ -*-.
+#ifndef TRUTHREFERENCE_H
+#define TRUTHREFERENCE_H
+
+#include <phool/PHObject.h>
+
+#include <cmath>
+#include <iostream>
+
+//! Truth reference of the event: last primary, its vertex and projection frame
+/*!
+ * Filled once per event by TruthReferenceReco (node TruthReference under PAR)
+ * and read by the QA and Eval modules instead of each of them looking up the
+ * primary in G4TruthInfo. The reference particle is the last primary (the
+ * particle of single particle events), the vertex is its production vertex.
+ * The projection frame follows the momentum of the primary:
+ *  - axis_proj: direction of the primary (z if it has no momentum),
+ *  - axis_azimuth: axis_proj x z (x along the beam),
+ *  - axis_polar: axis_proj x axis_azimuth,
+ * Lateral() gives the polar and azimuthal distance of a point to the axis
+ * through the vertex, as in the lateral truth projection histograms.
+ */
+class TruthReference : public PHObject
+{
+ public:
+  TruthReference() {}
+  virtual ~TruthReference() {}
+
+  void identify(std::ostream &os = std::cout) const override;
+
+  void Reset() override;
+
+  //! 1 if the event has a primary with a vertex
+  int isValid() const override { return nprimaries > 0; }
+
+  //! reference particle, computes the projection frame
+  void set_primary(const int trackid, const int id, const double energy, const double momx, const double momy, const double momz);
+
+  void set_vertex(const double x, const double y, const double z, const double t)
+  {
+    vx = x;
+    vy = y;
+    vz = z;
+    vt = t;
+  }
+
+  //! number and energy sum of all primaries
+  void set_primaries(const int n, const double energy)
+  {
+    nprimaries = n;
+    total_primary_energy = energy;
+  }
+
+  //! track id in G4TruthInfo (PHG4TruthInfoContainer::GetParticle())
+  int get_track_id() const { return track_id; }
+  int get_pid() const { return pid; }
+  double get_e() const { return e; }
+  double get_px() const { return px; }
+  double get_py() const { return py; }
+  double get_pz() const { return pz; }
+  double get_pt() const { return std::sqrt(px * px + py * py); }
+  double get_p() const { return std::sqrt(px * px + py * py + pz * pz); }
+
+  //! NAN along the beam
+  double get_eta() const;
+  double get_phi() const { return std::atan2(py, px); }
+  double get_theta() const { return std::acos(pz / get_p()); }
+
+  double get_vx() const { return vx; }
+  double get_vy() const { return vy; }
+  double get_vz() const { return vz; }
+  double get_vt() const { return vt; }
+
+  int get_nprimaries() const { return nprimaries; }
+  double get_total_primary_energy() const { return total_primary_energy; }
+
+  //! component i (0 - 2) of the frame axes
+  double get_axis_proj(const int i) const { return axis_proj[i]; }
+  double get_axis_azimuth(const int i) const { return axis_azimuth[i]; }
+  double get_axis_polar(const int i) const { return axis_polar[i]; }
+
+  //! polar and azimuthal distance of (x, y, z) to the axis through the vertex
+  void Lateral(const double x, const double y, const double z, double &polar, double &azimuth) const;
+
+ private:
+  int track_id = 0;
+  int pid = 0;
+  int nprimaries = 0;
+  double e = NAN;
+  double px = NAN;
+  double py = NAN;
+  double pz = NAN;
+  double vx = NAN;
+  double vy = NAN;
+  double vz = NAN;
+  double vt = NAN;
+  double total_primary_energy = 0;
+  double axis_proj[3] = {0, 0, 1};
+  double axis_azimuth[3] = {1, 0, 0};
+  double axis_polar[3] = {0, 1, 0};
+
+  ClassDefOverride(TruthReference, 1)
+};
+
+#endif  // TRUTHREFERENCE_H
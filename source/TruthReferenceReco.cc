@@ -0,0 +1,110 @@
+#include "TruthReferenceReco.h"
+
+#include "QAInstrumentation.h"
+#include "TruthReference.h"
+
+#include <g4main/PHG4Particle.h>
+#include <g4main/PHG4TruthInfoContainer.h>
+#include <g4main/PHG4VtxPoint.h>
+
+#include <fun4all/Fun4AllReturnCodes.h>
+
+#include <phool/PHCompositeNode.h>
+#include <phool/PHDataNode.h>
+#include <phool/PHNodeIterator.h>
+#include <phool/getClass.h>
+
+#include <iostream>  // for operator<<, endl, basic_ost...
+
+//____________________________________________________________________________..
+TruthReferenceReco::TruthReferenceReco(const std::string &name)
+  : SubsysReco(name)
+{
+}
+
+//____________________________________________________________________________..
+int TruthReferenceReco::Init(PHCompositeNode *topNode)
+{
+  if (!findNode::getClass<TruthReference>(topNode, NodeName()))
+  {
+    // derived from G4TruthInfo every event, a plain data node under PAR is
+    // not written by the output managers
+    PHNodeIterator iter(topNode);
+    PHCompositeNode *parNode = dynamic_cast<PHCompositeNode *>(iter.findFirst("PHCompositeNode", "PAR"));
+    if (!parNode)
+    {
+      std::cout << "TruthReferenceReco::Init - PAR node missing, cannot create " << NodeName() << std::endl;
+      return Fun4AllReturnCodes::ABORTRUN;
+    }
+    parNode->addNode(new PHDataNode<TruthReference>(new TruthReference(), NodeName()));
+  }
+  m_Timer = QAInstrumentation::instance()->Stage(Name());
+  return Fun4AllReturnCodes::EVENT_OK;
+}
+
+//____________________________________________________________________________..
+int TruthReferenceReco::process_event(PHCompositeNode *topNode)
+{
+  QAInstrumentation::Scope timer(m_Timer);
+  TruthReference *ref = findNode::getClass<TruthReference>(topNode, NodeName());
+  PHG4TruthInfoContainer *truthinfo = findNode::getClass<PHG4TruthInfoContainer>(topNode, "G4TruthInfo");
+  if (!ref || !truthinfo)
+  {
+    std::cout << "TruthReferenceReco::process_event - could not find " << (ref ? "G4TruthInfo" : NodeName()) << std::endl;
+    return Fun4AllReturnCodes::ABORTRUN;
+  }
+  ref->Reset();
+  m_NEvents++;
+
+  int nprimaries = 0;
+  double total_primary_energy = 0;
+  PHG4TruthInfoContainer::ConstRange range = truthinfo->GetPrimaryParticleRange();
+  for (PHG4TruthInfoContainer::ConstIterator iter = range.first; iter != range.second; ++iter)
+  {
+    nprimaries++;
+    total_primary_energy += iter->second->get_e();
+  }
+  if (nprimaries == 0)
+  {
+    m_NNoPrimary++;
+    return Fun4AllReturnCodes::EVENT_OK;
+  }
+  ref->set_primaries(nprimaries, total_primary_energy);
+
+  // the primaries have the highest track ids, the last one is the particle of single particle events
+  const PHG4Particle *last_primary = truthinfo->GetMap().rbegin()->second;
+  ref->set_primary(last_primary->get_track_id(), last_primary->get_pid(), last_primary->get_e(),
+                   last_primary->get_px(), last_primary->get_py(), last_primary->get_pz());
+  const PHG4VtxPoint *vtx = truthinfo->GetPrimaryVtx(last_primary->get_vtx_id());
+  if (!vtx)
+  {
+    // no projection frame without the vertex
+    m_NNoVertex++;
+    ref->Reset();
+    return Fun4AllReturnCodes::EVENT_OK;
+  }
+  ref->set_vertex(vtx->get_x(), vtx->get_y(), vtx->get_z(), vtx->get_t());
+  if (Verbosity() > 2)
+  {
+    ref->identify();
+  }
+  return Fun4AllReturnCodes::EVENT_OK;
+}
+
+//____________________________________________________________________________..
+int TruthReferenceReco::End(PHCompositeNode *topNode)
+{
+  if (m_NNoPrimary > 0 || m_NNoVertex > 0 || Verbosity() > 0)
+  {
+    Print();
+  }
+  QAInstrumentation::instance()->End();
+  return Fun4AllReturnCodes::EVENT_OK;
+}
+
+//____________________________________________________________________________..
+void TruthReferenceReco::Print(const std::string &what) const
+{
+  std::cout << "TruthReferenceReco: " << m_NEvents << " events, " << m_NNoPrimary
+            << " without primary particle, " << m_NNoVertex << " without primary vertex" << std::endl;
+}
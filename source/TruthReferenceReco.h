@@ -0,0 +1,57 @@
+// Tell emacs that this is a C++ source
+//  -*- C++ -*-.
+#ifndef TRUTHREFERENCERECO_H
+#define TRUTHREFERENCERECO_H
+
+#include <fun4all/SubsysReco.h>
+
+#include <string>
+
+class PHCompositeNode;
+
+//! Fills the TruthReference node once per event
+/*!
+ * The primary kinematics, the vertex of the last primary, the total primary
+ * energy and the projection frame are computed once here and shared by all
+ * QA and Eval modules (QAG4SimulationEicCalorimeter, its Sum,
+ * EvalRootTTreeReco, SamplingFractionReco) instead of each detector instance
+ * redoing it. It has to be registered before them, they stop the run in
+ * InitRun() if the node is missing. The node is created under PAR and is not
+ * written to the DST. Events without primaries or without the vertex of the
+ * last primary leave an invalid (isValid() == 0) reference, the modules skip
+ * their truth based histograms and branches for them.
+ */
+class TruthReferenceReco : public SubsysReco
+{
+ public:
+  TruthReferenceReco(const std::string &name = "TruthReferenceReco");
+
+  virtual ~TruthReferenceReco() {}
+
+  /** Called during initialization.
+      Creates the TruthReference node if it is not there yet.
+   */
+  int Init(PHCompositeNode *topNode) override;
+
+  /** Called for each event.
+      This is where you do the real work.
+   */
+  int process_event(PHCompositeNode *topNode) override;
+
+  /// Called at the end of all processing.
+  int End(PHCompositeNode *topNode) override;
+
+  void Print(const std::string &what = "ALL") const override;
+
+  //! name of the node read by the QA and Eval modules
+  static const char *NodeName() { return "TruthReference"; }
+
+ private:
+  int m_Timer = -1;  // QAInstrumentation stage
+
+  long long m_NEvents = 0;
+  long long m_NNoPrimary = 0;
+  long long m_NNoVertex = 0;
+};
+
+#endif  // TRUTHREFERENCERECO_H
@@ -0,0 +1,504 @@
+// Times the hot paths of the QA and Eval modules on synthetic calorimeter
+// events, no Geant4 needed:
+//
+//   qabenchmark [-n events] [-d distinct events] [-h hits] [-e eta bins]
+//               [-p phi bins] [-o tower occupancy] [-c clusters] [-s seed]
+//               [-b name filter] [-w output prefix] [-v]
+//
+// Every benchmark builds its own node tree, the content is regenerated
+// before each event (outside of the timing) from one of the distinct
+// events, so the numbers are reproducible for a given seed.
+// With -w the QA histograms (<prefix>_qa.root) and the Eval tree
+// (<prefix>_Eval_BENCHEVAL.root) are written, two builds run with the same
+// options can then be compared with QAGoldenCompare (QA_Golden.C).
+
+#include "EvalRootTTree.h"
+#include "EvalRootTTreeReco.h"
+#include "QAG4SimulationEicCalorimeter.h"
+#include "SamplingFractionReco.h"
+#include "TruthReferenceReco.h"
+
+#include <g4main/PHG4Hit.h>
+#include <g4main/PHG4HitContainer.h>
+#include <g4main/PHG4Hitv1.h>
+#include <g4main/PHG4Particlev2.h>
+#include <g4main/PHG4TruthInfoContainer.h>
+#include <g4main/PHG4VtxPointv1.h>
+
+#include <calobase/RawClusterContainer.h>
+#include <calobase/RawClusterv1.h>
+#include <calobase/RawTowerContainer.h>
+#include <calobase/RawTowerDefs.h>
+#include <calobase/RawTowerGeomContainer_Cylinderv1.h>
+#include <calobase/RawTowerGeomv1.h>
+#include <calobase/RawTowerv1.h>
+
+#include <fun4all/Fun4AllReturnCodes.h>
+#include <fun4all/Fun4AllServer.h>
+
+#include <qa_modules/QAHistManagerDef.h>
+
+#include <phool/PHCompositeNode.h>
+#include <phool/PHIODataNode.h>
+#include <phool/PHObject.h>
+#include <phool/getClass.h>
+
+#include <TFile.h>
+#include <TRandom3.h>
+#include <TTree.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>  // for operator<<, endl, basic_ost...
+#include <string>
+#include <unistd.h>
+
+namespace
+{
+  struct Options
+  {
+    int nevents = 1000;
+    int ndistinct = 10;
+    int nhits = 2000;
+    int netabins = 96;
+    int nphibins = 256;
+    double occupancy = 0.1;
+    int nclusters = 5;
+    unsigned int seed = 1;
+    std::string filter;
+    std::string output;
+    bool verbose = false;
+  };
+
+  typedef std::chrono::steady_clock Clock;
+
+  //! node tree of one calorimeter with G4 hits, towers, geometry, clusters, truth and its TruthReference
+  class SyntheticEvent
+  {
+   public:
+    SyntheticEvent(const std::string &det, const Options &opt)
+      : m_Options(opt)
+      , m_TopNode(new PHCompositeNode("TOP"))
+    {
+      PHCompositeNode *dstNode = new PHCompositeNode("DST");
+      PHCompositeNode *runNode = new PHCompositeNode("RUN");
+      PHCompositeNode *parNode = new PHCompositeNode("PAR");
+      m_TopNode->addNode(dstNode);
+      m_TopNode->addNode(runNode);
+      m_TopNode->addNode(parNode);
+
+      m_Truth = new PHG4TruthInfoContainer();
+      dstNode->addNode(new PHIODataNode<PHObject>(m_Truth, "G4TruthInfo", "PHObject"));
+      m_Hits = new PHG4HitContainer("G4HIT_" + det);
+      dstNode->addNode(new PHIODataNode<PHObject>(m_Hits, "G4HIT_" + det, "PHObject"));
+      m_AbsorberHits = new PHG4HitContainer("G4HIT_ABSORBER_" + det);
+      dstNode->addNode(new PHIODataNode<PHObject>(m_AbsorberHits, "G4HIT_ABSORBER_" + det, "PHObject"));
+      m_Towers = new RawTowerContainer(RawTowerDefs::CEMC);
+      dstNode->addNode(new PHIODataNode<PHObject>(m_Towers, "TOWER_CALIB_" + det, "PHObject"));
+      m_Clusters = new RawClusterContainer();
+      dstNode->addNode(new PHIODataNode<PHObject>(m_Clusters, "CLUSTER_" + det, "PHObject"));
+
+      // barrel like cylinder, r = 100 cm, |eta| < 1.1
+      m_Geom = new RawTowerGeomContainer_Cylinderv1(RawTowerDefs::CEMC);
+      m_Geom->set_radius(100);
+      m_Geom->set_thickness(20);
+      m_Geom->set_etabins(opt.netabins);
+      m_Geom->set_phibins(opt.nphibins);
+      const double etawidth = 2.2 / opt.netabins;
+      const double phiwidth = 2 * M_PI / opt.nphibins;
+      for (int ieta = 0; ieta < opt.netabins; ieta++)
+      {
+        m_Geom->set_etabounds(ieta, std::make_pair(-1.1 + ieta * etawidth, -1.1 + (ieta + 1) * etawidth));
+      }
+      for (int iphi = 0; iphi < opt.nphibins; iphi++)
+      {
+        m_Geom->set_phibounds(iphi, std::make_pair(-M_PI + iphi * phiwidth, -M_PI + (iphi + 1) * phiwidth));
+      }
+      for (int ieta = 0; ieta < opt.netabins; ieta++)
+      {
+        for (int iphi = 0; iphi < opt.nphibins; iphi++)
+        {
+          const double eta = m_Geom->get_etacenter(ieta);
+          const double phi = m_Geom->get_phicenter(iphi);
+          RawTowerGeomv1 *geom = new RawTowerGeomv1(RawTowerDefs::encode_towerid(RawTowerDefs::CEMC, ieta, iphi));
+          geom->set_center_x(110 * cos(phi));
+          geom->set_center_y(110 * sin(phi));
+          geom->set_center_z(110 * sinh(eta));
+          m_Geom->add_tower_geometry(geom);
+        }
+      }
+      runNode->addNode(new PHIODataNode<PHObject>(m_Geom, "TOWERGEOM_" + det, "PHObject"));
+    }
+
+    //! the node tree owns the containers
+    ~SyntheticEvent() { delete m_TopNode; }
+
+    PHCompositeNode *TopNode() const { return m_TopNode; }
+
+    //! creates the TruthReference node, returns the Fun4AllReturnCodes of TruthReferenceReco::Init()
+    int Init() { return m_TruthReference.Init(m_TopNode); }
+
+    //! refills the containers with distinct event ievent % ndistinct
+    void Generate(const int ievent)
+    {
+      TRandom3 rnd(m_Options.seed + (ievent % m_Options.ndistinct));
+      m_Truth->Reset();
+      m_Hits->Reset();
+      m_AbsorberHits->Reset();
+      m_Towers->Reset();
+      m_Clusters->Reset();
+
+      // single primary electron of 1 - 20 GeV
+      const double e = rnd.Uniform(1, 20);
+      const double eta = rnd.Uniform(-1, 1);
+      const double phi = rnd.Uniform(-M_PI, M_PI);
+      const double pt = e / cosh(eta);
+      PHG4VtxPointv1 *vtx = new PHG4VtxPointv1(0, 0, rnd.Gaus(0, 5), 0, 1);
+      m_Truth->AddVertex(1, vtx);
+      PHG4Particlev2 *particle = new PHG4Particlev2("e-", 11, pt * cos(phi), pt * sin(phi), pt * sinh(eta));
+      particle->set_e(e);
+      particle->set_vtx_id(1);
+      particle->set_track_id(1);
+      particle->set_primary_id(1);
+      particle->set_parent_id(0);
+      m_Truth->AddParticle(1, particle);
+
+      // shower around the primary direction, half in the absorber
+      for (int i = 0; i < m_Options.nhits; i++)
+      {
+        const double r = rnd.Uniform(100, 120);
+        const double hphi = phi + rnd.Gaus(0, 0.03);
+        const double heta = eta + rnd.Gaus(0, 0.03);
+        PHG4Hitv1 *hit = new PHG4Hitv1();
+        for (int j = 0; j < 2; j++)
+        {
+          hit->set_x(j, r * cos(hphi));
+          hit->set_y(j, r * sin(hphi));
+          hit->set_z(j, r * sinh(heta));
+          hit->set_t(j, rnd.Exp(5));
+        }
+        hit->set_edep(rnd.Exp(e / m_Options.nhits));
+        hit->set_eion(0.8 * hit->get_edep());
+        hit->set_light_yield(0.7 * hit->get_edep());
+        hit->set_trkid(1);
+        (i % 2 ? m_AbsorberHits : m_Hits)->AddHit(0, hit);
+      }
+
+      // random towers at the requested occupancy
+      for (int ieta = 0; ieta < m_Options.netabins; ieta++)
+      {
+        for (int iphi = 0; iphi < m_Options.nphibins; iphi++)
+        {
+          if (rnd.Rndm() >= m_Options.occupancy)
+          {
+            continue;
+          }
+          RawTowerv1 *tower = new RawTowerv1(ieta, iphi);
+          tower->set_energy(rnd.Exp(0.05));
+          m_Towers->AddTower(ieta, iphi, tower);
+        }
+      }
+
+      for (int i = 0; i < m_Options.nclusters; i++)
+      {
+        RawClusterv1 *cluster = new RawClusterv1();
+        cluster->set_energy(i == 0 ? 0.9 * e : rnd.Exp(0.2));
+        cluster->set_r(110);
+        cluster->set_phi(i == 0 ? phi : rnd.Uniform(-M_PI, M_PI));
+        cluster->set_z(110 * sinh(i == 0 ? eta : rnd.Uniform(-1, 1)));
+        m_Clusters->AddCluster(cluster);
+      }
+
+      // part of the event, as TruthReferenceReco runs once before all QA and Eval modules
+      m_TruthReference.process_event(m_TopNode);
+    }
+
+    PHG4HitContainer *Hits() const { return m_Hits; }
+
+   private:
+    Options m_Options;
+
+    PHCompositeNode *m_TopNode = nullptr;
+    PHG4TruthInfoContainer *m_Truth = nullptr;
+    PHG4HitContainer *m_Hits = nullptr;
+    PHG4HitContainer *m_AbsorberHits = nullptr;
+    RawTowerContainer *m_Towers = nullptr;
+    RawTowerGeomContainer_Cylinderv1 *m_Geom = nullptr;
+    RawClusterContainer *m_Clusters = nullptr;
+    TruthReferenceReco m_TruthReference;
+  };
+
+  //! runs the timed part once per event, the event is generated before (not timed)
+  void Run(const std::string &name, const Options &opt, SyntheticEvent &evt, const std::function<void()> &timed, const std::function<void()> &after = nullptr)
+  {
+    Clock::duration total(0);
+    for (int i = 0; i < opt.nevents; i++)
+    {
+      evt.Generate(i);
+      const Clock::time_point start = Clock::now();
+      timed();
+      total += Clock::now() - start;
+      if (after)
+      {
+        after();
+      }
+    }
+    const double seconds = std::chrono::duration<double>(total).count();
+    std::cout << std::setw(55) << std::left << name << std::right
+              << std::setw(10) << opt.nevents
+              << std::setw(12) << std::fixed << std::setprecision(3) << seconds
+              << std::setw(14) << std::setprecision(1) << (seconds > 0 ? opt.nevents / seconds : 0.)
+              << std::setw(14) << std::setprecision(2) << 1e6 * seconds / opt.nevents
+              << std::defaultfloat << std::setprecision(6) << std::endl;
+  }
+
+  bool Selected(const Options &opt, const std::string &name)
+  {
+    return opt.filter.empty() || name.find(opt.filter) != std::string::npos;
+  }
+
+  //! false with an error message if a module did not set up, the benchmark would only time aborts
+  bool Check(const std::string &name, const std::string &step, const int ret)
+  {
+    if (ret != Fun4AllReturnCodes::EVENT_OK)
+    {
+      std::cout << "qabenchmark: " << name << " - " << step << " failed with return code " << ret << std::endl;
+      return false;
+    }
+    return true;
+  }
+
+  bool BenchQAG4Hit(const Options &opt)
+  {
+    const std::string name = "QAG4SimulationEicCalorimeter::process_event_G4Hit";
+    if (!Selected(opt, name))
+    {
+      return true;
+    }
+    SyntheticEvent evt("BENCHG4HIT", opt);
+    if (!Check(name, "TruthReferenceReco::Init", evt.Init()))
+    {
+      return false;
+    }
+    QAG4SimulationEicCalorimeter qa("BENCHG4HIT", QAG4SimulationEicCalorimeter::kProcessG4Hit);
+    if (!Check(name, "Init", qa.Init(evt.TopNode())))
+    {
+      return false;
+    }
+    evt.Generate(0);
+    if (!Check(name, "InitRun", qa.InitRun(evt.TopNode())))
+    {
+      return false;
+    }
+    Run(name, opt, evt, [&]() { qa.process_event(evt.TopNode()); });
+    qa.End(evt.TopNode());
+    return true;
+  }
+
+  bool BenchQATower(const Options &opt)
+  {
+    const std::string name = "QAG4SimulationEicCalorimeter::process_event_Tower";
+    if (!Selected(opt, name))
+    {
+      return true;
+    }
+    SyntheticEvent evt("BENCHTOWER", opt);
+    if (!Check(name, "TruthReferenceReco::Init", evt.Init()))
+    {
+      return false;
+    }
+    QAG4SimulationEicCalorimeter qa("BENCHTOWER", QAG4SimulationEicCalorimeter::kProcessTower);
+    if (!Check(name, "Init", qa.Init(evt.TopNode())))
+    {
+      return false;
+    }
+    evt.Generate(0);
+    if (!Check(name, "InitRun", qa.InitRun(evt.TopNode())))
+    {
+      return false;
+    }
+    Run(name, opt, evt, [&]() { qa.process_event(evt.TopNode()); });
+    qa.End(evt.TopNode());
+    return true;
+  }
+
+  bool BenchEvalReco(const Options &opt)
+  {
+    const std::string name = "EvalRootTTreeReco::process_event";
+    if (!Selected(opt, name))
+    {
+      return true;
+    }
+    SyntheticEvent evt("BENCHEVAL", opt);
+    if (!Check(name, "TruthReferenceReco::Init", evt.Init()))
+    {
+      return false;
+    }
+    EvalRootTTreeReco eval("BENCHEVAL");
+    eval.Detector("BENCHEVAL");
+    if (!Check(name, "Init", eval.Init(evt.TopNode())) || !Check(name, "InitRun", eval.InitRun(evt.TopNode())))
+    {
+      return false;
+    }
+    EvalRootTTree *evaltree = findNode::getClass<EvalRootTTree>(evt.TopNode(), "EvalTTree_BENCHEVAL");
+
+    // same tree and branch name as the DST output of the Eval macros
+    TFile *fout = nullptr;
+    TTree *tree = nullptr;
+    if (!opt.output.empty())
+    {
+      fout = TFile::Open((opt.output + "_Eval_BENCHEVAL.root").c_str(), "RECREATE");
+      tree = new TTree("T", "qabenchmark Eval tree");
+      tree->Branch("DST#EvalTTree_BENCHEVAL", &evaltree, 32000, 99);
+    }
+    // the output node is reset by the server between events
+    Run(
+        name, opt, evt, [&]() { eval.process_event(evt.TopNode()); }, [&]() {
+          if (tree)
+          {
+            tree->Fill();
+          }
+          evaltree->Reset();
+        });
+    eval.End(evt.TopNode());
+    if (fout)
+    {
+      fout->Write();
+      fout->Close();
+      delete fout;
+    }
+    return true;
+  }
+
+  bool BenchEvalTree(const Options &opt)
+  {
+    const std::string name = "EvalRootTTree::AddHit/Reset";
+    if (!Selected(opt, name))
+    {
+      return true;
+    }
+    SyntheticEvent evt("BENCHTREE", opt);
+    EvalRootTTree evaltree;
+    Run(name, opt, evt, [&]() {
+      PHG4HitContainer::ConstRange hit_range = evt.Hits()->getHits();
+      for (PHG4HitContainer::ConstIterator hit_iter = hit_range.first; hit_iter != hit_range.second; hit_iter++)
+      {
+        evaltree.AddHit(hit_iter->second);
+      }
+      evaltree.Reset();
+    });
+    return true;
+  }
+
+  bool BenchSamplingFraction(const Options &opt)
+  {
+    const std::string name = "SamplingFractionReco::process_event";
+    if (!Selected(opt, name))
+    {
+      return true;
+    }
+    const std::string outfile = "qabenchmark_SamplingFraction.root";
+    SyntheticEvent evt("BENCHSF", opt);
+    if (!Check(name, "TruthReferenceReco::Init", evt.Init()))
+    {
+      return false;
+    }
+    SamplingFractionReco sf("BENCHSF", outfile);
+    sf.Detector("BENCHSF");
+    if (!Check(name, "Init", sf.Init(evt.TopNode())) || !Check(name, "InitRun", sf.InitRun(evt.TopNode())))
+    {
+      std::remove(outfile.c_str());
+      return false;
+    }
+    Run(name, opt, evt, [&]() { sf.process_event(evt.TopNode()); });
+    sf.End(evt.TopNode());
+    std::remove(outfile.c_str());
+    return true;
+  }
+
+  void Usage(const char *prog)
+  {
+    std::cout << "usage: " << prog << " [-n events] [-d distinct events] [-h hits] [-e eta bins] [-p phi bins]"
+              << " [-o tower occupancy] [-c clusters] [-s seed] [-b name filter] [-w output prefix] [-v]" << std::endl;
+  }
+}  // namespace
+
+int main(int argc, char *argv[])
+{
+  Options opt;
+  int c;
+  while ((c = getopt(argc, argv, "n:d:h:e:p:o:c:s:b:w:v")) != -1)
+  {
+    switch (c)
+    {
+    case 'n':
+      opt.nevents = atoi(optarg);
+      break;
+    case 'd':
+      opt.ndistinct = atoi(optarg);
+      break;
+    case 'h':
+      opt.nhits = atoi(optarg);
+      break;
+    case 'e':
+      opt.netabins = atoi(optarg);
+      break;
+    case 'p':
+      opt.nphibins = atoi(optarg);
+      break;
+    case 'o':
+      opt.occupancy = atof(optarg);
+      break;
+    case 'c':
+      opt.nclusters = atoi(optarg);
+      break;
+    case 's':
+      opt.seed = strtoul(optarg, nullptr, 10);
+      break;
+    case 'b':
+      opt.filter = optarg;
+      break;
+    case 'w':
+      opt.output = optarg;
+      break;
+    case 'v':
+      opt.verbose = true;
+      break;
+    default:
+      Usage(argv[0]);
+      return 1;
+    }
+  }
+  if (opt.nevents <= 0 || opt.ndistinct <= 0 || opt.nhits < 0 || opt.netabins <= 0 || opt.nphibins <= 0)
+  {
+    Usage(argv[0]);
+    return 1;
+  }
+
+  // the QA modules register their histograms with the server's histogram manager
+  Fun4AllServer *se = Fun4AllServer::instance();
+  se->Verbosity(opt.verbose ? 1 : 0);
+
+  std::cout << "qabenchmark: " << opt.nevents << " events (" << opt.ndistinct << " distinct), "
+            << opt.nhits << " G4 hits, " << opt.netabins << " x " << opt.nphibins << " towers at occupancy "
+            << opt.occupancy << ", " << opt.nclusters << " clusters, seed " << opt.seed << std::endl;
+  std::cout << std::setw(55) << std::left << "benchmark" << std::right
+            << std::setw(10) << "events" << std::setw(12) << "time (s)"
+            << std::setw(14) << "events/s" << std::setw(14) << "us/event" << std::endl;
+
+  // a module which does not set up stops the benchmark, no golden output is written
+  if (!BenchQAG4Hit(opt) || !BenchQATower(opt) || !BenchEvalReco(opt) || !BenchEvalTree(opt) || !BenchSamplingFraction(opt))
+  {
+    return 1;
+  }
+
+  if (!opt.output.empty())
+  {
+    QAHistManagerDef::saveQARootFile(opt.output + "_qa.root");
+  }
+  return 0;
+}
@@ -0,0 +1,171 @@
+// Plans a calorimeter scan by the measured cost per event and runs it on
+// the cores of this machine:
+//
+//   qascan plan [-j jobs | -t seconds per job] [-c cost file] [-d default cost]
+//               [-o plan file] [-v] <scan file>
+//   qascan run  [-p processes] [-m macro dir] [-w output dir] [-x command]
+//               [-b Combiner.csh dir] [-c cost file] [-v] <plan file>
+//
+// The scan file has one point per line:
+//   particle emin emax etamin etamax detector nevents
+// detector selects macros/Fun4All_G4_<detector>.C (EICDetector = all).
+// plan splits the points into jobs of about equal run time (ScanPlanner),
+// run executes them (ScanRunner) in the directory layout of the condor
+// jobs, afterwards Combiner.csh in the output directory merges them as
+// usual. The run times of the jobs go to the cost file (default
+// scan_costs.txt), the next plan uses them.
+
+#include "ScanPlanner.h"
+#include "ScanRunner.h"
+
+#include <cstdlib>
+#include <iostream>  // for operator<<, endl, basic_ost...
+#include <string>
+#include <unistd.h>
+
+namespace
+{
+  void Usage(const char *prog)
+  {
+    std::cout << "usage: " << prog << " plan [-j jobs | -t seconds per job] [-c cost file] [-d default cost]"
+              << " [-o plan file] [-v] <scan file>" << std::endl;
+    std::cout << "       " << prog << " run [-p processes] [-m macro dir] [-w output dir] [-x command]"
+              << " [-b Combiner.csh dir] [-c cost file] [-v] <plan file>" << std::endl;
+  }
+
+  int Plan(int argc, char *argv[])
+  {
+    ScanPlanner planner;
+    std::string costfile = "scan_costs.txt";
+    std::string planfile = "scan_plan.txt";
+    bool verbose = false;
+    int c;
+    while ((c = getopt(argc, argv, "j:t:c:d:o:v")) != -1)
+    {
+      switch (c)
+      {
+      case 'j':
+        planner.SetNJobs(atoi(optarg));
+        break;
+      case 't':
+        planner.SetTargetTime(atof(optarg));
+        break;
+      case 'c':
+        costfile = optarg;
+        break;
+      case 'd':
+        planner.DefaultCost(atof(optarg));
+        break;
+      case 'o':
+        planfile = optarg;
+        break;
+      case 'v':
+        verbose = true;
+        break;
+      default:
+        return -1;
+      }
+    }
+    if (optind + 1 != argc)
+    {
+      return -1;
+    }
+    if (planner.ReadScan(argv[optind]) <= 0 || planner.ReadCosts(costfile) < 0)
+    {
+      return 1;
+    }
+    if (planner.Plan() <= 0 || planner.WritePlan(planfile))
+    {
+      return 1;
+    }
+    planner.Print(verbose ? "ALL" : "SUMMARY");
+    std::cout << "qascan: plan written to " << planfile << std::endl;
+    return 0;
+  }
+
+  int Run(int argc, char *argv[])
+  {
+    std::string macrodir = "macros";
+    std::string outdir = "scan";
+    std::string costfile = "scan_costs.txt";
+    std::string command;
+    std::string combinerdir = ".";
+    unsigned int nprocesses = 0;
+    bool verbose = false;
+    int c;
+    while ((c = getopt(argc, argv, "p:m:w:x:b:c:v")) != -1)
+    {
+      switch (c)
+      {
+      case 'p':
+        nprocesses = strtoul(optarg, nullptr, 10);
+        break;
+      case 'm':
+        macrodir = optarg;
+        break;
+      case 'w':
+        outdir = optarg;
+        break;
+      case 'x':
+        command = optarg;
+        break;
+      case 'b':
+        combinerdir = optarg;
+        break;
+      case 'c':
+        costfile = optarg;
+        break;
+      case 'v':
+        verbose = true;
+        break;
+      default:
+        return -1;
+      }
+    }
+    if (optind + 1 != argc)
+    {
+      return -1;
+    }
+    ScanPlanner planner;
+    if (planner.ReadPlan(argv[optind]) || planner.Jobs().empty())
+    {
+      return 1;
+    }
+    ScanRunner runner(macrodir, outdir);
+    runner.SetNProcesses(nprocesses);
+    runner.SetCombinerDir(combinerdir);
+    runner.SetCostFile(costfile);
+    if (!command.empty())
+    {
+      runner.SetCommand(command);
+    }
+    runner.Verbosity(verbose ? 1 : 0);
+    const int failed = runner.Run(planner.Jobs());
+    runner.Print();
+    if (failed < 0)
+    {
+      return 1;
+    }
+    return (failed > 0) ? 2 : 0;
+  }
+}  // namespace
+
+int main(int argc, char *argv[])
+{
+  const std::string mode = (argc > 1) ? argv[1] : "";
+  int iret = -1;
+  if (mode == "plan")
+  {
+    iret = Plan(argc - 1, argv + 1);
+  }
+  else if (mode == "run")
+  {
+    iret = Run(argc - 1, argv + 1);
+  }
+  if (iret < 0)
+  {
+    Usage(argv[0]);
+    return 1;
+  }
+  return iret;
+}